@@ -0,0 +1,449 @@
+#include "vr_telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/time.h>
+
+// Producer hot-path microbenchmarks.
+//
+// Every benchmark times each operation individually into a vr_histogram_t
+// (for percentiles) and the whole run (for ns/op). Results can be written as
+// JSON or CSV and compared against a previous CSV run to catch regressions.
+
+#define BENCH_MAX_RESULTS 32       // Room for every bench in main(), broker ones included
+#define BENCH_MAX_NAME 32
+#define BENCH_SAMPLE_FRAMES 256    // Distinct frames cycled through by the encoders
+#define BENCH_SYNTH_FRAMES 64      // Timesteps per synthesis operation
+
+typedef struct {
+    char name[BENCH_MAX_NAME];
+    uint64_t iterations;
+    double ns_per_op;
+    double p50_ns;
+    double p99_ns;
+    double p999_ns;
+    double bytes_per_frame;        // 0 when not applicable
+} bench_result_t;
+
+static bench_result_t g_results[BENCH_MAX_RESULTS];
+static uint32_t g_result_count = 0;
+static uint32_t g_results_dropped = 0;  // Benches that ran but did not fit in g_results
+
+static vr_telemetry_packet_t g_frames[BENCH_SAMPLE_FRAMES];
+static uint8_t g_buffer[VR_BATCH_MAX_MESSAGE_SIZE];
+static volatile uint64_t g_sink;   // Keeps results observable to the compiler
+
+static uint64_t g_iterations = 100000;
+static uint32_t g_warmup = 1000;
+static uint32_t g_batch_frames = 20;
+
+typedef int (*bench_op_t)(uint64_t i);
+
+// Run one benchmark and store its result
+static void bench_run(const char *name, bench_op_t op, uint32_t frames_per_op) {
+    static vr_histogram_t hist;
+    memset(&hist, 0, sizeof(hist));
+
+    for (uint32_t i = 0; i < g_warmup; i++) {
+        op(i);
+    }
+
+    uint64_t bytes = 0;
+    uint64_t start = vr_get_monotonic_ns();
+    for (uint64_t i = 0; i < g_iterations; i++) {
+        uint64_t t0 = vr_get_monotonic_ns();
+        int len = op(i);
+        vr_histogram_record(&hist, vr_get_monotonic_ns() - t0);
+        if (len > 0) bytes += (uint64_t)len;
+    }
+    uint64_t elapsed = vr_get_monotonic_ns() - start;
+
+    bench_result_t result;
+    bench_result_t *r = &result;
+    memset(r, 0, sizeof(*r));
+    strncpy(r->name, name, sizeof(r->name) - 1);
+    r->iterations = g_iterations;
+    r->ns_per_op = (double)elapsed / g_iterations;
+    r->p50_ns = (double)vr_histogram_percentile(&hist, 50.0);
+    r->p99_ns = (double)vr_histogram_percentile(&hist, 99.0);
+    r->p999_ns = (double)vr_histogram_percentile(&hist, 99.9);
+    r->bytes_per_frame = frames_per_op ? (double)bytes / g_iterations / frames_per_op : 0.0;
+
+    printf("%-22s %10.1f ns/op  p50 %9.0f  p99 %9.0f  p99.9 %9.0f ns", r->name,
+           r->ns_per_op, r->p50_ns, r->p99_ns, r->p999_ns);
+    if (r->bytes_per_frame > 0) {
+        printf("  %7.1f B/frame", r->bytes_per_frame);
+    }
+    printf("\n");
+
+    // Never drop a result quietly: it would vanish from JSON/CSV and --baseline
+    if (g_result_count >= BENCH_MAX_RESULTS) {
+        fprintf(stderr, "Result table full (BENCH_MAX_RESULTS=%d), %s not recorded\n",
+                BENCH_MAX_RESULTS, name);
+        g_results_dropped++;
+        return;
+    }
+    g_results[g_result_count++] = result;
+}
+
+// Pick the batch starting point for iteration i
+static const vr_telemetry_packet_t *bench_batch(uint64_t i) {
+    return &g_frames[(i * g_batch_frames) % (BENCH_SAMPLE_FRAMES - g_batch_frames + 1)];
+}
+
+static int op_timestamp(uint64_t i) {
+    (void)i;
+    g_sink += vr_get_timestamp_us();
+    return 0;
+}
+
+// Reference: the gettimeofday() timestamp frames used before vr_clock
+static int op_timestamp_gettimeofday(uint64_t i) {
+    (void)i;
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    g_sink += (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+    return 0;
+}
+
+static int op_sensors_update(uint64_t i) {
+    (void)i;
+    vr_sensors_update();
+    return 0;
+}
+
+// Windowed statistics cost the same at any depth; bench a deep history
+static vr_sensor_history_t g_history;
+
+static int op_history_record(uint64_t i) {
+    vr_history_record(&g_history, &g_frames[i % BENCH_SAMPLE_FRAMES]);
+    return 0;
+}
+
+// One Euro, the most expensive telemetry filter, fed one sample
+static vr_filter_t g_filter;
+
+static int op_filter_one_euro(uint64_t i) {
+    vr_filter_update(&g_filter, &g_frames[i % BENCH_SAMPLE_FRAMES]);
+    return 0;
+}
+
+// Latest-sample snapshot as read by another thread
+static vr_packet_snapshot_t g_snapshot;
+
+static int op_snapshot_read(uint64_t i) {
+    vr_telemetry_packet_t packet;
+    (void)i;
+    vr_snapshot_read(&g_snapshot, &packet);
+    g_sink += packet.frame_id;
+    return 0;
+}
+
+// Transpose a batch of frames into columns
+static vr_packet_columns_t g_columns;
+
+static int op_columns_load(uint64_t i) {
+    g_sink += vr_columns_load(&g_columns, bench_batch(i), g_batch_frames);
+    return 0;
+}
+
+// One device over BENCH_SYNTH_FRAMES timesteps, with the kernel set by vr_synth_select()
+static vr_device_t g_synth_device;
+static vr_telemetry_packet_t g_synth_frames[BENCH_SYNTH_FRAMES];
+
+static int op_synth(uint64_t i) {
+    (void)i;
+    vr_device_generate(&g_synth_device, g_synth_frames, BENCH_SYNTH_FRAMES);
+    g_sink += g_synth_frames[BENCH_SYNTH_FRAMES - 1].battery_level;
+    return 0;
+}
+
+static int op_encode_json(uint64_t i) {
+    return vr_codec_encode_json(&g_frames[i % BENCH_SAMPLE_FRAMES], (char *)g_buffer, sizeof(g_buffer));
+}
+
+static int op_encode_json_printf(uint64_t i) {
+    return vr_codec_encode_json_printf(&g_frames[i % BENCH_SAMPLE_FRAMES], (char *)g_buffer, sizeof(g_buffer));
+}
+
+static int op_encode_binary(uint64_t i) {
+    return vr_codec_encode_binary(&g_frames[i % BENCH_SAMPLE_FRAMES], g_buffer, sizeof(g_buffer));
+}
+
+static int op_encode_json_batch(uint64_t i) {
+    return vr_codec_encode_json_batch(bench_batch(i), g_batch_frames, VR_SECTION_ALL,
+                                      (char *)g_buffer, sizeof(g_buffer));
+}
+
+static int op_encode_binary_batch(uint64_t i) {
+    return vr_codec_encode_binary_batch(bench_batch(i), g_batch_frames, VR_SECTION_ALL,
+                                        g_buffer, sizeof(g_buffer));
+}
+
+// Consecutive iterations encode consecutive frames, so deltas stay realistic
+static vr_delta_encoder_t g_delta_encoder;
+
+static int op_encode_delta_batch(uint64_t i) {
+    return vr_delta_encode_batch(&g_delta_encoder, bench_batch(i), g_batch_frames, VR_SECTION_ALL,
+                                 g_buffer, sizeof(g_buffer));
+}
+
+// Null sink: the publisher path from ring to encoded message, minus the socket
+static vr_packet_ring_t g_ring;
+static vr_batch_t g_batch;
+static vr_wire_format_t g_null_format = VR_WIRE_FORMAT_JSON;
+
+static int op_null_publish(uint64_t i) {
+    vr_telemetry_packet_t packet;
+    int len = 0;
+
+    for (uint32_t n = 0; n < g_batch_frames; n++) {
+        vr_ring_push(&g_ring, &g_frames[(i + n) % BENCH_SAMPLE_FRAMES]);
+    }
+    while (vr_ring_pop(&g_ring, &packet)) {
+        if (vr_batch_add(&g_batch, &packet, 0)) {
+            if (g_null_format == VR_WIRE_FORMAT_BINARY) {
+                len = vr_codec_encode_binary_batch(g_batch.frames, g_batch.count, VR_SECTION_ALL,
+                                                   g_buffer, sizeof(g_buffer));
+            } else {
+                len = vr_codec_encode_json_batch(g_batch.frames, g_batch.count, VR_SECTION_ALL,
+                                                 (char *)g_buffer, sizeof(g_buffer));
+            }
+            g_sink += g_buffer[len > 0 ? len - 1 : 0];
+            vr_batch_reset(&g_batch);
+        }
+    }
+    return len;
+}
+
+static int op_broker_publish(uint64_t i) {
+    return vr_rabbitmq_send_batch(bench_batch(i), g_batch_frames) == 0 ? 0 : -1;
+}
+
+// Write results as JSON
+static int bench_write_json(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "{\"iterations\":%lu,\"batch_frames\":%u,\"results\":[", g_iterations, g_batch_frames);
+    for (uint32_t i = 0; i < g_result_count; i++) {
+        const bench_result_t *r = &g_results[i];
+        fprintf(f, "%s\n  {\"name\":\"%s\",\"iterations\":%lu,\"ns_per_op\":%.1f,"
+                   "\"p50_ns\":%.0f,\"p99_ns\":%.0f,\"p999_ns\":%.0f,\"bytes_per_frame\":%.1f}",
+                i > 0 ? "," : "", r->name, r->iterations, r->ns_per_op,
+                r->p50_ns, r->p99_ns, r->p999_ns, r->bytes_per_frame);
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// Write results as CSV
+static int bench_write_csv(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "name,iterations,ns_per_op,p50_ns,p99_ns,p999_ns,bytes_per_frame\n");
+    for (uint32_t i = 0; i < g_result_count; i++) {
+        const bench_result_t *r = &g_results[i];
+        fprintf(f, "%s,%lu,%.1f,%.0f,%.0f,%.0f,%.1f\n", r->name, r->iterations,
+                r->ns_per_op, r->p50_ns, r->p99_ns, r->p999_ns, r->bytes_per_frame);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// Compare ns/op against a baseline CSV; returns the number of regressions
+static int bench_compare(const char *path, double threshold_pct) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open baseline %s\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int regressions = 0;
+    printf("\nBaseline comparison (%s, threshold %.0f%%):\n", path, threshold_pct);
+    while (fgets(line, sizeof(line), f)) {
+        char name[BENCH_MAX_NAME];
+        unsigned long iterations;
+        double ns_per_op;
+        if (sscanf(line, "%31[^,],%lu,%lf", name, &iterations, &ns_per_op) != 3) {
+            continue;  // Header or malformed line
+        }
+
+        for (uint32_t i = 0; i < g_result_count; i++) {
+            if (strcmp(g_results[i].name, name) != 0) continue;
+
+            double change = (g_results[i].ns_per_op - ns_per_op) / ns_per_op * 100.0;
+            bool regressed = change > threshold_pct;
+            printf("  %-22s %10.1f -> %10.1f ns/op  %+6.1f%%%s\n", name, ns_per_op,
+                   g_results[i].ns_per_op, change, regressed ? "  REGRESSION" : "");
+            if (regressed) regressions++;
+        }
+    }
+    fclose(f);
+    return regressions;
+}
+
+// Print usage information
+static void print_usage(const char *program_name) {
+    printf("VR Telemetry Producer Benchmarks\n");
+    printf("Usage: %s [OPTIONS]\n", program_name);
+    printf("\nOptions:\n");
+    printf("  -n, --iterations N     Timed iterations per benchmark (default: 100000)\n");
+    printf("  -b, --batch-size N     Frames per batched message (default: 20)\n");
+    printf("  -o, --output FILE      Write results as JSON\n");
+    printf("  -c, --csv FILE         Write results as CSV\n");
+    printf("  -B, --baseline FILE    Compare against a CSV baseline, exit 1 on regression\n");
+    printf("  -T, --threshold PCT    Allowed ns/op increase over the baseline (default: 10)\n");
+    printf("  -h, --host HOST        Also benchmark publishing to a RabbitMQ broker\n");
+    printf("  -p, --port PORT        RabbitMQ port (default: 5672)\n");
+    printf("      --help             Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *json_path = NULL;
+    const char *csv_path = NULL;
+    const char *baseline_path = NULL;
+    const char *host = NULL;
+    int port = 5672;
+    double threshold_pct = 10.0;
+
+    static struct option long_options[] = {
+        {"iterations", required_argument, 0, 'n'},
+        {"batch-size", required_argument, 0, 'b'},
+        {"output", required_argument, 0, 'o'},
+        {"csv", required_argument, 0, 'c'},
+        {"baseline", required_argument, 0, 'B'},
+        {"threshold", required_argument, 0, 'T'},
+        {"host", required_argument, 0, 'h'},
+        {"port", required_argument, 0, 'p'},
+        {"help", no_argument, 0, 0},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    int option_index = 0;
+    while ((opt = getopt_long(argc, argv, "n:b:o:c:B:T:h:p:", long_options, &option_index)) != -1) {
+        switch (opt) {
+            case 'n': g_iterations = strtoull(optarg, NULL, 10); break;
+            case 'b': g_batch_frames = atoi(optarg); break;
+            case 'o': json_path = optarg; break;
+            case 'c': csv_path = optarg; break;
+            case 'B': baseline_path = optarg; break;
+            case 'T': threshold_pct = atof(optarg); break;
+            case 'h': host = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 0:
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (g_iterations == 0) g_iterations = 1;
+    if (g_batch_frames < 1) g_batch_frames = 1;
+    if (g_batch_frames > BENCH_SAMPLE_FRAMES / 2) g_batch_frames = BENCH_SAMPLE_FRAMES / 2;
+
+    // Bring up the simulator (sensors, telemetry ring) without a broker
+    vr_embedded_config_t config = {
+        .system_clock_hz = 168000000,
+        .sensor_update_hz = 1000,
+        .telemetry_rate_hz = 60,
+        .telemetry_batch_size = g_batch_frames,
+        .telemetry_batch_window_us = 0,
+        .telemetry_ring_depth = 1024,
+        .telemetry_ring_policy = VR_RING_DROP_OLDEST,
+        .telemetry_spill_depth = 16,
+        .telemetry_spill_max_age_ms = 0,
+        .watchdog_enabled = false,
+        .power_save_enabled = false,
+    };
+    vr_embedded_init(&config, false);
+
+    // Realistic, varying frames for the encoders
+    for (uint32_t i = 0; i < BENCH_SAMPLE_FRAMES; i++) {
+        vr_sensors_update();
+        vr_sensors_get_packet(&g_frames[i]);
+    }
+
+    printf("\n%lu iterations, %u frames per batch\n\n", g_iterations, g_batch_frames);
+
+    bench_run("timestamp", op_timestamp, 0);
+    bench_run("timestamp_gettimeofday", op_timestamp_gettimeofday, 0);
+    bench_run("sensors_update", op_sensors_update, 0);
+    if (vr_history_init(&g_history, 4096) == 0) {
+        bench_run("history_record", op_history_record, 1);
+        vr_history_destroy(&g_history);
+    }
+    vr_filter_config_t filter_config = { .kind = VR_FILTER_ONE_EURO, .beta = VR_ONE_EURO_DEFAULT_BETA };
+    vr_filter_init(&g_filter, &filter_config, config.sensor_update_hz, config.telemetry_rate_hz);
+    bench_run("filter_one_euro", op_filter_one_euro, 1);
+    vr_snapshot_publish(&g_snapshot, &g_frames[0]);
+    bench_run("snapshot_read", op_snapshot_read, 0);
+    bench_run("columns_load_batch", op_columns_load, g_batch_frames);
+    vr_device_init(&g_synth_device, 0, config.sensor_update_hz);
+    vr_synth_select("scalar");
+    bench_run("synth_scalar_x64", op_synth, 0);
+    vr_synth_select("auto");
+    printf("(synth_simd_x64 uses the %s kernel)\n", vr_synth_get_isa());
+    bench_run("synth_simd_x64", op_synth, 0);
+    bench_run("encode_json", op_encode_json, 1);
+    bench_run("encode_json_printf", op_encode_json_printf, 1);
+    bench_run("encode_binary", op_encode_binary, 1);
+    bench_run("encode_json_batch", op_encode_json_batch, g_batch_frames);
+    bench_run("encode_binary_batch", op_encode_binary_batch, g_batch_frames);
+    vr_delta_init(&g_delta_encoder, VR_DELTA_DEFAULT_KEYFRAME_INTERVAL,
+                  VR_DELTA_DEFAULT_POSITION_UM, VR_DELTA_DEFAULT_QUAT_BITS);
+    bench_run("encode_delta_batch", op_encode_delta_batch, g_batch_frames);
+
+    if (vr_ring_init(&g_ring, g_batch_frames * 2, VR_RING_DROP_NEWEST) == 0) {
+        vr_batch_init(&g_batch, g_batch_frames, 0);
+        g_null_format = VR_WIRE_FORMAT_JSON;
+        bench_run("null_publish_json", op_null_publish, g_batch_frames);
+        g_null_format = VR_WIRE_FORMAT_BINARY;
+        bench_run("null_publish_binary", op_null_publish, g_batch_frames);
+        vr_ring_destroy(&g_ring);
+    }
+
+    // Stop the publisher thread so the benchmark owns the broker connection
+    vr_telemetry_shutdown();
+
+    if (host) {
+        vr_rabbitmq_set_delivery_mode(VR_DELIVERY_TRANSIENT);
+        if (vr_rabbitmq_init(host, port, "guest", "guest", "/", "vr_telemetry", "bench.data") == 0) {
+            vr_rabbitmq_set_wire_format(VR_WIRE_FORMAT_JSON);
+            bench_run("broker_publish_json", op_broker_publish, 0);
+            vr_rabbitmq_set_wire_format(VR_WIRE_FORMAT_BINARY);
+            bench_run("broker_publish_binary", op_broker_publish, 0);
+            vr_rabbitmq_close();
+        } else {
+            fprintf(stderr, "Broker %s:%d unavailable, skipping publish benchmarks\n", host, port);
+        }
+    }
+
+    if (g_results_dropped > 0) {
+        fprintf(stderr, "%u benchmark result(s) were not recorded; raise BENCH_MAX_RESULTS\n",
+                g_results_dropped);
+        return 1;
+    }
+
+    if (json_path && bench_write_json(json_path) != 0) {
+        fprintf(stderr, "Failed to write %s\n", json_path);
+        return 1;
+    }
+    if (csv_path && bench_write_csv(csv_path) != 0) {
+        fprintf(stderr, "Failed to write %s\n", csv_path);
+        return 1;
+    }
+    if (baseline_path) {
+        int regressions = bench_compare(baseline_path, threshold_pct);
+        if (regressions != 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
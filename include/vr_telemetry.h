@@ -3,8 +3,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <time.h>
 
+#define VR_CACHE_LINE_SIZE            64
+
 // VR Sensor Data Types
 typedef struct {
     float x, y, z;  // 3D position in meters
@@ -25,44 +28,692 @@ typedef struct {
 typedef struct {
     float x, y;  // Eye gaze position (normalized coordinates)
     float pupil_diameter;  // Pupil diameter in mm
-    bool is_blinking;
-} vr_eye_tracking_t;
+} vr_eye_tracking_t;  // Blinking: VR_WIRE_FLAG_*_BLINKING in the packet flags
 
 typedef struct {
     float x, y, z;  // Hand position in meters
     vr_orientation_t orientation;  // Hand orientation
     float grip_strength;  // 0.0 to 1.0
-    bool is_tracking;
-} vr_hand_tracking_t;
+} vr_hand_tracking_t;  // Tracking: VR_WIRE_FLAG_*_TRACKING in the packet flags
 
 // Main VR Telemetry Packet
+// Laid out by access, one cache line per group: line 0 is the head with the
+// frame id and sample time, which the sampling loop, filters and history
+// touch on every update; line 1 is both hands; line 2 the eyes, system status
+// and the wall-clock timestamp. Every byte is a named field (no implicit
+// padding, so packets compare and copy byte-for-byte), the booleans share one
+// flags byte, and the layout is checked at compile time below.
 typedef struct {
-    uint64_t timestamp_us;  // Microsecond timestamp
-    uint32_t frame_id;       // Frame sequence number
-    
-    // Head tracking
-    vr_position_t head_position;
-    vr_orientation_t head_orientation;
-    vr_acceleration_t head_acceleration;
-    vr_angular_velocity_t head_angular_velocity;
-    
-    // Eye tracking
-    vr_eye_tracking_t left_eye;
-    vr_eye_tracking_t right_eye;
+    // Cache line 0: head
+    vr_position_t head_position;                  //   0
+    vr_orientation_t head_orientation;            //  12
+    vr_acceleration_t head_acceleration;          //  28
+    vr_angular_velocity_t head_angular_velocity;  //  40
+    uint32_t frame_id;        //  52  Frame sequence number
+    uint64_t monotonic_us;    //  56  CLOCK_MONOTONIC_RAW sample time; never jumps (not on the wire)
     
-    // Hand tracking
-    vr_hand_tracking_t left_hand;
-    vr_hand_tracking_t right_hand;
+    // Cache line 1: hand tracking
+    vr_hand_tracking_t left_hand;                 //  64
+    vr_hand_tracking_t right_hand;                //  96
     
-    // System status
-    float cpu_usage;          // CPU usage percentage
-    float gpu_usage;          // GPU usage percentage
-    float temperature;        // Headset temperature in °C
-    uint8_t battery_level;    // Battery percentage (0-100)
-    bool is_connected;        // Connection status
-    
-} vr_telemetry_packet_t;
+    // Cache line 2: eye tracking, system status
+    vr_eye_tracking_t left_eye;                   // 128
+    vr_eye_tracking_t right_eye;                  // 140
+    float cpu_usage;          // 152  CPU usage percentage
+    float gpu_usage;          // 156  GPU usage percentage
+    float temperature;        // 160  Headset temperature in °C
+    uint8_t battery_level;    // 164  Battery percentage (0-100)
+    uint8_t flags;            // 165  VR_WIRE_FLAG_* (blinking, hand tracking, connected)
+    uint8_t reserved[2];      // 166  Zero
+    uint64_t timestamp_us;    // 168  Wall-clock microseconds: monotonic_us + wall-clock offset
+    uint8_t padding[16];      // 176  Zero, to the end of the cache line
+} __attribute__((aligned(VR_CACHE_LINE_SIZE))) vr_telemetry_packet_t;
+
+_Static_assert(sizeof(vr_telemetry_packet_t) == 3 * VR_CACHE_LINE_SIZE, "packet is three cache lines");
+_Static_assert(offsetof(vr_telemetry_packet_t, monotonic_us) == VR_CACHE_LINE_SIZE - sizeof(uint64_t),
+               "head, frame id and sample time fill cache line 0");
+_Static_assert(offsetof(vr_telemetry_packet_t, left_hand) == VR_CACHE_LINE_SIZE,
+               "hands fill cache line 1");
+_Static_assert(offsetof(vr_telemetry_packet_t, left_eye) == 2 * VR_CACHE_LINE_SIZE,
+               "eyes start cache line 2");
+_Static_assert(offsetof(vr_telemetry_packet_t, padding) == 176, "no implicit padding");
+
+// Seqlock around the latest packet: one writer publishes without waiting,
+// readers on any thread copy a consistent frame without locking, retrying
+// while a publish is in progress (see vr_packet.c)
+typedef struct {
+    uint32_t seq;                  // Odd while a publish is in progress
+    vr_telemetry_packet_t packet;
+} vr_packet_snapshot_t;
+
+// Structure-of-arrays view of up to VR_COLUMNS_MAX_FRAMES packets for batched
+// and vectorized code: one contiguous array per field, so a loop over frames
+// reads unit-stride floats instead of one field out of every 192-byte packet.
+// Float columns are in VR_WIRE_TYPE_FRAME order (see vr_packet.c).
+#define VR_PACKET_FLOATS              38
+#define VR_COLUMNS_MAX_FRAMES         256
+
+typedef struct {
+    float values[VR_PACKET_FLOATS][VR_COLUMNS_MAX_FRAMES] __attribute__((aligned(VR_CACHE_LINE_SIZE)));
+    uint64_t timestamp_us[VR_COLUMNS_MAX_FRAMES];
+    uint64_t monotonic_us[VR_COLUMNS_MAX_FRAMES];
+    uint32_t frame_id[VR_COLUMNS_MAX_FRAMES];
+    uint8_t battery_level[VR_COLUMNS_MAX_FRAMES];
+    uint8_t flags[VR_COLUMNS_MAX_FRAMES];
+    uint32_t count;
+} vr_packet_columns_t;
+
+// Wire Formats
+typedef enum {
+    VR_WIRE_FORMAT_JSON,           // Human-readable JSON object per frame
+    VR_WIRE_FORMAT_BINARY,         // Fixed-layout little-endian frame (see below)
+    VR_WIRE_FORMAT_DELTA           // Quantized keyframes and deltas (VR_WIRE_TYPE_DELTA)
+} vr_wire_format_t;
+
+// Binary wire format v1
+// Every message starts with a 4-byte header: magic (u16), version (u8), type (u8).
+// All multi-byte fields are little-endian, floats are IEEE-754 binary32.
+//
+// VR_WIRE_TYPE_FRAME body (166 bytes, offsets from start of message):
+//    4  u64  timestamp_us            12  u32  frame_id
+//   16  f32  head_position[3]        28  f32  head_orientation[4]
+//   44  f32  head_acceleration[3]    56  f32  head_angular_velocity[3]
+//   68  f32  left_eye x, y, pupil    80  f32  right_eye x, y, pupil
+//   92  f32  left_hand x, y, z, orientation[4], grip_strength
+//  124  f32  right_hand x, y, z, orientation[4], grip_strength
+//  156  f32  cpu_usage, gpu_usage, temperature
+//  168  u8   battery_level           169  u8   flags (VR_WIRE_FLAG_*)
+#define VR_WIRE_MAGIC                 0x5456  // "VT"
+#define VR_WIRE_VERSION               1
+#define VR_WIRE_HEADER_SIZE           4
+#define VR_WIRE_TYPE_FRAME            0x01
+#define VR_WIRE_TYPE_BATCH            0x02
+#define VR_WIRE_FRAME_SIZE            170
+
+// VR_WIRE_TYPE_BATCH body: u16 frame count, u16 reserved (0), then for each
+// frame a u16 length followed by a complete single-frame message (header included).
+#define VR_WIRE_BATCH_HEADER_SIZE     8
+
+// Telemetry sections: the parts of a frame a stream carries (see vr_stream_kind_t)
+#define VR_SECTION_HEAD               0x01    // Position, orientation, acceleration, angular velocity
+#define VR_SECTION_EYES               0x02    // Both eyes, blink flags
+#define VR_SECTION_HANDS              0x04    // Both hands, tracking flags
+#define VR_SECTION_STATUS             0x08    // CPU, GPU, temperature, battery, connected flag
+#define VR_SECTION_ALL                0x0F
+
+// VR_WIRE_TYPE_SECTIONS body: a frame reduced to the sections in its mask,
+// used by streams that do not carry complete frames:
+//    4  u64  timestamp_us            12  u32  frame_id
+//   16  u8   sections (VR_SECTION_*) 17  u8   flags of the included sections
+//   18  each included section in bit order, fields as in VR_WIRE_TYPE_FRAME:
+//       head   13 f32  position[3], orientation[4], acceleration[3], angular_velocity[3]
+//       eyes    6 f32  left x, y, pupil, right x, y, pupil
+//       hands  16 f32  left, right: x, y, z, orientation[4], grip_strength
+//       status  3 f32  cpu_usage, gpu_usage, temperature; u8 battery_level
+// It appears alone or inside VR_WIRE_TYPE_BATCH like VR_WIRE_TYPE_FRAME.
+#define VR_WIRE_TYPE_SECTIONS         0x04
+#define VR_WIRE_SECTIONS_HEADER_SIZE  18
+
+// VR_WIRE_TYPE_DELTA body: u16 frame count, u16 sequence (+1 per message),
+// u16 position resolution in um, u8 quaternion bits, u8 section mask
+// (VR_SECTION_*; 0 from older producers means all). Each
+// frame is a u8 kind (VR_DELTA_KEYFRAME / VR_DELTA_DELTA) followed by
+// VR_QUANT_FIELDS zigzag LEB128 varints: the quantized fields themselves for
+// a keyframe, or their difference from the previous frame for a delta.
+// Fields of sections outside the mask are left out; timestamp, frame_id and
+// flags are always present. Quantized fields, in order:
+//    0  timestamp_us             1  frame_id
+//    2  head_position[3]         position resolution
+//    5  head_orientation         smallest-three: index, a, b, c
+//    9  head_acceleration[3]     VR_QUANT_ACCEL_SCALE per m/s^2
+//   12  head_angular_velocity[3] VR_QUANT_GYRO_SCALE per rad/s
+//   15  left_eye x, y, pupil     VR_QUANT_EYE_SCALE, VR_QUANT_PUPIL_SCALE per mm
+//   18  right_eye x, y, pupil
+//   21  left_hand x, y, z, orientation (4), grip (VR_QUANT_GRIP_SCALE)
+//   29  right_hand x, y, z, orientation (4), grip
+//   37  cpu_usage, gpu_usage, temperature  VR_QUANT_STATUS_SCALE
+//   40  battery_level            41  flags (VR_WIRE_FLAG_*)
+// Smallest-three drops the largest quaternion component (made positive) and
+// stores its index plus the other three scaled from [-1/sqrt(2), 1/sqrt(2)]
+// to +/-(2^(bits-1) - 1). Index VR_QUAT_INDEX_ZERO marks an all-zero quaternion.
+#define VR_WIRE_TYPE_DELTA            0x03
+#define VR_WIRE_DELTA_HEADER_SIZE     12
+#define VR_DELTA_KEYFRAME             0x00
+#define VR_DELTA_DELTA                0x01
+#define VR_QUANT_FIELDS               42
+#define VR_QUANT_ACCEL_SCALE          1000    // 1 mm/s^2
+#define VR_QUANT_GYRO_SCALE           1000    // 1 mrad/s
+#define VR_QUANT_EYE_SCALE            10000
+#define VR_QUANT_PUPIL_SCALE          1000    // 1 um
+#define VR_QUANT_GRIP_SCALE           10000
+#define VR_QUANT_STATUS_SCALE         100     // Matches the JSON %.2f fields
+#define VR_QUAT_INDEX_ZERO            4
+#define VR_DELTA_MAX_FRAME_SIZE       (1 + VR_QUANT_FIELDS * 10)
+
+#define VR_DELTA_DEFAULT_KEYFRAME_INTERVAL 60
+#define VR_DELTA_DEFAULT_POSITION_UM       1000  // 1 mm
+#define VR_DELTA_DEFAULT_QUAT_BITS         12
+
+typedef struct {
+    int64_t fields[VR_QUANT_FIELDS];
+} vr_quant_frame_t;
+
+// Delta encoder state carried between messages on one stream
+typedef struct {
+    vr_quant_frame_t previous;
+    bool have_previous;            // false forces the next frame to be a keyframe
+    uint32_t frames_since_keyframe;
+    uint32_t keyframe_interval;    // Frames between keyframes (1 = keyframes only)
+    uint16_t position_um;          // Position resolution in micrometres
+    uint8_t quat_bits;             // Bits per smallest-three component (2..16)
+    uint16_t sequence;             // Sequence number of the next message
+} vr_delta_encoder_t;
+
+#define VR_WIRE_FLAG_LEFT_BLINKING    0x01
+#define VR_WIRE_FLAG_RIGHT_BLINKING   0x02
+#define VR_WIRE_FLAG_LEFT_TRACKING    0x04
+#define VR_WIRE_FLAG_RIGHT_TRACKING   0x08
+#define VR_WIRE_FLAG_CONNECTED        0x10
+
+#define VR_CONTENT_TYPE_JSON          "application/json"
+#define VR_CONTENT_TYPE_BINARY        "application/x-vr-telemetry; v=1"
+
+#define VR_JSON_MAX_SIZE              2048
+
+// Delivery Guarantees
+typedef enum {
+    VR_DELIVERY_TRANSIENT = 1,     // Broker keeps messages in memory only
+    VR_DELIVERY_PERSISTENT = 2     // Broker writes messages to disk
+} vr_delivery_mode_t;
+
+#define VR_CONFIRM_MAX_WINDOW         4096   // Upper bound on unconfirmed messages
+#define VR_CONFIRM_DEFAULT_WINDOW     256
+#define VR_CONFIRM_TIMEOUT_MS         5000   // Give up waiting for a full window after this
+#define VR_CONFIRM_POLL_US            1000   // Idle publisher re-checks outstanding confirms after this
+
+// Reconnect
+#define VR_CONNECT_TIMEOUT_MS         2000
+#define VR_RECONNECT_INITIAL_MS       100
+#define VR_RECONNECT_MAX_MS           10000
+
+typedef struct {
+    uint64_t messages_published;   // AMQP messages handed to the broker
+    uint64_t frames_published;     // Telemetry frames inside those messages
+    uint64_t publish_failures;
+    uint64_t confirms_acked;
+    uint64_t confirms_nacked;
+    uint64_t frames_nacked;
+    uint64_t frames_unconfirmed_lost; // Frames unconfirmed when a connection dropped
+    uint64_t connection_losses;
+    uint64_t reconnects;           // Successful reconnects after a loss
+    uint32_t confirms_in_flight;   // Published but not yet acked/nacked
+    uint32_t confirm_window;       // 0 when confirms are disabled
+} vr_publisher_stats_t;
+
+// One broker connection and channel (opaque; see vr_publisher_create)
+typedef struct vr_publisher vr_publisher_t;
+
+// Publisher shards: each connection has its own socket and publishing thread,
+// streams and devices are mapped to one by a stable hash (vr_shard_hash)
+#define VR_SHARD_MAX                  64
+
+#define VR_ROUTING_KEY_MAX            128
+
+// Logical telemetry streams. Each has its own rate and routing key: the frame
+// stream publishes complete packets on the configured key, the others only
+// their sections on that key with the last segment replaced by their name
+// ("telemetry.data" -> "telemetry.pose").
+typedef enum {
+    VR_STREAM_FRAME,               // Complete packets (VR_SECTION_ALL)
+    VR_STREAM_POSE,                // VR_SECTION_HEAD | VR_SECTION_HANDS
+    VR_STREAM_EYES,                // VR_SECTION_EYES
+    VR_STREAM_STATUS,              // VR_SECTION_STATUS
+    VR_STREAM_KIND_COUNT
+} vr_stream_kind_t;
+
+#define VR_STREAM_MAX_RATE_HZ         100000  // Per-stream rate ceiling (10 us scheduler period)
+
+// A sequence of telemetry messages on one routing key
+typedef struct {
+    char routing_key[VR_ROUTING_KEY_MAX];
+    uint32_t routing_key_len;      // Cached for the publish path
+    uint8_t sections;              // VR_SECTION_* carried by every frame
+    vr_delta_encoder_t delta;      // Delta format state; consumers decode per stream
+    uint32_t epoch;                // Publisher connection the delta state was sent on
+} vr_stream_t;
+
+// Telemetry Ring (sampling loop -> publisher thread)
+typedef enum {
+    VR_RING_DROP_OLDEST,           // Overwrite the oldest queued packet when full
+    VR_RING_DROP_NEWEST            // Reject the incoming packet when full
+} vr_ring_policy_t;
+
+#define VR_RING_MAX_DEPTH             (1u << 20)  // Frames per ring or spill buffer (192 MB)
+
+typedef struct {
+    vr_telemetry_packet_t *slots;
+    uint32_t capacity;             // Power of two
+    uint32_t mask;
+    vr_ring_policy_t policy;
+    uint64_t head __attribute__((aligned(VR_CACHE_LINE_SIZE)));  // Written by producer
+    uint64_t dropped;
+    uint32_t high_watermark;
+    uint64_t tail __attribute__((aligned(VR_CACHE_LINE_SIZE)));  // Written by consumer
+} vr_packet_ring_t;
+
+typedef struct {
+    uint32_t capacity;
+    uint32_t occupancy;            // Packets currently queued
+    uint32_t high_watermark;       // Highest occupancy seen
+    uint64_t pushed;               // Packets accepted into the ring
+    uint64_t dropped;              // Packets lost to the overflow policy
+} vr_ring_stats_t;
+
+typedef struct {
+    vr_ring_stats_t ring;          // Sampling loop -> publisher thread
+    vr_ring_stats_t spill;         // Frames buffered during broker outages
+    uint64_t frames_replayed;      // Spilled frames published after reconnect
+    uint64_t frames_expired;       // Spilled frames discarded by the max-age cutoff
+    uint64_t frames_discarded;     // Frames dropped because their message could not be sent
+    uint64_t publisher_wakeups;    // Publisher thread returns from its idle wait
+} vr_telemetry_stats_t;
+
+#define VR_PUBLISHER_IDLE_MAX_MS      100    // Longest an idle publisher thread sleeps between checks
+
+// Telemetry Batching
+#define VR_BATCH_MAX_FRAMES           256
+#define VR_BATCH_MAX_MESSAGE_SIZE     (VR_BATCH_MAX_FRAMES * VR_JSON_MAX_SIZE)
+
+typedef struct {
+    vr_telemetry_packet_t frames[VR_BATCH_MAX_FRAMES];
+    uint32_t count;                // Frames currently queued
+    uint32_t max_frames;           // Flush once this many frames are queued
+    uint32_t window_us;            // Flush once the oldest frame is this old (0 = no limit)
+    uint64_t opened_us;            // Monotonic time (vr_clock_monotonic_us) the first frame was added
+} vr_batch_t;
+
+// Timestamps (see vr_clock.c)
+#define VR_CLOCK_REFRESH_MS           10      // Wall-clock offset refresh interval
+#define VR_CLOCK_MAX_SLEW_PPM         500     // Fastest rate offset corrections are slewed at
+#define VR_CLOCK_STEP_US              1000000 // Larger wall-clock changes are applied at once
+
+// Logging (see vr_log.c)
+#define VR_LOG_RING_SIZE              1024    // Queued records; must be a power of two
+#define VR_LOG_RECORD_MAX             256     // Longer records are truncated
+#define VR_LOG_BURST                  10      // Records per call site per window
+#define VR_LOG_WINDOW_MS              1000
+#define VR_LOG_DRAIN_MS               5       // Writer thread poll interval when no eventfd is available
+
+typedef enum {
+    VR_LOG_INFO = 0,    // stdout
+    VR_LOG_ERROR        // stderr
+} vr_log_level_t;
+
+// Rate limit state of one logging call site (one static per VR_LOG)
+typedef struct vr_log_site {
+    const char *file;
+    int line;
+    vr_log_level_t level;
+    const char *format;             // First record's format, for the "[TAG]" of repeat reports
+    uint64_t window_start_us;
+    uint32_t count;                 // Records in the current window
+    uint32_t suppressed;            // Records over VR_LOG_BURST in the current window
+    int registered;
+    struct vr_log_site *next;
+} vr_log_site_t;
+
+typedef struct {
+    uint64_t written;
+    uint64_t suppressed;            // Over a call site's rate limit
+    uint64_t dropped;               // Ring full
+} vr_log_stats_t;
+
+// Capture Files (see vr_capture.c)
+// A 64-byte little-endian header followed by fixed-size records, each a
+// complete VR_WIRE_TYPE_FRAME message and the u64 monotonic_us it was
+// sampled at, so record n is at VR_CAPTURE_HEADER_SIZE + n * record size:
+//    0  u32  magic (VR_CAPTURE_MAGIC)      4  u16  version
+//    6  u16  record size (VR_CAPTURE_RECORD_SIZE)
+//    8  u64  record count                 16  u64  first timestamp_us
+//   24  u64  last timestamp_us            32  u64  first monotonic_us
+//   40  u64  last monotonic_us            48  reserved (0)
+// Version 1 records are the frame alone, without monotonic_us.
+#define VR_CAPTURE_MAGIC              0x50435256  // "VRCP"
+#define VR_CAPTURE_VERSION            2
+#define VR_CAPTURE_HEADER_SIZE        64
+#define VR_CAPTURE_RECORD_SIZE        (VR_WIRE_FRAME_SIZE + 8)
+#define VR_CAPTURE_GROW_BYTES         (16u << 20)  // File and mapping growth step while recording
+
+typedef struct {
+    int fd;
+    bool recording;                 // Created by vr_capture_create
+    bool writable;                  // Still accepting records
+    uint8_t *map;
+    size_t map_size;
+    uint16_t version;
+    size_t record_size;
+    uint64_t count;                 // Records
+    uint64_t first_timestamp_us;
+    uint64_t last_timestamp_us;
+    uint64_t first_monotonic_us;    // Sample times; replay is paced by these, not the wall clock
+    uint64_t last_monotonic_us;
+    uint32_t last_frame_id;         // Skip the same sample offered by several streams
+} vr_capture_t;
+
+// Sensor Calibration (see vr_calibration.c)
+// Resting head position (the tracking origin) and pupil diameters (the eye
+// tracking baseline) measured at startup, cached in a 64-byte little-endian
+// file so a warm start skips the measurement:
+//    0  u32  magic (VR_CALIBRATION_MAGIC)  4  u16  version   6  u16  size (64)
+//    8  u32  sensor_update_hz             12  u32  samples
+//   16  f32  head position[3]             28  f32  pupil diameter[2] (left, right)
+//   36  reserved (0)                      40  u64  measured wall-clock us
+//   48  u32  FNV-1a of bytes 0-47         52  reserved (0)
+#define VR_CALIBRATION_MAGIC          0x4C435256  // "VRCL"
+#define VR_CALIBRATION_VERSION        1
+#define VR_CALIBRATION_FILE_SIZE      64
+#define VR_CALIBRATION_SAMPLES        100     // One per millisecond
+#define VR_CALIBRATION_MAX_AGE_S      86400   // Older caches are measured again
+
+typedef struct {
+    uint32_t sensor_update_hz;     // Rate the offsets were measured at
+    uint32_t samples;
+    float head_position[3];        // Mean head position at rest
+    float pupil_diameter[2];       // Mean left and right pupil diameter at rest
+    uint64_t measured_us;          // Wall-clock time of the measurement
+} vr_calibration_t;
+
+// Sensor History (see vr_history.c)
+// One ring of recent samples per sensor channel, with the mean, variance,
+// minimum and maximum of every component over the samples it holds.
+typedef enum {
+    VR_HISTORY_POSE,               // Head position[3], orientation[4]
+    VR_HISTORY_IMU,                // Head acceleration[3], angular velocity[3]
+    VR_HISTORY_EYES,               // Left x, y, pupil, right x, y, pupil
+    VR_HISTORY_HANDS,              // Left, right: x, y, z, orientation[4], grip_strength
+    VR_HISTORY_CHANNEL_COUNT
+} vr_history_channel_t;
+
+#define VR_HISTORY_MAX_COMPONENTS     16      // One cache line of floats per sample
+#define VR_HISTORY_MAX_DEPTH          65536
+
+// Monotonic queue of the samples that are the window's successive minima
+// (or maxima); front is the current extreme
+typedef struct {
+    uint32_t position;             // Sample position
+    float value;
+} vr_history_extreme_t;
+
+typedef struct {
+    vr_history_extreme_t *entries; // capacity entries
+    uint32_t head;                 // Push/pop-back position (counts up, masked)
+    uint32_t tail;                 // Pop-front position
+} vr_history_extremes_t;
+
+typedef struct {
+    float *samples;                // capacity rows of VR_HISTORY_MAX_COMPONENTS floats, cache-line-aligned
+    uint64_t *timestamps_us;       // monotonic_us of each row
+    uint32_t capacity;             // Power of two
+    uint32_t mask;
+    uint32_t components;
+    uint32_t count;                // Samples in the window (<= capacity)
+    uint32_t position;             // Samples pushed so far (wraps); the next row is position & mask
+    double mean[VR_HISTORY_MAX_COMPONENTS];
+    double m2[VR_HISTORY_MAX_COMPONENTS];   // Sum of squared deviations from the mean
+    vr_history_extremes_t min[VR_HISTORY_MAX_COMPONENTS];
+    vr_history_extremes_t max[VR_HISTORY_MAX_COMPONENTS];
+} vr_history_ring_t;
+
+typedef struct {
+    vr_history_ring_t channels[VR_HISTORY_CHANNEL_COUNT];
+} vr_sensor_history_t;
+
+typedef struct {
+    uint32_t count;                // Samples the statistics cover
+    float mean;
+    float variance;                // Population variance over the window
+    float min;
+    float max;
+} vr_history_stats_t;
+
+// Telemetry Filters (see vr_filter.c)
+// Each stream's filter sees every sensor sample and produces the frame sent
+// at the stream's rate. The 38 float fields of a packet are filtered, in
+// VR_WIRE_TYPE_FRAME order; ids, timestamps and flags are the latest sample's.
+typedef enum {
+    VR_FILTER_NONE,                // Latest sample
+    VR_FILTER_BOX,                 // Mean of the samples since the previous frame
+    VR_FILTER_LOWPASS,             // First-order low-pass at cutoff_hz
+    VR_FILTER_ONE_EURO,            // One Euro filter on head and hand pose, box mean for the rest
+    VR_FILTER_KIND_COUNT
+} vr_filter_kind_t;
+
+#define VR_FILTER_FIELDS              VR_PACKET_FLOATS
+#define VR_ONE_EURO_DEFAULT_MIN_CUTOFF_HZ 1.0f
+#define VR_ONE_EURO_DEFAULT_BETA      1.0f
+#define VR_ONE_EURO_D_CUTOFF_HZ       1.0f    // Cutoff of the speed estimate
+
+typedef struct {
+    vr_filter_kind_t kind;
+    float cutoff_hz;               // Low-pass cutoff (0 = half the stream rate)
+    float min_cutoff_hz;           // One Euro cutoff at rest
+    float beta;                    // One Euro cutoff increase per unit/s of speed
+} vr_filter_config_t;
+
+typedef struct {
+    vr_filter_config_t config;
+    float stream_rate_hz;          // Frames produced per second
+    double sample_period_s;        // Fallback time step between samples
+    vr_telemetry_packet_t latest;  // Last sample seen
+    bool primed;                   // At least one sample seen
+    uint32_t count;                // Samples since the previous frame
+    double sum[VR_FILTER_FIELDS];  // Box: sum of those samples
+    float mean[VR_FILTER_FIELDS];  // Box: previous frame's values
+    float state[VR_FILTER_FIELDS]; // Low-pass / One Euro output
+    float speed[VR_FILTER_FIELDS]; // One Euro: filtered rate of change
+} vr_filter_t;
+
+// Queue a printf-style record from a hot path; never blocks on the terminal
+#define VR_LOG(log_level, ...) do { \
+    static vr_log_site_t vr_log_site_ = { .file = __FILE__, .line = __LINE__, .level = (log_level) }; \
+    vr_log_write(&vr_log_site_, __VA_ARGS__); \
+} while (0)
+
+// Real-time Scheduler
+#define VR_SCHED_MAX_TASKS 10
+#define VR_NSEC_PER_SEC 1000000000ULL
+
+typedef void (*vr_task_fn_t)(void *arg);
+
+// How the scheduler waits between deadlines (cpu_sleep_level selects one)
+typedef enum {
+    VR_IDLE_SPIN = 0,              // Poll the clock: lowest jitter, keeps a core busy
+    VR_IDLE_YIELD = 1,             // Poll, yielding the core to other runnable threads
+    VR_IDLE_SLEEP = 2,             // Block on a timerfd armed for the next deadline
+    VR_IDLE_DEEP = 3,              // Block until a slack-aligned time, running every task due within the slack
+    VR_IDLE_MODE_COUNT
+} vr_idle_mode_t;
+
+#define VR_IDLE_DEEP_SLACK_US 500  // Deep sleep: wake-up grid and coalescing window
+
+// Periodic task released at absolute CLOCK_MONOTONIC deadlines.
+// Release n is due at epoch_ns + n * period_num_ns / period_den, so a rate
+// such as 90 Hz (period 11111111.1 ns) never accumulates rounding drift.
+typedef struct {
+    const char *name;
+    vr_task_fn_t fn;
+    void *arg;                     // Passed to fn
+    uint64_t period_num_ns;        // Period numerator (1e9 for rate-based tasks)
+    uint32_t period_den;           // Period denominator (rate in Hz, or 1)
+    uint64_t epoch_ns;             // Rebased every period_den releases to avoid overflow
+    uint32_t release;              // Release index since epoch_ns
+    uint64_t deadline_ns;          // Next release time
+    uint64_t runs;                 // Releases executed
+    uint64_t overruns;             // Releases skipped because the task ran late
+    uint64_t jitter_sum_ns;        // Sum of start latencies (start - deadline)
+    uint64_t jitter_max_ns;        // Worst start latency
+    uint64_t runtime_max_ns;       // Worst execution time
+} vr_task_t;
+
+typedef struct {
+    vr_task_t tasks[VR_SCHED_MAX_TASKS];
+    uint32_t count;
+    uint64_t last_busy_ns;         // Time spent running tasks after the last wake-up
+    vr_idle_mode_t idle;           // Wait between deadlines
+    int timer_fd;                  // timerfd waited on through epoll_fd (-1 = clock_nanosleep)
+    int epoll_fd;
+    uint64_t started_ns;           // vr_scheduler_start time
+    uint64_t wakeups;              // Returns from a blocking wait or yield
+} vr_scheduler_t;
+
+typedef struct {
+    const char *name;
+    double period_us;
+    uint64_t runs;
+    uint64_t overruns;
+    double jitter_mean_us;
+    double jitter_max_us;
+    double runtime_max_us;
+} vr_task_stats_t;
+
+typedef struct {
+    vr_idle_mode_t idle;
+    uint64_t wakeups;
+    double elapsed_s;              // Since vr_scheduler_start
+    double wakeups_per_s;
+} vr_scheduler_idle_stats_t;
 
+// Runtime Metrics
+// Log-linear (HDR-style) histogram: 16 linear sub-buckets per power of two,
+// so any recorded value is reported within 1/16 (6.25%) of its true value.
+#define VR_HIST_SUB_BUCKET_BITS 4
+#define VR_HIST_SUB_BUCKETS (1u << VR_HIST_SUB_BUCKET_BITS)
+#define VR_HIST_MAX_EXPONENT 40    // Largest tracked value ~2^41 ns (~36 min)
+#define VR_HIST_BUCKETS ((VR_HIST_MAX_EXPONENT - VR_HIST_SUB_BUCKET_BITS + 2) * VR_HIST_SUB_BUCKETS)
+#define VR_METRICS_DEFAULT_ROUTING_KEY "telemetry.metrics"
+#define VR_METRICS_JSON_MAX_SIZE 8192  // Room for VR_SHARD_MAX shard entries
+
+typedef struct {
+    uint64_t buckets[VR_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} vr_histogram_t;
+
+typedef enum {
+    VR_METRIC_SENSOR_UPDATE,       // vr_sensors_update()
+    VR_METRIC_SERIALIZE,           // Encoding one message
+    VR_METRIC_PUBLISH,             // amqp_basic_publish()
+    VR_METRIC_LOOP,                // Busy time of one scheduler iteration
+    VR_METRIC_FRAME_AGE,           // Sample to publish of every frame sent
+    VR_METRIC_CONFIRM,             // Publish to broker ack/nack of every confirmed message
+    VR_METRIC_COUNT
+} vr_metric_t;
+
+typedef struct {
+    uint64_t count;
+    double mean_us;
+    double p50_us;
+    double p90_us;
+    double p99_us;
+    double p999_us;
+    double max_us;
+} vr_histogram_summary_t;
+
+// Adaptive Rate Control (see vr_ratectl.c)
+// AIMD controller of the frame stream rate: once per interval it scales the
+// rate down when publishing falls behind, and after several clear intervals
+// steps it back up, always within [min_hz, max_hz].
+#define VR_RATECTL_DEFAULT_INTERVAL_MS 250
+#define VR_RATECTL_DEFAULT_LATENCY_MS 10     // Publish p99 above this is congestion
+#define VR_RATECTL_RING_HIGH          0.5f   // Ring fill above this is congestion
+#define VR_RATECTL_CONFIRM_HIGH       0.75f  // Confirm window fill above this is congestion
+#define VR_RATECTL_DECREASE           0.75   // Rate factor per congested interval
+#define VR_RATECTL_INCREASE_DIVISOR   20     // Increase step: max_hz / 20 (at least 1 Hz)
+#define VR_RATECTL_HOLD_INTERVALS     2      // No change while a decrease drains the queues
+#define VR_RATECTL_PROBE_INTERVALS    4      // Clear intervals before each increase
+
+typedef enum {
+    VR_RATECTL_CLEAR,              // No congestion
+    VR_RATECTL_RING_DROPS,         // The frame ring overflowed
+    VR_RATECTL_RING_FILL,          // The frame ring is filling up
+    VR_RATECTL_CONFIRM_LAG,        // The confirm window is nearly full
+    VR_RATECTL_PUBLISH_LATENCY,    // amqp_basic_publish is slow
+    VR_RATECTL_CAUSE_COUNT
+} vr_ratectl_cause_t;
+
+typedef struct {
+    bool enabled;
+    uint32_t min_hz;               // Lowest rate (0 = a quarter of max_hz)
+    uint32_t max_hz;               // Highest rate (0 = the configured telemetry rate)
+    uint32_t interval_ms;          // Control period
+    uint32_t latency_us;           // Publish p99 target
+} vr_ratectl_config_t;
+
+// Congestion signals measured over one interval
+typedef struct {
+    bool connected;                // Broker link up and no batch waiting for a resend
+    uint64_t publishes;            // Messages published in the interval
+    uint64_t publish_p99_ns;       // 99th percentile publish time of those messages
+    float ring_fill;               // Frame ring occupancy / capacity
+    uint64_t ring_drops;           // Frames the ring dropped in the interval
+    float confirm_fill;            // Confirms in flight / window (0 without confirms)
+} vr_ratectl_signals_t;
+
+typedef struct {
+    bool enabled;
+    uint32_t rate_hz;              // Current frame stream rate
+    uint32_t min_hz;
+    uint32_t max_hz;
+    uint64_t decreases;
+    uint64_t increases;
+    vr_ratectl_cause_t last_cause; // Cause of the most recent decrease
+} vr_ratectl_stats_t;
+
+// Controller state (main loop); stats are read atomically by reporters
+typedef struct {
+    vr_ratectl_config_t config;
+    uint32_t step_hz;              // Additive increase
+    uint32_t hold;                 // Intervals left before the next change
+    uint32_t clear;                // Consecutive clear intervals
+    vr_ratectl_stats_t stats;
+} vr_ratectl_t;
+
+typedef struct {
+    uint64_t frames_produced;      // Frames handed to the publisher
+    uint64_t frames_sent;          // Frames published to the broker
+    uint64_t frames_dropped;       // Overflowed, expired, discarded, nacked or lost frames
+    uint64_t frames_retried;       // Frames replayed after a broker outage
+    vr_histogram_summary_t latency[VR_METRIC_COUNT];
+    vr_ratectl_stats_t rate_control; // Adaptive frame rate (enabled = false when off)
+    uint32_t shard_count;          // Connections carrying telemetry (the fleet's when running)
+    vr_publisher_stats_t shards[VR_SHARD_MAX];
+} vr_metrics_snapshot_t;
+
+// Sensor Synthesis
+#define VR_SYNTH_LANES                8       // Samples per SIMD block
+
+// Simulated Devices
+#define VR_DEVICE_MAX                 4096
+
+// Sensor simulation state of one headset
+typedef struct {
+    uint32_t id;
+    uint32_t sensor_update_hz;
+    uint32_t frame_counter;        // Next frame_id
+    double time_offset_s;          // Phase offset so devices do not move in lockstep
+    vr_telemetry_packet_t packet;  // Latest sample
+} vr_device_t;
+
+typedef struct {
+    uint32_t devices;
+    uint32_t workers;
+    uint64_t frames_sampled;       // Frames queued for publishing
+    uint64_t frames_dropped;       // Frames whose message could not be sent
+    uint32_t connections;          // Publisher shards (0 without a broker)
+    vr_publisher_stats_t publisher; // Summed over the connections
+    vr_publisher_stats_t shards[VR_SHARD_MAX];
+} vr_fleet_stats_t;
 
 // Embedded System Status
 typedef enum {
@@ -78,14 +729,74 @@ typedef enum {
 typedef struct {
     uint32_t system_clock_hz;      // System clock frequency
     uint32_t sensor_update_hz;     // Sensor update frequency
-    uint32_t telemetry_rate_hz;    // Telemetry transmission rate
+    uint32_t telemetry_rate_hz;    // Telemetry transmission rate (complete frames)
+    uint32_t pose_rate_hz;         // Pose stream rate (0 = off)
+    uint32_t eyes_rate_hz;         // Eye tracking stream rate (0 = off)
+    uint32_t status_rate_hz;       // System status stream rate (0 = off)
+    uint32_t telemetry_batch_size; // Frames per published message (1 = no batching)
+    uint32_t telemetry_batch_window_us; // Maximum time a frame waits in a batch
+    uint32_t telemetry_ring_depth; // Packets buffered between sampling and publishing
+    vr_ring_policy_t telemetry_ring_policy; // Overflow policy for the telemetry ring
+    uint32_t telemetry_spill_depth; // Frames kept while the broker is unreachable
+    uint32_t telemetry_spill_max_age_ms; // Spilled frames older than this are not replayed (0 = keep all)
     bool watchdog_enabled;         // Watchdog timer enabled
     uint32_t watchdog_timeout_ms;  // Watchdog timeout
     bool power_save_enabled;      // Power saving mode
-    uint8_t cpu_sleep_level;       // CPU sleep level (0-3)
+    uint8_t cpu_sleep_level;       // CPU sleep level (0-3, a vr_idle_mode_t)
+    uint32_t metrics_interval_ms;  // Publish a metrics message this often (0 = disabled)
+    uint32_t device_count;         // Devices simulated by the fleet (0/1 = this device only)
+    uint32_t history_depth;        // Samples kept per sensor channel (rounded up to a power of two), 0 = off
+    vr_filter_config_t telemetry_filter; // Filter between sampling and each stream
+    vr_ratectl_config_t telemetry_rate_control; // Adaptive frame stream rate
+    const char *calibration_cache_path; // Reuse and store sensor calibration here (NULL = always measure)
 } vr_embedded_config_t;
 
-// Embedded System Status
+// Load Generator (see vr_loadgen.c)
+// Steps a fleet through every combination of batch size, frame rate and
+// device count against the broker and measures each step once it is warm.
+#define VR_LOADGEN_MAX_VALUES         16      // Values per ramped parameter
+#define VR_LOADGEN_DEFAULT_STEP_S     10      // Measured time per step
+#define VR_LOADGEN_DEFAULT_WARMUP_S   2       // Unmeasured time before each measurement
+#define VR_LOADGEN_DEFAULT_LATENCY_MS 100     // Confirm p99 above this is saturation
+#define VR_LOADGEN_MIN_THROUGHPUT     0.95    // Sent / offered frames below this is saturation
+#define VR_LOADGEN_MAX_DROP_RATE      0.001   // Dropped / sampled frames above this is saturation
+
+typedef struct {
+    uint32_t devices[VR_LOADGEN_MAX_VALUES];     // Ascending device counts
+    uint32_t device_steps;
+    uint32_t rates_hz[VR_LOADGEN_MAX_VALUES];    // Frame stream rates
+    uint32_t rate_steps;
+    uint32_t batch_sizes[VR_LOADGEN_MAX_VALUES]; // Frames per message
+    uint32_t batch_steps;
+    uint32_t step_s;
+    uint32_t warmup_s;
+    uint32_t latency_ms;           // Confirm p99 limit
+    uint32_t workers;              // Fleet workers (0 = one per CPU)
+    uint32_t connections;          // Broker connections (0 = one per worker)
+    const char *csv_path;          // Step results as CSV (NULL = none)
+    const char *json_path;         // Step results and knees as JSON (NULL = none)
+} vr_loadgen_config_t;
+
+// Measurements of one step
+typedef struct {
+    uint32_t devices;
+    uint32_t rate_hz;
+    uint32_t batch_size;
+    double seconds;                // Measured time
+    double offered_fps;            // Frames per second the step should produce
+    double sent_fps;               // Frames per second published
+    double messages_per_s;
+    double drop_rate;              // Dropped, nacked or lost per sampled frame
+    double publish_p99_us;
+    double confirm_p50_us;
+    double confirm_p99_us;
+    double cpu_pct;                // Producer CPU time, % of one core
+    double cpu_us_per_frame;       // Producer CPU time per published frame
+    bool saturated;
+} vr_loadgen_step_t;
+
+// Embedded System Status (fields are accessed atomically; use
+// vr_embedded_get_status() for a consistent multi-field snapshot)
 typedef struct {
     vr_system_state_t state;
     uint32_t uptime_ms;           // System uptime in milliseconds
@@ -97,28 +808,160 @@ typedef struct {
 } vr_embedded_status_t;
 
 // Function prototypes - Embedded System Core
-void vr_embedded_init(vr_embedded_config_t *config, bool use_rabbitmq);
+int vr_embedded_init(vr_embedded_config_t *config, bool use_rabbitmq);
 void vr_embedded_main_loop(void);
 void vr_embedded_system_tick(void);
 vr_system_state_t vr_embedded_get_state(void);
-void vr_embedded_set_state(vr_system_state_t state);
+bool vr_embedded_set_state(vr_system_state_t state);
+void vr_embedded_get_status(vr_embedded_status_t *status);
+void vr_embedded_stop(void);
+
+// Load Generator
+int vr_loadgen_parse_list(const char *arg, uint32_t *values, uint32_t *count);
+int vr_loadgen_run(const vr_embedded_config_t *config, const vr_loadgen_config_t *loadgen);
+void vr_loadgen_stop(void);
 
 // Sensor Management
 void vr_sensors_init(void);
 void vr_sensors_update(void);
+void vr_sensors_get_packet(vr_telemetry_packet_t *packet);
 bool vr_sensors_self_test(void);
 void vr_sensors_calibrate(void);
+void vr_sensors_wait_ready(void);
+const vr_calibration_t *vr_sensors_get_calibration(void);
+const vr_sensor_history_t *vr_sensors_get_history(void);
+
+// Sensor Calibration
+int vr_calibration_measure(vr_calibration_t *cal, uint32_t sensor_update_hz, uint32_t samples);
+int vr_calibration_load(vr_calibration_t *cal, const char *path, uint32_t sensor_update_hz);
+int vr_calibration_save(const vr_calibration_t *cal, const char *path);
+
+// Sensor History
+int vr_history_init(vr_sensor_history_t *hist, uint32_t depth);
+void vr_history_destroy(vr_sensor_history_t *hist);
+void vr_history_reset(vr_sensor_history_t *hist);
+void vr_history_record(vr_sensor_history_t *hist, const vr_telemetry_packet_t *packet);
+int vr_history_ring_init(vr_history_ring_t *ring, uint32_t components, uint32_t depth);
+void vr_history_ring_destroy(vr_history_ring_t *ring);
+void vr_history_ring_push(vr_history_ring_t *ring, const float *values, uint64_t timestamp_us);
+const float *vr_history_ring_sample(const vr_history_ring_t *ring, uint32_t age, uint64_t *timestamp_us);
+int vr_history_ring_get_stats(const vr_history_ring_t *ring, uint32_t component, vr_history_stats_t *stats);
+int vr_history_get_stats(const vr_sensor_history_t *hist, vr_history_channel_t channel,
+                         uint32_t component, vr_history_stats_t *stats);
+const char *vr_history_channel_name(vr_history_channel_t channel);
+uint32_t vr_history_channel_components(vr_history_channel_t channel);
+
+// Telemetry Filters
+void vr_filter_init(vr_filter_t *filter, const vr_filter_config_t *config, uint32_t sample_rate_hz,
+                    uint32_t stream_rate_hz);
+void vr_filter_set_rate(vr_filter_t *filter, uint32_t stream_rate_hz);
+void vr_filter_update(vr_filter_t *filter, const vr_telemetry_packet_t *sample);
+void vr_filter_output(vr_filter_t *filter, vr_telemetry_packet_t *packet);
+const char *vr_filter_kind_name(vr_filter_kind_t kind);
+int vr_filter_parse_kind(const char *name, vr_filter_kind_t *kind);
+
+// Adaptive Rate Control
+void vr_ratectl_init(vr_ratectl_t *ctl, const vr_ratectl_config_t *config, uint32_t rate_hz);
+uint32_t vr_ratectl_update(vr_ratectl_t *ctl, uint32_t rate_hz, const vr_ratectl_signals_t *signals);
+void vr_ratectl_get_stats(const vr_ratectl_t *ctl, vr_ratectl_stats_t *stats);
+const char *vr_ratectl_cause_name(vr_ratectl_cause_t cause);
+
+// Sensor Synthesis
+void vr_synth_sample(float simulation_time, vr_telemetry_packet_t *packet);
+void vr_synth_samples(const float *times, vr_telemetry_packet_t *const *packets, uint32_t count);
+int vr_synth_select(const char *isa);
+const char *vr_synth_get_isa(void);
+
+// Simulated Devices
+void vr_device_init(vr_device_t *dev, uint32_t id, uint32_t sensor_update_hz);
+void vr_device_update(vr_device_t *dev);
+void vr_device_update_many(vr_device_t *const *devices, uint32_t count);
+void vr_device_generate(vr_device_t *dev, vr_telemetry_packet_t *packets, uint32_t count);
+int vr_device_format_routing_key(const char *base, uint32_t id, char *buffer, size_t size);
+int vr_fleet_start(const vr_embedded_config_t *config, uint32_t devices, uint32_t workers,
+                   uint32_t connections);
+void vr_fleet_stop(void);
+void vr_fleet_get_stats(vr_fleet_stats_t *stats);
 
 // Telemetry System
-void vr_telemetry_init(void);
+int vr_telemetry_init(void);
 void vr_telemetry_send_packet(const vr_telemetry_packet_t *packet);
+void vr_telemetry_send_stream(vr_stream_kind_t kind, const vr_telemetry_packet_t *packet);
+void vr_telemetry_set_capture(vr_capture_t *cap);
+uint32_t vr_telemetry_stream_room(vr_stream_kind_t kind);
 bool vr_telemetry_is_ready(void);
-void vr_telemetry_set_rate(uint32_t rate_hz);
+int vr_telemetry_set_rate(vr_stream_kind_t kind, uint32_t rate_hz);
+uint32_t vr_telemetry_stream_rate(const vr_embedded_config_t *config, vr_stream_kind_t kind);
+void vr_telemetry_shutdown(void);
+void vr_telemetry_get_stats(vr_telemetry_stats_t *stats);
+void vr_telemetry_get_rate_control(vr_ratectl_stats_t *stats);
+
+// Telemetry Ring
+int vr_ring_init(vr_packet_ring_t *ring, uint32_t depth, vr_ring_policy_t policy);
+void vr_ring_destroy(vr_packet_ring_t *ring);
+bool vr_ring_push(vr_packet_ring_t *ring, const vr_telemetry_packet_t *packet);
+bool vr_ring_pop(vr_packet_ring_t *ring, vr_telemetry_packet_t *packet);
+uint32_t vr_ring_occupancy(const vr_packet_ring_t *ring);
+void vr_ring_get_stats(const vr_packet_ring_t *ring, vr_ring_stats_t *stats);
+int vr_ring_parse_policy(const char *name, vr_ring_policy_t *policy);
+
+// Delta Encoding
+void vr_delta_init(vr_delta_encoder_t *enc, uint32_t keyframe_interval,
+                   uint32_t position_um, uint32_t quat_bits);
+void vr_delta_force_keyframe(vr_delta_encoder_t *enc);
+void vr_delta_quantize(const vr_delta_encoder_t *enc, const vr_telemetry_packet_t *packet,
+                       vr_quant_frame_t *frame);
+int vr_delta_encode_batch(vr_delta_encoder_t *enc, const vr_telemetry_packet_t *packets,
+                          uint32_t count, uint8_t sections, uint8_t *buffer, size_t size);
+
+// Telemetry Batching
+void vr_batch_init(vr_batch_t *batch, uint32_t max_frames, uint32_t window_us);
+bool vr_batch_add(vr_batch_t *batch, const vr_telemetry_packet_t *packet, uint64_t now_us);
+bool vr_batch_is_due(const vr_batch_t *batch, uint64_t now_us);
+uint64_t vr_batch_wait_us(const vr_batch_t *batch, uint64_t now_us);
+void vr_batch_reset(vr_batch_t *batch);
+
+// Packet Snapshots and Columns
+void vr_snapshot_publish(vr_packet_snapshot_t *snap, const vr_telemetry_packet_t *packet);
+void vr_snapshot_read(const vr_packet_snapshot_t *snap, vr_telemetry_packet_t *packet);
+void vr_packet_get_floats(const vr_telemetry_packet_t *packet, float *values);
+void vr_packet_set_floats(vr_telemetry_packet_t *packet, const float *values);
+uint32_t vr_columns_load(vr_packet_columns_t *cols, const vr_telemetry_packet_t *packets, uint32_t count);
+
+// Real-time Scheduler
+void vr_scheduler_init(vr_scheduler_t *sched);
+int vr_scheduler_add_rate(vr_scheduler_t *sched, const char *name, vr_task_fn_t fn, void *arg,
+                          uint32_t rate_hz);
+int vr_scheduler_add_period(vr_scheduler_t *sched, const char *name, vr_task_fn_t fn, void *arg,
+                            uint64_t period_us);
+int vr_scheduler_set_rate(vr_scheduler_t *sched, int task_id, uint32_t rate_hz);
+void vr_scheduler_start(vr_scheduler_t *sched);
+int vr_scheduler_run_once(vr_scheduler_t *sched);
+void vr_scheduler_get_stats(const vr_scheduler_t *sched, int task_id, vr_task_stats_t *stats);
+void vr_scheduler_set_idle(vr_scheduler_t *sched, vr_idle_mode_t idle);
+void vr_scheduler_get_idle_stats(const vr_scheduler_t *sched, vr_scheduler_idle_stats_t *stats);
+void vr_scheduler_close(vr_scheduler_t *sched);
+const char *vr_idle_mode_name(vr_idle_mode_t idle);
+
+// Runtime Metrics
+void vr_histogram_record(vr_histogram_t *hist, uint64_t value_ns);
+uint64_t vr_histogram_percentile(const vr_histogram_t *hist, double percentile);
+void vr_histogram_summarize(const vr_histogram_t *hist, vr_histogram_summary_t *summary);
+void vr_histogram_subtract(vr_histogram_t *hist, const vr_histogram_t *earlier);
+void vr_metrics_get_histogram(vr_metric_t metric, vr_histogram_t *copy);
+void vr_metrics_record(vr_metric_t metric, uint64_t value_ns);
+const char *vr_metrics_name(vr_metric_t metric);
+void vr_metrics_get_snapshot(vr_metrics_snapshot_t *snapshot);
+void vr_metrics_print(void);
+int vr_metrics_format_json(char *buffer, size_t size);
+void vr_metrics_request_dump(void);
+bool vr_metrics_dump_pending(void);
 
 // Power Management
 void vr_power_init(void);
 void vr_power_enter_sleep(uint8_t sleep_level);
 void vr_power_wake_up(void);
+vr_idle_mode_t vr_power_idle_mode(const vr_embedded_config_t *config);
 float vr_power_get_voltage(void);
 float vr_power_get_current(void);
 
@@ -137,8 +980,108 @@ uint32_t vr_get_system_tick(void);
 void vr_delay_ms(uint32_t ms);
 void vr_delay_us(uint32_t us);
 
+// Wire Encoding
+int vr_codec_encode_json(const vr_telemetry_packet_t *packet, char *buffer, size_t size);
+int vr_codec_encode_json_printf(const vr_telemetry_packet_t *packet, char *buffer, size_t size);
+int vr_codec_encode_binary(const vr_telemetry_packet_t *packet, uint8_t *buffer, size_t size);
+int vr_codec_decode_binary(const uint8_t *buffer, size_t size, vr_telemetry_packet_t *packet);
+int vr_codec_encode_json_sections(const vr_telemetry_packet_t *packet, uint8_t sections,
+                                  char *buffer, size_t size);
+int vr_codec_encode_binary_sections(const vr_telemetry_packet_t *packet, uint8_t sections,
+                                    uint8_t *buffer, size_t size);
+int vr_codec_encode_json_batch(const vr_telemetry_packet_t *packets, uint32_t count, uint8_t sections,
+                               char *buffer, size_t size);
+int vr_codec_encode_binary_batch(const vr_telemetry_packet_t *packets, uint32_t count, uint8_t sections,
+                                 uint8_t *buffer, size_t size);
+const char *vr_codec_content_type(vr_wire_format_t format);
+int vr_codec_parse_format(const char *name, vr_wire_format_t *format);
+
+// RabbitMQ Publisher
+int vr_rabbitmq_init(const char *host, int port, const char *username,
+                     const char *password, const char *vhost,
+                     const char *exchange, const char *routing_key);
+void vr_rabbitmq_configure(const char *host, int port, const char *username,
+                           const char *password, const char *vhost,
+                           const char *exchange, const char *routing_key);
+void vr_rabbitmq_connect_async(void);
+void vr_rabbitmq_set_wire_format(vr_wire_format_t format);
+void vr_rabbitmq_set_delta_params(uint32_t keyframe_interval, uint32_t position_um, uint32_t quat_bits);
+void vr_rabbitmq_set_delivery_mode(vr_delivery_mode_t mode);
+void vr_rabbitmq_set_confirms(bool enabled, uint32_t window);
+int vr_rabbitmq_poll_confirms(uint32_t shard);
+int vr_rabbitmq_wait_for_confirms(uint32_t timeout_ms);
+void vr_rabbitmq_get_stats(vr_publisher_stats_t *stats);
+int vr_rabbitmq_send_telemetry(const vr_telemetry_packet_t *packet);
+int vr_rabbitmq_send_batch(const vr_telemetry_packet_t *packets, uint32_t count);
+void vr_rabbitmq_set_metrics_routing_key(const char *routing_key);
+int vr_rabbitmq_send_metrics(void);
+bool vr_rabbitmq_is_connected(void);
+bool vr_rabbitmq_is_configured(void);
+bool vr_rabbitmq_has_parameters(void);
+void vr_rabbitmq_set_reconnect(uint32_t initial_ms, uint32_t max_ms);
+void vr_rabbitmq_service(uint32_t shard);
+uint64_t vr_rabbitmq_idle_us(uint32_t shard, uint64_t now_us);
+void vr_rabbitmq_close(void);
+int vr_rabbitmq_reconnect(void);
+void vr_rabbitmq_stream_init(vr_stream_t *stream, const char *routing_key, uint8_t sections);
+const char *vr_rabbitmq_get_routing_key(void);
+int vr_rabbitmq_send_stream_batch(vr_stream_kind_t kind, const vr_telemetry_packet_t *packets,
+                                  uint32_t count);
+int vr_rabbitmq_set_stream_routing_key(vr_stream_kind_t kind, const char *routing_key);
+const char *vr_rabbitmq_get_stream_routing_key(vr_stream_kind_t kind);
+int vr_rabbitmq_set_connections(uint32_t connections);
+uint32_t vr_rabbitmq_shard_count(void);
+uint32_t vr_rabbitmq_stream_shard(vr_stream_kind_t kind);
+bool vr_rabbitmq_shard_is_connected(uint32_t shard);
+void vr_rabbitmq_get_shard_stats(uint32_t shard, vr_publisher_stats_t *stats);
+uint32_t vr_shard_hash(const void *data, size_t len);
+
+// Telemetry Streams
+const char *vr_stream_kind_name(vr_stream_kind_t kind);
+uint8_t vr_stream_kind_sections(vr_stream_kind_t kind);
+int vr_stream_parse_kind(const char *name, vr_stream_kind_t *kind);
+int vr_stream_format_routing_key(const char *base, vr_stream_kind_t kind, char *buffer, size_t size);
+
+// Publisher Connections (vr_rabbitmq_* above use built-in default publishers)
+vr_publisher_t *vr_publisher_create(void);
+void vr_publisher_destroy(vr_publisher_t *pub);
+int vr_publisher_open(vr_publisher_t *pub);
+void vr_publisher_open_async(vr_publisher_t *pub);
+void vr_publisher_service(vr_publisher_t *pub);
+uint64_t vr_publisher_idle_us(const vr_publisher_t *pub, uint64_t now_us);
+int vr_publisher_send_batch(vr_publisher_t *pub, vr_stream_t *stream,
+                            const vr_telemetry_packet_t *packets, uint32_t count);
+int vr_publisher_poll_confirms(vr_publisher_t *pub);
+int vr_publisher_wait_for_confirms(vr_publisher_t *pub, uint32_t timeout_ms);
+bool vr_publisher_is_connected(const vr_publisher_t *pub);
+void vr_publisher_get_stats(const vr_publisher_t *pub, vr_publisher_stats_t *stats);
+void vr_publisher_close(vr_publisher_t *pub);
+
+// Timestamps
+void vr_clock_init(void);
+void vr_clock_refresh(void);
+uint64_t vr_clock_monotonic_us(void);
+int64_t vr_clock_wall_offset_us(void);
+uint64_t vr_clock_wall_us(uint64_t monotonic_us);
+uint64_t vr_clock_steps(void);
+int64_t vr_clock_correct(int64_t offset, int64_t target, uint64_t elapsed_us, bool *stepped);
+
+// Capture Files
+int vr_capture_create(vr_capture_t *cap, const char *path);
+int vr_capture_append(vr_capture_t *cap, const vr_telemetry_packet_t *packet);
+int vr_capture_open(vr_capture_t *cap, const char *path);
+int vr_capture_read(const vr_capture_t *cap, uint64_t index, vr_telemetry_packet_t *packet);
+void vr_capture_close(vr_capture_t *cap);
+
+// Logging
+int vr_log_init(void);
+void vr_log_shutdown(void);
+void vr_log_write(vr_log_site_t *site, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void vr_log_get_stats(vr_log_stats_t *stats);
+
 // Utility functions
 uint64_t vr_get_timestamp_us(void);
+uint64_t vr_get_monotonic_ns(void);
 void vr_add_sensor_noise(float *value, float noise_level);
 float vr_generate_sine_wave(float time, float frequency, float amplitude);
 float vr_generate_random_walk(float *last_value, float max_change);
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""
+VR Telemetry Columns
+
+Columnar ingest for the consumer: decoded frames are written into
+preallocated numpy arrays, one per field, instead of one dict per frame.
+Binary frames and batches of complete frames are decoded with a numpy
+structured view of the message, without a Python loop per frame; JSON,
+section and delta messages go through vr_wire and are flattened row by row.
+"""
+
+import numpy as np
+
+import vr_wire
+
+# Float columns, in the order of the 38 floats of a VR_WIRE_TYPE_FRAME plus battery_level
+VALUE_COLUMNS = (
+    'head_position_x', 'head_position_y', 'head_position_z',
+    'head_orientation_x', 'head_orientation_y', 'head_orientation_z', 'head_orientation_w',
+    'head_acceleration_x', 'head_acceleration_y', 'head_acceleration_z',
+    'head_angular_velocity_x', 'head_angular_velocity_y', 'head_angular_velocity_z',
+    'left_eye_x', 'left_eye_y', 'left_eye_pupil_diameter',
+    'right_eye_x', 'right_eye_y', 'right_eye_pupil_diameter',
+    'left_hand_x', 'left_hand_y', 'left_hand_z',
+    'left_hand_orientation_x', 'left_hand_orientation_y', 'left_hand_orientation_z',
+    'left_hand_orientation_w', 'left_hand_grip_strength',
+    'right_hand_x', 'right_hand_y', 'right_hand_z',
+    'right_hand_orientation_x', 'right_hand_orientation_y', 'right_hand_orientation_z',
+    'right_hand_orientation_w', 'right_hand_grip_strength',
+    'cpu_usage', 'gpu_usage', 'temperature', 'battery_level',
+)
+
+# Integer columns: frame identity, receive time, wire flags (FLAG_*) and the
+# sections (SECTION_*) a frame carried; value columns of other sections are NaN
+INT_COLUMNS = (('timestamp_us', np.int64), ('frame_id', np.int64), ('received_us', np.int64),
+               ('flags', np.uint8), ('sections', np.uint8))
+
+COLUMNS = tuple(name for name, _ in INT_COLUMNS) + VALUE_COLUMNS
+
+# VR_WIRE_TYPE_FRAME as a packed structured dtype (170 bytes), and the same
+# frame preceded by its u16 length as it appears inside VR_WIRE_TYPE_BATCH
+_FRAME_FIELDS = [('magic', '<u2'), ('version', 'u1'), ('type', 'u1'),
+                 ('timestamp_us', '<u8'), ('frame_id', '<u4'), ('values', '<f4', (38,)),
+                 ('battery_level', 'u1'), ('flags', 'u1')]
+FRAME_DTYPE = np.dtype(_FRAME_FIELDS)
+BATCH_FRAME_DTYPE = np.dtype([('length', '<u2')] + _FRAME_FIELDS)
+assert FRAME_DTYPE.itemsize == vr_wire.FRAME.size
+
+# Value column range of each section
+_SECTION_VALUES = {vr_wire.SECTION_HEAD: (0, 13), vr_wire.SECTION_EYES: (13, 19),
+                   vr_wire.SECTION_HANDS: (19, 35), vr_wire.SECTION_STATUS: (35, 39)}
+
+
+class FrameColumns:
+    """Decoded frames of one message, column by column"""
+    __slots__ = ('timestamp_us', 'frame_id', 'flags', 'sections', 'values')
+
+    def __init__(self, timestamp_us, frame_id, flags, sections, values):
+        self.timestamp_us = timestamp_us
+        self.frame_id = frame_id
+        self.flags = flags
+        self.sections = sections
+        self.values = values          # float32 [frames, len(VALUE_COLUMNS)]
+
+    def __len__(self):
+        return len(self.frame_id)
+
+
+def _from_records(records):
+    """Columns of a structured array of complete frames"""
+    if np.any(records['magic'] != vr_wire.WIRE_MAGIC) or np.any(records['version'] != vr_wire.WIRE_VERSION):
+        raise ValueError("bad wire header in frame")
+    values = np.empty((len(records), len(VALUE_COLUMNS)), dtype=np.float32)
+    values[:, :38] = records['values']
+    values[:, 38] = records['battery_level']
+    sections = np.full(len(records), vr_wire.SECTION_ALL, dtype=np.uint8)
+    return FrameColumns(records['timestamp_us'].astype(np.int64), records['frame_id'].astype(np.int64),
+                        records['flags'].copy(), sections, values)
+
+
+def _vec(d, keys):
+    return [d[k] for k in keys]
+
+
+def _frame_flags(frame):
+    flags = 0
+    if frame.get('left_eye', {}).get('is_blinking'):
+        flags |= vr_wire.FLAG_LEFT_BLINKING
+    if frame.get('right_eye', {}).get('is_blinking'):
+        flags |= vr_wire.FLAG_RIGHT_BLINKING
+    if frame.get('left_hand', {}).get('is_tracking'):
+        flags |= vr_wire.FLAG_LEFT_TRACKING
+    if frame.get('right_hand', {}).get('is_tracking'):
+        flags |= vr_wire.FLAG_RIGHT_TRACKING
+    if frame.get('is_connected'):
+        flags |= vr_wire.FLAG_CONNECTED
+    return flags
+
+
+def _frame_row(frame, row):
+    """Flatten one frame dict into a value row (missing sections stay NaN); returns its sections"""
+    sections = 0
+    if 'head_position' in frame:
+        row[0:13] = (_vec(frame['head_position'], 'xyz') + _vec(frame['head_orientation'], 'xyzw') +
+                     _vec(frame['head_acceleration'], 'xyz') + _vec(frame['head_angular_velocity'], 'xyz'))
+        sections |= vr_wire.SECTION_HEAD
+    if 'left_eye' in frame:
+        row[13:19] = (_vec(frame['left_eye'], ('x', 'y', 'pupil_diameter')) +
+                      _vec(frame['right_eye'], ('x', 'y', 'pupil_diameter')))
+        sections |= vr_wire.SECTION_EYES
+    if 'left_hand' in frame:
+        for offset, hand in ((19, frame['left_hand']), (27, frame['right_hand'])):
+            row[offset:offset + 8] = (_vec(hand, 'xyz') + _vec(hand['orientation'], 'xyzw') +
+                                      [hand['grip_strength']])
+        sections |= vr_wire.SECTION_HANDS
+    if 'cpu_usage' in frame:
+        row[35:39] = [frame['cpu_usage'], frame['gpu_usage'], frame['temperature'], frame['battery_level']]
+        sections |= vr_wire.SECTION_STATUS
+    return sections
+
+
+def columns_from_frames(frames):
+    """Columns of a list of frame dicts as produced by vr_wire"""
+    n = len(frames)
+    values = np.full((n, len(VALUE_COLUMNS)), np.nan, dtype=np.float32)
+    timestamp_us = np.empty(n, dtype=np.int64)
+    frame_id = np.empty(n, dtype=np.int64)
+    flags = np.empty(n, dtype=np.uint8)
+    sections = np.empty(n, dtype=np.uint8)
+    for i, frame in enumerate(frames):
+        timestamp_us[i] = frame.get('timestamp_us', 0)
+        frame_id[i] = frame.get('frame_id', 0)
+        flags[i] = _frame_flags(frame)
+        sections[i] = _frame_row(frame, values[i])
+    return FrameColumns(timestamp_us, frame_id, flags, sections, values)
+
+
+def decode_columns(body, content_type=None, delta_decoder=None):
+    """Decode a telemetry message straight into columns.
+
+    Single binary frames and batches of complete binary frames take the
+    vectorized path; everything else is decoded by vr_wire and flattened.
+    """
+    media_type, _ = vr_wire.parse_content_type(content_type)
+    if media_type == vr_wire.CONTENT_TYPE_BINARY and len(body) >= vr_wire.HEADER.size:
+        msg_type = body[3]
+        if msg_type == vr_wire.WIRE_TYPE_FRAME and len(body) >= FRAME_DTYPE.itemsize:
+            return _from_records(np.frombuffer(body, dtype=FRAME_DTYPE, count=1))
+        if msg_type == vr_wire.WIRE_TYPE_BATCH:
+            count = vr_wire.BATCH_HEADER.unpack_from(body, 0)[3]
+            end = vr_wire.BATCH_HEADER.size + count * BATCH_FRAME_DTYPE.itemsize
+            if count and len(body) == end:
+                records = np.frombuffer(body, dtype=BATCH_FRAME_DTYPE, count=count,
+                                        offset=vr_wire.BATCH_HEADER.size)
+                if (np.all(records['length'] == FRAME_DTYPE.itemsize) and
+                        np.all(records['type'] == vr_wire.WIRE_TYPE_FRAME)):
+                    return _from_records(records)
+    return columns_from_frames(vr_wire.decode_message(body, content_type, delta_decoder))
+
+
+class ColumnRing:
+    """Preallocated ring of the last `capacity` frames, one array per column.
+
+    The value columns are the columns of one Fortran-ordered block, so each
+    is contiguous and a message's frames are stored with one copy per block.
+    """
+
+    def __init__(self, capacity=100000):
+        self.capacity = capacity
+        self.values = np.full((capacity, len(VALUE_COLUMNS)), np.nan, dtype=np.float32, order='F')
+        self.columns = {name: np.zeros(capacity, dtype=dtype) for name, dtype in INT_COLUMNS}
+        for i, name in enumerate(VALUE_COLUMNS):
+            self.columns[name] = self.values[:, i]
+        self.head = 0                 # Total frames written; next slot is head % capacity
+
+    def __len__(self):
+        return min(self.head, self.capacity)
+
+    def append(self, frames, received_us):
+        """Store the FrameColumns of one message"""
+        n = len(frames)
+        if n == 0:
+            return
+        if n > self.capacity:
+            frames = FrameColumns(frames.timestamp_us[-self.capacity:], frames.frame_id[-self.capacity:],
+                                  frames.flags[-self.capacity:], frames.sections[-self.capacity:],
+                                  frames.values[-self.capacity:])
+            self.head += n - self.capacity
+            n = self.capacity
+
+        start = self.head % self.capacity
+        first = min(n, self.capacity - start)
+        for lo, hi, src in ((start, start + first, slice(0, first)), (0, n - first, slice(first, n))):
+            if hi <= lo:
+                continue
+            self.values[lo:hi] = frames.values[src]
+            self.columns['timestamp_us'][lo:hi] = frames.timestamp_us[src]
+            self.columns['frame_id'][lo:hi] = frames.frame_id[src]
+            self.columns['received_us'][lo:hi] = received_us
+            self.columns['flags'][lo:hi] = frames.flags[src]
+            self.columns['sections'][lo:hi] = frames.sections[src]
+        self.head += n
+
+    def latest(self, count=None, columns=None):
+        """The most recent `count` frames (all if None), oldest first, as {column: array}.
+
+        Slices are views while they do not wrap around the end of the ring;
+        copy them if they must outlive the next append.
+        """
+        size = len(self)
+        count = size if count is None else min(count, size)
+        names = columns or COLUMNS
+        end = self.head % self.capacity
+        start = end - count
+        if start >= 0:
+            return {name: self.columns[name][start:end] for name in names}
+        return {name: np.concatenate((self.columns[name][start:], self.columns[name][:end]))
+                for name in names}
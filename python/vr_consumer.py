@@ -6,12 +6,10 @@ This script consumes VR telemetry data from RabbitMQ and provides
 real-time visualization and analysis capabilities.
 """
 
-import json
 import time
 import threading
 import signal
 import sys
-from collections import deque
 from datetime import datetime, timedelta
 import argparse
 
@@ -30,9 +28,63 @@ from dash import dcc, html, Input, Output, dash_table
 import dash_bootstrap_components as dbc
 import psutil
 
+import vr_wire
+import vr_columns
+
+# Latency stages, measured on the frames' timestamp_us, the producer's
+# published_us header and the consumer's receive time (all wall-clock
+# microseconds, so publish->receive needs producer and consumer clocks in sync)
+LATENCY_STAGES = ('sample_to_publish', 'publish_to_receive', 'sample_to_receive')
+
+# Ingest defaults: frames kept in memory, unacknowledged messages the broker
+# may send ahead, and messages acknowledged at once (with multiple=True)
+DEFAULT_CAPACITY = 100000
+DEFAULT_PREFETCH = 1000
+DEFAULT_ACK_BATCH = 100
+ACK_FLUSH_INTERVAL_S = 0.1     # Acknowledge a partial batch after this long
+HISTORY_POINTS = 100           # Frames plotted by the visualizer
+
+def latency_summary(values_us):
+    """Count and p50/p99/max in milliseconds of an array of latency samples"""
+    if len(values_us) == 0:
+        return {'count': 0, 'p50_ms': None, 'p99_ms': None, 'max_ms': None}
+    values = np.asarray(values_us, dtype=np.float64) / 1000.0
+    p50, p99 = np.percentile(values, [50, 99])
+    return {'count': len(values), 'p50_ms': float(p50), 'p99_ms': float(p99),
+            'max_ms': float(values.max())}
+
+class LatencyWindow:
+    """Rolling window of latency samples in microseconds"""
+    def __init__(self, size=10000):
+        self.samples = np.zeros(size, dtype=np.float64)
+        self.count = 0
+    
+    def add(self, value_us):
+        self.samples[self.count % len(self.samples)] = value_us
+        self.count += 1
+    
+    def extend(self, values_us):
+        """Add an array of samples"""
+        values_us = values_us[-len(self.samples):]
+        start = self.count % len(self.samples)
+        first = min(len(values_us), len(self.samples) - start)
+        self.samples[start:start + first] = values_us[:first]
+        self.samples[:len(values_us) - first] = values_us[first:]
+        self.count += len(values_us)
+    
+    def values(self):
+        """Samples currently in the window (unordered)"""
+        return self.samples[:min(self.count, len(self.samples))]
+    
+    def summary(self):
+        """Count and p50/p99/max in milliseconds over the window"""
+        return latency_summary(self.values())
+
 class VRTelemetryConsumer:
     def __init__(self, host='localhost', port=5672, username='guest', password='guest',
-                 vhost='/', exchange='vr_telemetry', routing_key='telemetry.data'):
+                 vhost='/', exchange='vr_telemetry', routing_key='telemetry.data',
+                 capacity=DEFAULT_CAPACITY, prefetch=DEFAULT_PREFETCH, ack_batch=DEFAULT_ACK_BATCH,
+                 exporter=None):
         self.host = host
         self.port = port
         self.username = username
@@ -40,25 +92,32 @@ class VRTelemetryConsumer:
         self.vhost = vhost
         self.exchange = exchange
         self.routing_key = routing_key
+        self.prefetch = prefetch
+        # More unacknowledged messages than the prefetch window would never arrive
+        self.ack_batch = min(ack_batch, prefetch) if prefetch > 0 else ack_batch
         
         self.connection = None
         self.channel = None
         self.running = False
         
-        # Data storage
-        self.telemetry_data = deque(maxlen=1000)  # Keep last 1000 data points
+        # Data storage: the last `capacity` frames, one preallocated array per field
+        self.telemetry_data = vr_columns.ColumnRing(capacity)
+        self.delta_decoders = {}  # Delta streams are decoded per routing key (one per device)
+        self.exporter = exporter  # Optional vr_export.ColumnExporter receiving every frame
         self.stats = {
             'total_messages': 0,
-            'start_time': None,
-            'last_message_time': None,
-            'message_rate': 0.0
+            'total_frames': 0,
+            'start_us': None,
+            'last_message_us': None,
         }
         
-        # Performance metrics
-        self.cpu_usage_history = deque(maxlen=100)
-        self.gpu_usage_history = deque(maxlen=100)
-        self.temperature_history = deque(maxlen=100)
-        self.battery_history = deque(maxlen=100)
+        # Manual acknowledgements not yet sent
+        self.unacked = 0
+        self.last_delivery_tag = None
+        self.progress_interval = 100  # Messages between console status lines (0 = none)
+        
+        # End-to-end latency per stage (see LATENCY_STAGES)
+        self.latency = {stage: LatencyWindow() for stage in LATENCY_STAGES}
         
     def connect(self):
         """Connect to RabbitMQ"""
@@ -80,12 +139,10 @@ class VRTelemetryConsumer:
             # Declare queue
             result = self.channel.queue_declare(queue='', exclusive=True)
             queue_name = result.method.queue
+            if self.ack_batch > 0 and self.prefetch > 0:
+                self.channel.basic_qos(prefetch_count=self.prefetch)
             
-            # Bind queue to exchange
-            self.channel.queue_bind(exchange=self.exchange, queue=queue_name, routing_key=self.routing_key)
-            
-            print(f"Connected to RabbitMQ at {self.host}:{self.port}")
-            print(f"Listening to exchange: {self.exchange}, routing key: {self.routing_key}")
+            self.bind_queue(queue_name)
             
             return True
             
@@ -93,42 +150,81 @@ class VRTelemetryConsumer:
             print(f"Failed to connect to RabbitMQ: {e}")
             return False
     
+    def bind_queue(self, queue_name):
+        """Bind the queue to the exchange, once per comma-separated routing key"""
+        for routing_key in self.routing_key.split(','):
+            if routing_key.strip():
+                self.channel.queue_bind(exchange=self.exchange, queue=queue_name,
+                                        routing_key=routing_key.strip())
+        
+        print(f"Connected to RabbitMQ at {self.host}:{self.port}")
+        print(f"Listening to exchange: {self.exchange}, routing key: {self.routing_key}")
+    
     def process_message(self, ch, method, properties, body):
         """Process incoming telemetry message"""
         try:
-            data = json.loads(body.decode('utf-8'))
-            
-            # Add timestamp
-            data['received_at'] = datetime.now().isoformat()
+            received_us = time.time_ns() // 1000
+            content_type = properties.content_type if properties else None
+            headers = (properties.headers if properties else None) or {}
+            published_us = headers.get('published_us')
+            decoder = self.delta_decoders.get(method.routing_key)
+            if decoder is None:
+                decoder = self.delta_decoders[method.routing_key] = vr_wire.DeltaDecoder()
+            frames = vr_columns.decode_columns(body, content_type, decoder)
+            self.telemetry_data.append(frames, received_us)
+            if self.exporter:
+                self.exporter.submit(frames, received_us)
             
-            # Store data
-            self.telemetry_data.append(data)
+            if published_us is not None:
+                self.latency['publish_to_receive'].add(received_us - published_us)
+            sampled_us = frames.timestamp_us[frames.timestamp_us > 0]
+            if len(sampled_us):
+                self.latency['sample_to_receive'].extend(received_us - sampled_us)
+                if published_us is not None:
+                    self.latency['sample_to_publish'].extend(published_us - sampled_us)
             
-            # Update statistics
+            # Update statistics (rates are derived when read, see get_statistics)
             self.stats['total_messages'] += 1
-            if self.stats['start_time'] is None:
-                self.stats['start_time'] = datetime.now()
-            self.stats['last_message_time'] = datetime.now()
-            
-            # Calculate message rate
-            if self.stats['start_time']:
-                elapsed = (datetime.now() - self.stats['start_time']).total_seconds()
-                if elapsed > 0:
-                    self.stats['message_rate'] = self.stats['total_messages'] / elapsed
-            
-            # Update performance metrics
-            self.cpu_usage_history.append(data.get('cpu_usage', 0))
-            self.gpu_usage_history.append(data.get('gpu_usage', 0))
-            self.temperature_history.append(data.get('temperature', 0))
-            self.battery_history.append(data.get('battery_level', 0))
+            self.stats['total_frames'] += len(frames)
+            if self.stats['start_us'] is None:
+                self.stats['start_us'] = received_us
+            self.stats['last_message_us'] = received_us
             
-            # Print status every 100 messages
-            if self.stats['total_messages'] % 100 == 0:
-                print(f"Processed {self.stats['total_messages']} messages "
-                      f"(Rate: {self.stats['message_rate']:.1f} msg/s)")
+            # Print status every progress_interval messages
+            if self.progress_interval and self.stats['total_messages'] % self.progress_interval == 0:
+                stats = self.get_statistics()
+                e2e = stats['latency']['sample_to_receive']
+                latency = (f", latency p50 {e2e['p50_ms']:.2f} p99 {e2e['p99_ms']:.2f} ms"
+                           if e2e['count'] else "")
+                print(f"Processed {stats['total_messages']} messages, "
+                      f"{stats['total_frames']} frames "
+                      f"(Rate: {stats['message_rate']:.1f} msg/s, "
+                      f"{stats['frame_rate']:.1f} frames/s{latency})")
             
         except Exception as e:
             print(f"Error processing message: {e}")
+        finally:
+            if self.ack_batch > 0:
+                self.ack(method.delivery_tag)
+    
+    def ack(self, delivery_tag):
+        """Acknowledge a message, sending acks ack_batch at a time"""
+        self.unacked += 1
+        self.last_delivery_tag = delivery_tag
+        if self.unacked >= self.ack_batch:
+            self.flush_acks()
+    
+    def flush_acks(self):
+        """Acknowledge every message received so far"""
+        if self.unacked and self.channel and self.channel.is_open:
+            self.channel.basic_ack(delivery_tag=self.last_delivery_tag, multiple=True)
+        self.unacked = 0
+    
+    def _ack_timer(self):
+        """Acknowledge partial batches so a slow stream is not held at the broker"""
+        self.flush_acks()
+        if self.running:
+            self.connection.call_later(ACK_FLUSH_INTERVAL_S, self._ack_timer)
     
     def start_consuming(self):
         """Start consuming messages"""
@@ -137,12 +233,14 @@ class VRTelemetryConsumer:
         
         self.running = True
         
-        # Set up consumer
+        # Set up consumer; with ack batching off the broker treats delivery as acknowledgement
         self.channel.basic_consume(
             queue='',
             on_message_callback=self.process_message,
-            auto_ack=True
+            auto_ack=self.ack_batch <= 0
         )
+        if self.ack_batch > 0:
+            self.connection.call_later(ACK_FLUSH_INTERVAL_S, self._ack_timer)
         
         print("Starting to consume messages... (Press Ctrl+C to stop)")
         
@@ -158,31 +256,50 @@ class VRTelemetryConsumer:
         """Stop consuming messages"""
         self.running = False
         if self.channel:
+            self.flush_acks()
             self.channel.stop_consuming()
         if self.connection:
             self.connection.close()
         print("Consumer stopped.")
     
-    def get_latest_data(self, count=1):
-        """Get latest telemetry data"""
-        if not self.telemetry_data:
+    def get_latest_data(self, count=1, columns=None):
+        """Latest `count` frames as {column: numpy array}, oldest first (see vr_columns.COLUMNS).
+
+        Value columns of sections a frame did not carry are NaN.
+        """
+        if not len(self.telemetry_data):
             return None
-        return list(self.telemetry_data)[-count:] if count > 1 else self.telemetry_data[-1]
+        return self.telemetry_data.latest(count, columns)
     
     def get_statistics(self):
-        """Get consumer statistics"""
-        return self.stats.copy()
+        """Get consumer statistics, with rolling latency summaries per stage"""
+        stats = {'total_messages': self.stats['total_messages'],
+                 'total_frames': self.stats['total_frames'],
+                 'start_time': None, 'last_message_time': None,
+                 'message_rate': 0.0, 'frame_rate': 0.0}
+        start_us, last_us = self.stats['start_us'], self.stats['last_message_us']
+        if start_us is not None:
+            stats['start_time'] = datetime.fromtimestamp(start_us / 1e6)
+            stats['last_message_time'] = datetime.fromtimestamp(last_us / 1e6)
+            elapsed = (last_us - start_us) / 1e6
+            if elapsed > 0:
+                stats['message_rate'] = stats['total_messages'] / elapsed
+                stats['frame_rate'] = stats['total_frames'] / elapsed
+        stats['latency'] = {stage: window.summary() for stage, window in self.latency.items()}
+        if self.exporter:
+            stats['export'] = dict(self.exporter.stats)
+        return stats
     
     def export_data(self, filename=None):
         """Export telemetry data to CSV"""
-        if not self.telemetry_data:
+        if not len(self.telemetry_data):
             print("No data to export")
             return False
         
         if filename is None:
             filename = f"vr_telemetry_{datetime.now().strftime('%Y%m%d_%H%M%S')}.csv"
         
-        df = pd.DataFrame(list(self.telemetry_data))
+        df = pd.DataFrame(self.telemetry_data.latest())
         df.to_csv(filename, index=False)
         print(f"Data exported to {filename}")
         return True
@@ -250,12 +367,10 @@ class VRTelemetryVisualizer:
         
     def update_plots(self, frame):
         """Update plots with latest data"""
-        if not self.consumer.telemetry_data:
-            return
-        
-        # Get latest data
-        latest_data = self.consumer.get_latest_data()
-        if not latest_data:
+        data = self.consumer.get_latest_data(self.consumer.telemetry_data.capacity,
+                                             columns=('sections', 'cpu_usage', 'gpu_usage', 'temperature',
+                                                      'battery_level', 'head_position_x', 'head_position_y'))
+        if data is None:
             return
         
         # Clear axes
@@ -265,30 +380,36 @@ class VRTelemetryVisualizer:
         # Update plots
         self.setup_plots()
         
-        # CPU/GPU Usage
-        if len(self.consumer.cpu_usage_history) > 1:
-            self.axes[0, 0].plot(list(self.consumer.cpu_usage_history), label='CPU', color='blue')
-            self.axes[0, 0].plot(list(self.consumer.gpu_usage_history), label='GPU', color='red')
+        # System status of the last frames that carried it (pose and eye streams do not)
+        status = (data['sections'] & vr_wire.SECTION_STATUS) != 0
+        status_rows = np.flatnonzero(status)[-HISTORY_POINTS:]
+        if len(status_rows) > 1:
+            self.axes[0, 0].plot(data['cpu_usage'][status_rows], label='CPU', color='blue')
+            self.axes[0, 0].plot(data['gpu_usage'][status_rows], label='GPU', color='red')
             self.axes[0, 0].legend()
-        
-        # Temperature
-        if len(self.consumer.temperature_history) > 1:
-            self.axes[0, 1].plot(list(self.consumer.temperature_history), color='orange')
-        
-        # Battery Level
-        if len(self.consumer.battery_history) > 1:
-            self.axes[1, 0].plot(list(self.consumer.battery_history), color='green')
+            self.axes[0, 1].plot(data['temperature'][status_rows], color='orange')
+            self.axes[1, 0].plot(data['battery_level'][status_rows], color='green')
         
         # Head Position
-        if 'head_position' in latest_data:
-            pos = latest_data['head_position']
-            self.axes[1, 1].plot([pos['x']], [pos['y']], 'bo', markersize=8)
-            self.axes[1, 1].set_xlim(pos['x'] - 0.5, pos['x'] + 0.5)
-            self.axes[1, 1].set_ylim(pos['y'] - 0.5, pos['y'] + 0.5)
+        head_rows = np.flatnonzero(data['sections'] & vr_wire.SECTION_HEAD)
+        if len(head_rows):
+            x = float(data['head_position_x'][head_rows[-1]])
+            y = float(data['head_position_y'][head_rows[-1]])
+            self.axes[1, 1].plot([x], [y], 'bo', markersize=8)
+            self.axes[1, 1].set_xlim(x - 0.5, x + 0.5)
+            self.axes[1, 1].set_ylim(y - 0.5, y + 0.5)
         
         # Update statistics
         stats = self.consumer.get_statistics()
-        stats_text = f"Messages: {stats['total_messages']} | Rate: {stats['message_rate']:.1f} msg/s"
+        stats_text = (f"Messages: {stats['total_messages']} | Rate: {stats['message_rate']:.1f} msg/s | "
+                      f"Frames: {stats['total_frames']} ({stats['frame_rate']:.1f}/s)")
+        for stage, label in (('sample_to_publish', 'Sample→Publish'),
+                             ('publish_to_receive', 'Publish→Receive'),
+                             ('sample_to_receive', 'End-to-end')):
+            summary = stats['latency'][stage]
+            if summary['count']:
+                stats_text += (f" | {label} p50 {summary['p50_ms']:.2f} / p99 {summary['p99_ms']:.2f}"
+                               f" / max {summary['max_ms']:.2f} ms")
         self.stats_label.config(text=stats_text)
         
     def export_data(self):
@@ -304,6 +425,31 @@ def signal_handler(sig, frame):
     print("\nShutting down...")
     sys.exit(0)
 
+def run_pool(args):
+    """Consume with a pool of worker processes"""
+    import vr_pool
+    export = None
+    if args.export_dir:
+        export = dict(directory=args.export_dir, fmt=args.export_format, row_group=args.export_row_group,
+                      rotate_mb=args.export_rotate_mb, rotate_s=args.export_rotate_s)
+    pool = vr_pool.ConsumerPool(
+        args.workers,
+        shard_by=args.shard_by,
+        devices=args.devices,
+        export=export,
+        host=args.host,
+        port=args.port,
+        username=args.username,
+        password=args.password,
+        vhost=args.vhost,
+        exchange=args.exchange,
+        routing_key=args.routing_key,
+        capacity=args.capacity,
+        prefetch=args.prefetch,
+        ack_batch=args.ack_batch
+    )
+    pool.run()
+
 def main():
     parser = argparse.ArgumentParser(description='VR Telemetry Consumer')
     parser.add_argument('--host', default='localhost', help='RabbitMQ host')
@@ -312,15 +458,61 @@ def main():
     parser.add_argument('--password', default='guest', help='RabbitMQ password')
     parser.add_argument('--vhost', default='/', help='RabbitMQ vhost')
     parser.add_argument('--exchange', default='vr_telemetry', help='RabbitMQ exchange')
-    parser.add_argument('--routing-key', default='telemetry.data', help='RabbitMQ routing key')
+    parser.add_argument('--routing-key', default='telemetry.data',
+                        help="RabbitMQ routing key, comma-separated for several streams "
+                             "(use 'telemetry.*.data' for --devices, 'telemetry.pose,telemetry.status' for split streams)")
     parser.add_argument('--visualize', action='store_true', help='Enable real-time visualization')
     parser.add_argument('--export-interval', type=int, default=0, help='Auto-export interval in seconds (0 = disabled)')
+    parser.add_argument('--capacity', type=int, default=DEFAULT_CAPACITY,
+                        help='Frames kept in memory for plots and export')
+    parser.add_argument('--prefetch', type=int, default=DEFAULT_PREFETCH,
+                        help='Unacknowledged messages the broker may send ahead (0 = unlimited)')
+    parser.add_argument('--ack-batch', type=int, default=DEFAULT_ACK_BATCH,
+                        help='Acknowledge messages this many at a time (0 = auto-ack on delivery)')
+    parser.add_argument('--export-dir', help='Continuously export every frame to rolling files in this directory')
+    parser.add_argument('--export-format', choices=('parquet', 'arrow'), default='parquet',
+                        help='Export file format: Parquet or Arrow IPC')
+    parser.add_argument('--export-row-group', type=int, default=65536, help='Frames per exported row group')
+    parser.add_argument('--export-rotate-mb', type=int, default=256,
+                        help='Start a new export file after this many MB (0 = no size limit)')
+    parser.add_argument('--export-rotate-s', type=int, default=3600,
+                        help='Start a new export file after this many seconds (0 = no time limit)')
+    parser.add_argument('--workers', type=int, default=1,
+                        help='Consumer processes, each with its own connection and shard of the streams')
+    parser.add_argument('--shard-by', choices=('device', 'hash'),
+                        help='Split streams across workers by device id (needs --devices) or by a '
+                             'consistent-hash exchange (default: device with --devices, else hash)')
+    parser.add_argument('--devices', type=int, default=0,
+                        help="Number of simulated headsets publishing (the simulator's --devices)")
     
     args = parser.parse_args()
     
+    if args.workers > 1 and args.visualize:
+        parser.error('--visualize needs a single consumer process (--workers 1)')
+    if args.shard_by == 'device' and args.devices <= 0:
+        parser.error('--shard-by device needs --devices')
+    args.shard_by = args.shard_by or ('device' if args.devices > 0 else 'hash')
+    if args.workers > 1 and args.shard_by == 'hash':
+        import vr_pool
+        problem = vr_pool.hash_sharding_problem(args.routing_key, args.workers)
+        if problem:
+            parser.error(problem)
+    
     # Set up signal handler
     signal.signal(signal.SIGINT, signal_handler)
     
+    if args.workers > 1:
+        run_pool(args)
+        return
+    
+    # Continuous export (pyarrow is only needed with --export-dir)
+    exporter = None
+    if args.export_dir:
+        import vr_export
+        exporter = vr_export.ColumnExporter(args.export_dir, args.export_format, args.export_row_group,
+                                            args.export_rotate_mb, args.export_rotate_s)
+        exporter.start()
+    
     # Create consumer
     consumer = VRTelemetryConsumer(
         host=args.host,
@@ -329,30 +521,39 @@ def main():
         password=args.password,
         vhost=args.vhost,
         exchange=args.exchange,
-        routing_key=args.routing_key
+        routing_key=args.routing_key,
+        capacity=args.capacity,
+        prefetch=args.prefetch,
+        ack_batch=args.ack_batch,
+        exporter=exporter
     )
     
-    if args.visualize:
-        # Run with visualization
-        visualizer = VRTelemetryVisualizer(consumer)
-        
-        # Start consumer in separate thread
-        consumer_thread = threading.Thread(target=consumer.start_consuming)
-        consumer_thread.daemon = True
-        consumer_thread.start()
-        
-        # Run visualizer
-        visualizer.run()
-    else:
-        # Run without visualization
-        consumer.start_consuming()
+    try:
+        if args.visualize:
+            # Run with visualization
+            visualizer = VRTelemetryVisualizer(consumer)
+            
+            # Start consumer in separate thread
+            consumer_thread = threading.Thread(target=consumer.start_consuming)
+            consumer_thread.daemon = True
+            consumer_thread.start()
+            
+            # Run visualizer
+            visualizer.run()
+        else:
+            # Run without visualization
+            consumer.start_consuming()
+    finally:
+        # Write out the last partial row group on any exit, Ctrl+C included
+        if exporter:
+            exporter.stop()
     
     # Auto-export if enabled
     if args.export_interval > 0:
         def auto_export():
             while consumer.running:
                 time.sleep(args.export_interval)
-                if consumer.telemetry_data:
+                if len(consumer.telemetry_data):
                     consumer.export_data()
         
         export_thread = threading.Thread(target=auto_export)
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+VR Telemetry Export
+
+Continuous columnar export of consumed frames. The consumer hands each
+message's decoded columns to a ColumnExporter, which queues them without
+blocking; a background thread gathers them into fixed-size row groups and
+appends those to rolling Arrow IPC or Parquet files, starting a new file
+when the current one reaches a size or age limit.
+"""
+
+import os
+import queue
+import threading
+import time
+from datetime import datetime
+
+import numpy as np
+import pyarrow as pa
+import pyarrow.ipc
+import pyarrow.parquet
+
+import vr_columns
+
+EXPORT_FORMATS = ('parquet', 'arrow')
+DEFAULT_ROW_GROUP = 65536
+DEFAULT_ROTATE_MB = 256
+DEFAULT_ROTATE_S = 3600
+QUEUE_MESSAGES = 100000        # Messages buffered for the writer thread before export drops them
+
+_ARROW_TYPES = {np.dtype(np.int64): pa.int64(), np.dtype(np.uint8): pa.uint8()}
+
+SCHEMA = pa.schema([pa.field(name, _ARROW_TYPES[np.dtype(dtype)]) for name, dtype in vr_columns.INT_COLUMNS] +
+                   [pa.field(name, pa.float32()) for name in vr_columns.VALUE_COLUMNS])
+
+
+class ColumnExporter:
+    """Background writer of decoded frames to rotating Arrow IPC or Parquet files"""
+
+    def __init__(self, directory, fmt='parquet', row_group=DEFAULT_ROW_GROUP,
+                 rotate_mb=DEFAULT_ROTATE_MB, rotate_s=DEFAULT_ROTATE_S, prefix='vr_telemetry'):
+        if fmt not in EXPORT_FORMATS:
+            raise ValueError(f"unknown export format {fmt}")
+        self.directory = directory
+        self.fmt = fmt
+        self.row_group = max(1, row_group)
+        self.rotate_bytes = rotate_mb * 1024 * 1024 if rotate_mb > 0 else 0
+        self.rotate_s = rotate_s
+        self.prefix = prefix
+
+        self.queue = queue.Queue(maxsize=QUEUE_MESSAGES)
+        self.thread = None
+        self.stats = {'frames_written': 0, 'row_groups': 0, 'files': 0, 'messages_dropped': 0}
+
+        # Writer thread state
+        self._pending = []
+        self._pending_rows = 0
+        self._writer = None
+        self._sink = None
+        self._path = None
+        self._opened_at = 0.0
+        self._file_index = 0
+
+    def start(self):
+        """Start the writer thread"""
+        os.makedirs(self.directory, exist_ok=True)
+        self.thread = threading.Thread(target=self._run, name='vr-export', daemon=True)
+        self.thread.start()
+
+    def submit(self, frames, received_us):
+        """Queue one message's FrameColumns; never blocks (drops and counts when the writer is behind)"""
+        try:
+            self.queue.put_nowait((frames, received_us))
+        except queue.Full:
+            self.stats['messages_dropped'] += 1
+
+    def stop(self):
+        """Write out everything queued, close the current file and stop the thread"""
+        if self.thread is None:
+            return
+        self.queue.put(None)
+        self.thread.join()
+        self.thread = None
+
+    def _run(self):
+        while True:
+            try:
+                item = self.queue.get(timeout=1.0)
+            except queue.Empty:
+                item = ()
+            if item is None:
+                break
+            if item:
+                frames, received_us = item
+                self._pending.append(self._batch(frames, received_us))
+                self._pending_rows += len(frames)
+                while self._pending_rows >= self.row_group:
+                    self._write_row_group()
+            if self._writer is not None and self.rotate_s > 0 and time.monotonic() - self._opened_at >= self.rotate_s:
+                self._write_row_group()
+                self._close_file()
+        self._write_row_group()
+        self._close_file()
+
+    @staticmethod
+    def _batch(frames, received_us):
+        """Record batch of one message's frames"""
+        arrays = {
+            'timestamp_us': frames.timestamp_us,
+            'frame_id': frames.frame_id,
+            'received_us': np.full(len(frames), received_us, dtype=np.int64),
+            'flags': frames.flags,
+            'sections': frames.sections,
+        }
+        columns = [pa.array(arrays[name]) for name, _ in vr_columns.INT_COLUMNS]
+        columns += [pa.array(np.ascontiguousarray(frames.values[:, i])) for i in range(len(vr_columns.VALUE_COLUMNS))]
+        return pa.RecordBatch.from_arrays(columns, schema=SCHEMA)
+
+    def _write_row_group(self):
+        """Write the first row_group pending frames (all of them if fewer) as one row group"""
+        if not self._pending_rows:
+            return
+        pending = pa.Table.from_batches(self._pending, schema=SCHEMA)
+        rows = min(self.row_group, pending.num_rows)
+        group = pending.slice(0, rows).combine_chunks()
+        rest = pending.slice(rows)
+        self._pending = rest.to_batches()
+        self._pending_rows = rest.num_rows
+
+        if self._writer is None:
+            self._open_file()
+        if self.fmt == 'parquet':
+            self._writer.write_table(group, row_group_size=rows)
+        else:
+            self._writer.write_table(group)
+        self.stats['frames_written'] += rows
+        self.stats['row_groups'] += 1
+
+        if self.rotate_bytes and self._sink.tell() >= self.rotate_bytes:
+            self._close_file()
+
+    def _open_file(self):
+        stamp = datetime.now().strftime('%Y%m%d_%H%M%S')
+        self._path = os.path.join(self.directory, f"{self.prefix}_{stamp}_{self._file_index:04d}.{self.fmt}")
+        self._file_index += 1
+        self._sink = pa.OSFile(self._path, 'wb')
+        if self.fmt == 'parquet':
+            self._writer = pyarrow.parquet.ParquetWriter(self._sink, SCHEMA)
+        else:
+            self._writer = pyarrow.ipc.new_file(self._sink, SCHEMA)
+        self._opened_at = time.monotonic()
+        self.stats['files'] += 1
+
+    def _close_file(self):
+        if self._writer is None:
+            return
+        self._writer.close()
+        self._sink.close()
+        print(f"Exported {self._path}")
+        self._writer = None
+        self._sink = None
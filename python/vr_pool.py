@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""
+VR Telemetry Consumer Pool
+
+Runs several consumer processes, each with its own broker connection and
+queue, so consumption is not limited to the one core a Python process can
+use. Each worker receives a disjoint shard of the routing keys, so every
+device's stream (and its delta decoder state) stays in one worker:
+
+- 'device': worker w binds the per-device keys of devices w, w + W, ...
+  of the multi-headset routing scheme (telemetry.<id>.data).
+- 'hash':   a consistent-hash exchange bound to the telemetry exchange
+  spreads routing keys over the worker queues (requires the
+  rabbitmq_consistent_hash_exchange plugin).
+
+The hash exchange hashes the routing key, not the message, so every message
+with the same key lands on the same worker. A single headset publishing on
+one key (telemetry.data) would keep one worker busy and the rest idle. The
+pool therefore refuses hash sharding over a single literal key, and warns
+when there are fewer literal keys than workers. Bind a wildcard such as
+telemetry.*.data when many devices publish, or use 'device' sharding.
+
+Workers report their counters and latency samples to the coordinator,
+which merges them into pool-wide statistics.
+"""
+
+import multiprocessing
+import queue
+import signal
+import time
+
+import numpy as np
+
+from vr_consumer import VRTelemetryConsumer, LATENCY_STAGES, latency_summary
+
+SHARD_MODES = ('device', 'hash')
+REPORT_INTERVAL_S = 1.0        # Worker -> coordinator statistics
+PRINT_INTERVAL_S = 5.0         # Coordinator status line
+
+
+def device_routing_key(base, device_id):
+    """Per-device key of a base key, like vr_device_format_routing_key.
+
+    The id fills a '*' segment if the key has one (telemetry.*.data), else
+    it goes before the last segment (telemetry.data -> telemetry.<id>.data).
+    """
+    segments = base.split('.')
+    if '*' in segments:
+        segments[segments.index('*')] = str(device_id)
+        return '.'.join(segments)
+    prefix, dot, last = base.rpartition('.')
+    return f"{prefix}.{device_id}.{last}" if dot else f"{base}.{device_id}"
+
+
+def device_shard_keys(routing_key, index, workers, devices):
+    """Per-device keys worker `index` of `workers` binds: devices index, index + workers, ..."""
+    bases = [key.strip() for key in routing_key.split(',') if key.strip()]
+    return [device_routing_key(base, device_id) for base in bases
+            for device_id in range(index, devices, workers)]
+
+
+def hash_keys(routing_key):
+    """Literal keys of a binding list, or None if any key is a wildcard pattern"""
+    keys = [key.strip() for key in routing_key.split(',') if key.strip()]
+    if any(segment in ('*', '#') for key in keys for segment in key.split('.')):
+        return None
+    return keys
+
+
+def hash_sharding_problem(routing_key, workers):
+    """Why hash sharding cannot spread routing_key over workers, or None"""
+    keys = hash_keys(routing_key)
+    if workers > 1 and keys is not None and len(keys) <= 1:
+        return (f"hash sharding routes by routing key, so every message on '{routing_key}' "
+                f"would go to one of the {workers} workers; bind a pattern such as "
+                f"'telemetry.*.data' for a fleet, use --shard-by device, or run one worker")
+    return None
+
+
+class ShardConsumer(VRTelemetryConsumer):
+    """A pool worker: one shard of the routing keys on its own connection"""
+
+    def __init__(self, index, workers, shard_by, devices, stop_event, reports, **options):
+        super().__init__(**options)
+        self.index = index
+        self.workers = workers
+        self.shard_by = shard_by
+        self.devices = devices
+        self.stop_event = stop_event
+        self.reports = reports
+        self.progress_interval = 0  # The coordinator prints pool-wide status
+
+    def bind_queue(self, queue_name):
+        bases = [key.strip() for key in self.routing_key.split(',') if key.strip()]
+        if self.shard_by == 'device':
+            keys = device_shard_keys(self.routing_key, self.index, self.workers, self.devices)
+            for key in keys:
+                self.channel.queue_bind(exchange=self.exchange, queue=queue_name, routing_key=key)
+            print(f"Worker {self.index}: {len(keys) // max(1, len(bases))} devices on {self.exchange}")
+        else:
+            shards = f"{self.exchange}.shards"
+            self.channel.exchange_declare(exchange=shards, exchange_type='x-consistent-hash', durable=True)
+            for base in bases:
+                self.channel.exchange_bind(destination=shards, source=self.exchange, routing_key=base)
+            self.channel.queue_bind(exchange=shards, queue=queue_name, routing_key='1')  # Equal weight
+            print(f"Worker {self.index}: hash shard of {self.routing_key} via {shards}")
+
+    def start_consuming(self):
+        if not self.connect():
+            return False
+        self.running = True
+        self.channel.basic_consume(queue='', on_message_callback=self.process_message,
+                                   auto_ack=self.ack_batch <= 0)
+        if self.ack_batch > 0:
+            self.connection.call_later(0.1, self._ack_timer)
+        self.connection.call_later(REPORT_INTERVAL_S, self._report_timer)
+        self.channel.start_consuming()
+
+        # Stopped by the coordinator
+        self.flush_acks()
+        self.report()
+        self.connection.close()
+        return True
+
+    def report(self):
+        """Send counters and the current latency samples to the coordinator"""
+        self.reports.put({
+            'index': self.index,
+            'total_messages': self.stats['total_messages'],
+            'total_frames': self.stats['total_frames'],
+            'start_us': self.stats['start_us'],
+            'last_message_us': self.stats['last_message_us'],
+            'latency': {stage: window.values().copy() for stage, window in self.latency.items()},
+            'export': dict(self.exporter.stats) if self.exporter else None,
+        })
+
+    def _report_timer(self):
+        self.report()
+        if self.stop_event.is_set():
+            self.running = False
+            self.channel.stop_consuming()
+        else:
+            self.connection.call_later(REPORT_INTERVAL_S, self._report_timer)
+
+
+def _worker_main(index, workers, shard_by, devices, stop_event, reports, options, export):
+    # Ctrl+C reaches the whole process group; only the coordinator acts on it
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+    exporter = None
+    if export:
+        import vr_export
+        exporter = vr_export.ColumnExporter(prefix=f"vr_telemetry_w{index}", **export)
+        exporter.start()
+    try:
+        ShardConsumer(index, workers, shard_by, devices, stop_event, reports,
+                      exporter=exporter, **options).start_consuming()
+    finally:
+        if exporter:
+            exporter.stop()
+
+
+class ConsumerPool:
+    """Coordinator of `workers` ShardConsumer processes"""
+
+    def __init__(self, workers, shard_by='hash', devices=0, export=None, **options):
+        if shard_by not in SHARD_MODES:
+            raise ValueError(f"unknown shard mode {shard_by}")
+        if shard_by == 'device' and devices <= 0:
+            raise ValueError("sharding by device needs the device count")
+        if shard_by == 'hash':
+            problem = hash_sharding_problem(options.get('routing_key', ''), workers)
+            if problem:
+                raise ValueError(problem)
+            keys = hash_keys(options.get('routing_key', ''))
+            if keys is not None and len(keys) < workers:
+                print(f"Warning: {len(keys)} routing keys hash to at most {len(keys)} "
+                      f"of {workers} workers; the rest will stay idle")
+        self.workers = workers
+        self.shard_by = shard_by
+        self.devices = devices
+        self.export = export          # ColumnExporter arguments; each worker writes its own files
+        self.options = options        # VRTelemetryConsumer arguments
+        self.stop_event = multiprocessing.Event()
+        self.reports = multiprocessing.Queue()
+        self.processes = []
+        self.latest = {}              # Last report of each worker
+
+    def start(self):
+        for index in range(self.workers):
+            process = multiprocessing.Process(
+                target=_worker_main, name=f"vr-consumer-{index}",
+                args=(index, self.workers, self.shard_by, self.devices, self.stop_event,
+                      self.reports, self.options, self.export))
+            process.start()
+            self.processes.append(process)
+        print(f"Started {self.workers} consumer processes ({self.shard_by} sharding)")
+
+    def collect(self, timeout=0.0):
+        """Take in the reports workers have sent"""
+        deadline = time.monotonic() + timeout
+        while True:
+            try:
+                report = self.reports.get(timeout=max(0.0, deadline - time.monotonic()))
+            except queue.Empty:
+                return
+            self.latest[report['index']] = report
+
+    def get_statistics(self):
+        """Pool-wide totals, summed rates and latency percentiles over all workers' samples"""
+        stats = {'workers': self.workers, 'reporting': len(self.latest),
+                 'total_messages': 0, 'total_frames': 0, 'message_rate': 0.0, 'frame_rate': 0.0}
+        for report in self.latest.values():
+            stats['total_messages'] += report['total_messages']
+            stats['total_frames'] += report['total_frames']
+            if report['start_us'] is not None:
+                elapsed = (report['last_message_us'] - report['start_us']) / 1e6
+                if elapsed > 0:
+                    stats['message_rate'] += report['total_messages'] / elapsed
+                    stats['frame_rate'] += report['total_frames'] / elapsed
+        stats['latency'] = {
+            stage: latency_summary(np.concatenate([r['latency'][stage] for r in self.latest.values()])
+                                   if self.latest else [])
+            for stage in LATENCY_STAGES}
+        return stats
+
+    def run(self):
+        """Start the workers and print merged statistics until interrupted"""
+        self.start()
+        try:
+            next_print = time.monotonic() + PRINT_INTERVAL_S
+            while any(process.is_alive() for process in self.processes):
+                self.collect(timeout=0.5)
+                if time.monotonic() >= next_print:
+                    next_print += PRINT_INTERVAL_S
+                    self.print_status()
+        finally:
+            self.stop()
+
+    def print_status(self):
+        stats = self.get_statistics()
+        e2e = stats['latency']['sample_to_receive']
+        latency = (f", latency p50 {e2e['p50_ms']:.2f} p99 {e2e['p99_ms']:.2f} ms"
+                   if e2e['count'] else "")
+        print(f"Pool: {stats['total_messages']} messages, {stats['total_frames']} frames "
+              f"from {stats['reporting']}/{stats['workers']} workers "
+              f"(Rate: {stats['message_rate']:.1f} msg/s, {stats['frame_rate']:.1f} frames/s{latency})")
+
+    def stop(self):
+        """Stop the workers after their final reports"""
+        self.stop_event.set()
+        for process in self.processes:
+            while process.is_alive():
+                self.collect(timeout=0.2)
+                process.join(timeout=0.2)
+        self.collect()
+        self.print_status()
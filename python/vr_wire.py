@@ -0,0 +1,342 @@
+#!/usr/bin/env python3
+"""
+VR Telemetry Wire Formats
+
+Decoders for the message bodies published by the embedded simulator.
+The binary layout mirrors the VR_WIRE_* definitions in include/vr_telemetry.h.
+"""
+
+import json
+import math
+import struct
+
+CONTENT_TYPE_JSON = 'application/json'
+CONTENT_TYPE_BINARY = 'application/x-vr-telemetry'
+
+WIRE_MAGIC = 0x5456
+WIRE_VERSION = 1
+WIRE_TYPE_FRAME = 0x01
+WIRE_TYPE_BATCH = 0x02
+WIRE_TYPE_DELTA = 0x03
+WIRE_TYPE_SECTIONS = 0x04
+
+SECTION_HEAD = 0x01
+SECTION_EYES = 0x02
+SECTION_HANDS = 0x04
+SECTION_STATUS = 0x08
+SECTION_ALL = 0x0F
+
+# Frame keys carried by each section; timestamp_us and frame_id are always present
+SECTION_KEYS = {
+    SECTION_HEAD: ('head_position', 'head_orientation', 'head_acceleration', 'head_angular_velocity'),
+    SECTION_EYES: ('left_eye', 'right_eye'),
+    SECTION_HANDS: ('left_hand', 'right_hand'),
+    SECTION_STATUS: ('cpu_usage', 'gpu_usage', 'temperature', 'battery_level', 'is_connected'),
+}
+
+# Float range of each section in a VR_WIRE_TYPE_FRAME, and quantized field range in a delta frame
+_SECTION_FLOATS = {SECTION_HEAD: (0, 13), SECTION_EYES: (13, 19),
+                   SECTION_HANDS: (19, 35), SECTION_STATUS: (35, 38)}
+_SECTION_QUANT_FIELDS = {SECTION_HEAD: (2, 15), SECTION_EYES: (15, 21),
+                         SECTION_HANDS: (21, 37), SECTION_STATUS: (37, 41)}
+
+DELTA_KEYFRAME = 0x00
+DELTA_DELTA = 0x01
+QUANT_FIELDS = 42
+QUANT_ACCEL_SCALE = 1000
+QUANT_GYRO_SCALE = 1000
+QUANT_EYE_SCALE = 10000
+QUANT_PUPIL_SCALE = 1000
+QUANT_GRIP_SCALE = 10000
+QUANT_STATUS_SCALE = 100
+QUAT_INDEX_ZERO = 4
+
+FLAG_LEFT_BLINKING = 0x01
+FLAG_RIGHT_BLINKING = 0x02
+FLAG_LEFT_TRACKING = 0x04
+FLAG_RIGHT_TRACKING = 0x08
+FLAG_CONNECTED = 0x10
+
+HEADER = struct.Struct('<HBB')
+FRAME = struct.Struct('<HBBQI38fBB')
+BATCH_HEADER = struct.Struct('<HBBHH')
+LENGTH = struct.Struct('<H')
+DELTA_HEADER = struct.Struct('<HBBHHHBB')
+SECTIONS_HEADER = struct.Struct('<HBBQIBB')
+BATTERY = struct.Struct('<B')
+
+
+def parse_content_type(content_type):
+    """Split a content type such as 'application/x-vr-telemetry; v=1'"""
+    if not content_type:
+        return CONTENT_TYPE_JSON, {}
+    parts = [part.strip() for part in content_type.split(';')]
+    params = {}
+    for part in parts[1:]:
+        if '=' in part:
+            key, value = part.split('=', 1)
+            params[key.strip()] = value.strip()
+    return parts[0].lower(), params
+
+
+def _vec3(values, offset):
+    return {'x': values[offset], 'y': values[offset + 1], 'z': values[offset + 2]}
+
+
+def _quat(values, offset):
+    return {'x': values[offset], 'y': values[offset + 1],
+            'z': values[offset + 2], 'w': values[offset + 3]}
+
+
+def _hand(values, offset, is_tracking):
+    hand = _vec3(values, offset)
+    hand['orientation'] = _quat(values, offset + 3)
+    hand['grip_strength'] = values[offset + 7]
+    hand['is_tracking'] = is_tracking
+    return hand
+
+
+def filter_sections(frame, sections):
+    """Drop the keys of sections a stream does not carry"""
+    if sections & SECTION_ALL == SECTION_ALL:
+        return frame
+    for section, keys in SECTION_KEYS.items():
+        if not sections & section:
+            for key in keys:
+                frame.pop(key, None)
+    return frame
+
+
+def _frame_dict(timestamp_us, frame_id, v, battery_level, flags):
+    return {
+        'timestamp_us': timestamp_us,
+        'frame_id': frame_id,
+        'head_position': _vec3(v, 0),
+        'head_orientation': _quat(v, 3),
+        'head_acceleration': _vec3(v, 7),
+        'head_angular_velocity': _vec3(v, 10),
+        'left_eye': {'x': v[13], 'y': v[14], 'pupil_diameter': v[15],
+                     'is_blinking': bool(flags & FLAG_LEFT_BLINKING)},
+        'right_eye': {'x': v[16], 'y': v[17], 'pupil_diameter': v[18],
+                      'is_blinking': bool(flags & FLAG_RIGHT_BLINKING)},
+        'left_hand': _hand(v, 19, bool(flags & FLAG_LEFT_TRACKING)),
+        'right_hand': _hand(v, 27, bool(flags & FLAG_RIGHT_TRACKING)),
+        'cpu_usage': v[35],
+        'gpu_usage': v[36],
+        'temperature': v[37],
+        'battery_level': battery_level,
+        'is_connected': bool(flags & FLAG_CONNECTED),
+    }
+
+
+def decode_frame(body, offset=0):
+    """Decode one VR_WIRE_TYPE_FRAME into the same dict layout as the JSON format"""
+    fields = FRAME.unpack_from(body, offset)
+    magic, version, msg_type, timestamp_us, frame_id = fields[:5]
+    if magic != WIRE_MAGIC:
+        raise ValueError(f"bad wire magic 0x{magic:04x}")
+    if version != WIRE_VERSION:
+        raise ValueError(f"unsupported wire version {version}")
+    if msg_type != WIRE_TYPE_FRAME:
+        raise ValueError(f"unexpected message type 0x{msg_type:02x}")
+
+    return _frame_dict(timestamp_us, frame_id, fields[5:43], fields[43], fields[44])
+
+
+def decode_sections(body, offset=0):
+    """Decode one VR_WIRE_TYPE_SECTIONS frame; only its sections' keys are present"""
+    magic, version, msg_type, timestamp_us, frame_id, sections, flags = \
+        SECTIONS_HEADER.unpack_from(body, offset)
+    if magic != WIRE_MAGIC:
+        raise ValueError(f"bad wire magic 0x{magic:04x}")
+    if version != WIRE_VERSION:
+        raise ValueError(f"unsupported wire version {version}")
+    if msg_type != WIRE_TYPE_SECTIONS:
+        raise ValueError(f"unexpected message type 0x{msg_type:02x}")
+
+    v = [0.0] * 38
+    battery_level = 0
+    offset += SECTIONS_HEADER.size
+    for section, (first, last) in _SECTION_FLOATS.items():
+        if not sections & section:
+            continue
+        v[first:last] = struct.unpack_from(f'<{last - first}f', body, offset)
+        offset += (last - first) * 4
+        if section == SECTION_STATUS:
+            battery_level = BATTERY.unpack_from(body, offset)[0]
+            offset += BATTERY.size
+
+    return filter_sections(_frame_dict(timestamp_us, frame_id, v, battery_level, flags), sections)
+
+
+def _read_svarint(body, offset):
+    """Read a zigzag LEB128 varint; returns (value, new offset)"""
+    result = 0
+    shift = 0
+    while True:
+        byte = body[offset]
+        offset += 1
+        result |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            break
+        shift += 7
+    return (result >> 1) ^ -(result & 1), offset
+
+
+def _dequant_quat(fields, offset, quat_bits):
+    index, a, b, c = fields[offset:offset + 4]
+    if index == QUAT_INDEX_ZERO:
+        return {'x': 0.0, 'y': 0.0, 'z': 0.0, 'w': 0.0}
+    scale = ((1 << (quat_bits - 1)) - 1) * math.sqrt(2.0)
+    small = [a / scale, b / scale, c / scale]
+    largest = math.sqrt(max(0.0, 1.0 - sum(v * v for v in small)))
+    comps = small[:index] + [largest] + small[index:]
+    return {'x': comps[0], 'y': comps[1], 'z': comps[2], 'w': comps[3]}
+
+
+def _dequant_hand(fields, offset, position_scale, quat_bits, is_tracking):
+    return {
+        'x': fields[offset] / position_scale,
+        'y': fields[offset + 1] / position_scale,
+        'z': fields[offset + 2] / position_scale,
+        'orientation': _dequant_quat(fields, offset + 3, quat_bits),
+        'grip_strength': fields[offset + 7] / QUANT_GRIP_SCALE,
+        'is_tracking': is_tracking,
+    }
+
+
+def dequantize_frame(fields, position_um, quat_bits):
+    """Turn the VR_QUANT_FIELDS integers of a delta frame back into a frame dict"""
+    position_scale = 1e6 / position_um
+    flags = fields[41]
+
+    def vec3(offset, scale):
+        return {'x': fields[offset] / scale, 'y': fields[offset + 1] / scale,
+                'z': fields[offset + 2] / scale}
+
+    return {
+        'timestamp_us': fields[0],
+        'frame_id': fields[1],
+        'head_position': vec3(2, position_scale),
+        'head_orientation': _dequant_quat(fields, 5, quat_bits),
+        'head_acceleration': vec3(9, QUANT_ACCEL_SCALE),
+        'head_angular_velocity': vec3(12, QUANT_GYRO_SCALE),
+        'left_eye': {'x': fields[15] / QUANT_EYE_SCALE, 'y': fields[16] / QUANT_EYE_SCALE,
+                     'pupil_diameter': fields[17] / QUANT_PUPIL_SCALE,
+                     'is_blinking': bool(flags & FLAG_LEFT_BLINKING)},
+        'right_eye': {'x': fields[18] / QUANT_EYE_SCALE, 'y': fields[19] / QUANT_EYE_SCALE,
+                      'pupil_diameter': fields[20] / QUANT_PUPIL_SCALE,
+                      'is_blinking': bool(flags & FLAG_RIGHT_BLINKING)},
+        'left_hand': _dequant_hand(fields, 21, position_scale, quat_bits,
+                                   bool(flags & FLAG_LEFT_TRACKING)),
+        'right_hand': _dequant_hand(fields, 29, position_scale, quat_bits,
+                                    bool(flags & FLAG_RIGHT_TRACKING)),
+        'cpu_usage': fields[37] / QUANT_STATUS_SCALE,
+        'gpu_usage': fields[38] / QUANT_STATUS_SCALE,
+        'temperature': fields[39] / QUANT_STATUS_SCALE,
+        'battery_level': fields[40],
+        'is_connected': bool(flags & FLAG_CONNECTED),
+    }
+
+
+class DeltaDecoder:
+    """Reconstructs frames from VR_WIRE_TYPE_DELTA messages of one stream.
+
+    Deltas are applied to the previous frame. After a gap in the message
+    sequence, deltas are skipped until the next keyframe. Fields of sections
+    outside the message's section mask are not on the wire and stay 0.
+    """
+
+    def __init__(self):
+        self.previous = None
+        self.sequence = None
+        self.frames_skipped = 0
+
+    def decode(self, body):
+        magic, version, msg_type, count, sequence, position_um, quat_bits, sections = \
+            DELTA_HEADER.unpack_from(body, 0)
+        if msg_type != WIRE_TYPE_DELTA:
+            raise ValueError(f"unexpected message type 0x{msg_type:02x}")
+        sections = sections & SECTION_ALL or SECTION_ALL
+
+        present = [True] * QUANT_FIELDS
+        for section, (first, last) in _SECTION_QUANT_FIELDS.items():
+            if not sections & section:
+                present[first:last] = [False] * (last - first)
+
+        if self.sequence is not None and sequence != (self.sequence + 1) & 0xFFFF:
+            self.previous = None
+        self.sequence = sequence
+
+        offset = DELTA_HEADER.size
+        frames = []
+        for _ in range(count):
+            kind = body[offset]
+            offset += 1
+            values = [0] * QUANT_FIELDS
+            for f in range(QUANT_FIELDS):
+                if present[f]:
+                    values[f], offset = _read_svarint(body, offset)
+
+            if kind == DELTA_KEYFRAME:
+                fields = values
+            elif self.previous is None:
+                self.frames_skipped += 1
+                continue
+            else:
+                fields = [p + d for p, d in zip(self.previous, values)]
+
+            self.previous = fields
+            frames.append(filter_sections(dequantize_frame(fields, position_um, quat_bits), sections))
+        return frames
+
+
+_default_delta_decoder = DeltaDecoder()
+
+
+def decode_binary(body, delta_decoder=None):
+    """Decode a binary message into a list of frames"""
+    magic, version, msg_type = HEADER.unpack_from(body, 0)
+    if magic != WIRE_MAGIC:
+        raise ValueError(f"bad wire magic 0x{magic:04x}")
+    if version != WIRE_VERSION:
+        raise ValueError(f"unsupported wire version {version}")
+
+    if msg_type == WIRE_TYPE_FRAME:
+        return [decode_frame(body)]
+
+    if msg_type == WIRE_TYPE_SECTIONS:
+        return [decode_sections(body)]
+
+    if msg_type == WIRE_TYPE_BATCH:
+        count = BATCH_HEADER.unpack_from(body, 0)[3]
+        offset = BATCH_HEADER.size
+        frames = []
+        for _ in range(count):
+            length = LENGTH.unpack_from(body, offset)[0]
+            offset += LENGTH.size
+            frames.extend(decode_binary(body[offset:offset + length]))
+            offset += length
+        return frames
+
+    if msg_type == WIRE_TYPE_DELTA:
+        return (delta_decoder or _default_delta_decoder).decode(body)
+
+    raise ValueError(f"unknown message type 0x{msg_type:02x}")
+
+
+def decode_message(body, content_type=None, delta_decoder=None):
+    """Decode a telemetry message body into a list of frames.
+
+    Delta messages are stateful; pass one DeltaDecoder per stream when
+    consuming several streams, otherwise a module-wide decoder is used.
+    """
+    media_type, params = parse_content_type(content_type)
+    if media_type == CONTENT_TYPE_BINARY:
+        version = int(params.get('v', WIRE_VERSION))
+        if version != WIRE_VERSION:
+            raise ValueError(f"unsupported wire version {version}")
+        return decode_binary(body, delta_decoder)
+
+    data = json.loads(body.decode('utf-8'))
+    return data if isinstance(data, list) else [data]
@@ -13,6 +13,64 @@ static volatile bool g_running = true;
 void signal_handler(int sig) {
     printf("\n[EMBEDDED] Received signal %d, shutting down gracefully...\n", sig);
     g_running = false;
+    vr_embedded_stop();
+    vr_loadgen_stop();
+}
+
+// Metrics dump handler
+void metrics_handler(int sig) {
+    (void)sig;
+    vr_metrics_request_dump();
+}
+
+// Duration limit handler
+void duration_handler(int sig) {
+    (void)sig;
+    g_running = false;
+    vr_embedded_stop();
+    vr_loadgen_stop();
+}
+
+// Publish a capture on the frame stream instead of sampling sensors. speed
+// scales the recorded frame spacing; 0 publishes as fast as the stream drains.
+static uint64_t replay_capture(const vr_capture_t *cap, double speed) {
+    uint64_t start_ns = vr_get_monotonic_ns();
+    uint64_t replayed = 0;
+    vr_telemetry_packet_t packet;
+    
+    for (uint64_t i = 0; i < cap->count && g_running; i++) {
+        if (vr_capture_read(cap, i, &packet) != 0) {
+            fprintf(stderr, "[REPLAY] Record %lu is not a telemetry frame, stopping\n", i);
+            break;
+        }
+        
+        if (speed > 0) {
+            // Recorded sample offset from the first frame, scaled; immune to wall-clock steps
+            uint64_t offset_us = packet.monotonic_us > cap->first_monotonic_us ?
+                                 packet.monotonic_us - cap->first_monotonic_us : 0;
+            uint64_t due_ns = start_ns + (uint64_t)((double)offset_us * 1000.0 / speed);
+            uint64_t now_ns;
+            while (g_running && (now_ns = vr_get_monotonic_ns()) < due_ns) {
+                uint64_t wait_us = (due_ns - now_ns) / 1000;
+                vr_delay_us(wait_us > 100000 ? 100000 : (uint32_t)wait_us);
+            }
+        } else {
+            while (g_running && vr_telemetry_stream_room(VR_STREAM_FRAME) == 0) {
+                vr_delay_us(100);
+            }
+        }
+        
+        // Keep the recorded timestamp and frame id; the sample age starts now
+        packet.monotonic_us = vr_clock_monotonic_us();
+        vr_telemetry_send_packet(&packet);
+        vr_clock_refresh();
+        replayed++;
+    }
+    
+    double elapsed_s = (double)(vr_get_monotonic_ns() - start_ns) / 1e9;
+    printf("[REPLAY] Replayed %lu of %lu frames in %.2f s (%.0f frames/s)\n", replayed, cap->count,
+           elapsed_s, elapsed_s > 0 ? (double)replayed / elapsed_s : 0.0);
+    return replayed;
 }
 
 // Print usage information
@@ -29,19 +87,107 @@ void print_usage(const char *program_name) {
     printf("  -r, --routing-key KEY  RabbitMQ routing key (default: telemetry.data)\n");
     printf("  -f, --frequency FREQ   Sensor update frequency in Hz (default: 1000)\n");
     printf("  -t, --telemetry-rate RATE  Telemetry transmission rate in Hz (default: 60)\n");
+    printf("  --pose-rate RATE       Head and hand pose stream rate in Hz, 0 = off (default: 0)\n");
+    printf("  --eyes-rate RATE       Eye tracking stream rate in Hz, 0 = off (default: 0)\n");
+    printf("  --status-rate RATE     System status stream rate in Hz, 0 = off (default: 0)\n");
+    printf("  --stream-key NAME=KEY  Routing key of stream frame, pose, eyes or status\n");
+    printf("                         (default: routing key with its last segment replaced by NAME)\n");
+    printf("  --batch-size N         Frames per published message, max %d (default: 1)\n", VR_BATCH_MAX_FRAMES);
+    printf("  --batch-window-us US   Maximum time a frame waits in a batch (default: 10000)\n");
+    printf("  --ring-depth N         Frames buffered for the publisher thread, max %u (default: 1024)\n", VR_RING_MAX_DEPTH);
+    printf("  --ring-policy POLICY   When the ring is full: drop-oldest or drop-newest (default: drop-oldest)\n");
+    printf("  --filter NAME          Telemetry filter: none, box, lowpass or one-euro (default: none)\n");
+    printf("  --filter-cutoff HZ     Low-pass cutoff, 0 = half the stream rate (default: 0)\n");
+    printf("  --one-euro-min-cutoff HZ  One Euro cutoff at rest (default: %.1f)\n", VR_ONE_EURO_DEFAULT_MIN_CUTOFF_HZ);
+    printf("  --one-euro-beta B      One Euro cutoff increase with speed (default: %.1f)\n", VR_ONE_EURO_DEFAULT_BETA);
+    printf("  --adaptive-rate        Lower the frame rate under broker backpressure, raise it back after\n");
+    printf("  --rate-min HZ          Adaptive rate floor, 0 = a quarter of --rate-max (default: 0)\n");
+    printf("  --rate-max HZ          Adaptive rate ceiling, 0 = the telemetry rate (default: 0)\n");
+    printf("  --rate-interval MS     Adaptive rate control period (default: %d)\n", VR_RATECTL_DEFAULT_INTERVAL_MS);
+    printf("  --rate-latency-ms MS   Publish p99 above which the rate is lowered (default: %d)\n",
+           VR_RATECTL_DEFAULT_LATENCY_MS);
+    printf("  --calibration-cache FILE  Reuse sensor calibration from FILE, measure and store it if stale\n");
+    printf("  --history-depth N      Samples kept per sensor channel for windowed statistics, max %d (default: 0 = off)\n",
+           VR_HISTORY_MAX_DEPTH);
     printf("  -d, --duration SEC     Duration in seconds (default: 0 = infinite)\n");
     printf("  -n, --no-rabbitmq      Run without RabbitMQ (console output only)\n");
     printf("  -w, --watchdog-timeout MS  Watchdog timeout in milliseconds (default: 5000)\n");
-    printf("  --power-save           Enable power saving mode\n");
-    printf("  --cpu-sleep-level LEVEL CPU sleep level 0-3 (default: 1)\n");
+    printf("  --power-save           Enable power saving mode (deep sleep between deadlines)\n");
+    printf("  --cpu-sleep-level LEVEL Idle between deadlines: 0 spin, 1 yield, 2 sleep, 3 deep (default: 2)\n");
+    printf("  --format FORMAT        Wire format: json, binary or delta (default: json)\n");
+    printf("  --keyframe-interval N  Delta format: frames between keyframes (default: %d)\n",
+           VR_DELTA_DEFAULT_KEYFRAME_INTERVAL);
+    printf("  --position-um N        Delta format: position resolution in um (default: %d)\n",
+           VR_DELTA_DEFAULT_POSITION_UM);
+    printf("  --quat-bits N          Delta format: bits per quaternion component, 2-16 (default: %d)\n",
+           VR_DELTA_DEFAULT_QUAT_BITS);
+    printf("  --delivery-mode MODE   transient or persistent (default: persistent)\n");
+    printf("  --spill-depth N        Frames buffered during broker outages, max %u (default: 8192)\n", VR_RING_MAX_DEPTH);
+    printf("  --spill-max-age MS     Do not replay spilled frames older than MS, 0 = all (default: 5000)\n");
+    printf("  --reconnect-initial MS First reconnect delay, doubled per failure (default: %d)\n", VR_RECONNECT_INITIAL_MS);
+    printf("  --reconnect-max MS     Maximum reconnect delay (default: %d)\n", VR_RECONNECT_MAX_MS);
+    printf("  --metrics-interval MS  Publish latency metrics every MS, 0 = off (default: 0)\n");
+    printf("  --metrics-routing-key KEY  Routing key for metrics (default: %s)\n", VR_METRICS_DEFAULT_ROUTING_KEY);
+    printf("                         Send SIGUSR1 to print metrics at any time\n");
+    printf("  --devices N            Simulate N headsets, max %d (default: 1)\n", VR_DEVICE_MAX);
+    printf("  --workers N            Worker threads for --devices (default: one per CPU)\n");
+    printf("  --connections N        Broker connections, max %d; with --devices 0 = one per worker (default: 1)\n",
+           VR_SHARD_MAX);
+    printf("  --confirms             Enable asynchronous publisher confirms\n");
+    printf("  --confirm-window N     Maximum unconfirmed messages, max %d (default: %d)\n",
+           VR_CONFIRM_MAX_WINDOW, VR_CONFIRM_DEFAULT_WINDOW);
+    printf("  --capture FILE         Record every sent sample to a capture file\n");
+    printf("  --replay FILE          Publish a capture file instead of sampling sensors\n");
+    printf("  --replay-speed X       Replay at X times the recorded rate, 0 = as fast as possible (default: 1)\n");
+    printf("  --loadgen              Ramp simulated fleets against the broker and report where it saturates\n");
+    printf("  --loadgen-devices LIST Device counts to ramp through, ascending (default: 1,10,100,1000)\n");
+    printf("  --loadgen-rates LIST   Frame rates in Hz (default: the telemetry rate)\n");
+    printf("  --loadgen-batches LIST Frames per message (default: the batch size)\n");
+    printf("  --loadgen-step SEC     Measured time per step (default: %d)\n", VR_LOADGEN_DEFAULT_STEP_S);
+    printf("  --loadgen-warmup SEC   Unmeasured time before each step (default: %d)\n", VR_LOADGEN_DEFAULT_WARMUP_S);
+    printf("  --loadgen-latency-ms MS  Confirm p99 above which a step is saturated (default: %d)\n",
+           VR_LOADGEN_DEFAULT_LATENCY_MS);
+    printf("  --loadgen-csv FILE     Write the step results as CSV\n");
+    printf("  --loadgen-json FILE    Write the step results and knees as JSON\n");
     printf("  --help                 Show this help message\n");
     printf("\nExamples:\n");
     printf("  %s                                    # Run with defaults\n", program_name);
     printf("  %s -f 500 -t 30 -d 60                 # 500Hz sensors, 30Hz telemetry for 60s\n", program_name);
     printf("  %s -h rabbitmq.example.com -p 5673    # Custom RabbitMQ server\n", program_name);
     printf("  %s -n --power-save                     # Console output with power saving\n", program_name);
+    printf("  %s --format binary                     # Compact binary telemetry frames\n", program_name);
+    printf("  %s --format delta --keyframe-interval 90  # Quantized deltas for constrained uplinks\n", program_name);
+    printf("  %s -t 1000 --batch-size 50             # 1 kHz telemetry, 20 messages/s\n", program_name);
+    printf("  %s --devices 200 -f 90 -t 90           # 200 headsets on telemetry.<id>.data\n", program_name);
+    printf("  %s --devices 2000 --connections 8      # Spread 2000 headsets over 8 connections\n", program_name);
+    printf("  %s --capture session.vrcap -d 60     # Record a minute of telemetry\n", program_name);
+    printf("  %s --replay session.vrcap --replay-speed 0  # Replay it as fast as the broker takes it\n",
+           program_name);
+    printf("  %s -t 0 --pose-rate 1000 --eyes-rate 120 --status-rate 1  # Split pose, eyes and status streams\n",
+           program_name);
+    printf("  %s --loadgen --loadgen-rates 60,90 --loadgen-csv knee.csv  # Find the broker's saturation knee\n",
+           program_name);
 }
 
+// Parse a --stream-key NAME=KEY argument into keys[kind]
+static int parse_stream_key(const char *arg, const char **keys) {
+    const char *eq = strchr(arg, '=');
+    char name[16];
+    vr_stream_kind_t kind;
+    
+    if (!eq || eq == arg || (size_t)(eq - arg) >= sizeof(name) ||
+        !eq[1] || strlen(eq + 1) >= VR_ROUTING_KEY_MAX) {
+        return -1;
+    }
+    memcpy(name, arg, (size_t)(eq - arg));
+    name[eq - arg] = '\0';
+    if (vr_stream_parse_kind(name, &kind) != 0) {
+        return -1;
+    }
+    
+    keys[kind] = eq + 1;
+    return 0;
+}
 
 int main(int argc, char *argv[]) {
     // Default embedded configuration
@@ -49,10 +195,32 @@ int main(int argc, char *argv[]) {
         .system_clock_hz = 168000000,      // 168 MHz ARM Cortex-M4
         .sensor_update_hz = 1000,          // 1 kHz sensor updates
         .telemetry_rate_hz = 60,           // 60 Hz telemetry
+        .telemetry_batch_size = 1,         // One frame per message
+        .telemetry_batch_window_us = 10000, // 10 ms maximum batching delay
+        .telemetry_ring_depth = 1024,      // Frames buffered for the publisher thread
+        .telemetry_ring_policy = VR_RING_DROP_OLDEST,
+        .telemetry_spill_depth = 8192,     // ~1 MB outage buffer
+        .telemetry_spill_max_age_ms = 5000, // Do not replay frames older than 5 s
         .watchdog_enabled = true,
         .watchdog_timeout_ms = 5000,       // 5 second timeout
         .power_save_enabled = false,
-        .cpu_sleep_level = 1
+        .cpu_sleep_level = VR_IDLE_SLEEP,
+        .metrics_interval_ms = 0,          // Metrics publishing off
+        .device_count = 1,
+        .history_depth = 0,                // Sensor history off
+        .telemetry_filter = {
+            .kind = VR_FILTER_NONE,
+            .cutoff_hz = 0,                // Half the stream rate
+            .min_cutoff_hz = VR_ONE_EURO_DEFAULT_MIN_CUTOFF_HZ,
+            .beta = VR_ONE_EURO_DEFAULT_BETA
+        },
+        .telemetry_rate_control = {
+            .enabled = false,
+            .min_hz = 0,                   // A quarter of max_hz
+            .max_hz = 0,                   // The telemetry rate
+            .interval_ms = VR_RATECTL_DEFAULT_INTERVAL_MS,
+            .latency_us = VR_RATECTL_DEFAULT_LATENCY_MS * 1000
+        }
     };
     
     // RabbitMQ configuration
@@ -65,6 +233,31 @@ int main(int argc, char *argv[]) {
     char *routing_key = "telemetry.data";
     int duration = 0; // 0 = infinite
     bool use_rabbitmq = true;
+    vr_wire_format_t wire_format = VR_WIRE_FORMAT_JSON;
+    int keyframe_interval = VR_DELTA_DEFAULT_KEYFRAME_INTERVAL;
+    int position_um = VR_DELTA_DEFAULT_POSITION_UM;
+    int quat_bits = VR_DELTA_DEFAULT_QUAT_BITS;
+    vr_delivery_mode_t delivery_mode = VR_DELIVERY_PERSISTENT;
+    bool use_confirms = false;
+    int confirm_window = VR_CONFIRM_DEFAULT_WINDOW;
+    char *metrics_routing_key = VR_METRICS_DEFAULT_ROUTING_KEY;
+    int reconnect_initial_ms = VR_RECONNECT_INITIAL_MS;
+    int reconnect_max_ms = VR_RECONNECT_MAX_MS;
+    int device_count = 1;
+    int worker_count = 0; // 0 = one per CPU
+    int connection_count = 0; // 0 = one, or one per worker with --devices
+    const char *stream_keys[VR_STREAM_KIND_COUNT] = { 0 };  // --stream-key overrides
+    const char *capture_path = NULL;
+    const char *replay_path = NULL;
+    double replay_speed = 1.0;
+    bool loadgen = false;
+    vr_loadgen_config_t loadgen_config = {
+        .devices = { 1, 10, 100, 1000 },
+        .device_steps = 4,
+        .step_s = VR_LOADGEN_DEFAULT_STEP_S,
+        .warmup_s = VR_LOADGEN_DEFAULT_WARMUP_S,
+        .latency_ms = VR_LOADGEN_DEFAULT_LATENCY_MS
+    };
     
     // Parse command line arguments
     static struct option long_options[] = {
@@ -77,11 +270,58 @@ int main(int argc, char *argv[]) {
         {"routing-key", required_argument, 0, 'r'},
         {"frequency", required_argument, 0, 'f'},
         {"telemetry-rate", required_argument, 0, 't'},
+        {"pose-rate", required_argument, 0, 0},
+        {"eyes-rate", required_argument, 0, 0},
+        {"status-rate", required_argument, 0, 0},
+        {"stream-key", required_argument, 0, 0},
+        {"batch-size", required_argument, 0, 0},
+        {"batch-window-us", required_argument, 0, 0},
+        {"ring-depth", required_argument, 0, 0},
+        {"ring-policy", required_argument, 0, 0},
+        {"history-depth", required_argument, 0, 0},
+        {"calibration-cache", required_argument, 0, 0},
+        {"adaptive-rate", no_argument, 0, 0},
+        {"rate-min", required_argument, 0, 0},
+        {"rate-max", required_argument, 0, 0},
+        {"rate-interval", required_argument, 0, 0},
+        {"rate-latency-ms", required_argument, 0, 0},
+        {"filter", required_argument, 0, 0},
+        {"filter-cutoff", required_argument, 0, 0},
+        {"one-euro-min-cutoff", required_argument, 0, 0},
+        {"one-euro-beta", required_argument, 0, 0},
         {"duration", required_argument, 0, 'd'},
         {"no-rabbitmq", no_argument, 0, 'n'},
         {"watchdog-timeout", required_argument, 0, 'w'},
         {"power-save", no_argument, 0, 0},
         {"cpu-sleep-level", required_argument, 0, 0},
+        {"format", required_argument, 0, 0},
+        {"keyframe-interval", required_argument, 0, 0},
+        {"position-um", required_argument, 0, 0},
+        {"quat-bits", required_argument, 0, 0},
+        {"delivery-mode", required_argument, 0, 0},
+        {"spill-depth", required_argument, 0, 0},
+        {"spill-max-age", required_argument, 0, 0},
+        {"reconnect-initial", required_argument, 0, 0},
+        {"reconnect-max", required_argument, 0, 0},
+        {"metrics-interval", required_argument, 0, 0},
+        {"metrics-routing-key", required_argument, 0, 0},
+        {"devices", required_argument, 0, 0},
+        {"workers", required_argument, 0, 0},
+        {"connections", required_argument, 0, 0},
+        {"confirms", no_argument, 0, 0},
+        {"confirm-window", required_argument, 0, 0},
+        {"capture", required_argument, 0, 0},
+        {"replay", required_argument, 0, 0},
+        {"replay-speed", required_argument, 0, 0},
+        {"loadgen", no_argument, 0, 0},
+        {"loadgen-devices", required_argument, 0, 0},
+        {"loadgen-rates", required_argument, 0, 0},
+        {"loadgen-batches", required_argument, 0, 0},
+        {"loadgen-step", required_argument, 0, 0},
+        {"loadgen-warmup", required_argument, 0, 0},
+        {"loadgen-latency-ms", required_argument, 0, 0},
+        {"loadgen-csv", required_argument, 0, 0},
+        {"loadgen-json", required_argument, 0, 0},
         {"help", no_argument, 0, 0},
         {0, 0, 0, 0}
     };
@@ -103,12 +343,238 @@ int main(int argc, char *argv[]) {
             case 'd': duration = atoi(optarg); break;
             case 'n': use_rabbitmq = false; break;
             case 0: // Long options
-                if (strcmp(long_options[option_index].name, "watchdog-timeout") == 0) {
+                if (strcmp(long_options[option_index].name, "pose-rate") == 0) {
+                    int rate = atoi(optarg);
+                    if (rate < 0 || rate > VR_STREAM_MAX_RATE_HZ) {
+                        fprintf(stderr, "Pose rate must be 0 (off)-%d Hz: %s\n", VR_STREAM_MAX_RATE_HZ, optarg);
+                        return 1;
+                    }
+                    embedded_config.pose_rate_hz = rate;
+                } else if (strcmp(long_options[option_index].name, "eyes-rate") == 0) {
+                    int rate = atoi(optarg);
+                    if (rate < 0 || rate > VR_STREAM_MAX_RATE_HZ) {
+                        fprintf(stderr, "Eyes rate must be 0 (off)-%d Hz: %s\n", VR_STREAM_MAX_RATE_HZ, optarg);
+                        return 1;
+                    }
+                    embedded_config.eyes_rate_hz = rate;
+                } else if (strcmp(long_options[option_index].name, "status-rate") == 0) {
+                    int rate = atoi(optarg);
+                    if (rate < 0 || rate > VR_STREAM_MAX_RATE_HZ) {
+                        fprintf(stderr, "Status rate must be 0 (off)-%d Hz: %s\n", VR_STREAM_MAX_RATE_HZ, optarg);
+                        return 1;
+                    }
+                    embedded_config.status_rate_hz = rate;
+                } else if (strcmp(long_options[option_index].name, "stream-key") == 0) {
+                    if (parse_stream_key(optarg, stream_keys) != 0) {
+                        fprintf(stderr, "Invalid stream key (NAME=KEY, NAME is frame, pose, eyes or status): %s\n",
+                                optarg);
+                        print_usage(argv[0]);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "batch-size") == 0) {
+                    int batch_size = atoi(optarg);
+                    if (batch_size < 1 || batch_size > VR_BATCH_MAX_FRAMES) {
+                        fprintf(stderr, "Batch size must be 1-%d: %s\n", VR_BATCH_MAX_FRAMES, optarg);
+                        return 1;
+                    }
+                    embedded_config.telemetry_batch_size = batch_size;
+                } else if (strcmp(long_options[option_index].name, "batch-window-us") == 0) {
+                    embedded_config.telemetry_batch_window_us = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "ring-depth") == 0) {
+                    int depth = atoi(optarg);
+                    if (depth < 2 || depth > (int)VR_RING_MAX_DEPTH) {
+                        fprintf(stderr, "Ring depth must be 2-%u: %s\n", VR_RING_MAX_DEPTH, optarg);
+                        return 1;
+                    }
+                    embedded_config.telemetry_ring_depth = depth;
+                } else if (strcmp(long_options[option_index].name, "ring-policy") == 0) {
+                    if (vr_ring_parse_policy(optarg, &embedded_config.telemetry_ring_policy) != 0) {
+                        fprintf(stderr, "Unknown ring policy: %s\n", optarg);
+                        print_usage(argv[0]);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "filter") == 0) {
+                    if (vr_filter_parse_kind(optarg, &embedded_config.telemetry_filter.kind) != 0) {
+                        fprintf(stderr, "Unknown filter: %s\n", optarg);
+                        print_usage(argv[0]);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "filter-cutoff") == 0) {
+                    embedded_config.telemetry_filter.cutoff_hz = (float)atof(optarg);
+                } else if (strcmp(long_options[option_index].name, "one-euro-min-cutoff") == 0) {
+                    embedded_config.telemetry_filter.min_cutoff_hz = (float)atof(optarg);
+                    if (embedded_config.telemetry_filter.min_cutoff_hz <= 0) {
+                        fprintf(stderr, "One Euro minimum cutoff must be more than 0: %s\n", optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "one-euro-beta") == 0) {
+                    embedded_config.telemetry_filter.beta = (float)atof(optarg);
+                } else if (strcmp(long_options[option_index].name, "history-depth") == 0) {
+                    int depth = atoi(optarg);
+                    if (depth != 0 && (depth < 2 || depth > VR_HISTORY_MAX_DEPTH)) {
+                        fprintf(stderr, "History depth must be 0 (off) or 2-%d: %s\n", VR_HISTORY_MAX_DEPTH, optarg);
+                        return 1;
+                    }
+                    embedded_config.history_depth = depth;
+                } else if (strcmp(long_options[option_index].name, "calibration-cache") == 0) {
+                    embedded_config.calibration_cache_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "adaptive-rate") == 0) {
+                    embedded_config.telemetry_rate_control.enabled = true;
+                } else if (strcmp(long_options[option_index].name, "rate-min") == 0) {
+                    int rate = atoi(optarg);
+                    if (rate < 0 || rate > VR_STREAM_MAX_RATE_HZ) {
+                        fprintf(stderr, "Adaptive rate floor must be 0-%d Hz: %s\n", VR_STREAM_MAX_RATE_HZ, optarg);
+                        return 1;
+                    }
+                    embedded_config.telemetry_rate_control.min_hz = rate;
+                } else if (strcmp(long_options[option_index].name, "rate-max") == 0) {
+                    int rate = atoi(optarg);
+                    if (rate < 0 || rate > VR_STREAM_MAX_RATE_HZ) {
+                        fprintf(stderr, "Adaptive rate ceiling must be 0-%d Hz: %s\n", VR_STREAM_MAX_RATE_HZ, optarg);
+                        return 1;
+                    }
+                    embedded_config.telemetry_rate_control.max_hz = rate;
+                } else if (strcmp(long_options[option_index].name, "rate-interval") == 0) {
+                    int interval_ms = atoi(optarg);
+                    if (interval_ms < 1) {
+                        fprintf(stderr, "Rate control interval must be at least 1 ms: %s\n", optarg);
+                        return 1;
+                    }
+                    embedded_config.telemetry_rate_control.interval_ms = interval_ms;
+                } else if (strcmp(long_options[option_index].name, "rate-latency-ms") == 0) {
+                    double latency_ms = atof(optarg);
+                    if (latency_ms <= 0) {
+                        fprintf(stderr, "Rate control latency target must be more than 0: %s\n", optarg);
+                        return 1;
+                    }
+                    embedded_config.telemetry_rate_control.latency_us = (uint32_t)(latency_ms * 1000.0);
+                } else if (strcmp(long_options[option_index].name, "watchdog-timeout") == 0) {
                     embedded_config.watchdog_timeout_ms = atoi(optarg);
                 } else if (strcmp(long_options[option_index].name, "power-save") == 0) {
                     embedded_config.power_save_enabled = true;
                 } else if (strcmp(long_options[option_index].name, "cpu-sleep-level") == 0) {
-                    embedded_config.cpu_sleep_level = atoi(optarg);
+                    int level = atoi(optarg);
+                    if (level < 0 || level >= VR_IDLE_MODE_COUNT) {
+                        fprintf(stderr, "CPU sleep level must be 0-%d: %s\n", VR_IDLE_MODE_COUNT - 1, optarg);
+                        return 1;
+                    }
+                    embedded_config.cpu_sleep_level = (uint8_t)level;
+                } else if (strcmp(long_options[option_index].name, "keyframe-interval") == 0) {
+                    keyframe_interval = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "position-um") == 0) {
+                    position_um = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "quat-bits") == 0) {
+                    quat_bits = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "format") == 0) {
+                    if (vr_codec_parse_format(optarg, &wire_format) != 0) {
+                        fprintf(stderr, "Unknown wire format: %s\n", optarg);
+                        print_usage(argv[0]);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "delivery-mode") == 0) {
+                    if (strcmp(optarg, "transient") == 0) {
+                        delivery_mode = VR_DELIVERY_TRANSIENT;
+                    } else if (strcmp(optarg, "persistent") == 0) {
+                        delivery_mode = VR_DELIVERY_PERSISTENT;
+                    } else {
+                        fprintf(stderr, "Unknown delivery mode: %s\n", optarg);
+                        print_usage(argv[0]);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "spill-depth") == 0) {
+                    int depth = atoi(optarg);
+                    if (depth < 2 || depth > (int)VR_RING_MAX_DEPTH) {
+                        fprintf(stderr, "Spill depth must be 2-%u: %s\n", VR_RING_MAX_DEPTH, optarg);
+                        return 1;
+                    }
+                    embedded_config.telemetry_spill_depth = depth;
+                } else if (strcmp(long_options[option_index].name, "spill-max-age") == 0) {
+                    embedded_config.telemetry_spill_max_age_ms = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "reconnect-initial") == 0) {
+                    reconnect_initial_ms = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "reconnect-max") == 0) {
+                    reconnect_max_ms = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "metrics-interval") == 0) {
+                    embedded_config.metrics_interval_ms = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "metrics-routing-key") == 0) {
+                    metrics_routing_key = optarg;
+                } else if (strcmp(long_options[option_index].name, "devices") == 0) {
+                    device_count = atoi(optarg);
+                    if (device_count < 1 || device_count > VR_DEVICE_MAX) {
+                        fprintf(stderr, "Device count must be 1-%d: %s\n", VR_DEVICE_MAX, optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "workers") == 0) {
+                    worker_count = atoi(optarg);
+                    if (worker_count < 1 || worker_count > VR_DEVICE_MAX) {
+                        fprintf(stderr, "Worker count must be 1-%d: %s\n", VR_DEVICE_MAX, optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "connections") == 0) {
+                    connection_count = atoi(optarg);
+                    if (connection_count < 0 || connection_count > VR_SHARD_MAX) {
+                        fprintf(stderr, "Connection count must be 0-%d: %s\n", VR_SHARD_MAX, optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "confirms") == 0) {
+                    use_confirms = true;
+                } else if (strcmp(long_options[option_index].name, "confirm-window") == 0) {
+                    confirm_window = atoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "capture") == 0) {
+                    capture_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "replay") == 0) {
+                    replay_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "replay-speed") == 0) {
+                    replay_speed = atof(optarg);
+                    if (replay_speed < 0) {
+                        fprintf(stderr, "Replay speed must be 0 or more: %s\n", optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "loadgen") == 0) {
+                    loadgen = true;
+                } else if (strcmp(long_options[option_index].name, "loadgen-devices") == 0) {
+                    if (vr_loadgen_parse_list(optarg, loadgen_config.devices, &loadgen_config.device_steps) != 0) {
+                        fprintf(stderr, "Invalid device list (up to %d counts, e.g. 1,10,100): %s\n",
+                                VR_LOADGEN_MAX_VALUES, optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "loadgen-rates") == 0) {
+                    if (vr_loadgen_parse_list(optarg, loadgen_config.rates_hz, &loadgen_config.rate_steps) != 0) {
+                        fprintf(stderr, "Invalid rate list (up to %d rates in Hz, e.g. 30,60,90): %s\n",
+                                VR_LOADGEN_MAX_VALUES, optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "loadgen-batches") == 0) {
+                    if (vr_loadgen_parse_list(optarg, loadgen_config.batch_sizes, &loadgen_config.batch_steps) != 0) {
+                        fprintf(stderr, "Invalid batch size list (up to %d sizes, e.g. 1,10,50): %s\n",
+                                VR_LOADGEN_MAX_VALUES, optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "loadgen-step") == 0) {
+                    int step_s = atoi(optarg);
+                    if (step_s < 1) {
+                        fprintf(stderr, "Load generator step must be at least 1 s: %s\n", optarg);
+                        return 1;
+                    }
+                    loadgen_config.step_s = (uint32_t)step_s;
+                } else if (strcmp(long_options[option_index].name, "loadgen-warmup") == 0) {
+                    int warmup_s = atoi(optarg);
+                    if (warmup_s < 0) {
+                        fprintf(stderr, "Load generator warm-up must be 0 s or more: %s\n", optarg);
+                        return 1;
+                    }
+                    loadgen_config.warmup_s = (uint32_t)warmup_s;
+                } else if (strcmp(long_options[option_index].name, "loadgen-latency-ms") == 0) {
+                    int latency_ms = atoi(optarg);
+                    if (latency_ms < 1) {
+                        fprintf(stderr, "Load generator latency limit must be at least 1 ms: %s\n", optarg);
+                        return 1;
+                    }
+                    loadgen_config.latency_ms = (uint32_t)latency_ms;
+                } else if (strcmp(long_options[option_index].name, "loadgen-csv") == 0) {
+                    loadgen_config.csv_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "loadgen-json") == 0) {
+                    loadgen_config.json_path = optarg;
                 } else if (strcmp(long_options[option_index].name, "help") == 0) {
                     print_usage(argv[0]);
                     return 0;
@@ -120,71 +586,266 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    embedded_config.device_count = (uint32_t)device_count;
+    
+    // Capture and replay cover the firmware's own frame stream only
+    if ((capture_path || replay_path) && device_count > 1) {
+        fprintf(stderr, "--capture and --replay cannot be combined with --devices\n");
+        return 1;
+    }
+    if (replay_path && embedded_config.telemetry_rate_hz == 0) {
+        fprintf(stderr, "--replay publishes on the frame stream, which -t 0 disables\n");
+        return 1;
+    }
+    // The controller drives the firmware's own frame stream task
+    vr_ratectl_config_t *rate_control = &embedded_config.telemetry_rate_control;
+    if (rate_control->enabled && (device_count > 1 || replay_path || embedded_config.telemetry_rate_hz == 0)) {
+        fprintf(stderr, "--adaptive-rate needs the frame stream; it cannot be combined with --devices, --replay or -t 0\n");
+        return 1;
+    }
+    if (rate_control->enabled && rate_control->max_hz > 0 && rate_control->min_hz > rate_control->max_hz) {
+        fprintf(stderr, "--rate-min %u is above --rate-max %u\n", rate_control->min_hz, rate_control->max_hz);
+        return 1;
+    }
+    // The load generator runs its own fleets in place of the firmware
+    if (loadgen) {
+        if (!use_rabbitmq) {
+            fprintf(stderr, "--loadgen measures the broker; it cannot be combined with -n\n");
+            return 1;
+        }
+        if (device_count > 1 || capture_path || replay_path || rate_control->enabled) {
+            fprintf(stderr, "--loadgen cannot be combined with --devices, --capture, --replay or --adaptive-rate\n");
+            return 1;
+        }
+        for (uint32_t i = 0; i < loadgen_config.device_steps; i++) {
+            if (loadgen_config.devices[i] > VR_DEVICE_MAX ||
+                (i > 0 && loadgen_config.devices[i] <= loadgen_config.devices[i - 1])) {
+                fprintf(stderr, "--loadgen-devices must ascend and stay within %d\n", VR_DEVICE_MAX);
+                return 1;
+            }
+        }
+        for (uint32_t i = 0; i < loadgen_config.batch_steps; i++) {
+            if (loadgen_config.batch_sizes[i] > VR_BATCH_MAX_FRAMES) {
+                fprintf(stderr, "--loadgen-batches sizes must be 1-%d\n", VR_BATCH_MAX_FRAMES);
+                return 1;
+            }
+        }
+        if (loadgen_config.rate_steps == 0) {
+            loadgen_config.rates_hz[0] = embedded_config.telemetry_rate_hz;
+            loadgen_config.rate_steps = 1;
+        }
+        if (loadgen_config.batch_steps == 0) {
+            loadgen_config.batch_sizes[0] = embedded_config.telemetry_batch_size;
+            loadgen_config.batch_steps = 1;
+        }
+        loadgen_config.workers = worker_count > 0 ? (uint32_t)worker_count : 0;
+        loadgen_config.connections = (uint32_t)connection_count;
+        use_confirms = true;  // Confirm latency is part of every step
+    }
+    
+    vr_capture_t capture;
+    vr_capture_t replay;
+    if (replay_path && vr_capture_open(&replay, replay_path) != 0) {
+        return 1;
+    }
+    if (capture_path && vr_capture_create(&capture, capture_path) != 0) {
+        return 1;
+    }
+    
     // Set up signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, metrics_handler);
+    if (duration > 0) {
+        signal(SIGALRM, duration_handler);
+        alarm(duration);
+    }
     
     printf("[EMBEDDED] VR Embedded Telemetry System Starting...\n");
     printf("[EMBEDDED] Configuration:\n");
     printf("  System Clock: %u Hz\n", embedded_config.system_clock_hz);
     printf("  Sensor Update: %u Hz\n", embedded_config.sensor_update_hz);
     printf("  Telemetry Rate: %u Hz\n", embedded_config.telemetry_rate_hz);
+    printf("  Telemetry Batch: %u frames / %u us\n", embedded_config.telemetry_batch_size,
+           embedded_config.telemetry_batch_window_us);
+    printf("  Telemetry Ring: %u frames, %s\n", embedded_config.telemetry_ring_depth,
+           embedded_config.telemetry_ring_policy == VR_RING_DROP_OLDEST ? "drop-oldest" : "drop-newest");
+    if (embedded_config.history_depth > 0) {
+        printf("  Sensor History: %u samples per channel\n", embedded_config.history_depth);
+    } else {
+        printf("  Sensor History: off\n");
+    }
+    if (embedded_config.calibration_cache_path) {
+        printf("  Calibration Cache: %s\n", embedded_config.calibration_cache_path);
+    }
+    printf("  Telemetry Filter: %s\n", vr_filter_kind_name(embedded_config.telemetry_filter.kind));
+    if (rate_control->enabled) {
+        vr_ratectl_t ctl;
+        vr_ratectl_init(&ctl, rate_control, embedded_config.telemetry_rate_hz);
+        printf("  Adaptive Rate: %u-%u Hz, every %u ms, publish p99 target %.1f ms\n", ctl.stats.min_hz,
+               ctl.stats.max_hz, ctl.config.interval_ms, ctl.config.latency_us / 1000.0);
+    }
     printf("  Watchdog: %s (%u ms)\n", embedded_config.watchdog_enabled ? "enabled" : "disabled", 
            embedded_config.watchdog_timeout_ms);
     printf("  Power Save: %s\n", embedded_config.power_save_enabled ? "enabled" : "disabled");
-    printf("  CPU Sleep Level: %u\n", embedded_config.cpu_sleep_level);
+    printf("  CPU Sleep Level: %u (%s idle)\n", embedded_config.cpu_sleep_level,
+           vr_idle_mode_name(vr_power_idle_mode(&embedded_config)));
     printf("  Duration: %s\n", duration > 0 ? "limited" : "infinite");
+    if (loadgen) {
+        printf("  Load Generator: %u device counts x %u rates x %u batch sizes, %u s steps\n",
+               loadgen_config.device_steps, loadgen_config.rate_steps, loadgen_config.batch_steps,
+               loadgen_config.step_s);
+    }
+    if (capture_path) {
+        printf("  Capture: %s\n", capture_path);
+    }
+    if (replay_path) {
+        printf("  Replay: %s, %lu frames (%.1f s) at %s\n", replay_path, replay.count,
+               (double)(replay.last_monotonic_us - replay.first_monotonic_us) / 1e6,
+               replay_speed > 0 ? "recorded rate" : "full speed");
+        if (replay_speed > 0 && replay_speed != 1.0) {
+            printf("  Replay Speed: %.2fx\n", replay_speed);
+        }
+    }
+    if (device_count > 1) {
+        if (worker_count > 0) {
+            printf("  Devices: %d on %d workers\n", device_count, worker_count);
+        } else {
+            printf("  Devices: %d on one worker per CPU\n", device_count);
+        }
+    }
     printf("  RabbitMQ: %s\n", use_rabbitmq ? "enabled" : "disabled");
     if (use_rabbitmq) {
         printf("  Host: %s:%d\n", host, port);
+        if (connection_count > 1) {
+            printf("  Connections: %d\n", connection_count);
+        }
         printf("  Exchange: %s\n", exchange);
-        printf("  Routing Key: %s\n", routing_key);
+        printf("  Routing Key: %s%s\n", stream_keys[VR_STREAM_FRAME] ? stream_keys[VR_STREAM_FRAME] : routing_key,
+               device_count > 1 ? " (device id inserted)" : "");
+        for (int kind = VR_STREAM_FRAME + 1; kind < VR_STREAM_KIND_COUNT; kind++) {
+            uint32_t rate_hz = vr_telemetry_stream_rate(&embedded_config, (vr_stream_kind_t)kind);
+            char key[VR_ROUTING_KEY_MAX];
+            if (rate_hz == 0) continue;
+            if (stream_keys[kind]) {
+                snprintf(key, sizeof(key), "%s", stream_keys[kind]);
+            } else if (vr_stream_format_routing_key(routing_key, (vr_stream_kind_t)kind, key, sizeof(key)) != 0) {
+                snprintf(key, sizeof(key), "%s", routing_key);
+            }
+            printf("  Stream %s: %u Hz on %s\n", vr_stream_kind_name((vr_stream_kind_t)kind), rate_hz, key);
+        }
+        printf("  Wire Format: %s\n", vr_codec_content_type(wire_format));
+        printf("  Delivery: %s, confirms %s\n",
+               delivery_mode == VR_DELIVERY_PERSISTENT ? "persistent" : "transient",
+               use_confirms ? "enabled" : "disabled");
     }
     printf("\n");
     
-    // Initialize embedded system
-    vr_embedded_init(&embedded_config, use_rabbitmq);
+    // Shard the single-device streams before their publisher threads start;
+    // a fleet opens its own connections instead
+    if (use_rabbitmq && !loadgen && device_count <= 1 && connection_count > 1 &&
+        vr_rabbitmq_set_connections((uint32_t)connection_count) != 0) {
+        fprintf(stderr, "[EMBEDDED] Failed to set up %d broker connections\n", connection_count);
+        return 1;
+    }
+    
+    // Hot-path messages go through the log writer thread from here on
+    vr_log_init();
     
-    // RabbitMQ connection is handled by the embedded system
+    // Configure the telemetry publisher; vr_embedded_init connects it in the background
     if (use_rabbitmq) {
-        printf("[EMBEDDED] RabbitMQ will be handled by embedded system\n");
+        vr_rabbitmq_set_wire_format(wire_format);
+        vr_rabbitmq_set_delta_params(keyframe_interval > 0 ? (uint32_t)keyframe_interval : 1,
+                                     position_um > 0 ? (uint32_t)position_um : 1,
+                                     quat_bits > 0 ? (uint32_t)quat_bits : 1);
+        vr_rabbitmq_set_delivery_mode(delivery_mode);
+        vr_rabbitmq_set_confirms(use_confirms, confirm_window > 0 ? (uint32_t)confirm_window : 1);
+        vr_rabbitmq_set_metrics_routing_key(metrics_routing_key);
+        vr_rabbitmq_set_reconnect(reconnect_initial_ms > 0 ? (uint32_t)reconnect_initial_ms : 1,
+                                  reconnect_max_ms > 0 ? (uint32_t)reconnect_max_ms : 1);
+        for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+            if (stream_keys[kind]) {
+                vr_rabbitmq_set_stream_routing_key((vr_stream_kind_t)kind, stream_keys[kind]);
+            }
+        }
+        vr_rabbitmq_configure(host, port, username, password, vhost, exchange, routing_key);
     }
     
-    // Start embedded system main loop
-    printf("[EMBEDDED] Starting embedded system main loop... (Press Ctrl+C to stop)\n");
+    if (loadgen) {
+        int result = vr_loadgen_run(&embedded_config, &loadgen_config);
+        vr_log_shutdown();
+        return result == 0 ? 0 : 1;
+    }
     
-    time_t start_time = time(NULL);
-    uint32_t loop_count = 0;
+    // Initialize embedded system; without its rings the publisher would send nothing
+    if (vr_embedded_init(&embedded_config, use_rabbitmq) != 0 && use_rabbitmq) {
+        fprintf(stderr, "[EMBEDDED] Failed to set up the telemetry pipeline\n");
+        vr_rabbitmq_close();
+        vr_log_shutdown();
+        return 1;
+    }
     
-    while (g_running) {
-        // Check duration limit
-        if (duration > 0 && (time(NULL) - start_time) >= duration) {
-            printf("[EMBEDDED] Duration limit reached, stopping system.\n");
-            break;
+    // Simulate the other headsets on the worker pool
+    if (device_count > 1 &&
+        vr_fleet_start(&embedded_config, (uint32_t)device_count,
+                       worker_count > 0 ? (uint32_t)worker_count : 0, (uint32_t)connection_count) != 0) {
+        fprintf(stderr, "[EMBEDDED] Failed to start %d simulated devices\n", device_count);
+        vr_telemetry_shutdown();
+        if (use_rabbitmq) {
+            vr_rabbitmq_close();
         }
-        
-        // Run embedded system main loop
+        vr_log_shutdown();
+        return 1;
+    }
+    
+    if (capture_path) {
+        vr_telemetry_set_capture(&capture);
+    }
+    
+    // Replay mode publishes the capture instead of running the sampling loop
+    if (replay_path) {
+        replay_capture(&replay, replay_speed);
+    } else if (g_running) {
+        // Blocks until a signal or the duration alarm stops the system; the
+        // scheduler's status task reports progress meanwhile
+        printf("[EMBEDDED] Starting embedded system main loop... (Press Ctrl+C to stop)\n");
         vr_embedded_main_loop();
-        
-        // Print status every 1000 iterations
-        if (loop_count % 1000 == 0) {
-            vr_system_state_t state = vr_embedded_get_state();
-            uint32_t error_count = vr_get_error_count();
-            printf("[EMBEDDED] Loop %u: State=%d, Errors=%u, Uptime=%u ms\n", 
-                   loop_count, state, error_count, vr_get_system_tick());
-        }
-        
-        loop_count++;
-        
-        // Small delay to prevent 100% CPU usage
-        vr_delay_ms(1);
     }
     
     // Cleanup
+    if (capture_path) {
+        vr_telemetry_set_capture(NULL);
+        printf("[CAPTURE] Recorded %lu frames (%.1f s) to %s\n", capture.count,
+               capture.count > 0 ? (double)(capture.last_monotonic_us - capture.first_monotonic_us) / 1e6 : 0.0,
+               capture_path);
+        vr_capture_close(&capture);
+    }
+    if (replay_path) {
+        vr_capture_close(&replay);
+    }
+    vr_fleet_stop();
+    vr_telemetry_shutdown();
+    vr_log_shutdown();  // Publishers are stopped: write out their queued messages before the summary
+    vr_metrics_print();
     if (use_rabbitmq) {
         vr_rabbitmq_close();
+        
+        vr_publisher_stats_t pub_stats;
+        vr_rabbitmq_get_stats(&pub_stats);
+        printf("[EMBEDDED] Published %lu messages (%lu frames), failures: %lu, acked: %lu, nacked: %lu\n",
+               pub_stats.messages_published, pub_stats.frames_published, pub_stats.publish_failures,
+               pub_stats.confirms_acked, pub_stats.confirms_nacked);
+        printf("[EMBEDDED] Connection losses: %lu, reconnects: %lu, unconfirmed frames lost: %lu\n",
+               pub_stats.connection_losses, pub_stats.reconnects, pub_stats.frames_unconfirmed_lost);
+    }
+    
+    vr_log_stats_t log_stats;
+    vr_log_get_stats(&log_stats);
+    if (log_stats.suppressed > 0 || log_stats.dropped > 0) {
+        printf("[EMBEDDED] Log records written: %lu, rate-limited: %lu, dropped: %lu\n",
+               log_stats.written, log_stats.suppressed, log_stats.dropped);
     }
     
-    printf("[EMBEDDED] System shutdown completed. Total loops: %u\n", loop_count);
+    printf("[EMBEDDED] System shutdown completed.\n");
     return 0;
 }
@@ -0,0 +1,51 @@
+#include "vr_telemetry.h"
+#include <string.h>
+
+// Initialize batching stage
+void vr_batch_init(vr_batch_t *batch, uint32_t max_frames, uint32_t window_us) {
+    if (!batch) return;
+
+    if (max_frames == 0) max_frames = 1;
+    if (max_frames > VR_BATCH_MAX_FRAMES) max_frames = VR_BATCH_MAX_FRAMES;
+
+    batch->max_frames = max_frames;
+    batch->window_us = window_us;
+    vr_batch_reset(batch);
+}
+
+// Queue a packet; returns true when the batch should be flushed
+bool vr_batch_add(vr_batch_t *batch, const vr_telemetry_packet_t *packet, uint64_t now_us) {
+    if (!batch || !packet) return false;
+
+    if (batch->count == 0) {
+        batch->opened_us = now_us;
+    }
+
+    if (batch->count < batch->max_frames) {
+        memcpy(&batch->frames[batch->count], packet, sizeof(vr_telemetry_packet_t));
+        batch->count++;
+    }
+
+    return batch->count >= batch->max_frames || vr_batch_is_due(batch, now_us);
+}
+
+// Check if the oldest queued frame has waited for the full window
+bool vr_batch_is_due(const vr_batch_t *batch, uint64_t now_us) {
+    if (!batch || batch->count == 0) return false;
+    if (batch->window_us == 0) return false;
+    return now_us - batch->opened_us >= batch->window_us;
+}
+
+// Time until vr_batch_is_due() turns true (UINT64_MAX while nothing is waiting)
+uint64_t vr_batch_wait_us(const vr_batch_t *batch, uint64_t now_us) {
+    if (!batch || batch->count == 0 || batch->window_us == 0) return UINT64_MAX;
+    uint64_t age_us = now_us - batch->opened_us;
+    return age_us >= batch->window_us ? 0 : batch->window_us - age_us;
+}
+
+// Drop all queued frames
+void vr_batch_reset(vr_batch_t *batch) {
+    if (!batch) return;
+    batch->count = 0;
+    batch->opened_us = 0;
+}
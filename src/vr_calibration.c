@@ -0,0 +1,164 @@
+#include "vr_telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+// Sensor calibration and its cache file.
+//
+// Measuring takes one sensor sample per millisecond at rest.
+// The result is stored next to a checksum, so a warm start reads 64 bytes
+// instead; a cache that is corrupt, written by another version, measured at
+// another sensor rate or older than VR_CALIBRATION_MAX_AGE_S is measured again.
+// The file is written under a temporary name and renamed into place, so a
+// crash while saving never leaves a half-written cache behind.
+
+// Little-endian fields
+static void vr_calibration_put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void vr_calibration_put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void vr_calibration_put_f32(uint8_t *p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    vr_calibration_put_u32(p, bits);
+}
+
+static uint32_t vr_calibration_get_u32(const uint8_t *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t vr_calibration_get_u64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static float vr_calibration_get_f32(const uint8_t *p) {
+    uint32_t bits = vr_calibration_get_u32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// 32-bit FNV-1a of the cache bytes before the checksum field; part of the file
+// format, so it must not follow changes to the shard hash
+static uint32_t vr_calibration_checksum(const uint8_t *data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Average `samples` readings of a device at rest, one per millisecond
+int vr_calibration_measure(vr_calibration_t *cal, uint32_t sensor_update_hz, uint32_t samples) {
+    if (!cal || samples == 0) return -1;
+
+    vr_device_t device;
+    vr_device_init(&device, 0, sensor_update_hz);
+    double position[3] = { 0 };
+    double pupil[2] = { 0 };
+    for (uint32_t i = 0; i < samples; i++) {
+        vr_delay_ms(1);
+        vr_device_update(&device);
+        const vr_telemetry_packet_t *p = &device.packet;
+        position[0] += p->head_position.x;
+        position[1] += p->head_position.y;
+        position[2] += p->head_position.z;
+        pupil[0] += p->left_eye.pupil_diameter;
+        pupil[1] += p->right_eye.pupil_diameter;
+    }
+
+    memset(cal, 0, sizeof(*cal));
+    cal->sensor_update_hz = sensor_update_hz;
+    cal->samples = samples;
+    for (int i = 0; i < 3; i++) {
+        cal->head_position[i] = (float)(position[i] / samples);
+    }
+    for (int i = 0; i < 2; i++) {
+        cal->pupil_diameter[i] = (float)(pupil[i] / samples);
+    }
+    cal->measured_us = vr_get_timestamp_us();
+    return 0;
+}
+
+// Read a cached calibration; fails unless it is intact, current and measured at sensor_update_hz
+int vr_calibration_load(vr_calibration_t *cal, const char *path, uint32_t sensor_update_hz) {
+    if (!cal || !path) return -1;
+
+    uint8_t data[VR_CALIBRATION_FILE_SIZE];
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+    size_t read = fread(data, 1, sizeof(data), file);
+    fclose(file);
+
+    if (read != sizeof(data) ||
+        vr_calibration_get_u32(data) != VR_CALIBRATION_MAGIC ||
+        (data[4] | (data[5] << 8)) != VR_CALIBRATION_VERSION ||
+        (data[6] | (data[7] << 8)) != VR_CALIBRATION_FILE_SIZE ||
+        vr_calibration_get_u32(data + 48) != vr_calibration_checksum(data, 48)) {
+        printf("[SENSORS] Ignoring invalid calibration cache %s\n", path);
+        return -1;
+    }
+
+    uint64_t measured_us = vr_calibration_get_u64(data + 40);
+    uint64_t now_us = vr_get_timestamp_us();
+    if (vr_calibration_get_u32(data + 8) != sensor_update_hz || measured_us > now_us ||
+        now_us - measured_us > (uint64_t)VR_CALIBRATION_MAX_AGE_S * 1000000) {
+        return -1;
+    }
+
+    cal->sensor_update_hz = sensor_update_hz;
+    cal->samples = vr_calibration_get_u32(data + 12);
+    for (int i = 0; i < 3; i++) {
+        cal->head_position[i] = vr_calibration_get_f32(data + 16 + 4 * i);
+    }
+    for (int i = 0; i < 2; i++) {
+        cal->pupil_diameter[i] = vr_calibration_get_f32(data + 28 + 4 * i);
+    }
+    cal->measured_us = measured_us;
+    return 0;
+}
+
+// Write a calibration to the cache file
+int vr_calibration_save(const vr_calibration_t *cal, const char *path) {
+    if (!cal || !path) return -1;
+
+    uint8_t data[VR_CALIBRATION_FILE_SIZE] = { 0 };
+    vr_calibration_put_u32(data, VR_CALIBRATION_MAGIC);
+    data[4] = (uint8_t)VR_CALIBRATION_VERSION;
+    data[6] = (uint8_t)VR_CALIBRATION_FILE_SIZE;
+    vr_calibration_put_u32(data + 8, cal->sensor_update_hz);
+    vr_calibration_put_u32(data + 12, cal->samples);
+    for (int i = 0; i < 3; i++) {
+        vr_calibration_put_f32(data + 16 + 4 * i, cal->head_position[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        vr_calibration_put_f32(data + 28 + 4 * i, cal->pupil_diameter[i]);
+    }
+    vr_calibration_put_u64(data + 40, cal->measured_us);
+    vr_calibration_put_u32(data + 48, vr_calibration_checksum(data, 48));
+
+    char temp[4096];
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) {
+        return -1;
+    }
+    FILE *file = fopen(temp, "wb");
+    if (!file) {
+        return -1;
+    }
+    bool written = fwrite(data, 1, sizeof(data), file) == sizeof(data);
+    if (fclose(file) != 0 || !written || rename(temp, path) != 0) {
+        remove(temp);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "vr_telemetry.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Append-only telemetry capture files.
+//
+// Recording maps the file and copies each frame into the mapping, so the
+// sampling loop pays for a binary encode and a memcpy, not a write(2). The
+// file grows in VR_CAPTURE_GROW_BYTES steps; the header count is updated
+// after every record, so a capture cut short by a crash is still readable
+// up to its last complete record. Closing trims the unused tail. Each record
+// keeps the frame's monotonic sample time next to the wire frame, so replay
+// is paced by when samples were taken, not by the slewed wall clock.
+
+// Little-endian header fields
+static void vr_capture_put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void vr_capture_put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void vr_capture_put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t vr_capture_get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t vr_capture_get_u32(const uint8_t *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t vr_capture_get_u64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+// Byte offset of a record
+static size_t vr_capture_offset(const vr_capture_t *cap, uint64_t index) {
+    return VR_CAPTURE_HEADER_SIZE + (size_t)index * cap->record_size;
+}
+
+// Write the record count and time ranges into the header
+static void vr_capture_update_header(vr_capture_t *cap) {
+    vr_capture_put_u64(cap->map + 16, cap->first_timestamp_us);
+    vr_capture_put_u64(cap->map + 24, cap->last_timestamp_us);
+    vr_capture_put_u64(cap->map + 32, cap->first_monotonic_us);
+    vr_capture_put_u64(cap->map + 40, cap->last_monotonic_us);
+    vr_capture_put_u64(cap->map + 8, cap->count);
+}
+
+// Grow the file and its mapping by one step
+static int vr_capture_grow(vr_capture_t *cap) {
+    size_t size = cap->map_size + VR_CAPTURE_GROW_BYTES;
+    if (ftruncate(cap->fd, (off_t)size) != 0) {
+        return -1;
+    }
+    uint8_t *map = mremap(cap->map, cap->map_size, size, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    cap->map = map;
+    cap->map_size = size;
+    return 0;
+}
+
+// Create (or truncate) a capture file for recording
+int vr_capture_create(vr_capture_t *cap, const char *path) {
+    memset(cap, 0, sizeof(*cap));
+    cap->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (cap->fd < 0) {
+        fprintf(stderr, "[CAPTURE] Cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(cap->fd, VR_CAPTURE_GROW_BYTES) != 0) {
+        fprintf(stderr, "[CAPTURE] Cannot size %s: %s\n", path, strerror(errno));
+        close(cap->fd);
+        return -1;
+    }
+    cap->map = mmap(NULL, VR_CAPTURE_GROW_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, cap->fd, 0);
+    if (cap->map == MAP_FAILED) {
+        fprintf(stderr, "[CAPTURE] Cannot map %s: %s\n", path, strerror(errno));
+        close(cap->fd);
+        return -1;
+    }
+    cap->map_size = VR_CAPTURE_GROW_BYTES;
+    cap->recording = true;
+    cap->writable = true;
+    cap->version = VR_CAPTURE_VERSION;
+    cap->record_size = VR_CAPTURE_RECORD_SIZE;
+
+    vr_capture_put_u32(cap->map, VR_CAPTURE_MAGIC);
+    vr_capture_put_u16(cap->map + 4, VR_CAPTURE_VERSION);
+    vr_capture_put_u16(cap->map + 6, VR_CAPTURE_RECORD_SIZE);
+    vr_capture_update_header(cap);
+    return 0;
+}
+
+// Append one frame; a frame_id equal to the previous record's is skipped
+int vr_capture_append(vr_capture_t *cap, const vr_telemetry_packet_t *packet) {
+    if (!cap->writable) {
+        return -1;
+    }
+    if (cap->count > 0 && packet->frame_id == cap->last_frame_id) {
+        return 0;
+    }
+
+    size_t offset = vr_capture_offset(cap, cap->count);
+    if (offset + VR_CAPTURE_RECORD_SIZE > cap->map_size && vr_capture_grow(cap) != 0) {
+        fprintf(stderr, "[CAPTURE] Cannot grow capture file, recording stopped: %s\n", strerror(errno));
+        cap->writable = false;
+        return -1;
+    }
+
+    vr_codec_encode_binary(packet, cap->map + offset, VR_WIRE_FRAME_SIZE);
+    vr_capture_put_u64(cap->map + offset + VR_WIRE_FRAME_SIZE, packet->monotonic_us);
+    if (cap->count == 0) {
+        cap->first_timestamp_us = packet->timestamp_us;
+        cap->first_monotonic_us = packet->monotonic_us;
+    }
+    cap->last_timestamp_us = packet->timestamp_us;
+    cap->last_monotonic_us = packet->monotonic_us;
+    cap->last_frame_id = packet->frame_id;
+    cap->count++;
+    vr_capture_update_header(cap);
+    return 0;
+}
+
+// Open a capture file for replay
+int vr_capture_open(vr_capture_t *cap, const char *path) {
+    struct stat st;
+
+    memset(cap, 0, sizeof(*cap));
+    cap->fd = open(path, O_RDONLY);
+    if (cap->fd < 0) {
+        fprintf(stderr, "[CAPTURE] Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (fstat(cap->fd, &st) != 0 || (size_t)st.st_size < VR_CAPTURE_HEADER_SIZE) {
+        fprintf(stderr, "[CAPTURE] %s is not a capture file\n", path);
+        close(cap->fd);
+        return -1;
+    }
+    cap->map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, cap->fd, 0);
+    if (cap->map == MAP_FAILED) {
+        fprintf(stderr, "[CAPTURE] Cannot map %s: %s\n", path, strerror(errno));
+        close(cap->fd);
+        return -1;
+    }
+    cap->map_size = (size_t)st.st_size;
+
+    // Version 1 records have no monotonic_us
+    cap->version = vr_capture_get_u16(cap->map + 4);
+    cap->record_size = cap->version == 1 ? VR_WIRE_FRAME_SIZE : VR_CAPTURE_RECORD_SIZE;
+    if (vr_capture_get_u32(cap->map) != VR_CAPTURE_MAGIC ||
+        (cap->version != 1 && cap->version != VR_CAPTURE_VERSION) ||
+        vr_capture_get_u16(cap->map + 6) != cap->record_size) {
+        fprintf(stderr, "[CAPTURE] %s is not a version 1-%d capture file\n", path, VR_CAPTURE_VERSION);
+        vr_capture_close(cap);
+        return -1;
+    }
+
+    // Trust the header count only as far as the file holds complete records
+    uint64_t stored = (cap->map_size - VR_CAPTURE_HEADER_SIZE) / cap->record_size;
+    cap->count = vr_capture_get_u64(cap->map + 8);
+    if (cap->count > stored) {
+        cap->count = stored;
+    }
+    cap->first_timestamp_us = vr_capture_get_u64(cap->map + 16);
+    cap->last_timestamp_us = vr_capture_get_u64(cap->map + 24);
+    cap->first_monotonic_us = cap->version == 1 ? cap->first_timestamp_us : vr_capture_get_u64(cap->map + 32);
+    cap->last_monotonic_us = cap->version == 1 ? cap->last_timestamp_us : vr_capture_get_u64(cap->map + 40);
+
+    // Replay reads front to back
+    madvise(cap->map, cap->map_size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+// Decode record index into packet, with its recorded monotonic_us (the
+// wall-clock timestamp_us for version 1 files)
+int vr_capture_read(const vr_capture_t *cap, uint64_t index, vr_telemetry_packet_t *packet) {
+    if (index >= cap->count) {
+        return -1;
+    }
+    const uint8_t *record = cap->map + vr_capture_offset(cap, index);
+    if (vr_codec_decode_binary(record, VR_WIRE_FRAME_SIZE, packet) < 0) {
+        return -1;
+    }
+    packet->monotonic_us = cap->version == 1 ? packet->timestamp_us :
+                           vr_capture_get_u64(record + VR_WIRE_FRAME_SIZE);
+    return 0;
+}
+
+// Close a capture file, trimming a recording to its last record
+void vr_capture_close(vr_capture_t *cap) {
+    if (!cap->map) {
+        return;
+    }
+
+    size_t used = vr_capture_offset(cap, cap->count);
+    munmap(cap->map, cap->map_size);
+    if (cap->recording && ftruncate(cap->fd, (off_t)used) != 0) {
+        fprintf(stderr, "[CAPTURE] Cannot trim capture file: %s\n", strerror(errno));
+    }
+    cap->map = NULL;
+    close(cap->fd);
+    cap->fd = -1;
+}
@@ -0,0 +1,112 @@
+#include "vr_telemetry.h"
+#include <time.h>
+
+// Timestamp source for frames and timers.
+//
+// Frames are sampled with CLOCK_MONOTONIC_RAW, which never jumps and is not
+// rate-adjusted by NTP; on Linux it is read from the vDSO without a system
+// call. Wall-clock time is the monotonic time plus an offset that the main
+// loop refreshes every VR_CLOCK_REFRESH_MS. Differences between the offset
+// and the real wall clock are slewed out at VR_CLOCK_MAX_SLEW_PPM, so
+// successive wall-clock timestamps move by at most a few microseconds more or
+// less than real time; only a wall-clock change beyond VR_CLOCK_STEP_US (a
+// manual clock set, a suspend) is applied at once.
+
+static int64_t g_clock_offset_us = 0;      // Wall clock minus monotonic clock
+static int g_clock_ready = 0;
+static uint64_t g_clock_refreshed_us = 0;  // Last refresh; owned by the refresh thread
+static uint64_t g_clock_steps = 0;
+
+// Read a clock in microseconds
+static uint64_t vr_clock_read_us(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Monotonic sample time in microseconds
+uint64_t vr_clock_monotonic_us(void) {
+    return vr_clock_read_us(CLOCK_MONOTONIC_RAW);
+}
+
+// Measure the wall-clock offset, bracketing the wall-clock read with two
+// monotonic reads to halve the error from being preempted in between
+static int64_t vr_clock_measure_offset(uint64_t *monotonic_us) {
+    uint64_t before = vr_clock_monotonic_us();
+    uint64_t wall = vr_clock_read_us(CLOCK_REALTIME);
+    uint64_t after = vr_clock_monotonic_us();
+    *monotonic_us = before + (after - before) / 2;
+    return (int64_t)(wall - *monotonic_us);
+}
+
+// Take the initial wall-clock offset; the first timestamp read does this if nothing else did
+void vr_clock_init(void) {
+    uint64_t now;
+    int64_t offset = vr_clock_measure_offset(&now);
+    __atomic_store_n(&g_clock_offset_us, offset, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_clock_ready, 1, __ATOMIC_RELEASE);
+}
+
+// Move offset toward the measured target after elapsed_us: by at most
+// VR_CLOCK_MAX_SLEW_PPM of the elapsed time, or straight to the target when
+// the error exceeds VR_CLOCK_STEP_US (sets *stepped)
+int64_t vr_clock_correct(int64_t offset, int64_t target, uint64_t elapsed_us, bool *stepped) {
+    int64_t error = target - offset;
+    int64_t max_slew = (int64_t)(elapsed_us * VR_CLOCK_MAX_SLEW_PPM / 1000000);
+
+    *stepped = error > VR_CLOCK_STEP_US || error < -VR_CLOCK_STEP_US;
+    if (*stepped) {
+        return target;
+    } else if (error > max_slew) {
+        return offset + max_slew;
+    } else if (error < -max_slew) {
+        return offset - max_slew;
+    }
+    return target;
+}
+
+// Slew the offset toward the wall clock; cheap to call more often than VR_CLOCK_REFRESH_MS.
+// Call from one thread only (the main loop's tick task).
+void vr_clock_refresh(void) {
+    if (!__atomic_load_n(&g_clock_ready, __ATOMIC_ACQUIRE)) {
+        vr_clock_init();
+    }
+    if (g_clock_refreshed_us == 0) {
+        g_clock_refreshed_us = vr_clock_monotonic_us();
+        return;
+    }
+
+    if (vr_clock_monotonic_us() - g_clock_refreshed_us < (uint64_t)VR_CLOCK_REFRESH_MS * 1000) {
+        return;
+    }
+
+    uint64_t now;
+    int64_t target = vr_clock_measure_offset(&now);
+    int64_t offset = __atomic_load_n(&g_clock_offset_us, __ATOMIC_RELAXED);
+    bool stepped;
+    offset = vr_clock_correct(offset, target, now - g_clock_refreshed_us, &stepped);
+    g_clock_refreshed_us = now;
+
+    if (stepped) {
+        __atomic_fetch_add(&g_clock_steps, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&g_clock_offset_us, offset, __ATOMIC_RELAXED);
+}
+
+// Current offset from the monotonic clock to the wall clock
+int64_t vr_clock_wall_offset_us(void) {
+    if (!__atomic_load_n(&g_clock_ready, __ATOMIC_ACQUIRE)) {
+        vr_clock_init();
+    }
+    return __atomic_load_n(&g_clock_offset_us, __ATOMIC_RELAXED);
+}
+
+// Convert a monotonic sample time to wall-clock microseconds since the epoch
+uint64_t vr_clock_wall_us(uint64_t monotonic_us) {
+    return monotonic_us + (uint64_t)vr_clock_wall_offset_us();
+}
+
+// Wall-clock changes applied as a step instead of slewed
+uint64_t vr_clock_steps(void) {
+    return __atomic_load_n(&g_clock_steps, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,618 @@
+#include "vr_telemetry.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Worst-case size of one JSON frame (every float at FLT_MAX); the fast
+// encoder writes directly only into buffers at least this large
+#define VR_JSON_FAST_BOUND 3072
+#define VR_JSON_FIELD_MAX  64
+
+// Little-endian field writers (independent of host byte order)
+static uint8_t *put_u8(uint8_t *p, uint8_t v) {
+    *p++ = v;
+    return p;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v) {
+    *p++ = (uint8_t)(v);
+    *p++ = (uint8_t)(v >> 8);
+    return p;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    *p++ = (uint8_t)(v);
+    *p++ = (uint8_t)(v >> 8);
+    *p++ = (uint8_t)(v >> 16);
+    *p++ = (uint8_t)(v >> 24);
+    return p;
+}
+
+static uint8_t *put_u64(uint8_t *p, uint64_t v) {
+    p = put_u32(p, (uint32_t)v);
+    return put_u32(p, (uint32_t)(v >> 32));
+}
+
+static uint8_t *put_f32(uint8_t *p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return put_u32(p, bits);
+}
+
+static uint8_t *put_orientation(uint8_t *p, const vr_orientation_t *q) {
+    p = put_f32(p, q->x);
+    p = put_f32(p, q->y);
+    p = put_f32(p, q->z);
+    return put_f32(p, q->w);
+}
+
+static uint8_t *put_hand(uint8_t *p, const vr_hand_tracking_t *hand) {
+    p = put_f32(p, hand->x);
+    p = put_f32(p, hand->y);
+    p = put_f32(p, hand->z);
+    p = put_orientation(p, &hand->orientation);
+    return put_f32(p, hand->grip_strength);
+}
+
+// Little-endian field readers
+static const uint8_t *get_u8(const uint8_t *p, uint8_t *v) {
+    *v = *p++;
+    return p;
+}
+
+static const uint8_t *get_u16(const uint8_t *p, uint16_t *v) {
+    *v = (uint16_t)(p[0] | (p[1] << 8));
+    return p + 2;
+}
+
+static const uint8_t *get_u32(const uint8_t *p, uint32_t *v) {
+    *v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    return p + 4;
+}
+
+static const uint8_t *get_u64(const uint8_t *p, uint64_t *v) {
+    uint32_t lo, hi;
+    p = get_u32(p, &lo);
+    p = get_u32(p, &hi);
+    *v = (uint64_t)lo | ((uint64_t)hi << 32);
+    return p;
+}
+
+static const uint8_t *get_f32(const uint8_t *p, float *v) {
+    uint32_t bits;
+    p = get_u32(p, &bits);
+    memcpy(v, &bits, sizeof(*v));
+    return p;
+}
+
+static const uint8_t *get_orientation(const uint8_t *p, vr_orientation_t *q) {
+    p = get_f32(p, &q->x);
+    p = get_f32(p, &q->y);
+    p = get_f32(p, &q->z);
+    return get_f32(p, &q->w);
+}
+
+static const uint8_t *get_hand(const uint8_t *p, vr_hand_tracking_t *hand) {
+    p = get_f32(p, &hand->x);
+    p = get_f32(p, &hand->y);
+    p = get_f32(p, &hand->z);
+    p = get_orientation(p, &hand->orientation);
+    return get_f32(p, &hand->grip_strength);
+}
+
+// JSON text writers. They assume the caller reserved VR_JSON_FAST_BOUND bytes.
+#define PUT_LIT(p, s) (memcpy((p), (s), sizeof(s) - 1), (p) + sizeof(s) - 1)
+
+static const char g_digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Write an unsigned integer in decimal
+static char *put_dec(char *p, uint64_t v) {
+    char tmp[20];
+    char *t = tmp + sizeof(tmp);
+
+    while (v >= 100) {
+        t -= 2;
+        memcpy(t, &g_digit_pairs[(v % 100) * 2], 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        t -= 2;
+        memcpy(t, &g_digit_pairs[v * 2], 2);
+    } else {
+        *--t = (char)('0' + v);
+    }
+
+    size_t n = (size_t)(tmp + sizeof(tmp) - t);
+    memcpy(p, t, n);
+    return p + n;
+}
+
+// Write exactly `digits` (even) decimal digits, zero padded
+static char *put_dec_fixed(char *p, uint32_t v, int digits) {
+    for (int i = digits; i > 0; i -= 2) {
+        memcpy(p + i - 2, &g_digit_pairs[(v % 100) * 2], 2);
+        v /= 100;
+    }
+    return p + digits;
+}
+
+// Write a float exactly as printf("%.Nf") would. A float times 10^6 (or 10^2)
+// is exact in double, so rounding the product with rint() (ties-to-even, like
+// glibc) yields the correctly rounded digits. NaN, inf and values too large
+// for the integer path go through snprintf.
+static char *put_fixed(char *p, float v, uint32_t scale, int decimals, const char *fmt) {
+    double scaled = (double)v * scale;
+    if (!(fabs(scaled) < 9007199254740992.0)) {
+        return p + snprintf(p, VR_JSON_FIELD_MAX, fmt, (double)v);
+    }
+
+    if (signbit(v)) {
+        *p++ = '-';
+    }
+    uint64_t n = (uint64_t)rint(fabs(scaled));
+    p = put_dec(p, n / scale);
+    *p++ = '.';
+    return put_dec_fixed(p, (uint32_t)(n % scale), decimals);
+}
+
+static char *put_f6(char *p, float v) {
+    return put_fixed(p, v, 1000000, 6, "%.6f");
+}
+
+static char *put_f2(char *p, float v) {
+    return put_fixed(p, v, 100, 2, "%.2f");
+}
+
+static char *put_bool(char *p, bool v) {
+    return v ? PUT_LIT(p, "true") : PUT_LIT(p, "false");
+}
+
+static char *put_json_vec3(char *p, float x, float y, float z) {
+    p = PUT_LIT(p, "{\"x\":");
+    p = put_f6(p, x);
+    p = PUT_LIT(p, ",\"y\":");
+    p = put_f6(p, y);
+    p = PUT_LIT(p, ",\"z\":");
+    p = put_f6(p, z);
+    return PUT_LIT(p, "}");
+}
+
+static char *put_json_quat(char *p, const vr_orientation_t *q) {
+    p = PUT_LIT(p, "{\"x\":");
+    p = put_f6(p, q->x);
+    p = PUT_LIT(p, ",\"y\":");
+    p = put_f6(p, q->y);
+    p = PUT_LIT(p, ",\"z\":");
+    p = put_f6(p, q->z);
+    p = PUT_LIT(p, ",\"w\":");
+    p = put_f6(p, q->w);
+    return PUT_LIT(p, "}");
+}
+
+static char *put_json_eye(char *p, const vr_eye_tracking_t *eye, bool blinking) {
+    p = PUT_LIT(p, "{\"x\":");
+    p = put_f6(p, eye->x);
+    p = PUT_LIT(p, ",\"y\":");
+    p = put_f6(p, eye->y);
+    p = PUT_LIT(p, ",\"pupil_diameter\":");
+    p = put_f6(p, eye->pupil_diameter);
+    p = PUT_LIT(p, ",\"is_blinking\":");
+    p = put_bool(p, blinking);
+    return PUT_LIT(p, "}");
+}
+
+static char *put_json_hand(char *p, const vr_hand_tracking_t *hand, bool tracking) {
+    p = PUT_LIT(p, "{\"x\":");
+    p = put_f6(p, hand->x);
+    p = PUT_LIT(p, ",\"y\":");
+    p = put_f6(p, hand->y);
+    p = PUT_LIT(p, ",\"z\":");
+    p = put_f6(p, hand->z);
+    p = PUT_LIT(p, ",\"orientation\":");
+    p = put_json_quat(p, &hand->orientation);
+    p = PUT_LIT(p, ",\"grip_strength\":");
+    p = put_f6(p, hand->grip_strength);
+    p = PUT_LIT(p, ",\"is_tracking\":");
+    p = put_bool(p, tracking);
+    return PUT_LIT(p, "}");
+}
+
+// Write the sections of one JSON frame into a buffer of at least VR_JSON_FAST_BOUND bytes
+static int vr_codec_write_json(const vr_telemetry_packet_t *packet, uint8_t sections, char *buffer) {
+    char *p = buffer;
+
+    p = PUT_LIT(p, "{\"timestamp_us\":");
+    p = put_dec(p, packet->timestamp_us);
+    p = PUT_LIT(p, ",\"frame_id\":");
+    p = put_dec(p, packet->frame_id);
+    if (sections & VR_SECTION_HEAD) {
+        p = PUT_LIT(p, ",\"head_position\":");
+        p = put_json_vec3(p, packet->head_position.x, packet->head_position.y, packet->head_position.z);
+        p = PUT_LIT(p, ",\"head_orientation\":");
+        p = put_json_quat(p, &packet->head_orientation);
+        p = PUT_LIT(p, ",\"head_acceleration\":");
+        p = put_json_vec3(p, packet->head_acceleration.x, packet->head_acceleration.y, packet->head_acceleration.z);
+        p = PUT_LIT(p, ",\"head_angular_velocity\":");
+        p = put_json_vec3(p, packet->head_angular_velocity.x, packet->head_angular_velocity.y,
+                          packet->head_angular_velocity.z);
+    }
+    if (sections & VR_SECTION_EYES) {
+        p = PUT_LIT(p, ",\"left_eye\":");
+        p = put_json_eye(p, &packet->left_eye, packet->flags & VR_WIRE_FLAG_LEFT_BLINKING);
+        p = PUT_LIT(p, ",\"right_eye\":");
+        p = put_json_eye(p, &packet->right_eye, packet->flags & VR_WIRE_FLAG_RIGHT_BLINKING);
+    }
+    if (sections & VR_SECTION_HANDS) {
+        p = PUT_LIT(p, ",\"left_hand\":");
+        p = put_json_hand(p, &packet->left_hand, packet->flags & VR_WIRE_FLAG_LEFT_TRACKING);
+        p = PUT_LIT(p, ",\"right_hand\":");
+        p = put_json_hand(p, &packet->right_hand, packet->flags & VR_WIRE_FLAG_RIGHT_TRACKING);
+    }
+    if (sections & VR_SECTION_STATUS) {
+        p = PUT_LIT(p, ",\"cpu_usage\":");
+        p = put_f2(p, packet->cpu_usage);
+        p = PUT_LIT(p, ",\"gpu_usage\":");
+        p = put_f2(p, packet->gpu_usage);
+        p = PUT_LIT(p, ",\"temperature\":");
+        p = put_f2(p, packet->temperature);
+        p = PUT_LIT(p, ",\"battery_level\":");
+        p = put_dec(p, packet->battery_level);
+        p = PUT_LIT(p, ",\"is_connected\":");
+        p = put_bool(p, packet->flags & VR_WIRE_FLAG_CONNECTED);
+    }
+    p = PUT_LIT(p, "}");
+    *p = '\0';
+
+    return (int)(p - buffer);
+}
+
+// Serialize packet to JSON (byte-identical to vr_codec_encode_json_printf)
+int vr_codec_encode_json(const vr_telemetry_packet_t *packet, char *buffer, size_t size) {
+    return vr_codec_encode_json_sections(packet, VR_SECTION_ALL, buffer, size);
+}
+
+// Serialize the given sections of a packet to JSON; other keys are left out
+int vr_codec_encode_json_sections(const vr_telemetry_packet_t *packet, uint8_t sections,
+                                  char *buffer, size_t size) {
+    if (!packet || !buffer) {
+        return -1;
+    }
+
+    if (size >= VR_JSON_FAST_BOUND) {
+        return vr_codec_write_json(packet, sections, buffer);
+    }
+
+    // Small buffer: encode into worst-case scratch space, then copy if it fits
+    char scratch[VR_JSON_FAST_BOUND];
+    int len = vr_codec_write_json(packet, sections, scratch);
+    if ((size_t)len >= size) {
+        return -1;
+    }
+    memcpy(buffer, scratch, (size_t)len + 1);
+    return len;
+}
+
+// Serialize packet to JSON with snprintf (reference implementation)
+int vr_codec_encode_json_printf(const vr_telemetry_packet_t *packet, char *buffer, size_t size) {
+    if (!packet || !buffer) {
+        return -1;
+    }
+
+    int len = snprintf(buffer, size,
+        "{"
+        "\"timestamp_us\":%lu,"
+        "\"frame_id\":%u,"
+        "\"head_position\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f},"
+        "\"head_orientation\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"w\":%.6f},"
+        "\"head_acceleration\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f},"
+        "\"head_angular_velocity\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f},"
+        "\"left_eye\":{\"x\":%.6f,\"y\":%.6f,\"pupil_diameter\":%.6f,\"is_blinking\":%s},"
+        "\"right_eye\":{\"x\":%.6f,\"y\":%.6f,\"pupil_diameter\":%.6f,\"is_blinking\":%s},"
+        "\"left_hand\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"orientation\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"w\":%.6f},\"grip_strength\":%.6f,\"is_tracking\":%s},"
+        "\"right_hand\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"orientation\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"w\":%.6f},\"grip_strength\":%.6f,\"is_tracking\":%s},"
+        "\"cpu_usage\":%.2f,"
+        "\"gpu_usage\":%.2f,"
+        "\"temperature\":%.2f,"
+        "\"battery_level\":%u,"
+        "\"is_connected\":%s"
+        "}",
+        packet->timestamp_us,
+        packet->frame_id,
+        packet->head_position.x, packet->head_position.y, packet->head_position.z,
+        packet->head_orientation.x, packet->head_orientation.y, packet->head_orientation.z, packet->head_orientation.w,
+        packet->head_acceleration.x, packet->head_acceleration.y, packet->head_acceleration.z,
+        packet->head_angular_velocity.x, packet->head_angular_velocity.y, packet->head_angular_velocity.z,
+        packet->left_eye.x, packet->left_eye.y, packet->left_eye.pupil_diameter, (packet->flags & VR_WIRE_FLAG_LEFT_BLINKING) ? "true" : "false",
+        packet->right_eye.x, packet->right_eye.y, packet->right_eye.pupil_diameter, (packet->flags & VR_WIRE_FLAG_RIGHT_BLINKING) ? "true" : "false",
+        packet->left_hand.x, packet->left_hand.y, packet->left_hand.z,
+        packet->left_hand.orientation.x, packet->left_hand.orientation.y, packet->left_hand.orientation.z, packet->left_hand.orientation.w,
+        packet->left_hand.grip_strength, (packet->flags & VR_WIRE_FLAG_LEFT_TRACKING) ? "true" : "false",
+        packet->right_hand.x, packet->right_hand.y, packet->right_hand.z,
+        packet->right_hand.orientation.x, packet->right_hand.orientation.y, packet->right_hand.orientation.z, packet->right_hand.orientation.w,
+        packet->right_hand.grip_strength, (packet->flags & VR_WIRE_FLAG_RIGHT_TRACKING) ? "true" : "false",
+        packet->cpu_usage,
+        packet->gpu_usage,
+        packet->temperature,
+        packet->battery_level,
+        (packet->flags & VR_WIRE_FLAG_CONNECTED) ? "true" : "false"
+    );
+
+    if (len < 0 || (size_t)len >= size) {
+        return -1;
+    }
+
+    return len;
+}
+
+// Wire flags of the given sections
+static uint8_t vr_codec_flags(const vr_telemetry_packet_t *packet, uint8_t sections) {
+    uint8_t mask = 0;
+    if (sections & VR_SECTION_EYES)   mask |= VR_WIRE_FLAG_LEFT_BLINKING | VR_WIRE_FLAG_RIGHT_BLINKING;
+    if (sections & VR_SECTION_HANDS)  mask |= VR_WIRE_FLAG_LEFT_TRACKING | VR_WIRE_FLAG_RIGHT_TRACKING;
+    if (sections & VR_SECTION_STATUS) mask |= VR_WIRE_FLAG_CONNECTED;
+    return packet->flags & mask;
+}
+
+static uint8_t *put_head(uint8_t *p, const vr_telemetry_packet_t *packet) {
+    p = put_f32(p, packet->head_position.x);
+    p = put_f32(p, packet->head_position.y);
+    p = put_f32(p, packet->head_position.z);
+    p = put_orientation(p, &packet->head_orientation);
+    p = put_f32(p, packet->head_acceleration.x);
+    p = put_f32(p, packet->head_acceleration.y);
+    p = put_f32(p, packet->head_acceleration.z);
+    p = put_f32(p, packet->head_angular_velocity.x);
+    p = put_f32(p, packet->head_angular_velocity.y);
+    return put_f32(p, packet->head_angular_velocity.z);
+}
+
+static uint8_t *put_eyes(uint8_t *p, const vr_telemetry_packet_t *packet) {
+    p = put_f32(p, packet->left_eye.x);
+    p = put_f32(p, packet->left_eye.y);
+    p = put_f32(p, packet->left_eye.pupil_diameter);
+    p = put_f32(p, packet->right_eye.x);
+    p = put_f32(p, packet->right_eye.y);
+    return put_f32(p, packet->right_eye.pupil_diameter);
+}
+
+static uint8_t *put_status(uint8_t *p, const vr_telemetry_packet_t *packet) {
+    p = put_f32(p, packet->cpu_usage);
+    p = put_f32(p, packet->gpu_usage);
+    p = put_f32(p, packet->temperature);
+    return put_u8(p, packet->battery_level);
+}
+
+// Size of a binary frame message carrying the given sections
+static size_t vr_codec_binary_size(uint8_t sections) {
+    if (sections == VR_SECTION_ALL) {
+        return VR_WIRE_FRAME_SIZE;
+    }
+    size_t size = VR_WIRE_SECTIONS_HEADER_SIZE;
+    if (sections & VR_SECTION_HEAD)   size += 13 * 4;
+    if (sections & VR_SECTION_EYES)   size += 6 * 4;
+    if (sections & VR_SECTION_HANDS)  size += 16 * 4;
+    if (sections & VR_SECTION_STATUS) size += 3 * 4 + 1;
+    return size;
+}
+
+// Serialize packet to the binary wire format (VR_WIRE_TYPE_FRAME)
+int vr_codec_encode_binary(const vr_telemetry_packet_t *packet, uint8_t *buffer, size_t size) {
+    if (!packet || !buffer || size < VR_WIRE_FRAME_SIZE) {
+        return -1;
+    }
+
+    uint8_t *p = buffer;
+
+    // Header
+    p = put_u16(p, VR_WIRE_MAGIC);
+    p = put_u8(p, VR_WIRE_VERSION);
+    p = put_u8(p, VR_WIRE_TYPE_FRAME);
+
+    p = put_u64(p, packet->timestamp_us);
+    p = put_u32(p, packet->frame_id);
+
+    p = put_head(p, packet);
+    p = put_eyes(p, packet);
+    p = put_hand(p, &packet->left_hand);
+    p = put_hand(p, &packet->right_hand);
+    p = put_status(p, packet);
+    p = put_u8(p, vr_codec_flags(packet, VR_SECTION_ALL));
+
+    return (int)(p - buffer);
+}
+
+// Parse a binary frame message (VR_WIRE_TYPE_FRAME) back into a packet.
+// monotonic_us is not on the wire and is left zero.
+int vr_codec_decode_binary(const uint8_t *buffer, size_t size, vr_telemetry_packet_t *packet) {
+    if (!buffer || !packet || size < VR_WIRE_FRAME_SIZE) {
+        return -1;
+    }
+
+    const uint8_t *p = buffer;
+    uint16_t magic;
+    uint8_t version, type;
+    p = get_u16(p, &magic);
+    p = get_u8(p, &version);
+    p = get_u8(p, &type);
+    if (magic != VR_WIRE_MAGIC || version != VR_WIRE_VERSION || type != VR_WIRE_TYPE_FRAME) {
+        return -1;
+    }
+
+    memset(packet, 0, sizeof(*packet));
+    p = get_u64(p, &packet->timestamp_us);
+    p = get_u32(p, &packet->frame_id);
+
+    p = get_f32(p, &packet->head_position.x);
+    p = get_f32(p, &packet->head_position.y);
+    p = get_f32(p, &packet->head_position.z);
+    p = get_orientation(p, &packet->head_orientation);
+    p = get_f32(p, &packet->head_acceleration.x);
+    p = get_f32(p, &packet->head_acceleration.y);
+    p = get_f32(p, &packet->head_acceleration.z);
+    p = get_f32(p, &packet->head_angular_velocity.x);
+    p = get_f32(p, &packet->head_angular_velocity.y);
+    p = get_f32(p, &packet->head_angular_velocity.z);
+
+    p = get_f32(p, &packet->left_eye.x);
+    p = get_f32(p, &packet->left_eye.y);
+    p = get_f32(p, &packet->left_eye.pupil_diameter);
+    p = get_f32(p, &packet->right_eye.x);
+    p = get_f32(p, &packet->right_eye.y);
+    p = get_f32(p, &packet->right_eye.pupil_diameter);
+
+    p = get_hand(p, &packet->left_hand);
+    p = get_hand(p, &packet->right_hand);
+
+    p = get_f32(p, &packet->cpu_usage);
+    p = get_f32(p, &packet->gpu_usage);
+    p = get_f32(p, &packet->temperature);
+    p = get_u8(p, &packet->battery_level);
+    p = get_u8(p, &packet->flags);
+
+    return (int)(p - buffer);
+}
+
+// Serialize the given sections of a packet (VR_WIRE_TYPE_SECTIONS, or
+// VR_WIRE_TYPE_FRAME when all sections are included)
+int vr_codec_encode_binary_sections(const vr_telemetry_packet_t *packet, uint8_t sections,
+                                    uint8_t *buffer, size_t size) {
+    sections &= VR_SECTION_ALL;
+    if (sections == VR_SECTION_ALL) {
+        return vr_codec_encode_binary(packet, buffer, size);
+    }
+    if (!packet || !buffer || size < vr_codec_binary_size(sections)) {
+        return -1;
+    }
+
+    uint8_t *p = buffer;
+    p = put_u16(p, VR_WIRE_MAGIC);
+    p = put_u8(p, VR_WIRE_VERSION);
+    p = put_u8(p, VR_WIRE_TYPE_SECTIONS);
+
+    p = put_u64(p, packet->timestamp_us);
+    p = put_u32(p, packet->frame_id);
+    p = put_u8(p, sections);
+    p = put_u8(p, vr_codec_flags(packet, sections));
+
+    if (sections & VR_SECTION_HEAD) {
+        p = put_head(p, packet);
+    }
+    if (sections & VR_SECTION_EYES) {
+        p = put_eyes(p, packet);
+    }
+    if (sections & VR_SECTION_HANDS) {
+        p = put_hand(p, &packet->left_hand);
+        p = put_hand(p, &packet->right_hand);
+    }
+    if (sections & VR_SECTION_STATUS) {
+        p = put_status(p, packet);
+    }
+
+    return (int)(p - buffer);
+}
+
+// Serialize several packets as a JSON array
+int vr_codec_encode_json_batch(const vr_telemetry_packet_t *packets, uint32_t count, uint8_t sections,
+                               char *buffer, size_t size) {
+    if (!packets || !buffer || count == 0 || size < 2) {
+        return -1;
+    }
+
+    size_t pos = 0;
+    buffer[pos++] = '[';
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (i > 0) {
+            if (pos >= size) {
+                return -1;
+            }
+            buffer[pos++] = ',';
+        }
+
+        int len = vr_codec_encode_json_sections(&packets[i], sections, buffer + pos, size - pos);
+        if (len < 0) {
+            return -1;
+        }
+        pos += (size_t)len;
+    }
+
+    if (pos + 1 >= size) {
+        return -1;
+    }
+    buffer[pos++] = ']';
+    buffer[pos] = '\0';
+
+    return (int)pos;
+}
+
+// Serialize several packets as a VR_WIRE_TYPE_BATCH message
+int vr_codec_encode_binary_batch(const vr_telemetry_packet_t *packets, uint32_t count, uint8_t sections,
+                                 uint8_t *buffer, size_t size) {
+    if (!packets || !buffer || count == 0 || count > UINT16_MAX) {
+        return -1;
+    }
+
+    sections &= VR_SECTION_ALL;
+    size_t frame_size = vr_codec_binary_size(sections);
+    size_t needed = VR_WIRE_BATCH_HEADER_SIZE + (size_t)count * (2 + frame_size);
+    if (size < needed) {
+        return -1;
+    }
+
+    uint8_t *p = buffer;
+    p = put_u16(p, VR_WIRE_MAGIC);
+    p = put_u8(p, VR_WIRE_VERSION);
+    p = put_u8(p, VR_WIRE_TYPE_BATCH);
+    p = put_u16(p, (uint16_t)count);
+    p = put_u16(p, 0);
+
+    for (uint32_t i = 0; i < count; i++) {
+        p = put_u16(p, (uint16_t)frame_size);
+        int len = vr_codec_encode_binary_sections(&packets[i], sections, p, size - (size_t)(p - buffer));
+        if (len < 0) {
+            return -1;
+        }
+        p += len;
+    }
+
+    return (int)(p - buffer);
+}
+
+// Get AMQP content type for a wire format
+const char *vr_codec_content_type(vr_wire_format_t format) {
+    switch (format) {
+        case VR_WIRE_FORMAT_BINARY:
+        case VR_WIRE_FORMAT_DELTA:  return VR_CONTENT_TYPE_BINARY;
+        case VR_WIRE_FORMAT_JSON:
+        default:                    return VR_CONTENT_TYPE_JSON;
+    }
+}
+
+// Parse wire format name from the command line
+int vr_codec_parse_format(const char *name, vr_wire_format_t *format) {
+    if (!name || !format) {
+        return -1;
+    }
+
+    if (strcmp(name, "json") == 0) {
+        *format = VR_WIRE_FORMAT_JSON;
+    } else if (strcmp(name, "binary") == 0) {
+        *format = VR_WIRE_FORMAT_BINARY;
+    } else if (strcmp(name, "delta") == 0) {
+        *format = VR_WIRE_FORMAT_DELTA;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
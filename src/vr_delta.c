@@ -0,0 +1,229 @@
+#include "vr_telemetry.h"
+#include <math.h>
+#include <string.h>
+
+// Delta encoding for the binary wire format (VR_WIRE_TYPE_DELTA).
+//
+// Each frame is quantized to integers first, so deltas are exact and the
+// consumer reconstructs the quantized stream without drift. Keyframes are
+// deltas against an all-zero frame, which keeps a single encoding path.
+
+#define VR_QUANT_LIMIT 2147483647.0  // Quantized floats are clamped to int32 range
+
+static uint8_t *put_u8(uint8_t *p, uint8_t v) {
+    *p++ = v;
+    return p;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v) {
+    *p++ = (uint8_t)(v);
+    *p++ = (uint8_t)(v >> 8);
+    return p;
+}
+
+// Zigzag-encode a signed value and write it as an LEB128 varint
+static uint8_t *put_svarint(uint8_t *p, int64_t v) {
+    uint64_t z = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    while (z >= 0x80) {
+        *p++ = (uint8_t)(z | 0x80);
+        z >>= 7;
+    }
+    *p++ = (uint8_t)z;
+    return p;
+}
+
+// Scale and round a float to a fixed-point integer
+static int64_t quant(float v, double scale) {
+    double q = rint((double)v * scale);
+    if (q != q) return 0;  // NaN
+    if (q > VR_QUANT_LIMIT) return (int64_t)VR_QUANT_LIMIT;
+    if (q < -VR_QUANT_LIMIT) return -(int64_t)VR_QUANT_LIMIT;
+    return (int64_t)q;
+}
+
+// Smallest-three quaternion packing into index + three components
+static int64_t *quant_quat(int64_t *out, const vr_orientation_t *q, uint32_t bits) {
+    double c[4] = { q->x, q->y, q->z, q->w };
+    double norm = sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2] + c[3] * c[3]);
+
+    if (!(norm > 1e-6)) {
+        out[0] = VR_QUAT_INDEX_ZERO;
+        out[1] = out[2] = out[3] = 0;
+        return out + 4;
+    }
+
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabs(c[i]) > fabs(c[largest])) largest = i;
+    }
+
+    // q and -q are the same rotation: flip so the dropped component is positive
+    double sign = c[largest] < 0 ? -1.0 : 1.0;
+    double max = (double)((1u << (bits - 1)) - 1);
+
+    out[0] = largest;
+    int n = 1;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        double v = rint(sign * c[i] / norm * M_SQRT2 * max);
+        if (v > max) v = max;
+        if (v < -max) v = -max;
+        out[n++] = (int64_t)v;
+    }
+    return out + 4;
+}
+
+// Quantize a hand: position, orientation, grip
+static int64_t *quant_hand(int64_t *out, const vr_hand_tracking_t *hand, double position_scale,
+                           uint32_t quat_bits) {
+    *out++ = quant(hand->x, position_scale);
+    *out++ = quant(hand->y, position_scale);
+    *out++ = quant(hand->z, position_scale);
+    out = quant_quat(out, &hand->orientation, quat_bits);
+    *out++ = quant(hand->grip_strength, VR_QUANT_GRIP_SCALE);
+    return out;
+}
+
+// Initialize a delta encoder; parameters are clamped to supported ranges
+void vr_delta_init(vr_delta_encoder_t *enc, uint32_t keyframe_interval,
+                   uint32_t position_um, uint32_t quat_bits) {
+    if (!enc) return;
+
+    memset(enc, 0, sizeof(*enc));
+    enc->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+    enc->position_um = (uint16_t)(position_um < 1 ? 1 : position_um > UINT16_MAX ? UINT16_MAX : position_um);
+    enc->quat_bits = (uint8_t)(quat_bits < 2 ? 2 : quat_bits > 16 ? 16 : quat_bits);
+}
+
+// Make the next frame a keyframe (e.g. after a message may have been lost)
+void vr_delta_force_keyframe(vr_delta_encoder_t *enc) {
+    if (enc) {
+        enc->have_previous = false;
+    }
+}
+
+// Quantize a packet into the VR_QUANT_FIELDS integer fields
+void vr_delta_quantize(const vr_delta_encoder_t *enc, const vr_telemetry_packet_t *packet,
+                       vr_quant_frame_t *frame) {
+    double position_scale = 1000000.0 / enc->position_um;
+    int64_t *f = frame->fields;
+
+    *f++ = (int64_t)packet->timestamp_us;
+    *f++ = packet->frame_id;
+
+    // Head tracking
+    *f++ = quant(packet->head_position.x, position_scale);
+    *f++ = quant(packet->head_position.y, position_scale);
+    *f++ = quant(packet->head_position.z, position_scale);
+    f = quant_quat(f, &packet->head_orientation, enc->quat_bits);
+    *f++ = quant(packet->head_acceleration.x, VR_QUANT_ACCEL_SCALE);
+    *f++ = quant(packet->head_acceleration.y, VR_QUANT_ACCEL_SCALE);
+    *f++ = quant(packet->head_acceleration.z, VR_QUANT_ACCEL_SCALE);
+    *f++ = quant(packet->head_angular_velocity.x, VR_QUANT_GYRO_SCALE);
+    *f++ = quant(packet->head_angular_velocity.y, VR_QUANT_GYRO_SCALE);
+    *f++ = quant(packet->head_angular_velocity.z, VR_QUANT_GYRO_SCALE);
+
+    // Eye tracking
+    *f++ = quant(packet->left_eye.x, VR_QUANT_EYE_SCALE);
+    *f++ = quant(packet->left_eye.y, VR_QUANT_EYE_SCALE);
+    *f++ = quant(packet->left_eye.pupil_diameter, VR_QUANT_PUPIL_SCALE);
+    *f++ = quant(packet->right_eye.x, VR_QUANT_EYE_SCALE);
+    *f++ = quant(packet->right_eye.y, VR_QUANT_EYE_SCALE);
+    *f++ = quant(packet->right_eye.pupil_diameter, VR_QUANT_PUPIL_SCALE);
+
+    // Hand tracking
+    f = quant_hand(f, &packet->left_hand, position_scale, enc->quat_bits);
+    f = quant_hand(f, &packet->right_hand, position_scale, enc->quat_bits);
+
+    // System status
+    *f++ = quant(packet->cpu_usage, VR_QUANT_STATUS_SCALE);
+    *f++ = quant(packet->gpu_usage, VR_QUANT_STATUS_SCALE);
+    *f++ = quant(packet->temperature, VR_QUANT_STATUS_SCALE);
+    *f++ = packet->battery_level;
+    *f++ = packet->flags;
+}
+
+// Quantized field range of each section, in VR_SECTION_* bit order
+static const struct {
+    uint8_t section;
+    uint8_t first;
+    uint8_t last;
+} g_section_fields[] = {
+    { VR_SECTION_HEAD,   2, 14 },
+    { VR_SECTION_EYES,   15, 20 },
+    { VR_SECTION_HANDS,  21, 36 },
+    { VR_SECTION_STATUS, 37, 40 },
+};
+
+// Mark which quantized fields a section mask carries
+static void vr_delta_field_mask(uint8_t sections, bool *present) {
+    for (int f = 0; f < VR_QUANT_FIELDS; f++) {
+        present[f] = true;
+    }
+    for (size_t i = 0; i < sizeof(g_section_fields) / sizeof(g_section_fields[0]); i++) {
+        if (sections & g_section_fields[i].section) continue;
+        for (int f = g_section_fields[i].first; f <= g_section_fields[i].last; f++) {
+            present[f] = false;
+        }
+    }
+}
+
+// Wire flags that belong to the sections in a mask
+static int64_t vr_delta_flag_mask(uint8_t sections) {
+    int64_t mask = 0;
+    if (sections & VR_SECTION_EYES)   mask |= VR_WIRE_FLAG_LEFT_BLINKING | VR_WIRE_FLAG_RIGHT_BLINKING;
+    if (sections & VR_SECTION_HANDS)  mask |= VR_WIRE_FLAG_LEFT_TRACKING | VR_WIRE_FLAG_RIGHT_TRACKING;
+    if (sections & VR_SECTION_STATUS) mask |= VR_WIRE_FLAG_CONNECTED;
+    return mask;
+}
+
+// Serialize the given sections of packets as one VR_WIRE_TYPE_DELTA message, advancing the encoder
+int vr_delta_encode_batch(vr_delta_encoder_t *enc, const vr_telemetry_packet_t *packets,
+                          uint32_t count, uint8_t sections, uint8_t *buffer, size_t size) {
+    if (!enc || !packets || !buffer || count == 0 || count > UINT16_MAX) {
+        return -1;
+    }
+
+    sections &= VR_SECTION_ALL;
+    if (sections == 0) {
+        return -1;
+    }
+    bool present[VR_QUANT_FIELDS];
+    vr_delta_field_mask(sections, present);
+    int64_t flag_mask = vr_delta_flag_mask(sections);
+
+    size_t needed = VR_WIRE_DELTA_HEADER_SIZE + (size_t)count * VR_DELTA_MAX_FRAME_SIZE;
+    if (size < needed) {
+        return -1;
+    }
+
+    uint8_t *p = buffer;
+    p = put_u16(p, VR_WIRE_MAGIC);
+    p = put_u8(p, VR_WIRE_VERSION);
+    p = put_u8(p, VR_WIRE_TYPE_DELTA);
+    p = put_u16(p, (uint16_t)count);
+    p = put_u16(p, enc->sequence++);
+    p = put_u16(p, enc->position_um);
+    p = put_u8(p, enc->quat_bits);
+    p = put_u8(p, sections);
+
+    for (uint32_t i = 0; i < count; i++) {
+        vr_quant_frame_t frame;
+        vr_delta_quantize(enc, &packets[i], &frame);
+        frame.fields[VR_QUANT_FIELDS - 1] &= flag_mask;
+
+        bool keyframe = !enc->have_previous || enc->frames_since_keyframe >= enc->keyframe_interval;
+        p = put_u8(p, keyframe ? VR_DELTA_KEYFRAME : VR_DELTA_DELTA);
+        for (int f = 0; f < VR_QUANT_FIELDS; f++) {
+            if (!present[f]) continue;
+            int64_t base = keyframe ? 0 : enc->previous.fields[f];
+            p = put_svarint(p, frame.fields[f] - base);
+        }
+
+        enc->previous = frame;
+        enc->have_previous = true;
+        enc->frames_since_keyframe = keyframe ? 1 : enc->frames_since_keyframe + 1;
+    }
+
+    return (int)(p - buffer);
+}
@@ -0,0 +1,509 @@
+#include "vr_telemetry.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Simulated headsets and the fleet that runs many of them in one process.
+//
+// A vr_device_t holds one headset's sensor state, so any number can be
+// simulated side by side. The fleet gives every device its own streams and
+// batches. Devices are hashed by id onto a fixed set of broker connections
+// (shards), and each shard belongs to one worker thread, so a device always
+// publishes over the same connection. Each worker runs a scheduler for the
+// devices of its shards; workers share nothing on the hot path except the
+// metrics histograms.
+
+#define VR_DEVICE_SYNTH_CHUNK 64  // Samples handed to the synthesis kernel at once
+
+// One of a device's streams; batch is NULL when the stream is off
+typedef struct {
+    vr_stream_t stream;
+    vr_batch_t *batch;
+} vr_fleet_stream_t;
+
+// A device with its publishing state (fleet only)
+typedef struct {
+    vr_device_t device;
+    vr_publisher_t *publisher;     // Connection of the device's shard; NULL without a broker
+    vr_fleet_stream_t streams[VR_STREAM_KIND_COUNT];
+} vr_fleet_device_t;
+
+typedef struct vr_fleet_worker vr_fleet_worker_t;
+
+// Argument of a worker's telemetry task for one stream kind
+typedef struct {
+    vr_fleet_worker_t *worker;
+    vr_stream_kind_t kind;
+} vr_fleet_task_t;
+
+struct vr_fleet_worker {
+    uint32_t index;
+    vr_fleet_device_t *devices;    // Devices of this worker's shards, a slice of g_fleet_devices
+    vr_device_t **device_ptrs;     // The slice's devices, for vr_device_update_many()
+    uint32_t count;
+    vr_scheduler_t scheduler;
+    pthread_t thread;
+    bool started;
+    vr_fleet_task_t tasks[VR_STREAM_KIND_COUNT];
+    uint64_t frames_sampled;
+    uint64_t frames_dropped;
+};
+
+// Fleet state; start/stop/stats are cold paths serialized by g_fleet_lock
+static pthread_mutex_t g_fleet_lock = PTHREAD_MUTEX_INITIALIZER;
+static vr_fleet_device_t *g_fleet_devices = NULL;
+static vr_device_t **g_fleet_device_ptrs = NULL;
+static vr_batch_t *g_fleet_batches[VR_STREAM_KIND_COUNT];  // One batch per device for each stream on
+static vr_fleet_worker_t *g_fleet_workers = NULL;
+static vr_publisher_t *g_fleet_publishers[VR_SHARD_MAX];  // Shard s is owned by worker s % workers
+static uint32_t g_fleet_device_count = 0;
+static uint32_t g_fleet_worker_count = 0;
+static uint32_t g_fleet_connection_count = 0;  // 0 when running without a broker
+static volatile bool g_fleet_running = false;
+static vr_fleet_stats_t g_fleet_final_stats;  // Totals of the last stopped fleet
+
+// Initialize a device at rest; device 0 reproduces the single-device waveforms
+void vr_device_init(vr_device_t *dev, uint32_t id, uint32_t sensor_update_hz) {
+    if (!dev) return;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->id = id;
+    dev->sensor_update_hz = sensor_update_hz > 0 ? sensor_update_hz : 1;
+    dev->time_offset_s = (double)((id * 37u) % 600u) / 10.0;  // Spread over one minute
+
+    dev->packet.head_position.y = 1.7f;  // Average head height
+    dev->packet.head_orientation.w = 1.0f;
+    dev->packet.battery_level = 100;
+    dev->packet.flags = VR_WIRE_FLAG_CONNECTED;
+}
+
+// Simulation time of a device's frame
+static float vr_device_time(const vr_device_t *dev, uint32_t frame) {
+    return (float)((double)frame / dev->sensor_update_hz + dev->time_offset_s);
+}
+
+// Advance a device by one sensor period and synthesize its next sample
+void vr_device_update(vr_device_t *dev) {
+    vr_telemetry_packet_t *p = &dev->packet;
+
+    // Update simulation time: one sensor period per update
+    float simulation_time = vr_device_time(dev, dev->frame_counter);
+
+    // Update timestamps and frame ID
+    p->monotonic_us = vr_clock_monotonic_us();
+    p->timestamp_us = vr_clock_wall_us(p->monotonic_us);
+    p->frame_id = dev->frame_counter++;
+
+    vr_synth_sample(simulation_time, p);
+}
+
+// Advance several devices by one sensor period with the vectorized kernel;
+// they share one timestamp, as if sampled by the same tick
+void vr_device_update_many(vr_device_t *const *devices, uint32_t count) {
+    float times[VR_DEVICE_SYNTH_CHUNK];
+    vr_telemetry_packet_t *packets[VR_DEVICE_SYNTH_CHUNK];
+    uint64_t now = vr_clock_monotonic_us();
+    uint64_t wall = vr_clock_wall_us(now);
+
+    for (uint32_t base = 0; base < count; base += VR_DEVICE_SYNTH_CHUNK) {
+        uint32_t n = count - base < VR_DEVICE_SYNTH_CHUNK ? count - base : VR_DEVICE_SYNTH_CHUNK;
+        for (uint32_t i = 0; i < n; i++) {
+            vr_device_t *dev = devices[base + i];
+            times[i] = vr_device_time(dev, dev->frame_counter);
+            packets[i] = &dev->packet;
+            dev->packet.monotonic_us = now;
+            dev->packet.timestamp_us = wall;
+            dev->packet.frame_id = dev->frame_counter++;
+        }
+        vr_synth_samples(times, packets, n);
+    }
+}
+
+// Synthesize a device's next `count` samples into an array, timestamped one
+// sensor period apart from now; dev->packet ends up holding the last one
+void vr_device_generate(vr_device_t *dev, vr_telemetry_packet_t *packets, uint32_t count) {
+    float times[VR_DEVICE_SYNTH_CHUNK];
+    vr_telemetry_packet_t *out[VR_DEVICE_SYNTH_CHUNK];
+    uint64_t start = vr_clock_monotonic_us();
+    int64_t offset = vr_clock_wall_offset_us();
+
+    for (uint32_t base = 0; base < count; base += VR_DEVICE_SYNTH_CHUNK) {
+        uint32_t n = count - base < VR_DEVICE_SYNTH_CHUNK ? count - base : VR_DEVICE_SYNTH_CHUNK;
+        for (uint32_t i = 0; i < n; i++) {
+            vr_telemetry_packet_t *p = &packets[base + i];
+            times[i] = vr_device_time(dev, dev->frame_counter);
+            out[i] = p;
+            p->monotonic_us = start + (uint64_t)(base + i) * 1000000u / dev->sensor_update_hz;
+            p->timestamp_us = p->monotonic_us + (uint64_t)offset;
+            p->frame_id = dev->frame_counter++;
+        }
+        vr_synth_samples(times, out, n);
+    }
+    if (count > 0) {
+        dev->packet = packets[count - 1];
+    }
+}
+
+// Insert the device id before the last segment of a routing key:
+// "telemetry.data" -> "telemetry.<id>.data", "telemetry" -> "telemetry.<id>"
+int vr_device_format_routing_key(const char *base, uint32_t id, char *buffer, size_t size) {
+    if (!base || !buffer || size == 0) return -1;
+
+    const char *dot = strrchr(base, '.');
+    int len;
+    if (dot) {
+        len = snprintf(buffer, size, "%.*s.%u%s", (int)(dot - base), base, id, dot);
+    } else {
+        len = snprintf(buffer, size, "%s.%u", base, id);
+    }
+    return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+// Sensor task: sample every device in the worker's slice
+static void vr_fleet_sensors_task(void *arg) {
+    vr_fleet_worker_t *worker = arg;
+    uint64_t start = vr_get_monotonic_ns();
+    if (worker->count == 0) {
+        return;
+    }
+    vr_device_update_many(worker->device_ptrs, worker->count);
+    vr_metrics_record(VR_METRIC_SENSOR_UPDATE, (vr_get_monotonic_ns() - start) / worker->count);
+}
+
+// Shard a device is published on
+static uint32_t vr_fleet_device_shard(uint32_t id, uint32_t connections) {
+    const uint8_t bytes[4] = { (uint8_t)id, (uint8_t)(id >> 8), (uint8_t)(id >> 16), (uint8_t)(id >> 24) };
+    return vr_shard_hash(bytes, sizeof(bytes)) % connections;
+}
+
+// Publish a device stream's batch; frames are dropped while the broker is unreachable
+static void vr_fleet_flush(vr_fleet_worker_t *worker, vr_fleet_device_t *dev, vr_fleet_stream_t *stream) {
+    if (!stream->batch || stream->batch->count == 0) {
+        return;
+    }
+    if (vr_publisher_send_batch(dev->publisher, &stream->stream, stream->batch->frames,
+                                stream->batch->count) != 0) {
+        __atomic_fetch_add(&worker->frames_dropped, stream->batch->count, __ATOMIC_RELAXED);
+    }
+    vr_batch_reset(stream->batch);
+}
+
+// Telemetry task: queue every device's latest sample on one stream and publish the batches that are due
+static void vr_fleet_telemetry_task(void *arg) {
+    const vr_fleet_task_t *task = arg;
+    vr_fleet_worker_t *worker = task->worker;
+    if (g_fleet_connection_count == 0) {
+        __atomic_fetch_add(&worker->frames_sampled, worker->count, __ATOMIC_RELAXED);
+        return;
+    }
+
+    for (uint32_t s = worker->index; s < g_fleet_connection_count; s += g_fleet_worker_count) {
+        vr_publisher_service(g_fleet_publishers[s]);
+    }
+
+    uint64_t now = vr_clock_monotonic_us();
+    for (uint32_t i = 0; i < worker->count; i++) {
+        vr_fleet_device_t *dev = &worker->devices[i];
+        vr_fleet_stream_t *stream = &dev->streams[task->kind];
+        if (vr_batch_add(stream->batch, &dev->device.packet, now) || vr_batch_is_due(stream->batch, now)) {
+            vr_fleet_flush(worker, dev, stream);
+        }
+    }
+    __atomic_fetch_add(&worker->frames_sampled, worker->count, __ATOMIC_RELAXED);
+
+    for (uint32_t s = worker->index; s < g_fleet_connection_count; s += g_fleet_worker_count) {
+        vr_publisher_poll_confirms(g_fleet_publishers[s]);
+    }
+}
+
+// Worker thread: connect its shards, then run the slice's sensor and telemetry tasks until stopped
+static void *vr_fleet_worker_thread(void *arg) {
+    vr_fleet_worker_t *worker = arg;
+
+    for (uint32_t s = worker->index; s < g_fleet_connection_count; s += g_fleet_worker_count) {
+        vr_publisher_open(g_fleet_publishers[s]);  // Retried by the telemetry task on failure
+    }
+
+    vr_scheduler_start(&worker->scheduler);
+    while (g_fleet_running) {
+        if (worker->scheduler.count == 0) {
+            vr_delay_ms(10);
+            continue;
+        }
+        vr_scheduler_run_once(&worker->scheduler);
+    }
+    vr_scheduler_close(&worker->scheduler);
+
+    // Publish partially filled batches before disconnecting
+    if (g_fleet_connection_count > 0) {
+        for (uint32_t i = 0; i < worker->count; i++) {
+            vr_fleet_device_t *dev = &worker->devices[i];
+            for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+                vr_fleet_flush(worker, dev, &dev->streams[kind]);
+            }
+        }
+    }
+    for (uint32_t s = worker->index; s < g_fleet_connection_count; s += g_fleet_worker_count) {
+        vr_publisher_close(g_fleet_publishers[s]);
+    }
+    return NULL;
+}
+
+// Add up counters of the running fleet (caller holds g_fleet_lock)
+static void vr_fleet_collect_stats(vr_fleet_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->devices = g_fleet_device_count;
+    stats->workers = g_fleet_worker_count;
+    stats->connections = g_fleet_connection_count;
+
+    for (uint32_t w = 0; w < g_fleet_worker_count; w++) {
+        vr_fleet_worker_t *worker = &g_fleet_workers[w];
+        stats->frames_sampled += __atomic_load_n(&worker->frames_sampled, __ATOMIC_RELAXED);
+        stats->frames_dropped += __atomic_load_n(&worker->frames_dropped, __ATOMIC_RELAXED);
+    }
+
+    for (uint32_t s = 0; s < g_fleet_connection_count; s++) {
+        vr_publisher_stats_t pub;
+        vr_publisher_get_stats(g_fleet_publishers[s], &pub);
+        stats->shards[s] = pub;
+        stats->publisher.messages_published += pub.messages_published;
+        stats->publisher.frames_published += pub.frames_published;
+        stats->publisher.publish_failures += pub.publish_failures;
+        stats->publisher.confirms_acked += pub.confirms_acked;
+        stats->publisher.confirms_nacked += pub.confirms_nacked;
+        stats->publisher.frames_nacked += pub.frames_nacked;
+        stats->publisher.frames_unconfirmed_lost += pub.frames_unconfirmed_lost;
+        stats->publisher.connection_losses += pub.connection_losses;
+        stats->publisher.reconnects += pub.reconnects;
+        stats->publisher.confirms_in_flight += pub.confirms_in_flight;
+        stats->publisher.confirm_window += pub.confirm_window;
+    }
+}
+
+// Zeroed array on a cache line boundary (packets are cache-line aligned; free() releases it)
+static void *vr_fleet_alloc(size_t count, size_t size) {
+    void *block = NULL;
+    if (count == 0 || size > SIZE_MAX / count ||
+        posix_memalign(&block, VR_CACHE_LINE_SIZE, count * size) != 0) {
+        return NULL;
+    }
+    memset(block, 0, count * size);
+    return block;
+}
+
+// Free fleet allocations (caller holds g_fleet_lock; workers must be stopped)
+static void vr_fleet_release(void) {
+    for (uint32_t s = 0; s < g_fleet_connection_count; s++) {
+        vr_publisher_destroy(g_fleet_publishers[s]);
+        g_fleet_publishers[s] = NULL;
+    }
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        free(g_fleet_batches[kind]);
+        g_fleet_batches[kind] = NULL;
+    }
+    free(g_fleet_workers);
+    free(g_fleet_device_ptrs);
+    free(g_fleet_devices);
+    g_fleet_workers = NULL;
+    g_fleet_device_ptrs = NULL;
+    g_fleet_devices = NULL;
+    g_fleet_worker_count = 0;
+    g_fleet_device_count = 0;
+    g_fleet_connection_count = 0;
+}
+
+// Join the started workers (caller holds g_fleet_lock)
+static void vr_fleet_join(void) {
+    g_fleet_running = false;
+    for (uint32_t w = 0; w < g_fleet_worker_count; w++) {
+        if (g_fleet_workers[w].started) {
+            pthread_join(g_fleet_workers[w].thread, NULL);
+            g_fleet_workers[w].started = false;
+        }
+    }
+}
+
+// Simulate `devices` headsets on `workers` threads (0 = one per online CPU)
+// publishing over `connections` broker connections (0 = one per worker).
+// Devices publish each stream on its default routing key with their id inserted.
+int vr_fleet_start(const vr_embedded_config_t *config, uint32_t devices, uint32_t workers,
+                   uint32_t connections) {
+    if (!config || devices == 0 || devices > VR_DEVICE_MAX || connections > VR_SHARD_MAX) {
+        return -1;
+    }
+
+    if (workers == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    if (workers > devices) workers = devices;
+    if (connections == 0) connections = workers < VR_SHARD_MAX ? workers : VR_SHARD_MAX;
+    if (connections > devices) connections = devices;
+    if (workers > connections) workers = connections;  // A worker without a shard has no devices
+
+    pthread_mutex_lock(&g_fleet_lock);
+    if (g_fleet_workers) {
+        pthread_mutex_unlock(&g_fleet_lock);
+        return -1;  // Already running
+    }
+
+    g_fleet_devices = vr_fleet_alloc(devices, sizeof(*g_fleet_devices));
+    g_fleet_device_ptrs = calloc(devices, sizeof(*g_fleet_device_ptrs));
+    g_fleet_workers = calloc(workers, sizeof(*g_fleet_workers));
+    if (!g_fleet_devices || !g_fleet_device_ptrs || !g_fleet_workers) {
+        vr_fleet_release();
+        pthread_mutex_unlock(&g_fleet_lock);
+        return -1;
+    }
+    g_fleet_device_count = devices;
+    g_fleet_worker_count = workers;
+
+    bool publish = vr_rabbitmq_has_parameters();
+    if (publish) {
+        for (uint32_t s = 0; s < connections; s++) {
+            g_fleet_connection_count = s + 1;
+            g_fleet_publishers[s] = vr_publisher_create();
+            if (!g_fleet_publishers[s]) {
+                vr_fleet_release();
+                pthread_mutex_unlock(&g_fleet_lock);
+                return -1;
+            }
+        }
+    }
+
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        if (vr_telemetry_stream_rate(config, (vr_stream_kind_t)kind) == 0) continue;
+        g_fleet_batches[kind] = vr_fleet_alloc(devices, sizeof(vr_batch_t));
+        if (!g_fleet_batches[kind]) {
+            vr_fleet_release();
+            pthread_mutex_unlock(&g_fleet_lock);
+            return -1;
+        }
+    }
+
+    // Order the devices by owning worker so each worker gets a contiguous
+    // slice: count per worker, turn counts into slice offsets, then place
+    uint32_t offsets[VR_SHARD_MAX + 1] = { 0 };
+    for (uint32_t id = 0; id < devices; id++) {
+        offsets[vr_fleet_device_shard(id, connections) % workers + 1]++;
+    }
+    for (uint32_t w = 0; w < workers; w++) {
+        offsets[w + 1] += offsets[w];
+        g_fleet_workers[w].devices = &g_fleet_devices[offsets[w]];
+        g_fleet_workers[w].device_ptrs = &g_fleet_device_ptrs[offsets[w]];
+    }
+
+    for (uint32_t id = 0; id < devices; id++) {
+        uint32_t shard = vr_fleet_device_shard(id, connections);
+        vr_fleet_worker_t *worker = &g_fleet_workers[shard % workers];
+        uint32_t i = (uint32_t)(worker->devices - g_fleet_devices) + worker->count++;
+        vr_fleet_device_t *dev = &g_fleet_devices[i];
+        vr_device_init(&dev->device, id, config->sensor_update_hz);
+        dev->publisher = publish ? g_fleet_publishers[shard] : NULL;
+        g_fleet_device_ptrs[i] = &dev->device;
+
+        for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+            vr_fleet_stream_t *stream = &dev->streams[kind];
+            char routing_key[VR_ROUTING_KEY_MAX];
+            if (vr_device_format_routing_key(vr_rabbitmq_get_stream_routing_key((vr_stream_kind_t)kind), id,
+                                             routing_key, sizeof(routing_key)) != 0) {
+                vr_fleet_release();
+                pthread_mutex_unlock(&g_fleet_lock);
+                return -1;
+            }
+            vr_rabbitmq_stream_init(&stream->stream, routing_key, vr_stream_kind_sections((vr_stream_kind_t)kind));
+            if (g_fleet_batches[kind]) {
+                stream->batch = &g_fleet_batches[kind][i];
+                vr_batch_init(stream->batch, config->telemetry_batch_size, config->telemetry_batch_window_us);
+            }
+        }
+    }
+
+    g_fleet_running = true;
+    for (uint32_t w = 0; w < workers; w++) {
+        vr_fleet_worker_t *worker = &g_fleet_workers[w];
+        worker->index = w;
+
+        // Sensors before telemetry when both are due, as in the main loop
+        vr_scheduler_init(&worker->scheduler);
+        vr_scheduler_set_idle(&worker->scheduler, vr_power_idle_mode(config));
+        if (config->sensor_update_hz > 0) {
+            vr_scheduler_add_rate(&worker->scheduler, "sensors", vr_fleet_sensors_task, worker,
+                                  config->sensor_update_hz);
+        }
+        for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+            if (!g_fleet_batches[kind]) continue;
+            worker->tasks[kind].worker = worker;
+            worker->tasks[kind].kind = (vr_stream_kind_t)kind;
+            vr_scheduler_add_rate(&worker->scheduler,
+                                  kind == VR_STREAM_FRAME ? "telemetry" : vr_stream_kind_name((vr_stream_kind_t)kind),
+                                  vr_fleet_telemetry_task, &worker->tasks[kind],
+                                  vr_telemetry_stream_rate(config, (vr_stream_kind_t)kind));
+        }
+
+        if (pthread_create(&worker->thread, NULL, vr_fleet_worker_thread, worker) != 0) {
+            vr_scheduler_close(&worker->scheduler);
+            vr_fleet_join();
+            vr_fleet_release();
+            pthread_mutex_unlock(&g_fleet_lock);
+            return -1;
+        }
+        worker->started = true;
+    }
+
+    printf("[FLEET] Simulating %u devices on %u workers and %u connections (%s synthesis)\n",
+           devices, workers, g_fleet_connection_count, vr_synth_get_isa());
+    pthread_mutex_unlock(&g_fleet_lock);
+    return 0;
+}
+
+// Stop the workers, publish what they have batched and release the fleet
+void vr_fleet_stop(void) {
+    pthread_mutex_lock(&g_fleet_lock);
+    if (!g_fleet_workers) {
+        pthread_mutex_unlock(&g_fleet_lock);
+        return;
+    }
+
+    vr_fleet_join();
+    vr_fleet_collect_stats(&g_fleet_final_stats);
+    double wakeups_per_s = 0.0;
+    for (uint32_t w = 0; w < g_fleet_worker_count; w++) {
+        vr_scheduler_idle_stats_t idle;
+        vr_scheduler_get_idle_stats(&g_fleet_workers[w].scheduler, &idle);
+        wakeups_per_s += idle.wakeups_per_s;
+    }
+    vr_idle_mode_t idle_mode = g_fleet_workers[0].scheduler.idle;
+    vr_fleet_release();
+    pthread_mutex_unlock(&g_fleet_lock);
+
+    const vr_fleet_stats_t *stats = &g_fleet_final_stats;
+    printf("[FLEET] Stopped %u devices - sampled: %lu, published: %lu frames in %lu messages, dropped: %lu\n",
+           stats->devices, stats->frames_sampled, stats->publisher.frames_published,
+           stats->publisher.messages_published, stats->frames_dropped);
+    printf("[FLEET] Connection losses: %lu, reconnects: %lu, nacked frames: %lu, unconfirmed frames lost: %lu\n",
+           stats->publisher.connection_losses, stats->publisher.reconnects,
+           stats->publisher.frames_nacked, stats->publisher.frames_unconfirmed_lost);
+    printf("[FLEET] Worker wake-ups: %.0f/s (%s idle)\n", wakeups_per_s, vr_idle_mode_name(idle_mode));
+    for (uint32_t s = 0; stats->connections > 1 && s < stats->connections; s++) {
+        printf("[FLEET] Connection %u: %lu frames in %lu messages, connection losses: %lu\n",
+               s, stats->shards[s].frames_published, stats->shards[s].messages_published,
+               stats->shards[s].connection_losses);
+    }
+}
+
+// Get counters of the running fleet, or the totals of the last one stopped
+void vr_fleet_get_stats(vr_fleet_stats_t *stats) {
+    if (!stats) return;
+
+    pthread_mutex_lock(&g_fleet_lock);
+    if (g_fleet_workers) {
+        vr_fleet_collect_stats(stats);
+    } else {
+        *stats = g_fleet_final_stats;
+    }
+    pthread_mutex_unlock(&g_fleet_lock);
+}
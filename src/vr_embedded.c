@@ -2,12 +2,16 @@
 #define _GNU_SOURCE
 #include "vr_telemetry.h"
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/time.h>
+#include <time.h>
 #include <signal.h>
 #include <pthread.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -25,19 +29,62 @@
 // Embedded System State
 static vr_embedded_config_t g_embedded_config;
 static vr_embedded_status_t g_embedded_status;
-static vr_telemetry_packet_t g_telemetry_packet;
-static bool g_system_running = true;
-static pthread_mutex_t g_system_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vr_device_t g_device;              // The headset this firmware runs on
+static vr_packet_snapshot_t g_sensor_snapshot;  // Latest sample, for readers on other threads
+static volatile bool g_system_running = true;
+
+// Status seqlock: odd while the sampling thread is updating several status
+// fields at once. Individual fields are also accessed atomically, so other
+// threads may bump counters such as error_count without taking part in it.
+static uint32_t g_status_seq = 0;
 
 // System Timing
-static uint32_t g_system_tick = 0;
-static uint32_t g_last_sensor_update = 0;
-static uint32_t g_last_telemetry_send = 0;
-static uint32_t g_last_watchdog_feed = 0;
+static uint64_t g_boot_ns = 0;            // CLOCK_MONOTONIC at boot; uptime is derived from it
+static vr_scheduler_t g_scheduler;
+#define VR_STATUS_REPORT_MS 1000           // Period of the main loop's status line
+
+// Telemetry Publisher
+// One pipeline per stream kind: sampling task -> filter -> ring -> publisher thread -> batch.
+// Each publisher shard has its own thread, which drains only its own streams.
+typedef struct {
+    vr_stream_kind_t kind;
+    uint32_t shard;                // Publisher shard and thread of this stream
+    bool enabled;                  // Rings allocated; the frame stream always is
+    int task_id;                   // Scheduler task (-1 when not scheduled)
+    vr_filter_t filter;            // Sees every sensor sample (sampling thread)
+    vr_packet_ring_t ring;
+    vr_packet_ring_t spill;
+    vr_batch_t batch;
+    bool retry_pending;            // Batch failed on a dropped connection (atomic outside the publisher)
+} vr_telemetry_pipeline_t;
+
+static vr_telemetry_pipeline_t g_pipelines[VR_STREAM_KIND_COUNT] = {
+    [VR_STREAM_FRAME]  = { .kind = VR_STREAM_FRAME,  .task_id = -1 },
+    [VR_STREAM_POSE]   = { .kind = VR_STREAM_POSE,   .task_id = -1 },
+    [VR_STREAM_EYES]   = { .kind = VR_STREAM_EYES,   .task_id = -1 },
+    [VR_STREAM_STATUS] = { .kind = VR_STREAM_STATUS, .task_id = -1 },
+};
+static pthread_t g_publisher_threads[VR_SHARD_MAX];
+static uint32_t g_publisher_thread_count = 0;
+static bool g_publisher_started = false;
+static volatile bool g_publisher_running = false;
+static int g_publisher_wake_fds[VR_SHARD_MAX];     // eventfd doorbells rung by the sampling thread (-1 = poll)
+static int g_publisher_waiting[VR_SHARD_MAX];      // Publisher is blocked on its doorbell
+static vr_telemetry_stats_t g_telemetry_stats;
+static vr_capture_t *g_capture = NULL;     // Recording of every sample sent (sampling thread)
+
+// Sensor History (sampling thread)
+static vr_sensor_history_t g_sensor_history;
 
-// Sensor Data Buffers
-static float g_sensor_buffer[32];  // Circular buffer for sensor data
-static uint8_t g_sensor_buffer_index = 0;
+// Sensor Bring-up: the self-test runs in the background while sampling starts
+static vr_calibration_t g_calibration;
+static pthread_t g_self_test_thread;
+static bool g_self_test_started = false;
+
+// Adaptive Rate Control (main loop)
+static vr_ratectl_t g_ratectl;
+static vr_histogram_t g_ratectl_publish;  // Publish histogram at the previous interval
+static uint64_t g_ratectl_ring_dropped;    // Frame ring drops at the previous interval
 
 // Power Management
 static float g_system_voltage = 3.3f;
@@ -52,9 +99,28 @@ static bool g_power_save_active = false;
 #define VR_ERROR_SENSOR_CALIBRATION    0x05
 #define VR_ERROR_MEMORY_ALLOC          0x06
 
-// Initialize embedded system
-void vr_embedded_init(vr_embedded_config_t *config, bool use_rabbitmq) {
-    pthread_mutex_lock(&g_system_mutex);
+// Begin a multi-field status update (sampling thread only)
+static void vr_status_write_begin(void) {
+    uint32_t seq = __atomic_load_n(&g_status_seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_status_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Publish a multi-field status update
+static void vr_status_write_end(void) {
+    uint32_t seq = __atomic_load_n(&g_status_seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_status_seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+// Initialize embedded system; returns -1 when telemetry could not be set up
+int vr_embedded_init(vr_embedded_config_t *config, bool use_rabbitmq) {
+    // A reset waits for the previous self-test before clearing its result
+    vr_sensors_wait_ready();
+    
+    if (g_boot_ns == 0) {
+        g_boot_ns = vr_get_monotonic_ns();
+        vr_clock_init();
+    }
     
     if (config) {
         memcpy(&g_embedded_config, config, sizeof(vr_embedded_config_t));
@@ -63,23 +129,40 @@ void vr_embedded_init(vr_embedded_config_t *config, bool use_rabbitmq) {
         g_embedded_config.system_clock_hz = 168000000;  // 168 MHz ARM Cortex-M4
         g_embedded_config.sensor_update_hz = 1000;      // 1 kHz sensor updates
         g_embedded_config.telemetry_rate_hz = 60;      // 60 Hz telemetry
+        g_embedded_config.telemetry_batch_size = 1;     // One frame per message
+        g_embedded_config.telemetry_batch_window_us = 10000;
+        g_embedded_config.telemetry_ring_depth = 1024;
+        g_embedded_config.telemetry_ring_policy = VR_RING_DROP_OLDEST;
+        g_embedded_config.telemetry_spill_depth = 8192;
+        g_embedded_config.telemetry_spill_max_age_ms = 5000;
+        g_embedded_config.history_depth = 0;           // Sensor history off
         g_embedded_config.watchdog_enabled = true;
         g_embedded_config.watchdog_timeout_ms = 5000;   // 5 second timeout
         g_embedded_config.power_save_enabled = true;
-        g_embedded_config.cpu_sleep_level = 1;
+        g_embedded_config.cpu_sleep_level = VR_IDLE_SLEEP;
+        g_embedded_config.metrics_interval_ms = 0;
     }
     
-    // Initialize system status
-    memset(&g_embedded_status, 0, sizeof(vr_embedded_status_t));
-    g_embedded_status.state = VR_SYSTEM_INIT;
-    g_embedded_status.uptime_ms = 0;
-    g_embedded_status.error_count = 0;
-    g_embedded_status.reset_count = 0;
-    g_embedded_status.sensors_initialized = false;
-    g_embedded_status.communication_ready = false;
+    // Initialize system status (reset_count survives vr_system_reset)
+    vr_status_write_begin();
+    __atomic_store_n(&g_embedded_status.state, VR_SYSTEM_INIT, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_embedded_status.uptime_ms, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_embedded_status.last_watchdog_reset, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_embedded_status.error_count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_embedded_status.sensors_initialized, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_embedded_status.communication_ready, false, __ATOMIC_RELAXED);
+    vr_status_write_end();
     
-    // Initialize sensors
-    vr_sensors_init();
+    // Bring-up runs concurrently: the publisher threads connect to the broker
+    // (frames wait in the spill buffer until they have), the sensor self-test
+    // runs in the background, and calibration is read from its cache or
+    // measured on this thread meanwhile
+    if (use_rabbitmq) {
+        vr_rabbitmq_connect_async();
+    }
+    
+    // Initialize telemetry system (starts the publisher threads)
+    int result = vr_telemetry_init();
     
     // Initialize power management
     vr_power_init();
@@ -89,75 +172,250 @@ void vr_embedded_init(vr_embedded_config_t *config, bool use_rabbitmq) {
         vr_watchdog_init(g_embedded_config.watchdog_timeout_ms);
     }
     
-    // Initialize telemetry system (without connecting to RabbitMQ)
-    printf("[TELEMETRY] Telemetry system initialized\n");
-    g_embedded_status.communication_ready = true;
+    // Initialize sensors (sensors_initialized is set once the self-test passes)
+    vr_sensors_init();
     
     // Set system state to ready
-    g_embedded_status.state = VR_SYSTEM_READY;
-    g_embedded_status.sensors_initialized = true;
-    g_embedded_status.communication_ready = true;
-    
-    pthread_mutex_unlock(&g_system_mutex);
+    vr_status_write_begin();
+    __atomic_store_n(&g_embedded_status.state, VR_SYSTEM_READY, __ATOMIC_RELAXED);
+    vr_status_write_end();
     
     printf("[EMBEDDED] System initialized - Clock: %u Hz, Sensors: %u Hz, Telemetry: %u Hz\n",
            g_embedded_config.system_clock_hz,
            g_embedded_config.sensor_update_hz,
            g_embedded_config.telemetry_rate_hz);
+    return result;
+}
+
+// Tick task: keep uptime and the wall-clock offset current. Runs at the
+// clock's refresh rate; nothing it does needs a faster beat.
+static void vr_tick_task(void *arg) {
+    (void)arg;
+    vr_embedded_system_tick();
+    vr_clock_refresh();
+}
+
+// Sensor task: sample sensors and record how long it took
+static void vr_sensors_task(void *arg) {
+    (void)arg;
+    uint64_t start = vr_get_monotonic_ns();
+    vr_sensors_update();
+    vr_metrics_record(VR_METRIC_SENSOR_UPDATE, vr_get_monotonic_ns() - start);
+}
+
+// Telemetry task: hand the stream's filtered frame to its publisher
+static void vr_telemetry_task(void *arg) {
+    vr_telemetry_pipeline_t *pipe = arg;
+    if (!pipe->filter.primed) {
+        // No sample yet (or sensors not sampled): send the device's initial state
+        vr_telemetry_send_stream(pipe->kind, &g_device.packet);
+        return;
+    }
+    
+    vr_telemetry_packet_t packet;
+    vr_filter_output(&pipe->filter, &packet);
+    vr_telemetry_send_stream(pipe->kind, &packet);
+}
+
+// Watchdog task: feed the watchdog
+static void vr_watchdog_task(void *arg) {
+    (void)arg;
+    vr_watchdog_feed();
+}
+
+// Report task: print system state, telemetry queue levels and windowed sensor statistics
+static void vr_report_task(void *arg) {
+    (void)arg;
+    vr_embedded_status_t status;
+    vr_embedded_get_status(&status);
+    vr_telemetry_stats_t telemetry_stats;
+    vr_telemetry_get_stats(&telemetry_stats);
+    VR_LOG(VR_LOG_INFO, "[EMBEDDED] Status: State=%d, Errors=%u, Uptime=%u ms, Ring=%u/%u, Dropped=%lu, Spilled=%u\n",
+           status.state, status.error_count, status.uptime_ms,
+           telemetry_stats.ring.occupancy, telemetry_stats.ring.capacity,
+           telemetry_stats.ring.dropped, telemetry_stats.spill.occupancy);
+    
+    // Windowed sensor statistics; the report runs on the sampling thread, which owns the history
+    if (!g_sensor_history.channels[0].samples || g_sensor_history.channels[0].count == 0) {
+        return;
+    }
+    vr_history_stats_t position[3], gaze_x, gaze_y, left_pupil, right_pupil;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        vr_history_get_stats(&g_sensor_history, VR_HISTORY_POSE, axis, &position[axis]);
+    }
+    vr_history_get_stats(&g_sensor_history, VR_HISTORY_EYES, 0, &gaze_x);
+    vr_history_get_stats(&g_sensor_history, VR_HISTORY_EYES, 1, &gaze_y);
+    vr_history_get_stats(&g_sensor_history, VR_HISTORY_EYES, 2, &left_pupil);
+    vr_history_get_stats(&g_sensor_history, VR_HISTORY_EYES, 5, &right_pupil);
+    VR_LOG(VR_LOG_INFO, "[HISTORY] Last %u samples - head position sd %.2f/%.2f/%.2f mm, "
+           "left gaze x %.3f..%.3f y %.3f..%.3f, pupils %.2f / %.2f mm\n",
+           position[0].count,
+           sqrtf(position[0].variance) * 1000.0f, sqrtf(position[1].variance) * 1000.0f,
+           sqrtf(position[2].variance) * 1000.0f,
+           gaze_x.min, gaze_x.max, gaze_y.min, gaze_y.max, left_pupil.mean, right_pupil.mean);
+}
+
+// Reschedule one stream and record its new rate (main loop)
+static int vr_telemetry_apply_rate(vr_stream_kind_t kind, uint32_t rate_hz) {
+    if ((unsigned)kind >= VR_STREAM_KIND_COUNT || g_pipelines[kind].task_id < 0 ||
+        vr_scheduler_set_rate(&g_scheduler, g_pipelines[kind].task_id, rate_hz) != 0) {
+        return -1;
+    }
+    
+    switch (kind) {
+        case VR_STREAM_POSE:   g_embedded_config.pose_rate_hz = rate_hz; break;
+        case VR_STREAM_EYES:   g_embedded_config.eyes_rate_hz = rate_hz; break;
+        case VR_STREAM_STATUS: g_embedded_config.status_rate_hz = rate_hz; break;
+        default:               g_embedded_config.telemetry_rate_hz = rate_hz; break;
+    }
+    vr_filter_set_rate(&g_pipelines[kind].filter, rate_hz);
+    return 0;
+}
+
+// Rate control task: measure the last interval and apply the controller's frame rate
+static void vr_ratectl_task(void *arg) {
+    (void)arg;
+    vr_telemetry_pipeline_t *pipe = &g_pipelines[VR_STREAM_FRAME];
+    vr_ratectl_signals_t signals = { 0 };
+    vr_histogram_t publish;
+    vr_ring_stats_t ring;
+    vr_publisher_stats_t publisher;
+    
+    vr_metrics_get_histogram(VR_METRIC_PUBLISH, &publish);
+    vr_ring_get_stats(&pipe->ring, &ring);
+    vr_rabbitmq_get_stats(&publisher);
+    
+    signals.connected = vr_rabbitmq_shard_is_connected(pipe->shard) &&
+                        !__atomic_load_n(&pipe->retry_pending, __ATOMIC_RELAXED);
+    signals.ring_fill = ring.capacity > 0 ? (float)ring.occupancy / ring.capacity : 0.0f;
+    signals.ring_drops = ring.dropped - g_ratectl_ring_dropped;
+    signals.confirm_fill = publisher.confirm_window > 0 ?
+                           (float)publisher.confirms_in_flight / publisher.confirm_window : 0.0f;
+    vr_histogram_t interval = publish;
+    vr_histogram_subtract(&interval, &g_ratectl_publish);
+    signals.publishes = interval.count;
+    signals.publish_p99_ns = vr_histogram_percentile(&interval, 99.0);
+    g_ratectl_publish = publish;
+    g_ratectl_ring_dropped = ring.dropped;
+    
+    uint32_t rate_hz = g_embedded_config.telemetry_rate_hz;
+    uint32_t next_hz = vr_ratectl_update(&g_ratectl, rate_hz, &signals);
+    if (next_hz != rate_hz && vr_telemetry_apply_rate(VR_STREAM_FRAME, next_hz) == 0) {
+        VR_LOG(VR_LOG_INFO, "[RATE] Frame rate %u -> %u Hz, %s (publish p99 %.1f ms, ring %.0f%%, confirms %.0f%%)\n",
+               rate_hz, next_hz,
+               next_hz < rate_hz ? vr_ratectl_cause_name(g_ratectl.stats.last_cause) : "probing",
+               signals.publish_p99_ns / 1e6, signals.ring_fill * 100.0f, signals.confirm_fill * 100.0f);
+    }
+}
+
+// Print per-task timing statistics
+static void vr_embedded_print_schedule_stats(void) {
+    for (uint32_t i = 0; i < g_scheduler.count; i++) {
+        vr_task_stats_t stats;
+        vr_scheduler_get_stats(&g_scheduler, (int)i, &stats);
+        printf("[SCHED] %-10s period %.1f us, runs %lu, overruns %lu, jitter mean %.1f us max %.1f us, runtime max %.1f us\n",
+               stats.name, stats.period_us, stats.runs, stats.overruns,
+               stats.jitter_mean_us, stats.jitter_max_us, stats.runtime_max_us);
+    }
+    
+    // Wake-ups are what idle CPUs pay for: each one ends a low-power state
+    vr_scheduler_idle_stats_t idle;
+    vr_scheduler_get_idle_stats(&g_scheduler, &idle);
+    vr_telemetry_stats_t telemetry;
+    vr_telemetry_get_stats(&telemetry);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double elapsed_s = (double)(vr_get_monotonic_ns() - g_boot_ns) / 1e9;
+    double cpu_s = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                   (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    printf("[POWER] Wake-ups/s - main loop (%s): %.0f, publishers: %.0f, process: %.0f; CPU %.1f%%\n",
+           vr_idle_mode_name(idle.idle), idle.wakeups_per_s,
+           idle.elapsed_s > 0 ? telemetry.publisher_wakeups / idle.elapsed_s : 0.0,
+           elapsed_s > 0 ? (usage.ru_nvcsw + usage.ru_nivcsw) / elapsed_s : 0.0,
+           elapsed_s > 0 ? cpu_s / elapsed_s * 100.0 : 0.0);
 }
 
 // Main embedded system loop
 void vr_embedded_main_loop(void) {
     printf("[EMBEDDED] Starting main loop...\n");
     
-    while (g_system_running) {
-        // System tick update
-        vr_embedded_system_tick();
-        
-        // Update sensors at configured rate
-        uint32_t sensor_interval = 1000 / g_embedded_config.sensor_update_hz;
-        if (g_system_tick - g_last_sensor_update >= sensor_interval) {
-            vr_sensors_update();
-            g_last_sensor_update = g_system_tick;
-        }
-        
-        // Send telemetry at configured rate
-        uint32_t telemetry_interval = 1000 / g_embedded_config.telemetry_rate_hz;
-        if (g_system_tick - g_last_telemetry_send >= telemetry_interval) {
-            vr_telemetry_send_packet(&g_telemetry_packet);
-            g_last_telemetry_send = g_system_tick;
+    // Tasks run in registration order when due together, so fresh sensor
+    // data is sampled before telemetry picks it up. With a fleet running,
+    // the workers sample and publish the devices and this loop only keeps
+    // the system tick, watchdog and reports.
+    bool local_device = g_embedded_config.device_count <= 1;
+    vr_scheduler_init(&g_scheduler);
+    vr_scheduler_add_period(&g_scheduler, "tick", vr_tick_task, NULL, (uint64_t)VR_CLOCK_REFRESH_MS * 1000);
+    if (local_device && g_embedded_config.sensor_update_hz > 0) {
+        vr_scheduler_add_rate(&g_scheduler, "sensors", vr_sensors_task, NULL,
+                              g_embedded_config.sensor_update_hz);
+    }
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        vr_telemetry_pipeline_t *pipe = &g_pipelines[kind];
+        uint32_t rate_hz = vr_telemetry_stream_rate(&g_embedded_config, (vr_stream_kind_t)kind);
+        pipe->task_id = -1;
+        if (local_device && pipe->enabled && rate_hz > 0) {
+            pipe->task_id = vr_scheduler_add_rate(&g_scheduler,
+                                                  kind == VR_STREAM_FRAME ? "telemetry" : vr_stream_kind_name(pipe->kind),
+                                                  vr_telemetry_task, pipe, rate_hz);
+            vr_filter_init(&pipe->filter, &g_embedded_config.telemetry_filter,
+                           g_embedded_config.sensor_update_hz, rate_hz);
         }
-        
-        // Feed watchdog
-        if (g_embedded_config.watchdog_enabled) {
-            uint32_t watchdog_interval = g_embedded_config.watchdog_timeout_ms / 2;
-            if (g_system_tick - g_last_watchdog_feed >= watchdog_interval) {
-                vr_watchdog_feed();
-                g_last_watchdog_feed = g_system_tick;
-            }
+    }
+    // Rate control measures from now on, so earlier publishes do not count
+    vr_telemetry_pipeline_t *frames = &g_pipelines[VR_STREAM_FRAME];
+    vr_ratectl_init(&g_ratectl, &g_embedded_config.telemetry_rate_control, g_embedded_config.telemetry_rate_hz);
+    if (g_ratectl.config.enabled && frames->task_id >= 0) {
+        vr_ring_stats_t ring;
+        vr_metrics_get_histogram(VR_METRIC_PUBLISH, &g_ratectl_publish);
+        vr_ring_get_stats(&frames->ring, &ring);
+        g_ratectl_ring_dropped = ring.dropped;
+        vr_scheduler_add_period(&g_scheduler, "ratectl", vr_ratectl_task, NULL,
+                                (uint64_t)g_ratectl.config.interval_ms * 1000);
+    } else {
+        g_ratectl.stats.enabled = false;
+    }
+    if (g_embedded_config.watchdog_enabled && g_embedded_config.watchdog_timeout_ms >= 2) {
+        vr_scheduler_add_period(&g_scheduler, "watchdog", vr_watchdog_task, NULL,
+                                (uint64_t)g_embedded_config.watchdog_timeout_ms / 2 * 1000);
+    }
+    vr_scheduler_add_period(&g_scheduler, "report", vr_report_task, NULL,
+                            (uint64_t)VR_STATUS_REPORT_MS * 1000);
+    vr_scheduler_set_idle(&g_scheduler, vr_power_idle_mode(&g_embedded_config));
+    printf("[EMBEDDED] Idling between deadlines: %s\n", vr_idle_mode_name(g_scheduler.idle));
+    vr_scheduler_start(&g_scheduler);
+    
+    while (g_system_running) {
+        // Sleep until the next deadline, then run whatever is due
+        if (vr_scheduler_run_once(&g_scheduler) > 0) {
+            vr_metrics_record(VR_METRIC_LOOP, g_scheduler.last_busy_ns);
         }
         
-        // Power management
-        if (g_embedded_config.power_save_enabled && g_power_save_active) {
-            vr_power_enter_sleep(g_embedded_config.cpu_sleep_level);
+        // Metrics report requested with SIGUSR1
+        if (vr_metrics_dump_pending()) {
+            vr_metrics_print();
         }
-        
-        // Small delay to prevent 100% CPU usage
-        vr_delay_us(100);
     }
     
     printf("[EMBEDDED] Main loop stopped\n");
+    vr_sensors_wait_ready();
+    vr_embedded_print_schedule_stats();
+    vr_scheduler_close(&g_scheduler);
+}
+
+// Request main loop exit (async-signal-safe)
+void vr_embedded_stop(void) {
+    g_system_running = false;
 }
 
 // System tick handler (called by timer interrupt)
 void vr_embedded_system_tick(void) {
-    pthread_mutex_lock(&g_system_mutex);
-    
-    g_system_tick++;
-    g_embedded_status.uptime_ms = g_system_tick;
+    // Derive uptime from the clock so skipped ticks cannot slow it down
+    __atomic_store_n(&g_embedded_status.uptime_ms, vr_get_system_tick(), __ATOMIC_RELAXED);
     
     // Check for system errors
-    if (g_embedded_status.error_count > 10) {
+    if (__atomic_load_n(&g_embedded_status.error_count, __ATOMIC_RELAXED) > 10 &&
+        vr_embedded_get_state() != VR_SYSTEM_ERROR) {
         vr_embedded_set_state(VR_SYSTEM_ERROR);
         vr_error_handler(VR_ERROR_SENSOR_INIT_FAILED);
     }
@@ -166,113 +424,120 @@ void vr_embedded_system_tick(void) {
     if (g_system_voltage < 3.0f) {
         vr_error_handler(VR_ERROR_POWER_LOW);
     }
-    
-    pthread_mutex_unlock(&g_system_mutex);
 }
 
 // Get current system state
 vr_system_state_t vr_embedded_get_state(void) {
-    pthread_mutex_lock(&g_system_mutex);
-    vr_system_state_t state = g_embedded_status.state;
-    pthread_mutex_unlock(&g_system_mutex);
-    return state;
+    return __atomic_load_n(&g_embedded_status.state, __ATOMIC_ACQUIRE);
+}
+
+// Set system state; logs and returns true only on an actual transition
+bool vr_embedded_set_state(vr_system_state_t state) {
+    vr_system_state_t previous = __atomic_exchange_n(&g_embedded_status.state, state, __ATOMIC_ACQ_REL);
+    if (previous == state) return false;
+    VR_LOG(VR_LOG_INFO, "[EMBEDDED] State changed to: %d\n", state);
+    return true;
+}
+
+// Take a consistent snapshot of the system status without blocking the writer
+void vr_embedded_get_status(vr_embedded_status_t *status) {
+    if (!status) return;
+    
+    uint32_t begin, end;
+    do {
+        begin = __atomic_load_n(&g_status_seq, __ATOMIC_ACQUIRE);
+        status->state = __atomic_load_n(&g_embedded_status.state, __ATOMIC_RELAXED);
+        status->uptime_ms = __atomic_load_n(&g_embedded_status.uptime_ms, __ATOMIC_RELAXED);
+        status->last_watchdog_reset = __atomic_load_n(&g_embedded_status.last_watchdog_reset, __ATOMIC_RELAXED);
+        status->error_count = __atomic_load_n(&g_embedded_status.error_count, __ATOMIC_RELAXED);
+        status->reset_count = __atomic_load_n(&g_embedded_status.reset_count, __ATOMIC_RELAXED);
+        status->sensors_initialized = __atomic_load_n(&g_embedded_status.sensors_initialized, __ATOMIC_RELAXED);
+        status->communication_ready = __atomic_load_n(&g_embedded_status.communication_ready, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&g_status_seq, __ATOMIC_RELAXED);
+    } while ((begin & 1) || begin != end);
 }
 
-// Set system state
-void vr_embedded_set_state(vr_system_state_t state) {
-    pthread_mutex_lock(&g_system_mutex);
-    g_embedded_status.state = state;
-    printf("[EMBEDDED] State changed to: %d\n", state);
-    pthread_mutex_unlock(&g_system_mutex);
+// Background self-test; the sensors count as initialized once it passes
+static void *vr_sensors_self_test_thread(void *arg) {
+    (void)arg;
+    if (!vr_sensors_self_test()) {
+        vr_error_handler(VR_ERROR_SENSOR_INIT_FAILED);
+        return NULL;
+    }
+    __atomic_store_n(&g_embedded_status.sensors_initialized, true, __ATOMIC_RELAXED);
+    return NULL;
 }
 
 // Initialize sensors
 void vr_sensors_init(void) {
     printf("[SENSORS] Initializing sensors...\n");
     
-    // Initialize sensor buffer
-    memset(g_sensor_buffer, 0, sizeof(g_sensor_buffer));
-    g_sensor_buffer_index = 0;
+    // Allocate the sensor history once, if enabled; a system reset only empties it
+    if (!g_sensor_history.channels[0].samples && g_embedded_config.history_depth > 0) {
+        if (vr_history_init(&g_sensor_history, g_embedded_config.history_depth) != 0) {
+            vr_error_handler(VR_ERROR_MEMORY_ALLOC);
+            return;
+        }
+    } else if (g_sensor_history.channels[0].samples) {
+        vr_history_reset(&g_sensor_history);
+    }
     
-    // Initialize telemetry packet
-    memset(&g_telemetry_packet, 0, sizeof(vr_telemetry_packet_t));
-    g_telemetry_packet.head_position.y = 1.7f;  // Average head height
-    g_telemetry_packet.head_orientation.w = 1.0f;
-    g_telemetry_packet.battery_level = 100;
-    g_telemetry_packet.is_connected = true;
+    // Reset the device to rest; frame ids keep counting across a system reset
+    uint32_t frame_counter = g_device.frame_counter;
+    vr_device_init(&g_device, 0, g_embedded_config.sensor_update_hz);
+    g_device.frame_counter = frame_counter;
     
-    // Self-test sensors
-    if (!vr_sensors_self_test()) {
-        vr_error_handler(VR_ERROR_SENSOR_INIT_FAILED);
-        return;
+    // Self-test in the background, calibrate here
+    vr_sensors_wait_ready();
+    if (pthread_create(&g_self_test_thread, NULL, vr_sensors_self_test_thread, NULL) == 0) {
+        g_self_test_started = true;
+    } else {
+        vr_sensors_self_test_thread(NULL);
     }
-    
-    // Calibrate sensors
     vr_sensors_calibrate();
     
-    printf("[SENSORS] Sensors initialized successfully\n");
+    printf("[SENSORS] Sensors initialized, self-test running\n");
+}
+
+// Wait for a background self-test to finish
+void vr_sensors_wait_ready(void) {
+    if (g_self_test_started) {
+        pthread_join(g_self_test_thread, NULL);
+        g_self_test_started = false;
+    }
+}
+
+// Cached or measured calibration of the last vr_sensors_init()
+const vr_calibration_t *vr_sensors_get_calibration(void) {
+    return &g_calibration;
 }
 
 // Update sensor data
 void vr_sensors_update(void) {
-    static float simulation_time = 0.0f;
-    static uint32_t frame_counter = 0;
-    
-    // Update simulation time
-    simulation_time += 0.001f;  // 1ms update rate
-    
-    // Update timestamp and frame ID
-    g_telemetry_packet.timestamp_us = vr_get_timestamp_us();
-    g_telemetry_packet.frame_id = frame_counter++;
-    
-    // Simulate head movement
-    g_telemetry_packet.head_position.x = sin(simulation_time * 0.5f) * 0.1f;
-    g_telemetry_packet.head_position.y = 1.7f + sin(simulation_time * 0.3f) * 0.02f;
-    g_telemetry_packet.head_position.z = cos(simulation_time * 0.4f) * 0.1f;
-    
-    // Simulate head orientation
-    g_telemetry_packet.head_orientation.x = sin(simulation_time * 0.2f) * 0.1f;
-    g_telemetry_packet.head_orientation.y = sin(simulation_time * 0.15f) * 0.2f;
-    g_telemetry_packet.head_orientation.z = sin(simulation_time * 0.1f) * 0.05f;
-    g_telemetry_packet.head_orientation.w = sqrt(1.0f - 
-        (g_telemetry_packet.head_orientation.x * g_telemetry_packet.head_orientation.x +
-         g_telemetry_packet.head_orientation.y * g_telemetry_packet.head_orientation.y +
-         g_telemetry_packet.head_orientation.z * g_telemetry_packet.head_orientation.z));
-    
-    // Simulate eye tracking
-    g_telemetry_packet.left_eye.x = 0.5f + sin(simulation_time * 2.0f) * 0.1f;
-    g_telemetry_packet.left_eye.y = 0.5f + cos(simulation_time * 1.5f) * 0.1f;
-    g_telemetry_packet.left_eye.pupil_diameter = 3.5f + sin(simulation_time * 0.5f) * 0.5f;
-    g_telemetry_packet.left_eye.is_blinking = (fmod(simulation_time, 3.0f) > 2.9f);
-    
-    g_telemetry_packet.right_eye.x = 0.5f + sin(simulation_time * 2.1f) * 0.1f;
-    g_telemetry_packet.right_eye.y = 0.5f + cos(simulation_time * 1.6f) * 0.1f;
-    g_telemetry_packet.right_eye.pupil_diameter = 3.5f + sin(simulation_time * 0.51f) * 0.5f;
-    g_telemetry_packet.right_eye.is_blinking = g_telemetry_packet.left_eye.is_blinking;
-    
-    // Simulate hand tracking
-    g_telemetry_packet.left_hand.x = 0.3f + sin(simulation_time) * 0.2f;
-    g_telemetry_packet.left_hand.y = 1.2f + cos(simulation_time * 0.7f) * 0.3f;
-    g_telemetry_packet.left_hand.z = 0.1f + sin(simulation_time * 1.2f) * 0.15f;
-    g_telemetry_packet.left_hand.grip_strength = 0.5f + sin(simulation_time * 0.4f) * 0.3f;
-    g_telemetry_packet.left_hand.is_tracking = true;
-    
-    g_telemetry_packet.right_hand.x = -0.3f + sin(simulation_time * 1.1f) * 0.2f;
-    g_telemetry_packet.right_hand.y = 1.2f + cos(simulation_time * 0.7f) * 0.3f;
-    g_telemetry_packet.right_hand.z = 0.1f + sin(simulation_time * 1.2f) * 0.15f;
-    g_telemetry_packet.right_hand.grip_strength = 0.5f + sin(simulation_time * 0.4f) * 0.3f;
-    g_telemetry_packet.right_hand.is_tracking = true;
-    
-    // Simulate system metrics
-    g_telemetry_packet.cpu_usage = 45.0f + sin(simulation_time * 0.8f) * 10.0f;
-    g_telemetry_packet.gpu_usage = 60.0f + cos(simulation_time * 0.6f) * 15.0f;
-    g_telemetry_packet.temperature = 35.0f + (g_telemetry_packet.cpu_usage + g_telemetry_packet.gpu_usage) * 0.1f;
-    g_telemetry_packet.battery_level = (uint8_t)(100.0f - simulation_time * 0.1f);
-    g_telemetry_packet.is_connected = (simulation_time < 300.0f || fmod(simulation_time, 60.0f) < 58.0f);
-    
-    // Store in sensor buffer
-    g_sensor_buffer[g_sensor_buffer_index] = g_telemetry_packet.head_position.x;
-    g_sensor_buffer_index = (g_sensor_buffer_index + 1) % 32;
+    vr_device_update(&g_device);
+    vr_snapshot_publish(&g_sensor_snapshot, &g_device.packet);
+    
+    vr_history_record(&g_sensor_history, &g_device.packet);  // No-op when history is off
+    
+    // Every scheduled stream's filter sees every sample
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        if (g_pipelines[kind].task_id >= 0) {
+            vr_filter_update(&g_pipelines[kind].filter, &g_device.packet);
+        }
+    }
+}
+
+// Recent samples and windowed statistics of every sensor channel (sampling thread)
+const vr_sensor_history_t *vr_sensors_get_history(void) {
+    return &g_sensor_history;
+}
+
+// Copy the most recent sensor sample (any thread; never torn)
+void vr_sensors_get_packet(vr_telemetry_packet_t *packet) {
+    if (packet) {
+        vr_snapshot_read(&g_sensor_snapshot, packet);
+    }
 }
 
 // Sensor self-test
@@ -295,60 +560,523 @@ bool vr_sensors_self_test(void) {
     return true;
 }
 
-// Sensor calibration
+// Sensor calibration: reuse the cached offsets if they are still valid
 void vr_sensors_calibrate(void) {
+    const char *cache = g_embedded_config.calibration_cache_path;
+    uint32_t sensor_hz = g_embedded_config.sensor_update_hz;
+    
+    if (cache && vr_calibration_load(&g_calibration, cache, sensor_hz) == 0) {
+        printf("[SENSORS] Calibration loaded from %s\n", cache);
+        return;
+    }
+    
     printf("[SENSORS] Calibrating sensors...\n");
+    if (vr_calibration_measure(&g_calibration, sensor_hz, VR_CALIBRATION_SAMPLES) != 0) {
+        vr_error_handler(VR_ERROR_SENSOR_CALIBRATION);
+        return;
+    }
+    printf("[SENSORS] Calibration complete - head at (%.3f, %.3f, %.3f) m, pupils %.2f / %.2f mm\n",
+           g_calibration.head_position[0], g_calibration.head_position[1], g_calibration.head_position[2],
+           g_calibration.pupil_diameter[0], g_calibration.pupil_diameter[1]);
+    
+    if (cache && vr_calibration_save(&g_calibration, cache) != 0) {
+        printf("[SENSORS] Could not write calibration cache %s\n", cache);
+    }
+}
+
+// Check if a frame is too old to be worth replaying after an outage (now_us is monotonic)
+static bool vr_telemetry_is_expired(const vr_telemetry_packet_t *packet, uint64_t now_us) {
+    uint64_t max_age_us = (uint64_t)g_embedded_config.telemetry_spill_max_age_ms * 1000;
+    return max_age_us > 0 && now_us > packet->monotonic_us &&
+           now_us - packet->monotonic_us > max_age_us;
+}
+
+// Publish all queued frames of one stream (publisher thread)
+static void vr_telemetry_flush_stream(vr_telemetry_pipeline_t *pipe) {
+    if (pipe->batch.count == 0) {
+        return;
+    }
+    
+    if (vr_rabbitmq_send_stream_batch(pipe->kind, pipe->batch.frames, pipe->batch.count) != 0) {
+        if (!vr_rabbitmq_shard_is_connected(pipe->shard)) {
+            // Connection dropped: keep the batch and resend it after reconnect
+            __atomic_store_n(&pipe->retry_pending, true, __ATOMIC_RELAXED);
+            return;
+        }
+        // Connection is fine, the batch itself could not be sent
+        __atomic_fetch_add(&g_telemetry_stats.frames_discarded, pipe->batch.count, __ATOMIC_RELAXED);
+        VR_LOG(VR_LOG_INFO, "[TELEMETRY] Failed to send %s packet, discarded %u frames\n",
+               vr_stream_kind_name(pipe->kind), pipe->batch.count);
+    }
+    
+    vr_batch_reset(&pipe->batch);
+}
+
+// Route one frame: into the current batch while connected, into the spill buffer otherwise
+static void vr_telemetry_route(vr_telemetry_pipeline_t *pipe, const vr_telemetry_packet_t *packet) {
+    if (pipe->retry_pending || !vr_rabbitmq_shard_is_connected(pipe->shard)) {
+        vr_ring_push(&pipe->spill, packet);
+        return;
+    }
+    
+    if (vr_batch_add(&pipe->batch, packet, vr_clock_monotonic_us())) {
+        vr_telemetry_flush_stream(pipe);
+    }
+}
+
+// After a reconnect: resend the batch that failed, then replay spilled frames in order
+static bool vr_telemetry_replay(vr_telemetry_pipeline_t *pipe) {
+    uint64_t now = vr_clock_monotonic_us();
+    bool replayed = false;
+    
+    if (pipe->retry_pending) {
+        // Drop frames from the failed batch that aged out during the outage
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < pipe->batch.count; i++) {
+            if (vr_telemetry_is_expired(&pipe->batch.frames[i], now)) {
+                __atomic_fetch_add(&g_telemetry_stats.frames_expired, 1, __ATOMIC_RELAXED);
+            } else {
+                pipe->batch.frames[kept++] = pipe->batch.frames[i];
+            }
+        }
+        pipe->batch.count = kept;
+        __atomic_store_n(&pipe->retry_pending, false, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&g_telemetry_stats.frames_replayed, kept, __ATOMIC_RELAXED);
+        vr_telemetry_flush_stream(pipe);
+        replayed = true;
+    }
+    
+    vr_telemetry_packet_t packet;
+    while (!pipe->retry_pending && vr_rabbitmq_shard_is_connected(pipe->shard) &&
+           vr_ring_pop(&pipe->spill, &packet)) {
+        replayed = true;
+        if (vr_telemetry_is_expired(&packet, now)) {
+            __atomic_fetch_add(&g_telemetry_stats.frames_expired, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        __atomic_fetch_add(&g_telemetry_stats.frames_replayed, 1, __ATOMIC_RELAXED);
+        if (vr_batch_add(&pipe->batch, &packet, vr_clock_monotonic_us())) {
+            vr_telemetry_flush_stream(pipe);
+        }
+    }
+    
+    return replayed;
+}
+
+// Frames waiting in the spill buffers of one shard's streams
+static uint32_t vr_telemetry_spilled(uint32_t shard) {
+    uint32_t spilled = 0;
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        if (g_pipelines[kind].enabled && g_pipelines[kind].shard == shard) {
+            spilled += vr_ring_occupancy(&g_pipelines[kind].spill);
+        }
+    }
+    return spilled;
+}
+
+// Publish a metrics report when the configured interval has elapsed
+static void vr_telemetry_publish_metrics(uint64_t *next_us) {
+    uint32_t interval_ms = g_embedded_config.metrics_interval_ms;
+    if (interval_ms == 0 || !vr_rabbitmq_is_connected()) {
+        return;
+    }
+    
+    uint64_t now = vr_clock_monotonic_us();
+    if (*next_us == 0) {
+        // First report after one full interval
+        *next_us = now + (uint64_t)interval_ms * 1000;
+    }
+    if (now < *next_us) {
+        return;
+    }
+    *next_us = now + (uint64_t)interval_ms * 1000;
+    
+    vr_rabbitmq_send_metrics();
+}
+
+// Frames queued on the rings of one shard's streams
+static uint32_t vr_telemetry_queued(uint32_t shard) {
+    uint32_t queued = 0;
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        if (g_pipelines[kind].enabled && g_pipelines[kind].shard == shard) {
+            queued += vr_ring_occupancy(&g_pipelines[kind].ring);
+        }
+    }
+    return queued;
+}
+
+// Ring a shard's doorbell if its publisher is blocked waiting for frames
+static void vr_telemetry_wake_publisher(uint32_t shard) {
+    // Pairs with the fence in vr_telemetry_publisher_wait: either the publisher
+    // sees the pushed frame before blocking, or this sees it waiting
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_publisher_waiting[shard], __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&g_publisher_waiting[shard], 0, __ATOMIC_RELAXED)) {
+        uint64_t one = 1;
+        ssize_t written = write(g_publisher_wake_fds[shard], &one, sizeof(one));
+        (void)written;
+    }
+}
+
+// Sleep until frames arrive or the next timed duty of the shard is due:
+// a batch window closing, a reconnect attempt, a confirm poll or a metrics report
+static void vr_telemetry_publisher_wait(uint32_t shard, uint64_t next_metrics_us) {
+    uint64_t now = vr_clock_monotonic_us();
+    uint64_t timeout_us = vr_rabbitmq_idle_us(shard, now);
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        const vr_telemetry_pipeline_t *pipe = &g_pipelines[kind];
+        if (!pipe->enabled || pipe->shard != shard || pipe->retry_pending) continue;
+        
+        uint64_t batch_us = vr_batch_wait_us(&pipe->batch, now);
+        if (batch_us < timeout_us) timeout_us = batch_us;
+    }
+    if (shard == 0 && g_embedded_config.metrics_interval_ms > 0 && vr_rabbitmq_is_connected()) {
+        uint64_t metrics_us = next_metrics_us == 0 ? (uint64_t)g_embedded_config.metrics_interval_ms * 1000 :
+                              next_metrics_us > now ? next_metrics_us - now : 0;
+        if (metrics_us < timeout_us) timeout_us = metrics_us;
+    }
+    if (timeout_us > (uint64_t)VR_PUBLISHER_IDLE_MAX_MS * 1000) {
+        timeout_us = (uint64_t)VR_PUBLISHER_IDLE_MAX_MS * 1000;
+    }
+    if (timeout_us == 0) {
+        return;
+    }
+    
+    int fd = g_publisher_wake_fds[shard];
+    if (fd < 0) {
+        // No doorbell: poll the rings
+        vr_delay_us(timeout_us < 100 ? (uint32_t)timeout_us : 100);
+        __atomic_fetch_add(&g_telemetry_stats.publisher_wakeups, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    __atomic_store_n(&g_publisher_waiting[shard], 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (vr_telemetry_queued(shard) == 0 && g_publisher_running) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        struct timespec timeout = {
+            .tv_sec = (time_t)(timeout_us / 1000000),
+            .tv_nsec = (long)(timeout_us % 1000000) * 1000,
+        };
+        ppoll(&pfd, 1, &timeout, NULL);
+        __atomic_fetch_add(&g_telemetry_stats.publisher_wakeups, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&g_publisher_waiting[shard], 0, __ATOMIC_RELAXED);
+    
+    uint64_t rung;
+    ssize_t drained = read(fd, &rung, sizeof(rung));
+    (void)drained;
+}
+
+// Publisher thread of one shard: drains its streams' rings into batches and
+// publishes them on the shard's connection; shard 0 also publishes metrics
+static void *vr_telemetry_publisher_thread(void *arg) {
+    uint32_t shard = (uint32_t)(uintptr_t)arg;
+    vr_telemetry_packet_t packet;
+    bool link_up = vr_rabbitmq_shard_is_connected(shard);
+    uint64_t next_metrics_us = 0;
+    
+    while (g_publisher_running) {
+        bool idle = true;
+        
+        // Reconnect with backoff; runs here so outages never stall sampling
+        vr_rabbitmq_service(shard);
+        
+        bool connected = vr_rabbitmq_shard_is_connected(shard);
+        if (connected != link_up) {
+            VR_LOG(VR_LOG_INFO, "[TELEMETRY] Broker link %u %s, %u frames spilled\n",
+                   shard, connected ? "restored" : "lost", vr_telemetry_spilled(shard));
+            link_up = connected;
+        }
+        
+        for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+            vr_telemetry_pipeline_t *pipe = &g_pipelines[kind];
+            if (!pipe->enabled || pipe->shard != shard) continue;
+            
+            if (connected && (pipe->retry_pending || vr_ring_occupancy(&pipe->spill) > 0)) {
+                if (vr_telemetry_replay(pipe)) {
+                    idle = false;
+                }
+            }
+            
+            while (vr_ring_pop(&pipe->ring, &packet)) {
+                idle = false;
+                vr_telemetry_route(pipe, &packet);
+            }
+            
+            // Flush a partially filled batch once its window expires
+            if (!pipe->retry_pending && vr_batch_is_due(&pipe->batch, vr_clock_monotonic_us())) {
+                vr_telemetry_flush_stream(pipe);
+            }
+        }
+        
+        // Collect publisher confirms asynchronously
+        vr_rabbitmq_poll_confirms(shard);
+        
+        if (shard == 0) {
+            vr_telemetry_publish_metrics(&next_metrics_us);
+        }
+        
+        if (idle) {
+            vr_telemetry_publisher_wait(shard, next_metrics_us);
+        }
+    }
+    
+    // Drain whatever the sampling loop queued before shutdown
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        vr_telemetry_pipeline_t *pipe = &g_pipelines[kind];
+        if (!pipe->enabled || pipe->shard != shard) continue;
+        
+        if (vr_rabbitmq_shard_is_connected(shard)) {
+            vr_telemetry_replay(pipe);
+        }
+        while (vr_ring_pop(&pipe->ring, &packet)) {
+            vr_telemetry_route(pipe, &packet);
+        }
+        if (!pipe->retry_pending) {
+            vr_telemetry_flush_stream(pipe);
+        }
+    }
+    
+    return NULL;
+}
+
+// Release the rings of every stream
+static void vr_telemetry_destroy_pipelines(void) {
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        vr_ring_destroy(&g_pipelines[kind].ring);
+        vr_ring_destroy(&g_pipelines[kind].spill);
+        g_pipelines[kind].enabled = false;
+    }
+}
+
+// Stop and join the running publisher threads
+static void vr_telemetry_join_publishers(void) {
+    g_publisher_running = false;
+    for (uint32_t i = 0; i < g_publisher_thread_count; i++) {
+        __atomic_store_n(&g_publisher_waiting[i], 1, __ATOMIC_RELAXED);
+        vr_telemetry_wake_publisher(i);
+        pthread_join(g_publisher_threads[i], NULL);
+    }
+    for (uint32_t i = 0; i < VR_SHARD_MAX; i++) {
+        if (g_publisher_wake_fds[i] >= 0) {
+            close(g_publisher_wake_fds[i]);
+        }
+        g_publisher_wake_fds[i] = -1;
+    }
+    g_publisher_thread_count = 0;
+}
+
+// Allocate the rings of a stream
+static int vr_telemetry_init_pipeline(vr_telemetry_pipeline_t *pipe) {
+    if (vr_ring_init(&pipe->ring, g_embedded_config.telemetry_ring_depth,
+                     g_embedded_config.telemetry_ring_policy) != 0) {
+        return -1;
+    }
     
-    // Simulate calibration process
-    for (int i = 0; i < 100; i++) {
-        vr_delay_ms(1);
-        // Simulate calibration data collection
+    // Outage buffer: keeps the newest frames while the broker is unreachable
+    if (vr_ring_init(&pipe->spill, g_embedded_config.telemetry_spill_depth,
+                     VR_RING_DROP_OLDEST) != 0) {
+        vr_ring_destroy(&pipe->ring);
+        return -1;
     }
     
-    printf("[SENSORS] Calibration complete\n");
+    pipe->shard = vr_rabbitmq_stream_shard(pipe->kind);
+    pipe->enabled = true;
+    return 0;
 }
 
-// Initialize telemetry system
-void vr_telemetry_init(void) {
+// Initialize telemetry system; returns -1 when the rings or publishers could not be set up
+int vr_telemetry_init(void) {
     printf("[TELEMETRY] Initializing telemetry system...\n");
     
-    // Check if RabbitMQ is available at compile time
-#ifdef HAVE_RABBITMQ
-    // Initialize RabbitMQ connection
-    if (vr_rabbitmq_init(NULL, 5672, "guest", "guest", "/", "vr_telemetry", "telemetry.data") != 0) {
-        printf("[TELEMETRY] Failed to initialize RabbitMQ connection\n");
-        g_embedded_status.communication_ready = false;
-    } else {
-        printf("[TELEMETRY] Telemetry system ready\n");
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        vr_batch_init(&g_pipelines[kind].batch, g_embedded_config.telemetry_batch_size,
+                      g_embedded_config.telemetry_batch_window_us);
     }
-#else
-    // RabbitMQ not available - console mode
-    printf("[TELEMETRY] RabbitMQ not available - running in console mode\n");
-    g_embedded_status.communication_ready = true;
-#endif
+    
+    // Start publisher thread once; a system reset keeps the running publisher.
+    // The frame stream is always set up, the others only when given a rate.
+    if (!g_publisher_started) {
+        for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+            if (kind != VR_STREAM_FRAME &&
+                vr_telemetry_stream_rate(&g_embedded_config, (vr_stream_kind_t)kind) == 0) {
+                continue;
+            }
+            if (vr_telemetry_init_pipeline(&g_pipelines[kind]) != 0) {
+                vr_telemetry_destroy_pipelines();
+                vr_error_handler(VR_ERROR_MEMORY_ALLOC);
+                __atomic_store_n(&g_embedded_status.communication_ready, false, __ATOMIC_RELAXED);
+                return -1;
+            }
+        }
+        
+        g_publisher_running = true;
+        for (uint32_t shard = 0; shard < VR_SHARD_MAX; shard++) {
+            g_publisher_wake_fds[shard] = shard < vr_rabbitmq_shard_count() ?
+                                          eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) : -1;
+        }
+        for (uint32_t shard = 0; shard < vr_rabbitmq_shard_count(); shard++) {
+            if (pthread_create(&g_publisher_threads[shard], NULL, vr_telemetry_publisher_thread,
+                               (void *)(uintptr_t)shard) != 0) {
+                vr_telemetry_join_publishers();
+                vr_telemetry_destroy_pipelines();
+                vr_error_handler(VR_ERROR_MEMORY_ALLOC);
+                __atomic_store_n(&g_embedded_status.communication_ready, false, __ATOMIC_RELAXED);
+                return -1;
+            }
+            g_publisher_thread_count++;
+        }
+        g_publisher_started = true;
+    }
+    
+    const vr_packet_ring_t *ring = &g_pipelines[VR_STREAM_FRAME].ring;
+    printf("[TELEMETRY] Telemetry system initialized (ring: %u packets, %s, spill: %u packets)\n",
+           ring->capacity,
+           ring->policy == VR_RING_DROP_OLDEST ? "drop-oldest" : "drop-newest",
+           g_pipelines[VR_STREAM_FRAME].spill.capacity);
+    for (int kind = VR_STREAM_FRAME + 1; kind < VR_STREAM_KIND_COUNT; kind++) {
+        if (g_pipelines[kind].enabled) {
+            printf("[TELEMETRY] Stream %s: %u Hz\n", vr_stream_kind_name((vr_stream_kind_t)kind),
+                   vr_telemetry_stream_rate(&g_embedded_config, (vr_stream_kind_t)kind));
+        }
+    }
+    if (g_publisher_thread_count > 1) {
+        printf("[TELEMETRY] Publishing on %u connections:", g_publisher_thread_count);
+        for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+            if (g_pipelines[kind].enabled) {
+                printf(" %s -> %u", vr_stream_kind_name((vr_stream_kind_t)kind), g_pipelines[kind].shard);
+            }
+        }
+        printf("\n");
+    }
+    __atomic_store_n(&g_embedded_status.communication_ready, true, __ATOMIC_RELAXED);
+    return 0;
 }
 
-// Send telemetry packet
+// Send telemetry packet on the frame stream
 void vr_telemetry_send_packet(const vr_telemetry_packet_t *packet) {
+    vr_telemetry_send_stream(VR_STREAM_FRAME, packet);
+}
+
+// Send the sections of a telemetry packet that belong to one stream
+void vr_telemetry_send_stream(vr_stream_kind_t kind, const vr_telemetry_packet_t *packet) {
+    if ((unsigned)kind >= VR_STREAM_KIND_COUNT || !g_pipelines[kind].enabled) {
+        return;
+    }
+    
+    // Record the complete sample once, however many streams it goes out on
+    if (g_capture) {
+        vr_capture_append(g_capture, packet);
+    }
+    
     if (!vr_telemetry_is_ready()) {
         return;
     }
     
-    if (vr_rabbitmq_send_telemetry(packet) != 0) {
-        g_embedded_status.error_count++;
-        printf("[TELEMETRY] Failed to send packet, error count: %u\n", g_embedded_status.error_count);
+    // Hand the frame to the publisher thread; never blocks the sampling loop
+    vr_ring_push(&g_pipelines[kind].ring, packet);
+    vr_telemetry_wake_publisher(g_pipelines[kind].shard);
+}
+
+// Record every sample sent from now on into cap, or stop recording with NULL
+void vr_telemetry_set_capture(vr_capture_t *cap) {
+    g_capture = cap;
+}
+
+// Free ring slots of one stream; replay at full speed waits for room instead of dropping
+uint32_t vr_telemetry_stream_room(vr_stream_kind_t kind) {
+    if ((unsigned)kind >= VR_STREAM_KIND_COUNT || !g_pipelines[kind].enabled) {
+        return 0;
+    }
+    const vr_packet_ring_t *ring = &g_pipelines[kind].ring;
+    return ring->capacity - vr_ring_occupancy(ring);
+}
+
+// Stop the publisher thread after draining queued frames
+void vr_telemetry_shutdown(void) {
+    if (!g_publisher_started) {
+        return;
+    }
+    
+    vr_telemetry_join_publishers();
+    g_publisher_started = false;
+    
+    vr_telemetry_stats_t stats;
+    vr_telemetry_get_stats(&stats);
+    printf("[TELEMETRY] Publisher stopped - queued: %lu, dropped: %lu, ring high watermark: %u/%u\n",
+           stats.ring.pushed, stats.ring.dropped, stats.ring.high_watermark, stats.ring.capacity);
+    uint32_t unsent = stats.spill.occupancy;
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        if (g_pipelines[kind].retry_pending) {
+            unsent += g_pipelines[kind].batch.count;
+        }
+    }
+    printf("[TELEMETRY] Spill - spilled: %lu, replayed: %lu, expired: %lu, overflowed: %lu, unsent: %u\n",
+           stats.spill.pushed, stats.frames_replayed, stats.frames_expired, stats.spill.dropped, unsent);
+    vr_telemetry_destroy_pipelines();
+}
+
+// Add one ring's counters to a total
+static void vr_telemetry_add_ring_stats(vr_ring_stats_t *total, const vr_packet_ring_t *ring) {
+    vr_ring_stats_t stats;
+    vr_ring_get_stats(ring, &stats);
+    total->capacity += stats.capacity;
+    total->occupancy += stats.occupancy;
+    if (stats.high_watermark > total->high_watermark) {
+        total->high_watermark = stats.high_watermark;
+    }
+    total->pushed += stats.pushed;
+    total->dropped += stats.dropped;
+}
+
+// Get telemetry ring, spill and replay counters, summed over all streams
+void vr_telemetry_get_stats(vr_telemetry_stats_t *stats) {
+    if (!stats) return;
+    memset(&stats->ring, 0, sizeof(stats->ring));
+    memset(&stats->spill, 0, sizeof(stats->spill));
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        vr_telemetry_add_ring_stats(&stats->ring, &g_pipelines[kind].ring);
+        vr_telemetry_add_ring_stats(&stats->spill, &g_pipelines[kind].spill);
     }
+    stats->frames_replayed = __atomic_load_n(&g_telemetry_stats.frames_replayed, __ATOMIC_RELAXED);
+    stats->frames_expired = __atomic_load_n(&g_telemetry_stats.frames_expired, __ATOMIC_RELAXED);
+    stats->frames_discarded = __atomic_load_n(&g_telemetry_stats.frames_discarded, __ATOMIC_RELAXED);
+    stats->publisher_wakeups = __atomic_load_n(&g_telemetry_stats.publisher_wakeups, __ATOMIC_RELAXED);
 }
 
-// Check if telemetry is ready
+// Check if telemetry is ready (a broker is configured; it may be reconnecting)
 bool vr_telemetry_is_ready(void) {
-    return g_embedded_status.communication_ready && vr_rabbitmq_is_connected();
+    return __atomic_load_n(&g_embedded_status.communication_ready, __ATOMIC_RELAXED) &&
+           vr_rabbitmq_is_configured();
+}
+
+// Set the rate of one stream; fails if the stream is not running or the rate is 0.
+// With rate control on, the frame stream rate is the controller's new starting point.
+int vr_telemetry_set_rate(vr_stream_kind_t kind, uint32_t rate_hz) {
+    if (vr_telemetry_apply_rate(kind, rate_hz) != 0) {
+        return -1;
+    }
+    printf("[TELEMETRY] %s rate set to %u Hz\n", vr_stream_kind_name(kind), rate_hz);
+    return 0;
+}
+
+// Get the adaptive frame rate state and counters
+void vr_telemetry_get_rate_control(vr_ratectl_stats_t *stats) {
+    vr_ratectl_get_stats(&g_ratectl, stats);
 }
 
-// Set telemetry rate
-void vr_telemetry_set_rate(uint32_t rate_hz) {
-    g_embedded_config.telemetry_rate_hz = rate_hz;
-    printf("[TELEMETRY] Telemetry rate set to %u Hz\n", rate_hz);
+// Get the configured rate of a stream (0 = off)
+uint32_t vr_telemetry_stream_rate(const vr_embedded_config_t *config, vr_stream_kind_t kind) {
+    if (!config) return 0;
+    
+    switch (kind) {
+        case VR_STREAM_FRAME:  return config->telemetry_rate_hz;
+        case VR_STREAM_POSE:   return config->pose_rate_hz;
+        case VR_STREAM_EYES:   return config->eyes_rate_hz;
+        case VR_STREAM_STATUS: return config->status_rate_hz;
+        default:               return 0;
+    }
 }
 
 // Initialize power management
@@ -360,19 +1088,28 @@ void vr_power_init(void) {
     printf("[POWER] Power management ready\n");
 }
 
-// Enter sleep mode
-void vr_power_enter_sleep(uint8_t sleep_level) {
-    if (sleep_level > 0) {
-        printf("[POWER] Entering sleep level %d\n", sleep_level);
-        g_power_save_active = true;
-        vr_delay_ms(10);  // Simulate sleep
-        g_power_save_active = false;
+// Idle strategy of a configuration: the CPU sleep level, raised to deep sleep in power-save mode
+vr_idle_mode_t vr_power_idle_mode(const vr_embedded_config_t *config) {
+    vr_idle_mode_t idle = config->cpu_sleep_level < VR_IDLE_MODE_COUNT ?
+                          (vr_idle_mode_t)config->cpu_sleep_level : VR_IDLE_DEEP;
+    if (config->power_save_enabled && idle < VR_IDLE_DEEP) {
+        idle = VR_IDLE_DEEP;
     }
+    return idle;
+}
+
+// Enter sleep mode: the main loop idles at this level between deadlines (main loop thread)
+void vr_power_enter_sleep(uint8_t sleep_level) {
+    vr_idle_mode_t idle = sleep_level < VR_IDLE_MODE_COUNT ? (vr_idle_mode_t)sleep_level : VR_IDLE_DEEP;
+    VR_LOG(VR_LOG_INFO, "[POWER] Entering sleep level %d (%s)\n", sleep_level, vr_idle_mode_name(idle));
+    vr_scheduler_set_idle(&g_scheduler, idle);
+    g_power_save_active = idle == VR_IDLE_DEEP;
 }
 
-// Wake up from sleep
+// Wake up from sleep: back to the configured idle strategy (main loop thread)
 void vr_power_wake_up(void) {
-    printf("[POWER] Waking up from sleep\n");
+    VR_LOG(VR_LOG_INFO, "[POWER] Waking up from sleep\n");
+    vr_scheduler_set_idle(&g_scheduler, vr_power_idle_mode(&g_embedded_config));
     g_power_save_active = false;
 }
 
@@ -389,12 +1126,12 @@ float vr_power_get_current(void) {
 // Initialize watchdog
 void vr_watchdog_init(uint32_t timeout_ms) {
     printf("[WATCHDOG] Initializing watchdog with %u ms timeout\n", timeout_ms);
-    g_embedded_status.last_watchdog_reset = g_system_tick;
+    __atomic_store_n(&g_embedded_status.last_watchdog_reset, vr_get_system_tick(), __ATOMIC_RELAXED);
 }
 
 // Feed watchdog
 void vr_watchdog_feed(void) {
-    g_embedded_status.last_watchdog_reset = g_system_tick;
+    __atomic_store_n(&g_embedded_status.last_watchdog_reset, vr_get_system_tick(), __ATOMIC_RELAXED);
 }
 
 // Disable watchdog
@@ -404,32 +1141,29 @@ void vr_watchdog_disable(void) {
 
 // Error handler
 void vr_error_handler(uint32_t error_code) {
-    g_embedded_status.error_count++;
-    printf("[ERROR] Error code: 0x%02X, count: %u\n", error_code, g_embedded_status.error_count);
+    uint32_t errors = __atomic_add_fetch(&g_embedded_status.error_count, 1, __ATOMIC_RELAXED);
+    VR_LOG(VR_LOG_INFO, "[ERROR] Error code: 0x%02X, count: %u\n", error_code, errors);
     
-    if (g_embedded_status.error_count > 5) {
-        vr_embedded_set_state(VR_SYSTEM_ERROR);
-        printf("[ERROR] Too many errors, entering error state\n");
+    if (errors > 5 && vr_embedded_set_state(VR_SYSTEM_ERROR)) {
+        VR_LOG(VR_LOG_INFO, "[ERROR] Too many errors, entering error state\n");
     }
 }
 
 // System reset
 void vr_system_reset(void) {
     printf("[SYSTEM] Performing system reset...\n");
-    g_embedded_status.reset_count++;
-    g_embedded_status.error_count = 0;
-    g_embedded_status.state = VR_SYSTEM_INIT;
+    __atomic_fetch_add(&g_embedded_status.reset_count, 1, __ATOMIC_RELAXED);
     vr_embedded_init(&g_embedded_config, true);
 }
 
 // Get error count
 uint32_t vr_get_error_count(void) {
-    return g_embedded_status.error_count;
+    return __atomic_load_n(&g_embedded_status.error_count, __ATOMIC_RELAXED);
 }
 
-// Get system tick
+// Get system tick: milliseconds since boot, read from the clock
 uint32_t vr_get_system_tick(void) {
-    return g_system_tick;
+    return g_boot_ns == 0 ? 0 : (uint32_t)((vr_get_monotonic_ns() - g_boot_ns) / 1000000);
 }
 
 // Delay in milliseconds
@@ -442,11 +1176,16 @@ void vr_delay_us(uint32_t us) {
     usleep(us);
 }
 
-// Get timestamp in microseconds
+// Get monotonic time in nanoseconds (unaffected by wall-clock adjustments)
+uint64_t vr_get_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * VR_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+// Get wall-clock timestamp in microseconds (monotonic clock plus the slewed offset)
 uint64_t vr_get_timestamp_us(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    return vr_clock_wall_us(vr_clock_monotonic_us());
 }
 
 // Add sensor noise
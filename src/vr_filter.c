@@ -0,0 +1,213 @@
+#include "vr_telemetry.h"
+#include <math.h>
+#include <string.h>
+
+// Decimation filters between the sensor loop and the telemetry streams.
+//
+// Sensors update far faster than frames are sent, so sending the latest
+// sample discards most of them and aliases anything faster than half the
+// stream rate into the output. A filter instead sees every sample
+// (vr_filter_update, sampling thread) and produces one frame per send
+// (vr_filter_output, also the sampling thread). Filters are selected by
+// kind from g_filters; each works on the packet's float fields as an array
+// in VR_WIRE_TYPE_FRAME order (vr_packet_get_floats).
+// Quaternions are averaged component-wise after flipping each onto the same
+// hemisphere as the previous output, then renormalized; for the small spread
+// of rotations within one frame this matches the true rotation average.
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// First field of each quaternion
+static const int g_filter_quats[] = { 3, 22, 30 };
+#define VR_FILTER_QUAT_COUNT (int)(sizeof(g_filter_quats) / sizeof(g_filter_quats[0]))
+
+// Head and hand position and orientation, filtered by One Euro
+static const int g_filter_pose_ranges[][2] = { { 0, 7 }, { 19, 26 }, { 27, 34 } };
+#define VR_FILTER_POSE_RANGES (int)(sizeof(g_filter_pose_ranges) / sizeof(g_filter_pose_ranges[0]))
+
+typedef struct {
+    const char *name;
+    void (*update)(vr_filter_t *filter, const float *x, double dt_s);
+    void (*output)(vr_filter_t *filter, float *y);
+} vr_filter_ops_t;
+
+// Flip each quaternion of x onto the hemisphere of the same quaternion in ref (q and -q are one rotation)
+static void vr_filter_align_quats(float *x, const float *ref) {
+    for (int k = 0; k < VR_FILTER_QUAT_COUNT; k++) {
+        float *q = x + g_filter_quats[k];
+        const float *r = ref + g_filter_quats[k];
+        if (q[0] * r[0] + q[1] * r[1] + q[2] * r[2] + q[3] * r[3] < 0.0f) {
+            for (int j = 0; j < 4; j++) q[j] = -q[j];
+        }
+    }
+}
+
+// Scale each quaternion of y back to unit length
+static void vr_filter_normalize_quats(float *y) {
+    for (int k = 0; k < VR_FILTER_QUAT_COUNT; k++) {
+        float *q = y + g_filter_quats[k];
+        float norm = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        if (norm > 1e-6f) {
+            for (int j = 0; j < 4; j++) q[j] /= norm;
+        }
+    }
+}
+
+// Smoothing factor of a first-order low-pass at cutoff_hz for one time step
+static float vr_filter_alpha(double cutoff_hz, double dt_s) {
+    double tau = 1.0 / (2.0 * M_PI * cutoff_hz);
+    return (float)(dt_s / (dt_s + tau));
+}
+
+// Low-pass cutoff: configured, or half the stream rate
+static double vr_filter_cutoff_hz(const vr_filter_t *filter) {
+    if (filter->config.cutoff_hz > 0.0f) {
+        return filter->config.cutoff_hz;
+    }
+    return filter->stream_rate_hz > 0.0f ? filter->stream_rate_hz / 2.0 : 30.0;
+}
+
+// Box: accumulate until the next frame
+static void vr_filter_box_update(vr_filter_t *filter, const float *x, double dt_s) {
+    (void)dt_s;
+    for (int i = 0; i < VR_FILTER_FIELDS; i++) {
+        filter->sum[i] += x[i];
+    }
+    filter->count++;
+}
+
+static void vr_filter_box_output(vr_filter_t *filter, float *y) {
+    if (filter->count > 0) {
+        for (int i = 0; i < VR_FILTER_FIELDS; i++) {
+            filter->mean[i] = (float)(filter->sum[i] / filter->count);
+            filter->sum[i] = 0.0;
+        }
+        vr_filter_normalize_quats(filter->mean);
+        filter->count = 0;
+    }
+    // No new sample since the previous frame: repeat it
+    memcpy(y, filter->mean, sizeof(filter->mean));
+}
+
+// Low-pass: exponential smoothing at every sample
+static void vr_filter_lowpass_update(vr_filter_t *filter, const float *x, double dt_s) {
+    float alpha = vr_filter_alpha(vr_filter_cutoff_hz(filter), dt_s);
+    for (int i = 0; i < VR_FILTER_FIELDS; i++) {
+        filter->state[i] += alpha * (x[i] - filter->state[i]);
+    }
+    vr_filter_normalize_quats(filter->state);
+}
+
+static void vr_filter_state_output(vr_filter_t *filter, float *y) {
+    memcpy(y, filter->state, sizeof(filter->state));
+}
+
+// One Euro (Casiez et al., CHI 2012): a low-pass whose cutoff rises with the
+// filtered speed, so pose is smooth at rest and does not lag in fast motion
+static void vr_filter_one_euro_update(vr_filter_t *filter, const float *x, double dt_s) {
+    float speed_alpha = vr_filter_alpha(VR_ONE_EURO_D_CUTOFF_HZ, dt_s);
+    for (int r = 0; r < VR_FILTER_POSE_RANGES; r++) {
+        for (int i = g_filter_pose_ranges[r][0]; i < g_filter_pose_ranges[r][1]; i++) {
+            float speed = (float)((x[i] - filter->state[i]) / dt_s);
+            filter->speed[i] += speed_alpha * (speed - filter->speed[i]);
+            double cutoff = filter->config.min_cutoff_hz + filter->config.beta * fabsf(filter->speed[i]);
+            filter->state[i] += vr_filter_alpha(cutoff, dt_s) * (x[i] - filter->state[i]);
+        }
+    }
+    vr_filter_normalize_quats(filter->state);
+    vr_filter_box_update(filter, x, dt_s);
+}
+
+static void vr_filter_one_euro_output(vr_filter_t *filter, float *y) {
+    vr_filter_box_output(filter, y);
+    for (int r = 0; r < VR_FILTER_POSE_RANGES; r++) {
+        for (int i = g_filter_pose_ranges[r][0]; i < g_filter_pose_ranges[r][1]; i++) {
+            y[i] = filter->state[i];
+        }
+    }
+}
+
+static const vr_filter_ops_t g_filters[VR_FILTER_KIND_COUNT] = {
+    [VR_FILTER_NONE]     = { "none", NULL, NULL },
+    [VR_FILTER_BOX]      = { "box", vr_filter_box_update, vr_filter_box_output },
+    [VR_FILTER_LOWPASS]  = { "lowpass", vr_filter_lowpass_update, vr_filter_state_output },
+    [VR_FILTER_ONE_EURO] = { "one-euro", vr_filter_one_euro_update, vr_filter_one_euro_output },
+};
+
+// Set up a filter for samples at sample_rate_hz and frames at stream_rate_hz
+void vr_filter_init(vr_filter_t *filter, const vr_filter_config_t *config, uint32_t sample_rate_hz,
+                    uint32_t stream_rate_hz) {
+    memset(filter, 0, sizeof(*filter));
+    if (config && (unsigned)config->kind < VR_FILTER_KIND_COUNT) {
+        filter->config = *config;
+    }
+    if (filter->config.min_cutoff_hz <= 0.0f) {
+        filter->config.min_cutoff_hz = VR_ONE_EURO_DEFAULT_MIN_CUTOFF_HZ;
+    }
+    filter->sample_period_s = 1.0 / (sample_rate_hz > 0 ? sample_rate_hz : 1000);
+    filter->stream_rate_hz = (float)stream_rate_hz;
+}
+
+// Follow a stream rate change (the default low-pass cutoff is derived from it)
+void vr_filter_set_rate(vr_filter_t *filter, uint32_t stream_rate_hz) {
+    filter->stream_rate_hz = (float)stream_rate_hz;
+}
+
+// Feed one sensor sample
+void vr_filter_update(vr_filter_t *filter, const vr_telemetry_packet_t *sample) {
+    const vr_filter_ops_t *ops = &g_filters[filter->config.kind];
+    double dt_s = filter->sample_period_s;
+    if (filter->primed && sample->monotonic_us > filter->latest.monotonic_us) {
+        dt_s = (double)(sample->monotonic_us - filter->latest.monotonic_us) / 1e6;
+    }
+    filter->latest = *sample;
+    bool first = !filter->primed;
+    filter->primed = true;
+    if (!ops->update) {
+        return;
+    }
+
+    float x[VR_FILTER_FIELDS];
+    vr_packet_get_floats(sample, x);
+    if (first) {
+        // Start from the first sample instead of ramping up from zero
+        memcpy(filter->state, x, sizeof(x));
+        memcpy(filter->mean, x, sizeof(x));
+    }
+    vr_filter_align_quats(x, filter->config.kind == VR_FILTER_BOX ? filter->mean : filter->state);
+    ops->update(filter, x, dt_s);
+}
+
+// Produce the frame to send: the latest sample with its float fields filtered
+void vr_filter_output(vr_filter_t *filter, vr_telemetry_packet_t *packet) {
+    const vr_filter_ops_t *ops = &g_filters[filter->config.kind];
+    *packet = filter->latest;
+    if (!ops->output || !filter->primed) {
+        return;
+    }
+
+    float y[VR_FILTER_FIELDS];
+    ops->output(filter, y);
+    vr_packet_set_floats(packet, y);
+}
+
+// Filter name for the command line and reports
+const char *vr_filter_kind_name(vr_filter_kind_t kind) {
+    if ((unsigned)kind >= VR_FILTER_KIND_COUNT) return "unknown";
+    return g_filters[kind].name;
+}
+
+// Parse filter name from the command line
+int vr_filter_parse_kind(const char *name, vr_filter_kind_t *kind) {
+    if (!name || !kind) return -1;
+
+    for (int k = 0; k < VR_FILTER_KIND_COUNT; k++) {
+        if (strcmp(name, g_filters[k].name) == 0) {
+            *kind = (vr_filter_kind_t)k;
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,288 @@
+#include "vr_telemetry.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Per-channel sensor history with O(1) windowed statistics.
+//
+// Each channel is a power-of-two ring of the last `capacity` samples, one
+// cache line per sample. Pushing a sample updates the statistics of the
+// window instead of recomputing them:
+// - mean and variance with Welford's update, extended to remove the sample
+//   that leaves a full window; accumulators are double precision, so the
+//   rounding drift stays far below the float resolution of the samples.
+// - minimum and maximum with monotonic queues of (position, value): each
+//   sample is pushed and popped at most once, so a push is amortized O(1)
+//   and the extreme is always at the front.
+// A ring has a single writer (the sampling thread) and is read on that thread.
+
+static const uint32_t g_history_components[VR_HISTORY_CHANNEL_COUNT] = {
+    [VR_HISTORY_POSE]  = 7,
+    [VR_HISTORY_IMU]   = 6,
+    [VR_HISTORY_EYES]  = 6,
+    [VR_HISTORY_HANDS] = 16,
+};
+
+static const char *const g_history_names[VR_HISTORY_CHANNEL_COUNT] = {
+    [VR_HISTORY_POSE]  = "pose",
+    [VR_HISTORY_IMU]   = "imu",
+    [VR_HISTORY_EYES]  = "eyes",
+    [VR_HISTORY_HANDS] = "hands",
+};
+
+// Round up to the next power of two
+static uint32_t vr_history_round_up_pow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Row of the sample at a position
+static float *vr_history_row(const vr_history_ring_t *ring, uint32_t position) {
+    return ring->samples + (size_t)(position & ring->mask) * VR_HISTORY_MAX_COMPONENTS;
+}
+
+// Allocate a ring of at least `depth` samples of `components` floats
+int vr_history_ring_init(vr_history_ring_t *ring, uint32_t components, uint32_t depth) {
+    if (!ring || components == 0 || components > VR_HISTORY_MAX_COMPONENTS) return -1;
+
+    memset(ring, 0, sizeof(*ring));
+    if (depth < 2) depth = 2;
+    if (depth > VR_HISTORY_MAX_DEPTH) depth = VR_HISTORY_MAX_DEPTH;
+
+    ring->capacity = vr_history_round_up_pow2(depth);
+    ring->mask = ring->capacity - 1;
+    ring->components = components;
+
+    // One block: sample rows, timestamps, then the min and max queues of each component
+    size_t rows = (size_t)ring->capacity * VR_HISTORY_MAX_COMPONENTS * sizeof(float);
+    size_t stamps = (size_t)ring->capacity * sizeof(uint64_t);
+    size_t queues = (size_t)ring->capacity * sizeof(vr_history_extreme_t) * 2 * components;
+    void *block = NULL;
+    if (posix_memalign(&block, VR_CACHE_LINE_SIZE, rows + stamps + queues) != 0) {
+        ring->capacity = 0;
+        return -1;
+    }
+    memset(block, 0, rows + stamps);
+
+    ring->samples = block;
+    ring->timestamps_us = (uint64_t *)((uint8_t *)block + rows);
+    vr_history_extreme_t *entries = (vr_history_extreme_t *)((uint8_t *)block + rows + stamps);
+    for (uint32_t c = 0; c < components; c++) {
+        ring->min[c].entries = entries + (size_t)(2 * c) * ring->capacity;
+        ring->max[c].entries = entries + (size_t)(2 * c + 1) * ring->capacity;
+    }
+    return 0;
+}
+
+// Release ring storage
+void vr_history_ring_destroy(vr_history_ring_t *ring) {
+    if (!ring) return;
+    free(ring->samples);
+    memset(ring, 0, sizeof(*ring));
+}
+
+// Forget every sample, keeping the storage
+static void vr_history_ring_clear(vr_history_ring_t *ring) {
+    ring->count = 0;
+    ring->position = 0;
+    memset(ring->mean, 0, sizeof(ring->mean));
+    memset(ring->m2, 0, sizeof(ring->m2));
+    for (uint32_t c = 0; c < ring->components; c++) {
+        ring->min[c].head = ring->min[c].tail = 0;
+        ring->max[c].head = ring->max[c].tail = 0;
+    }
+}
+
+// Queue a sample, first dropping the queued ones it makes irrelevant (values
+// >= value for the minima queue, <= value for the maxima queue)
+static void vr_history_minima_push(vr_history_extremes_t *q, uint32_t mask, uint32_t position, float value) {
+    while (q->head != q->tail && q->entries[(q->head - 1) & mask].value >= value) {
+        q->head--;
+    }
+    q->entries[q->head & mask] = (vr_history_extreme_t){ .position = position, .value = value };
+    q->head++;
+}
+
+static void vr_history_maxima_push(vr_history_extremes_t *q, uint32_t mask, uint32_t position, float value) {
+    while (q->head != q->tail && q->entries[(q->head - 1) & mask].value <= value) {
+        q->head--;
+    }
+    q->entries[q->head & mask] = (vr_history_extreme_t){ .position = position, .value = value };
+    q->head++;
+}
+
+// Drop a sample leaving the window if it is the current extreme
+static void vr_history_extremes_expire(vr_history_extremes_t *q, uint32_t mask, uint32_t position) {
+    if (q->head != q->tail && q->entries[q->tail & mask].position == position) {
+        q->tail++;
+    }
+}
+
+// Add a sample of ring->components values, evicting the oldest from a full window
+void vr_history_ring_push(vr_history_ring_t *ring, const float *values, uint64_t timestamp_us) {
+    uint32_t position = ring->position;
+    float *row = vr_history_row(ring, position);
+    bool full = ring->count == ring->capacity;
+    if (!full) {
+        ring->count++;
+    }
+    double inv_n = 1.0 / (double)ring->count;
+    uint32_t expired = position - ring->capacity;
+
+    for (uint32_t c = 0; c < ring->components; c++) {
+        double x = values[c];
+        double mean = ring->mean[c];
+
+        if (full) {
+            // Replace the oldest sample (still in this row) by the new one
+            double old = row[c];
+            double updated = mean + (x - old) * inv_n;
+            ring->m2[c] += (x - old) * (x - updated + old - mean);
+            ring->mean[c] = updated;
+            vr_history_extremes_expire(&ring->min[c], ring->mask, expired);
+            vr_history_extremes_expire(&ring->max[c], ring->mask, expired);
+        } else {
+            double delta = x - mean;
+            ring->mean[c] = mean + delta * inv_n;
+            ring->m2[c] += delta * (x - ring->mean[c]);
+        }
+        if (ring->m2[c] < 0.0) {
+            ring->m2[c] = 0.0;
+        }
+
+        vr_history_minima_push(&ring->min[c], ring->mask, position, values[c]);
+        vr_history_maxima_push(&ring->max[c], ring->mask, position, values[c]);
+    }
+
+    // The outgoing sample was read from this row above, so store the new one last
+    memcpy(row, values, ring->components * sizeof(float));
+    ring->timestamps_us[position & ring->mask] = timestamp_us;
+    ring->position = position + 1;
+}
+
+// Sample `age` pushes back (0 = latest); NULL if the window holds fewer
+const float *vr_history_ring_sample(const vr_history_ring_t *ring, uint32_t age, uint64_t *timestamp_us) {
+    if (!ring || age >= ring->count) return NULL;
+
+    uint32_t position = ring->position - 1 - age;
+    if (timestamp_us) {
+        *timestamp_us = ring->timestamps_us[position & ring->mask];
+    }
+    return vr_history_row(ring, position);
+}
+
+// Statistics of one component over the window
+int vr_history_ring_get_stats(const vr_history_ring_t *ring, uint32_t component, vr_history_stats_t *stats) {
+    if (!ring || !stats || component >= ring->components) return -1;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = ring->count;
+    if (ring->count == 0) {
+        return 0;
+    }
+    stats->mean = (float)ring->mean[component];
+    stats->variance = (float)(ring->m2[component] / ring->count);
+    stats->min = ring->min[component].entries[ring->min[component].tail & ring->mask].value;
+    stats->max = ring->max[component].entries[ring->max[component].tail & ring->mask].value;
+    return 0;
+}
+
+// Allocate every channel with at least `depth` samples
+int vr_history_init(vr_sensor_history_t *hist, uint32_t depth) {
+    if (!hist) return -1;
+
+    memset(hist, 0, sizeof(*hist));
+    for (int ch = 0; ch < VR_HISTORY_CHANNEL_COUNT; ch++) {
+        if (vr_history_ring_init(&hist->channels[ch], g_history_components[ch], depth) != 0) {
+            vr_history_destroy(hist);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Release every channel
+void vr_history_destroy(vr_sensor_history_t *hist) {
+    if (!hist) return;
+    for (int ch = 0; ch < VR_HISTORY_CHANNEL_COUNT; ch++) {
+        vr_history_ring_destroy(&hist->channels[ch]);
+    }
+}
+
+// Forget all samples
+void vr_history_reset(vr_sensor_history_t *hist) {
+    if (!hist) return;
+    for (int ch = 0; ch < VR_HISTORY_CHANNEL_COUNT; ch++) {
+        vr_history_ring_clear(&hist->channels[ch]);
+    }
+}
+
+// Copy a hand into 8 channel values
+static void vr_history_put_hand(float *v, const vr_hand_tracking_t *hand) {
+    v[0] = hand->x;
+    v[1] = hand->y;
+    v[2] = hand->z;
+    v[3] = hand->orientation.x;
+    v[4] = hand->orientation.y;
+    v[5] = hand->orientation.z;
+    v[6] = hand->orientation.w;
+    v[7] = hand->grip_strength;
+}
+
+// Push one sensor sample into every channel
+void vr_history_record(vr_sensor_history_t *hist, const vr_telemetry_packet_t *packet) {
+    if (!hist || !hist->channels[0].samples || !packet) return;
+
+    float v[VR_HISTORY_MAX_COMPONENTS];
+    uint64_t t = packet->monotonic_us;
+
+    v[0] = packet->head_position.x;
+    v[1] = packet->head_position.y;
+    v[2] = packet->head_position.z;
+    v[3] = packet->head_orientation.x;
+    v[4] = packet->head_orientation.y;
+    v[5] = packet->head_orientation.z;
+    v[6] = packet->head_orientation.w;
+    vr_history_ring_push(&hist->channels[VR_HISTORY_POSE], v, t);
+
+    v[0] = packet->head_acceleration.x;
+    v[1] = packet->head_acceleration.y;
+    v[2] = packet->head_acceleration.z;
+    v[3] = packet->head_angular_velocity.x;
+    v[4] = packet->head_angular_velocity.y;
+    v[5] = packet->head_angular_velocity.z;
+    vr_history_ring_push(&hist->channels[VR_HISTORY_IMU], v, t);
+
+    v[0] = packet->left_eye.x;
+    v[1] = packet->left_eye.y;
+    v[2] = packet->left_eye.pupil_diameter;
+    v[3] = packet->right_eye.x;
+    v[4] = packet->right_eye.y;
+    v[5] = packet->right_eye.pupil_diameter;
+    vr_history_ring_push(&hist->channels[VR_HISTORY_EYES], v, t);
+
+    vr_history_put_hand(v, &packet->left_hand);
+    vr_history_put_hand(v + 8, &packet->right_hand);
+    vr_history_ring_push(&hist->channels[VR_HISTORY_HANDS], v, t);
+}
+
+// Statistics of one component of a channel
+int vr_history_get_stats(const vr_sensor_history_t *hist, vr_history_channel_t channel,
+                         uint32_t component, vr_history_stats_t *stats) {
+    if (!hist || channel < 0 || channel >= VR_HISTORY_CHANNEL_COUNT) return -1;
+    return vr_history_ring_get_stats(&hist->channels[channel], component, stats);
+}
+
+// Channel name for reports
+const char *vr_history_channel_name(vr_history_channel_t channel) {
+    if (channel < 0 || channel >= VR_HISTORY_CHANNEL_COUNT) return "unknown";
+    return g_history_names[channel];
+}
+
+// Values per sample of a channel
+uint32_t vr_history_channel_components(vr_history_channel_t channel) {
+    if (channel < 0 || channel >= VR_HISTORY_CHANNEL_COUNT) return 0;
+    return g_history_components[channel];
+}
@@ -0,0 +1,348 @@
+#include "vr_telemetry.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+// Load generator: ramps simulated fleets against the broker to find where
+// the producer/broker pair saturates.
+//
+// Every step starts a fleet of `devices` headsets publishing frames at
+// `rate_hz` in messages of `batch_size` frames, lets it warm up (connect,
+// fill the confirm window) and then measures for step_s: frames and messages
+// sent per second, the drop rate, publish and confirm latency and the CPU
+// time of the whole process. A step is saturated when fewer than
+// VR_LOADGEN_MIN_THROUGHPUT of the offered frames were sent, more than
+// VR_LOADGEN_MAX_DROP_RATE of the sampled frames were dropped, or the confirm
+// p99 is above the latency limit.
+// Device counts are the innermost ramp. For each rate and batch size the
+// knee is the last step before the first saturated one; the ramp then moves
+// on to the next rate, since more devices only add load to a broker that is
+// already behind. Publisher confirms are always on (see main.c): without
+// them a publish only measures how fast the socket buffer fills.
+
+typedef struct {
+    uint64_t ns;
+    double cpu_s;
+    vr_fleet_stats_t fleet;
+    vr_histogram_t publish;
+    vr_histogram_t confirm;
+} vr_loadgen_sample_t;
+
+// Outcome of ramping the devices at one rate and batch size
+typedef struct {
+    uint32_t rate_hz;
+    uint32_t batch_size;
+    int knee;                      // Step index of the last unsaturated step (-1 = none)
+    int saturated;                 // Step index of the first saturated step (-1 = none)
+} vr_loadgen_series_t;
+
+static volatile sig_atomic_t g_loadgen_stop = 0;
+static vr_loadgen_sample_t g_loadgen_before;
+static vr_loadgen_sample_t g_loadgen_after;
+
+// Parse a comma-separated list of positive integers
+int vr_loadgen_parse_list(const char *arg, uint32_t *values, uint32_t *count) {
+    if (!arg || !values || !count) return -1;
+
+    uint32_t n = 0;
+    const char *p = arg;
+    while (*p) {
+        if (*p < '0' || *p > '9' || n == VR_LOADGEN_MAX_VALUES) {
+            return -1;  // strtoul would accept signs and spaces
+        }
+        char *end;
+        errno = 0;
+        unsigned long value = strtoul(p, &end, 10);
+        if (errno != 0 || value == 0 || value > UINT32_MAX || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        values[n++] = (uint32_t)value;
+        p = *end == ',' ? end + 1 : end;
+        if (*end == ',' && *p == '\0') {
+            return -1;  // Trailing comma
+        }
+    }
+    if (n == 0) return -1;
+
+    *count = n;
+    return 0;
+}
+
+// Interrupt the ramp after the current step (signal handlers)
+void vr_loadgen_stop(void) {
+    g_loadgen_stop = 1;
+}
+
+// Sleep for `seconds` while keeping the frame clock current; false if stopped meanwhile
+static bool vr_loadgen_wait(uint32_t seconds) {
+    uint64_t until = vr_get_monotonic_ns() + (uint64_t)seconds * 1000000000ull;
+    while (!g_loadgen_stop) {
+        uint64_t now = vr_get_monotonic_ns();
+        if (now >= until) {
+            return true;
+        }
+        vr_clock_refresh();
+        uint64_t left_ms = (until - now) / 1000000;
+        vr_delay_ms(left_ms >= 100 ? 100 : (uint32_t)left_ms + 1);
+    }
+    return false;
+}
+
+// Read the counters a step is measured by
+static void vr_loadgen_sample(vr_loadgen_sample_t *sample) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    sample->ns = vr_get_monotonic_ns();
+    sample->cpu_s = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    vr_fleet_get_stats(&sample->fleet);
+    vr_metrics_get_histogram(VR_METRIC_PUBLISH, &sample->publish);
+    vr_metrics_get_histogram(VR_METRIC_CONFIRM, &sample->confirm);
+}
+
+// Run one step; -1 if the fleet did not start or the ramp was stopped
+static int vr_loadgen_run_step(const vr_embedded_config_t *base, const vr_loadgen_config_t *loadgen,
+                               vr_loadgen_step_t *step) {
+    vr_embedded_config_t config = *base;
+    config.telemetry_rate_hz = step->rate_hz;
+    config.telemetry_batch_size = step->batch_size;
+    config.device_count = step->devices;
+
+    double offered_hz = 0;
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        offered_hz += vr_telemetry_stream_rate(&config, (vr_stream_kind_t)kind);
+    }
+
+    if (vr_fleet_start(&config, step->devices, loadgen->workers, loadgen->connections) != 0) {
+        fprintf(stderr, "[LOADGEN] Failed to start %u simulated devices\n", step->devices);
+        return -1;
+    }
+    bool measured = vr_loadgen_wait(loadgen->warmup_s);
+    if (measured) {
+        vr_loadgen_sample(&g_loadgen_before);
+        measured = vr_loadgen_wait(loadgen->step_s);
+    }
+    if (measured) {
+        vr_loadgen_sample(&g_loadgen_after);
+    }
+    vr_fleet_stop();
+    if (!measured) {
+        return -1;
+    }
+
+    const vr_fleet_stats_t *before = &g_loadgen_before.fleet;
+    const vr_fleet_stats_t *after = &g_loadgen_after.fleet;
+    uint64_t sampled = after->frames_sampled - before->frames_sampled;
+    uint64_t sent = after->publisher.frames_published - before->publisher.frames_published;
+    uint64_t messages = after->publisher.messages_published - before->publisher.messages_published;
+    uint64_t dropped = (after->frames_dropped - before->frames_dropped) +
+                       (after->publisher.frames_nacked - before->publisher.frames_nacked) +
+                       (after->publisher.frames_unconfirmed_lost - before->publisher.frames_unconfirmed_lost);
+    double seconds = (double)(g_loadgen_after.ns - g_loadgen_before.ns) / 1e9;
+    double cpu_s = g_loadgen_after.cpu_s - g_loadgen_before.cpu_s;
+
+    vr_histogram_summary_t publish;
+    vr_histogram_summary_t confirm;
+    vr_histogram_subtract(&g_loadgen_after.publish, &g_loadgen_before.publish);
+    vr_histogram_subtract(&g_loadgen_after.confirm, &g_loadgen_before.confirm);
+    vr_histogram_summarize(&g_loadgen_after.publish, &publish);
+    vr_histogram_summarize(&g_loadgen_after.confirm, &confirm);
+
+    step->seconds = seconds;
+    step->offered_fps = offered_hz * step->devices;
+    step->sent_fps = sent / seconds;
+    step->messages_per_s = messages / seconds;
+    step->drop_rate = sampled > 0 ? (double)dropped / sampled : 0.0;
+    step->publish_p99_us = publish.p99_us;
+    step->confirm_p50_us = confirm.p50_us;
+    step->confirm_p99_us = confirm.p99_us;
+    step->cpu_pct = cpu_s / seconds * 100.0;
+    step->cpu_us_per_frame = sent > 0 ? cpu_s * 1e6 / sent : 0.0;
+    step->saturated = step->sent_fps < step->offered_fps * VR_LOADGEN_MIN_THROUGHPUT ||
+                      step->drop_rate > VR_LOADGEN_MAX_DROP_RATE ||
+                      step->confirm_p99_us > loadgen->latency_ms * 1000.0;
+    return 0;
+}
+
+// Print one step's measurements
+static void vr_loadgen_print_step(const vr_loadgen_step_t *step, uint32_t index, uint32_t total) {
+    printf("[LOADGEN] Step %u/%u: %u devices x %u Hz, batch %u - sent %.0f/%.0f frames/s (%.1f%%), "
+           "%.0f msg/s, drops %.2f%%, confirm p50 %.2f / p99 %.2f ms, CPU %.1f%% (%.1f us/frame)%s\n",
+           index + 1, total, step->devices, step->rate_hz, step->batch_size, step->sent_fps, step->offered_fps,
+           step->offered_fps > 0 ? step->sent_fps / step->offered_fps * 100.0 : 0.0, step->messages_per_s,
+           step->drop_rate * 100.0, step->confirm_p50_us / 1000.0, step->confirm_p99_us / 1000.0,
+           step->cpu_pct, step->cpu_us_per_frame, step->saturated ? " SATURATED" : "");
+}
+
+// Print where each rate and batch size saturated
+static void vr_loadgen_print_knees(const vr_loadgen_step_t *steps, const vr_loadgen_series_t *series,
+                                   uint32_t series_count) {
+    int best = -1;
+    for (uint32_t i = 0; i < series_count; i++) {
+        const vr_loadgen_series_t *s = &series[i];
+        if (s->knee < 0 && s->saturated < 0) continue;  // Stopped before its first step
+
+        printf("[LOADGEN] %u Hz, batch %u: ", s->rate_hz, s->batch_size);
+        if (s->knee >= 0) {
+            if (best < 0 || steps[s->knee].sent_fps > steps[best].sent_fps) {
+                best = s->knee;
+            }
+            printf("%s %u devices (%.0f frames/s sustained)", s->saturated >= 0 ? "knee at" : "no saturation up to",
+                   steps[s->knee].devices, steps[s->knee].sent_fps);
+        } else {
+            printf("saturated from the first step");
+        }
+        if (s->saturated >= 0) {
+            const vr_loadgen_step_t *sat = &steps[s->saturated];
+            printf(", saturated at %u devices (sent %.1f%%, drops %.2f%%, confirm p99 %.2f ms)", sat->devices,
+                   sat->offered_fps > 0 ? sat->sent_fps / sat->offered_fps * 100.0 : 0.0, sat->drop_rate * 100.0,
+                   sat->confirm_p99_us / 1000.0);
+        }
+        printf("\n");
+    }
+    if (best >= 0) {
+        printf("[LOADGEN] Highest sustained throughput: %.0f frames/s, %.0f msg/s (%u devices x %u Hz, batch %u)\n",
+               steps[best].sent_fps, steps[best].messages_per_s, steps[best].devices, steps[best].rate_hz,
+               steps[best].batch_size);
+    }
+}
+
+// Write the steps as CSV
+static int vr_loadgen_write_csv(const char *path, const vr_loadgen_step_t *steps, uint32_t count) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "devices,rate_hz,batch_size,seconds,offered_fps,sent_fps,messages_per_s,drop_rate,"
+               "publish_p99_us,confirm_p50_us,confirm_p99_us,cpu_pct,cpu_us_per_frame,saturated\n");
+    for (uint32_t i = 0; i < count; i++) {
+        const vr_loadgen_step_t *s = &steps[i];
+        fprintf(f, "%u,%u,%u,%.3f,%.1f,%.1f,%.1f,%.6f,%.1f,%.1f,%.1f,%.1f,%.2f,%d\n", s->devices, s->rate_hz,
+                s->batch_size, s->seconds, s->offered_fps, s->sent_fps, s->messages_per_s, s->drop_rate,
+                s->publish_p99_us, s->confirm_p50_us, s->confirm_p99_us, s->cpu_pct, s->cpu_us_per_frame,
+                s->saturated ? 1 : 0);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// Write the steps and knees as JSON
+static int vr_loadgen_write_json(const char *path, const vr_loadgen_config_t *loadgen, const vr_loadgen_step_t *steps,
+                                 uint32_t count, const vr_loadgen_series_t *series, uint32_t series_count) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "{\"step_s\":%u,\"warmup_s\":%u,\"latency_ms\":%u,\"steps\":[", loadgen->step_s, loadgen->warmup_s,
+            loadgen->latency_ms);
+    for (uint32_t i = 0; i < count; i++) {
+        const vr_loadgen_step_t *s = &steps[i];
+        fprintf(f, "%s\n  {\"devices\":%u,\"rate_hz\":%u,\"batch_size\":%u,\"seconds\":%.3f,"
+                   "\"offered_fps\":%.1f,\"sent_fps\":%.1f,\"messages_per_s\":%.1f,\"drop_rate\":%.6f,"
+                   "\"publish_p99_us\":%.1f,\"confirm_p50_us\":%.1f,\"confirm_p99_us\":%.1f,"
+                   "\"cpu_pct\":%.1f,\"cpu_us_per_frame\":%.2f,\"saturated\":%s}",
+                i > 0 ? "," : "", s->devices, s->rate_hz, s->batch_size, s->seconds, s->offered_fps, s->sent_fps,
+                s->messages_per_s, s->drop_rate, s->publish_p99_us, s->confirm_p50_us, s->confirm_p99_us,
+                s->cpu_pct, s->cpu_us_per_frame, s->saturated ? "true" : "false");
+    }
+    fprintf(f, "\n],\"knees\":[");
+    bool first = true;
+    for (uint32_t i = 0; i < series_count; i++) {
+        const vr_loadgen_series_t *s = &series[i];
+        if (s->knee < 0 && s->saturated < 0) continue;
+
+        fprintf(f, "%s\n  {\"rate_hz\":%u,\"batch_size\":%u,", first ? "" : ",", s->rate_hz, s->batch_size);
+        if (s->knee >= 0) {
+            fprintf(f, "\"knee_devices\":%u,\"knee_sent_fps\":%.1f,", steps[s->knee].devices, steps[s->knee].sent_fps);
+        } else {
+            fprintf(f, "\"knee_devices\":null,\"knee_sent_fps\":null,");
+        }
+        if (s->saturated >= 0) {
+            fprintf(f, "\"saturated_devices\":%u}", steps[s->saturated].devices);
+        } else {
+            fprintf(f, "\"saturated_devices\":null}");
+        }
+        first = false;
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// Ramp batch sizes, rates and devices (innermost) and report each combination's knee
+int vr_loadgen_run(const vr_embedded_config_t *config, const vr_loadgen_config_t *loadgen) {
+    if (!config || !loadgen || loadgen->device_steps == 0 || loadgen->rate_steps == 0 ||
+        loadgen->batch_steps == 0) {
+        return -1;
+    }
+
+    uint32_t series_count = loadgen->batch_steps * loadgen->rate_steps;
+    uint32_t total = series_count * loadgen->device_steps;
+    vr_loadgen_step_t *steps = calloc(total, sizeof(*steps));
+    vr_loadgen_series_t *series = calloc(series_count, sizeof(*series));
+    if (!steps || !series) {
+        free(steps);
+        free(series);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < series_count; i++) {
+        series[i].knee = -1;
+        series[i].saturated = -1;
+    }
+    vr_clock_init();
+    printf("[LOADGEN] Up to %u steps of %u s after a %u s warm-up; saturation below %.0f%% of offered frames, "
+           "above %.1f%% drops or confirm p99 %u ms\n", total, loadgen->step_s, loadgen->warmup_s,
+           VR_LOADGEN_MIN_THROUGHPUT * 100.0, VR_LOADGEN_MAX_DROP_RATE * 100.0, loadgen->latency_ms);
+
+    int result = 0;
+    uint32_t count = 0;
+    for (uint32_t b = 0; b < loadgen->batch_steps && !g_loadgen_stop && result == 0; b++) {
+        for (uint32_t r = 0; r < loadgen->rate_steps && !g_loadgen_stop && result == 0; r++) {
+            vr_loadgen_series_t *s = &series[b * loadgen->rate_steps + r];
+            s->rate_hz = loadgen->rates_hz[r];
+            s->batch_size = loadgen->batch_sizes[b];
+
+            for (uint32_t d = 0; d < loadgen->device_steps && !g_loadgen_stop; d++) {
+                vr_loadgen_step_t *step = &steps[count];
+                step->devices = loadgen->devices[d];
+                step->rate_hz = s->rate_hz;
+                step->batch_size = s->batch_size;
+                if (vr_loadgen_run_step(config, loadgen, step) != 0) {
+                    if (!g_loadgen_stop) result = -1;
+                    break;
+                }
+                vr_loadgen_print_step(step, count, total);
+                if (step->saturated) {
+                    s->saturated = (int)count++;
+                    break;
+                }
+                s->knee = (int)count++;
+            }
+        }
+    }
+    if (g_loadgen_stop) {
+        printf("[LOADGEN] Stopped after %u steps\n", count);
+    }
+
+    vr_loadgen_print_knees(steps, series, series_count);
+    if (loadgen->csv_path) {
+        if (vr_loadgen_write_csv(loadgen->csv_path, steps, count) != 0) {
+            fprintf(stderr, "[LOADGEN] Failed to write %s\n", loadgen->csv_path);
+            result = -1;
+        } else {
+            printf("[LOADGEN] Wrote %u steps to %s\n", count, loadgen->csv_path);
+        }
+    }
+    if (loadgen->json_path) {
+        if (vr_loadgen_write_json(loadgen->json_path, loadgen, steps, count, series, series_count) != 0) {
+            fprintf(stderr, "[LOADGEN] Failed to write %s\n", loadgen->json_path);
+            result = -1;
+        } else {
+            printf("[LOADGEN] Wrote %u steps to %s\n", count, loadgen->json_path);
+        }
+    }
+
+    free(steps);
+    free(series);
+    return result;
+}
@@ -0,0 +1,326 @@
+#include "vr_telemetry.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// Asynchronous, rate-limited logging for the real-time paths.
+//
+// VR_LOG formats a record straight into a slot of a bounded lock-free ring
+// (Vyukov's per-slot sequence scheme, so any thread may produce) and returns;
+// a background thread writes the records to stdout or stderr. Producers never
+// block on the terminal: when the ring is full the record is dropped and
+// counted. Each call site keeps its own window of VR_LOG_WINDOW_MS and writes
+// at most VR_LOG_BURST records per window; the rest are counted and reported
+// as one "message repeated N times" line when the window closes, either by
+// the next call from that site or by the writer thread if the site went quiet.
+// The writer blocks on an eventfd doorbell that producers ring only while it
+// is waiting, and wakes on a timer only while some site has suppressed
+// records to report. Before vr_log_init and after vr_log_shutdown records
+// are written directly.
+
+typedef struct {
+    uint64_t sequence;        // Slot position + 1 once filled, + VR_LOG_RING_SIZE once read
+    vr_log_level_t level;
+    uint32_t length;
+    char text[VR_LOG_RECORD_MAX];
+} vr_log_record_t;
+
+static vr_log_record_t g_log_ring[VR_LOG_RING_SIZE];
+static uint64_t g_log_head __attribute__((aligned(VR_CACHE_LINE_SIZE))) = 0;  // Next slot to claim
+static uint64_t g_log_tail __attribute__((aligned(VR_CACHE_LINE_SIZE))) = 0;  // Next slot to write out; writer thread only
+
+static vr_log_site_t *g_log_sites = NULL;  // Call sites seen so far
+static vr_log_stats_t g_log_stats;
+static int g_log_running = 0;
+static int g_log_submitters = 0;     // Producers between the running check and publishing their record
+static pthread_t g_log_thread;
+static int g_log_wake_fd = -1;       // eventfd doorbell of the writer (-1 = poll every VR_LOG_DRAIN_MS)
+static int g_log_waiting = 0;        // Writer is blocked on its doorbell
+
+// Write one record to its stream
+static void vr_log_emit(vr_log_level_t level, const char *text, size_t length) {
+    fwrite(text, 1, length, level == VR_LOG_ERROR ? stderr : stdout);
+    __atomic_fetch_add(&g_log_stats.written, 1, __ATOMIC_RELAXED);
+}
+
+// Ring the writer's doorbell if it is blocked waiting for records
+static void vr_log_wake_writer(void) {
+    // Pairs with the fence in vr_log_wait: either the writer sees the record
+    // before blocking, or this sees it waiting
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_log_waiting, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&g_log_waiting, 0, __ATOMIC_RELAXED)) {
+        uint64_t one = 1;
+        ssize_t written = write(g_log_wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+// Queue a formatted record, or write it directly while the writer thread is not running
+static void vr_log_vsubmit(vr_log_level_t level, const char *format, va_list args) {
+    // Pairs with vr_log_shutdown: either this sees the writer stopping, or
+    // shutdown sees this submitter and waits for its record before the final drain
+    __atomic_fetch_add(&g_log_submitters, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&g_log_running, __ATOMIC_SEQ_CST)) {
+        __atomic_fetch_sub(&g_log_submitters, 1, __ATOMIC_RELEASE);
+        char text[VR_LOG_RECORD_MAX];
+        int len = vsnprintf(text, sizeof(text), format, args);
+        if (len < 0) return;
+        vr_log_emit(level, text, (size_t)len < sizeof(text) ? (size_t)len : sizeof(text) - 1);
+        return;
+    }
+
+    uint64_t pos = __atomic_load_n(&g_log_head, __ATOMIC_RELAXED);
+    vr_log_record_t *slot;
+    for (;;) {
+        slot = &g_log_ring[pos & (VR_LOG_RING_SIZE - 1)];
+        int64_t diff = (int64_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&g_log_head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&g_log_stats.dropped, 1, __ATOMIC_RELAXED);  // Writer is behind
+            __atomic_fetch_sub(&g_log_submitters, 1, __ATOMIC_RELEASE);
+            return;
+        } else {
+            pos = __atomic_load_n(&g_log_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    int len = vsnprintf(slot->text, sizeof(slot->text), format, args);
+    slot->level = level;
+    slot->length = len < 0 ? 0 : ((size_t)len < sizeof(slot->text) ? (uint32_t)len : sizeof(slot->text) - 1);
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+    vr_log_wake_writer();
+    __atomic_fetch_sub(&g_log_submitters, 1, __ATOMIC_RELEASE);
+}
+
+// Queue a record outside any call site's rate limit
+static void vr_log_submit(vr_log_level_t level, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vr_log_vsubmit(level, format, args);
+    va_end(args);
+}
+
+// Close a site's window if it has expired, reporting what it suppressed
+static void vr_log_site_roll(vr_log_site_t *site, uint64_t now_us) {
+    uint64_t start = __atomic_load_n(&site->window_start_us, __ATOMIC_RELAXED);
+    if (now_us - start < (uint64_t)VR_LOG_WINDOW_MS * 1000) {
+        return;
+    }
+    if (!__atomic_compare_exchange_n(&site->window_start_us, &start, now_us, false,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;  // Another thread closed it
+    }
+
+    __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+    uint32_t suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+    if (suppressed == 0) {
+        return;
+    }
+
+    // Repeat the record's "[TAG] " prefix, if it has one
+    const char *format = __atomic_load_n(&site->format, __ATOMIC_RELAXED);
+    int tag = 0;
+    if (format && format[0] == '[') {
+        const char *end = strchr(format, ']');
+        if (end) tag = (int)(end - format) + 1;
+    }
+    const char *file = strrchr(site->file, '/');
+    vr_log_submit(site->level, "%.*s%sMessage repeated %u times (%s:%d)\n",
+                  tag, format ? format : "", tag ? " " : "", suppressed,
+                  file ? file + 1 : site->file, site->line);
+}
+
+// Register a call site so the writer thread can close its windows
+static void vr_log_site_register(vr_log_site_t *site) {
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&site->registered, &expected, 1, false,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+    site->next = __atomic_load_n(&g_log_sites, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&g_log_sites, &site->next, site, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Rate-limited write from one call site (use VR_LOG)
+void vr_log_write(vr_log_site_t *site, const char *format, ...) {
+    uint64_t now = vr_clock_monotonic_us();
+    if (!__atomic_load_n(&site->registered, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&site->format, format, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->window_start_us, now, __ATOMIC_RELAXED);
+        vr_log_site_register(site);
+    }
+    vr_log_site_roll(site, now);
+
+    if (__atomic_fetch_add(&site->count, 1, __ATOMIC_RELAXED) >= VR_LOG_BURST) {
+        // The first suppressed record makes the writer arm a timer for the window's end
+        if (__atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED) == 0) {
+            vr_log_wake_writer();
+        }
+        __atomic_fetch_add(&g_log_stats.suppressed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vr_log_vsubmit(site->level, format, args);
+    va_end(args);
+}
+
+// Write out every queued record; returns the number written
+static uint32_t vr_log_drain(void) {
+    uint32_t written = 0;
+    for (;;) {
+        vr_log_record_t *slot = &g_log_ring[g_log_tail & (VR_LOG_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != g_log_tail + 1) {
+            break;
+        }
+        vr_log_emit(slot->level, slot->text, slot->length);
+        __atomic_store_n(&slot->sequence, g_log_tail + VR_LOG_RING_SIZE, __ATOMIC_RELEASE);
+        g_log_tail++;
+        written++;
+    }
+    if (written > 0) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+    return written;
+}
+
+// A record is queued at the tail
+static bool vr_log_pending(void) {
+    const vr_log_record_t *slot = &g_log_ring[g_log_tail & (VR_LOG_RING_SIZE - 1)];
+    return __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) == g_log_tail + 1;
+}
+
+// Close the windows of sites that went quiet; returns the time until the
+// next window with suppressed records closes (UINT64_MAX when there is none)
+static uint64_t vr_log_roll_sites(void) {
+    uint64_t now = vr_clock_monotonic_us();
+    uint64_t window_us = (uint64_t)VR_LOG_WINDOW_MS * 1000;
+    uint64_t timeout_us = UINT64_MAX;
+    for (vr_log_site_t *site = __atomic_load_n(&g_log_sites, __ATOMIC_ACQUIRE); site; site = site->next) {
+        if (__atomic_load_n(&site->suppressed, __ATOMIC_RELAXED) == 0) continue;
+
+        vr_log_site_roll(site, now);
+        if (__atomic_load_n(&site->suppressed, __ATOMIC_RELAXED) == 0) continue;
+        uint64_t elapsed = now - __atomic_load_n(&site->window_start_us, __ATOMIC_RELAXED);
+        uint64_t remaining = elapsed < window_us ? window_us - elapsed : 0;
+        if (remaining < timeout_us) timeout_us = remaining;
+    }
+    return timeout_us;
+}
+
+// Sleep until a record is queued, a site starts suppressing, or the next
+// window with suppressed records closes
+static void vr_log_wait(uint64_t timeout_us) {
+    if (g_log_wake_fd < 0) {
+        vr_delay_ms(VR_LOG_DRAIN_MS);
+        return;
+    }
+
+    __atomic_store_n(&g_log_waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!vr_log_pending() && __atomic_load_n(&g_log_running, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd = { .fd = g_log_wake_fd, .events = POLLIN };
+        struct timespec timeout = {
+            .tv_sec = (time_t)(timeout_us / 1000000),
+            .tv_nsec = (long)(timeout_us % 1000000) * 1000,
+        };
+        ppoll(&pfd, 1, timeout_us == UINT64_MAX ? NULL : &timeout, NULL);
+    }
+    __atomic_store_n(&g_log_waiting, 0, __ATOMIC_RELAXED);
+
+    uint64_t rung;
+    ssize_t drained = read(g_log_wake_fd, &rung, sizeof(rung));
+    (void)drained;
+}
+
+// Writer thread: drain the ring, close the windows of sites that went quiet
+static void *vr_log_thread(void *arg) {
+    (void)arg;
+    while (__atomic_load_n(&g_log_running, __ATOMIC_ACQUIRE)) {
+        if (vr_log_drain() > 0) {
+            continue;
+        }
+        uint64_t timeout_us = vr_log_roll_sites();
+        if (!vr_log_pending()) {
+            vr_log_wait(timeout_us);
+        }
+    }
+    return NULL;
+}
+
+// Start the writer thread
+int vr_log_init(void) {
+    if (__atomic_load_n(&g_log_running, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    for (uint64_t pos = g_log_head; pos < g_log_head + VR_LOG_RING_SIZE; pos++) {
+        g_log_ring[pos & (VR_LOG_RING_SIZE - 1)].sequence = pos;
+    }
+    g_log_tail = g_log_head;
+    g_log_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    __atomic_store_n(&g_log_running, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&g_log_thread, NULL, vr_log_thread, NULL) != 0) {
+        __atomic_store_n(&g_log_running, 0, __ATOMIC_RELEASE);
+        if (g_log_wake_fd >= 0) close(g_log_wake_fd);
+        g_log_wake_fd = -1;
+        fprintf(stderr, "[LOG] Failed to start log writer, logging synchronously\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Stop the writer thread after writing out everything queued. Records
+// from threads still running are written directly from here on; those
+// that already claimed a slot are waited for and written by the final drain.
+void vr_log_shutdown(void) {
+    if (!__atomic_load_n(&g_log_running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    __atomic_store_n(&g_log_running, 0, __ATOMIC_SEQ_CST);
+    if (g_log_wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(g_log_wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+    pthread_join(g_log_thread, NULL);
+    while (__atomic_load_n(&g_log_submitters, __ATOMIC_SEQ_CST) > 0) {
+        sched_yield();  // A producer is formatting a record into its slot
+    }
+    if (g_log_wake_fd >= 0) close(g_log_wake_fd);
+    g_log_wake_fd = -1;
+
+    // Write out the tail of the ring, then what every site still had suppressed
+    vr_log_drain();
+    for (vr_log_site_t *site = __atomic_load_n(&g_log_sites, __ATOMIC_ACQUIRE); site; site = site->next) {
+        if (__atomic_load_n(&site->suppressed, __ATOMIC_RELAXED) > 0) {
+            __atomic_store_n(&site->window_start_us, 0, __ATOMIC_RELAXED);
+            vr_log_site_roll(site, vr_clock_monotonic_us());
+        }
+    }
+    fflush(stdout);
+}
+
+// Records written, suppressed by rate limits and dropped on a full ring
+void vr_log_get_stats(vr_log_stats_t *stats) {
+    stats->written = __atomic_load_n(&g_log_stats.written, __ATOMIC_RELAXED);
+    stats->suppressed = __atomic_load_n(&g_log_stats.suppressed, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&g_log_stats.dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,272 @@
+#include "vr_telemetry.h"
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+// Latency histograms and counters for the sampling and publishing paths.
+//
+// Recording is a handful of relaxed atomic adds, so any thread may record
+// without locks; readers see a slightly racy but never torn view, which is
+// fine for monitoring.
+
+static vr_histogram_t g_histograms[VR_METRIC_COUNT];
+static volatile sig_atomic_t g_dump_requested = 0;
+
+static const char *g_metric_names[VR_METRIC_COUNT] = {
+    "sensor_update",
+    "serialize",
+    "publish",
+    "loop",
+    "sample_to_publish",
+    "publish_to_ack",
+};
+
+// Map a value to its histogram bucket
+static uint32_t vr_histogram_index(uint64_t value) {
+    if (value < VR_HIST_SUB_BUCKETS) {
+        return (uint32_t)value;
+    }
+
+    uint32_t exponent = 63 - (uint32_t)__builtin_clzll(value);
+    if (exponent > VR_HIST_MAX_EXPONENT) {
+        return VR_HIST_BUCKETS - 1;
+    }
+
+    uint32_t shift = exponent - VR_HIST_SUB_BUCKET_BITS;
+    uint32_t sub = (uint32_t)(value >> shift) - VR_HIST_SUB_BUCKETS;
+    return (shift + 1) * VR_HIST_SUB_BUCKETS + sub;
+}
+
+// Highest value that maps to a bucket
+static uint64_t vr_histogram_bucket_high(uint32_t index) {
+    if (index < VR_HIST_SUB_BUCKETS) {
+        return index;
+    }
+
+    uint32_t shift = index / VR_HIST_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(index % VR_HIST_SUB_BUCKETS + VR_HIST_SUB_BUCKETS) << shift;
+    return low + ((uint64_t)1 << shift) - 1;
+}
+
+// Record one sample
+void vr_histogram_record(vr_histogram_t *hist, uint64_t value_ns) {
+    __atomic_fetch_add(&hist->buckets[vr_histogram_index(value_ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->sum_ns, value_ns, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+    while (value_ns > max &&
+           !__atomic_compare_exchange_n(&hist->max_ns, &max, value_ns, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Value at or below which `percentile` percent of samples fall
+uint64_t vr_histogram_percentile(const vr_histogram_t *hist, double percentile) {
+    uint64_t count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t)(percentile / 100.0 * (double)count + 0.5);
+    if (target < 1) target = 1;
+    if (target > count) target = count;
+
+    uint64_t max = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < VR_HIST_BUCKETS; i++) {
+        seen += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        if (seen >= target) {
+            uint64_t high = vr_histogram_bucket_high(i);
+            return high < max ? high : max;
+        }
+    }
+    return max;
+}
+
+// Summarize a histogram in microseconds
+void vr_histogram_summarize(const vr_histogram_t *hist, vr_histogram_summary_t *summary) {
+    memset(summary, 0, sizeof(*summary));
+    summary->count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    if (summary->count == 0) {
+        return;
+    }
+
+    summary->mean_us = (double)__atomic_load_n(&hist->sum_ns, __ATOMIC_RELAXED) / summary->count / 1000.0;
+    summary->p50_us = vr_histogram_percentile(hist, 50.0) / 1000.0;
+    summary->p90_us = vr_histogram_percentile(hist, 90.0) / 1000.0;
+    summary->p99_us = vr_histogram_percentile(hist, 99.0) / 1000.0;
+    summary->p999_us = vr_histogram_percentile(hist, 99.9) / 1000.0;
+    summary->max_us = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED) / 1000.0;
+}
+
+// Turn a copy of a histogram into the samples recorded since an earlier copy
+// (max_ns stays the all-time maximum, so percentiles are bounded by bucket edges)
+void vr_histogram_subtract(vr_histogram_t *hist, const vr_histogram_t *earlier) {
+    for (uint32_t i = 0; i < VR_HIST_BUCKETS; i++) {
+        hist->buckets[i] -= hist->buckets[i] >= earlier->buckets[i] ? earlier->buckets[i] : hist->buckets[i];
+    }
+    hist->count -= hist->count >= earlier->count ? earlier->count : hist->count;
+    hist->sum_ns -= hist->sum_ns >= earlier->sum_ns ? earlier->sum_ns : hist->sum_ns;
+}
+
+// Record a latency sample for one pipeline stage
+void vr_metrics_record(vr_metric_t metric, uint64_t value_ns) {
+    if (metric >= VR_METRIC_COUNT) return;
+    vr_histogram_record(&g_histograms[metric], value_ns);
+}
+
+// Get a stage name for reports
+const char *vr_metrics_name(vr_metric_t metric) {
+    return metric < VR_METRIC_COUNT ? g_metric_names[metric] : "unknown";
+}
+
+// Copy one stage's histogram; count may trail the buckets by samples recorded meanwhile
+void vr_metrics_get_histogram(vr_metric_t metric, vr_histogram_t *copy) {
+    if (!copy) return;
+    if (metric >= VR_METRIC_COUNT) {
+        memset(copy, 0, sizeof(*copy));
+        return;
+    }
+
+    const vr_histogram_t *hist = &g_histograms[metric];
+    for (uint32_t i = 0; i < VR_HIST_BUCKETS; i++) {
+        copy->buckets[i] = __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+    }
+    copy->count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    copy->sum_ns = __atomic_load_n(&hist->sum_ns, __ATOMIC_RELAXED);
+    copy->max_ns = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+}
+
+// Collect counters from the telemetry pipeline and summarize all histograms
+void vr_metrics_get_snapshot(vr_metrics_snapshot_t *snapshot) {
+    if (!snapshot) return;
+
+    vr_telemetry_stats_t telemetry;
+    vr_publisher_stats_t publisher;
+    vr_fleet_stats_t fleet;
+    vr_telemetry_get_stats(&telemetry);
+    vr_rabbitmq_get_stats(&publisher);
+    vr_fleet_get_stats(&fleet);
+
+    snapshot->frames_produced = telemetry.ring.pushed + fleet.frames_sampled;
+    snapshot->frames_sent = publisher.frames_published + fleet.publisher.frames_published;
+    snapshot->frames_dropped = telemetry.ring.dropped + telemetry.spill.dropped +
+                               telemetry.frames_expired + telemetry.frames_discarded +
+                               publisher.frames_nacked + publisher.frames_unconfirmed_lost +
+                               fleet.frames_dropped + fleet.publisher.frames_nacked +
+                               fleet.publisher.frames_unconfirmed_lost;
+    snapshot->frames_retried = telemetry.frames_replayed;
+    vr_telemetry_get_rate_control(&snapshot->rate_control);
+
+    // Per-connection throughput of whichever publishers carry telemetry
+    if (fleet.connections > 0) {
+        snapshot->shard_count = fleet.connections;
+        memcpy(snapshot->shards, fleet.shards, fleet.connections * sizeof(fleet.shards[0]));
+    } else {
+        snapshot->shard_count = vr_rabbitmq_shard_count();
+        for (uint32_t i = 0; i < snapshot->shard_count; i++) {
+            vr_rabbitmq_get_shard_stats(i, &snapshot->shards[i]);
+        }
+    }
+
+    for (int i = 0; i < VR_METRIC_COUNT; i++) {
+        vr_histogram_summarize(&g_histograms[i], &snapshot->latency[i]);
+    }
+}
+
+// Print a human-readable metrics report
+void vr_metrics_print(void) {
+    vr_metrics_snapshot_t snapshot;
+    vr_metrics_get_snapshot(&snapshot);
+
+    printf("[METRICS] Frames produced: %lu, sent: %lu, dropped: %lu, retried: %lu\n",
+           snapshot.frames_produced, snapshot.frames_sent,
+           snapshot.frames_dropped, snapshot.frames_retried);
+    for (int i = 0; i < VR_METRIC_COUNT; i++) {
+        const vr_histogram_summary_t *h = &snapshot.latency[i];
+        printf("[METRICS] %-17s n=%-8lu mean %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f us\n",
+               vr_metrics_name((vr_metric_t)i), h->count, h->mean_us,
+               h->p50_us, h->p90_us, h->p99_us, h->p999_us, h->max_us);
+    }
+    if (snapshot.rate_control.enabled) {
+        const vr_ratectl_stats_t *rc = &snapshot.rate_control;
+        printf("[METRICS] frame rate        %u Hz (%u-%u Hz), decreases %lu, increases %lu, last cause: %s\n",
+               rc->rate_hz, rc->min_hz, rc->max_hz, rc->decreases, rc->increases,
+               vr_ratectl_cause_name(rc->last_cause));
+    }
+    double uptime_s = vr_get_system_tick() / 1000.0;
+    for (uint32_t i = 0; snapshot.shard_count > 1 && i < snapshot.shard_count; i++) {
+        const vr_publisher_stats_t *shard = &snapshot.shards[i];
+        printf("[METRICS] shard %-11u messages %-8lu frames %-8lu %8.1f frames/s, connection losses %lu\n",
+               i, shard->messages_published, shard->frames_published,
+               uptime_s > 0 ? shard->frames_published / uptime_s : 0.0, shard->connection_losses);
+    }
+}
+
+// Serialize the current metrics as a JSON object
+int vr_metrics_format_json(char *buffer, size_t size) {
+    if (!buffer || size == 0) return -1;
+
+    vr_metrics_snapshot_t snapshot;
+    vr_metrics_get_snapshot(&snapshot);
+
+    int len = snprintf(buffer, size,
+        "{\"timestamp_us\":%lu,\"uptime_ms\":%u,"
+        "\"frames_produced\":%lu,\"frames_sent\":%lu,\"frames_dropped\":%lu,\"frames_retried\":%lu,"
+        "\"latency_us\":{",
+        vr_get_timestamp_us(), vr_get_system_tick(),
+        snapshot.frames_produced, snapshot.frames_sent,
+        snapshot.frames_dropped, snapshot.frames_retried);
+
+    for (int i = 0; i < VR_METRIC_COUNT && len >= 0 && (size_t)len < size; i++) {
+        const vr_histogram_summary_t *h = &snapshot.latency[i];
+        len += snprintf(buffer + len, size - (size_t)len,
+            "%s\"%s\":{\"count\":%lu,\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,"
+            "\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+            i > 0 ? "," : "", vr_metrics_name((vr_metric_t)i), h->count, h->mean_us,
+            h->p50_us, h->p90_us, h->p99_us, h->p999_us, h->max_us);
+    }
+
+    if (len >= 0 && (size_t)len < size) {
+        const vr_ratectl_stats_t *rc = &snapshot.rate_control;
+        len += snprintf(buffer + len, size - (size_t)len,
+            "},\"rate_control\":{\"enabled\":%s,\"rate_hz\":%u,\"min_hz\":%u,\"max_hz\":%u,"
+            "\"decreases\":%lu,\"increases\":%lu,\"last_cause\":\"%s\"},\"shards\":[",
+            rc->enabled ? "true" : "false", rc->rate_hz, rc->min_hz, rc->max_hz,
+            rc->decreases, rc->increases, vr_ratectl_cause_name(rc->last_cause));
+    }
+
+    // Throughput averaged over the uptime; consumers diff successive reports for rates
+    double uptime_s = vr_get_system_tick() / 1000.0;
+    for (uint32_t i = 0; i < snapshot.shard_count && len >= 0 && (size_t)len < size; i++) {
+        const vr_publisher_stats_t *shard = &snapshot.shards[i];
+        len += snprintf(buffer + len, size - (size_t)len,
+            "%s{\"messages\":%lu,\"frames\":%lu,\"frames_per_s\":%.1f,\"connection_losses\":%lu}",
+            i > 0 ? "," : "", shard->messages_published, shard->frames_published,
+            uptime_s > 0 ? shard->frames_published / uptime_s : 0.0, shard->connection_losses);
+    }
+
+    if (len >= 0 && (size_t)len < size) {
+        len += snprintf(buffer + len, size - (size_t)len, "]}");
+    }
+
+    if (len < 0 || (size_t)len >= size) {
+        return -1;
+    }
+    return len;
+}
+
+// Ask the main loop to print a report (async-signal-safe)
+void vr_metrics_request_dump(void) {
+    g_dump_requested = 1;
+}
+
+// Check and clear a pending report request
+bool vr_metrics_dump_pending(void) {
+    if (!g_dump_requested) {
+        return false;
+    }
+    g_dump_requested = 0;
+    return true;
+}
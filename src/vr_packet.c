@@ -0,0 +1,104 @@
+#include "vr_telemetry.h"
+#include <stddef.h>
+#include <string.h>
+
+// Packet snapshots and structure-of-arrays columns.
+//
+// A snapshot is a seqlock: the writer makes the sequence odd, stores the
+// packet and makes it even again; a reader copies the packet between two
+// reads of the sequence and retries unless both saw the same even value.
+// The packet is copied as 64-bit words with relaxed atomics, so a reader
+// racing a publish sees stale or mixed words and retries rather than
+// racing, and the writer never waits for readers.
+//
+// Columns transpose packets into one array per field for loops that work
+// across frames; the float fields are addressed through g_packet_floats.
+
+#define VR_PACKET_WORDS (sizeof(vr_telemetry_packet_t) / sizeof(uint64_t))
+
+// The float fields, in VR_WIRE_TYPE_FRAME order
+#define P(field) offsetof(vr_telemetry_packet_t, field)
+static const size_t g_packet_floats[VR_PACKET_FLOATS] = {
+    P(head_position.x), P(head_position.y), P(head_position.z),
+    P(head_orientation.x), P(head_orientation.y), P(head_orientation.z), P(head_orientation.w),
+    P(head_acceleration.x), P(head_acceleration.y), P(head_acceleration.z),
+    P(head_angular_velocity.x), P(head_angular_velocity.y), P(head_angular_velocity.z),
+    P(left_eye.x), P(left_eye.y), P(left_eye.pupil_diameter),
+    P(right_eye.x), P(right_eye.y), P(right_eye.pupil_diameter),
+    P(left_hand.x), P(left_hand.y), P(left_hand.z),
+    P(left_hand.orientation.x), P(left_hand.orientation.y), P(left_hand.orientation.z),
+    P(left_hand.orientation.w), P(left_hand.grip_strength),
+    P(right_hand.x), P(right_hand.y), P(right_hand.z),
+    P(right_hand.orientation.x), P(right_hand.orientation.y), P(right_hand.orientation.z),
+    P(right_hand.orientation.w), P(right_hand.grip_strength),
+    P(cpu_usage), P(gpu_usage), P(temperature),
+};
+#undef P
+
+// Publish a packet (single writer)
+void vr_snapshot_publish(vr_packet_snapshot_t *snap, const vr_telemetry_packet_t *packet) {
+    uint64_t *dst = (uint64_t *)&snap->packet;
+    const uint64_t *src = (const uint64_t *)packet;
+    uint32_t seq = __atomic_load_n(&snap->seq, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&snap->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < VR_PACKET_WORDS; i++) {
+        __atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&snap->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Copy the latest published packet (any thread)
+void vr_snapshot_read(const vr_packet_snapshot_t *snap, vr_telemetry_packet_t *packet) {
+    const uint64_t *src = (const uint64_t *)&snap->packet;
+    uint64_t *dst = (uint64_t *)packet;
+    uint32_t begin, end;
+
+    do {
+        begin = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+        for (size_t i = 0; i < VR_PACKET_WORDS; i++) {
+            dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&snap->seq, __ATOMIC_RELAXED);
+    } while ((begin & 1) || begin != end);
+}
+
+// Copy the float fields of a packet into VR_PACKET_FLOATS values
+void vr_packet_get_floats(const vr_telemetry_packet_t *packet, float *values) {
+    const uint8_t *base = (const uint8_t *)packet;
+    for (int i = 0; i < VR_PACKET_FLOATS; i++) {
+        memcpy(&values[i], base + g_packet_floats[i], sizeof(float));
+    }
+}
+
+// Write VR_PACKET_FLOATS values into the float fields of a packet
+void vr_packet_set_floats(vr_telemetry_packet_t *packet, const float *values) {
+    uint8_t *base = (uint8_t *)packet;
+    for (int i = 0; i < VR_PACKET_FLOATS; i++) {
+        memcpy(base + g_packet_floats[i], &values[i], sizeof(float));
+    }
+}
+
+// Transpose up to VR_COLUMNS_MAX_FRAMES packets into columns; returns the frames loaded
+uint32_t vr_columns_load(vr_packet_columns_t *cols, const vr_telemetry_packet_t *packets, uint32_t count) {
+    if (count > VR_COLUMNS_MAX_FRAMES) count = VR_COLUMNS_MAX_FRAMES;
+
+    // Field-major, so each column is written with unit stride
+    for (int f = 0; f < VR_PACKET_FLOATS; f++) {
+        size_t offset = g_packet_floats[f];
+        for (uint32_t i = 0; i < count; i++) {
+            memcpy(&cols->values[f][i], (const uint8_t *)&packets[i] + offset, sizeof(float));
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        cols->timestamp_us[i] = packets[i].timestamp_us;
+        cols->monotonic_us[i] = packets[i].monotonic_us;
+        cols->frame_id[i] = packets[i].frame_id;
+        cols->battery_level[i] = packets[i].battery_level;
+        cols->flags[i] = packets[i].flags;
+    }
+    cols->count = count;
+    return count;
+}
@@ -7,24 +7,159 @@
 #include <string.h>
 #include <unistd.h>
 
-// RabbitMQ connection state
-static amqp_connection_state_t g_conn = NULL;
-static amqp_socket_t *g_socket = NULL;
-static bool g_connected = false;
-
-// Connection parameters
+// Connection parameters (shared by every publisher)
 static char g_host[256] = "localhost";
 static int g_port = 5672;
 static char g_username[64] = "guest";
 static char g_password[64] = "guest";
 static char g_vhost[64] = "/";
 static char g_exchange[64] = "vr_telemetry";
-static char g_routing_key[64] = "telemetry.data";
+static size_t g_exchange_len = sizeof("vr_telemetry") - 1;
+static char g_routing_key[VR_ROUTING_KEY_MAX] = "telemetry.data";
+static char g_metrics_routing_key[64] = VR_METRICS_DEFAULT_ROUTING_KEY;
+static size_t g_metrics_routing_key_len = sizeof(VR_METRICS_DEFAULT_ROUTING_KEY) - 1;
+static bool g_parameters_set = false;     // vr_rabbitmq_configure() has set up the streams
 
-// Initialize RabbitMQ connection
-int vr_rabbitmq_init(const char *host, int port, const char *username, 
-                     const char *password, const char *vhost, 
-                     const char *exchange, const char *routing_key) {
+// Message encoding
+static vr_wire_format_t g_wire_format = VR_WIRE_FORMAT_JSON;
+static uint32_t g_keyframe_interval = VR_DELTA_DEFAULT_KEYFRAME_INTERVAL;
+static uint32_t g_position_um = VR_DELTA_DEFAULT_POSITION_UM;
+static uint32_t g_quat_bits = VR_DELTA_DEFAULT_QUAT_BITS;
+
+// Delivery guarantees
+static vr_delivery_mode_t g_delivery_mode = VR_DELIVERY_PERSISTENT;
+static uint32_t g_props_generation = 1;  // Bumped when cached publish arguments go stale
+static bool g_confirms_enabled = false;
+static uint32_t g_confirm_window = VR_CONFIRM_DEFAULT_WINDOW;
+
+// Reconnect backoff
+static uint32_t g_reconnect_initial_ms = VR_RECONNECT_INITIAL_MS;
+static uint32_t g_reconnect_max_ms = VR_RECONNECT_MAX_MS;
+
+// Headers of telemetry messages, in table order
+enum {
+    VR_HEADER_FRAME_COUNT,         // Frames in the message, so consumers can unpack batches
+    VR_HEADER_PUBLISHED_US,        // Wall-clock publish time, for end-to-end latency
+    VR_HEADER_COUNT
+};
+
+// Publisher confirm tracking, indexed by delivery tag
+typedef struct {
+    uint64_t delivery_tag;         // 0 = slot settled
+    uint64_t published_ns;         // Monotonic publish time, for the publish_to_ack histogram
+    uint32_t frames;
+    vr_stream_t *stream;           // Resynced with a keyframe if the message is nacked
+} vr_confirm_slot_t;
+
+// One AMQP connection and channel. A publisher is driven by one thread at a
+// time; only its statistics and connected flag may be read from elsewhere.
+struct vr_publisher {
+    amqp_connection_state_t conn;
+    amqp_socket_t *socket;
+    bool connected;
+    bool configured;               // Opened; reconnect after a loss until closed
+    uint32_t epoch;                // Incremented on every successful connect
+    
+    // Reconnect state machine (driven by vr_publisher_service)
+    uint32_t reconnect_backoff_ms;
+    uint64_t next_reconnect_us;    // Monotonic (vr_clock_monotonic_us), immune to wall-clock steps
+    
+    vr_confirm_slot_t confirm_slots[VR_CONFIRM_MAX_WINDOW];
+    uint64_t next_delivery_tag;    // Tag the broker will assign to the next publish
+    uint64_t oldest_unconfirmed;   // Lowest tag that may still be outstanding
+    uint32_t confirms_in_flight;
+    
+    vr_publisher_stats_t stats;    // Written by the owning thread, read by anyone
+    
+    // Publish arguments built once by vr_publisher_prepare(); per message only
+    // the header values and timestamp change, so publishing formats no strings
+    // and scans none
+    uint32_t props_generation;     // g_props_generation these were built for
+    amqp_bytes_t exchange;
+    amqp_table_entry_t headers[VR_HEADER_COUNT];
+    amqp_basic_properties_t telemetry_props;
+    amqp_basic_properties_t metrics_props;
+    
+    // Encoders write straight into this buffer and publish it with its exact
+    // length; librabbitmq sends the body from here without copying it
+    char message[VR_BATCH_MAX_MESSAGE_SIZE];  // Sized for a full JSON batch
+};
+
+// Default publisher and streams behind the vr_rabbitmq_* functions
+static vr_publisher_t g_publisher = {
+    .next_delivery_tag = 1,
+    .oldest_unconfirmed = 1,
+    .reconnect_backoff_ms = VR_RECONNECT_INITIAL_MS,
+};
+static vr_stream_t g_streams[VR_STREAM_KIND_COUNT];
+
+// Publisher shards: g_publisher is shard 0 and also carries metrics.
+// Resized only before the publisher threads start (vr_rabbitmq_set_connections).
+static vr_publisher_t *g_shards[VR_SHARD_MAX] = { &g_publisher };
+static uint32_t g_shard_count = 1;
+static uint32_t g_stream_shards[VR_STREAM_KIND_COUNT];  // Shard of each stream kind
+static char g_stream_keys[VR_STREAM_KIND_COUNT][VR_ROUTING_KEY_MAX];  // Overrides; "" derives from g_routing_key
+
+// Name and sections of each stream kind, indexed by vr_stream_kind_t
+static const struct {
+    const char *name;
+    uint8_t sections;
+} g_stream_kinds[VR_STREAM_KIND_COUNT] = {
+    [VR_STREAM_FRAME]  = { "frame",  VR_SECTION_ALL },
+    [VR_STREAM_POSE]   = { "pose",   VR_SECTION_HEAD | VR_SECTION_HANDS },
+    [VR_STREAM_EYES]   = { "eyes",   VR_SECTION_EYES },
+    [VR_STREAM_STATUS] = { "status", VR_SECTION_STATUS },
+};
+
+static int vr_publisher_connect(vr_publisher_t *pub);
+
+// Allocate a disconnected publisher
+vr_publisher_t *vr_publisher_create(void) {
+    vr_publisher_t *pub = calloc(1, sizeof(*pub));
+    if (!pub) {
+        return NULL;
+    }
+    pub->next_delivery_tag = 1;
+    pub->oldest_unconfirmed = 1;
+    pub->reconnect_backoff_ms = g_reconnect_initial_ms;
+    return pub;
+}
+
+// Close and free a publisher from vr_publisher_create()
+void vr_publisher_destroy(vr_publisher_t *pub) {
+    if (!pub) return;
+    vr_publisher_close(pub);
+    free(pub);
+}
+
+// Connect using the shared parameters; on failure keep retrying from vr_publisher_service()
+int vr_publisher_open(vr_publisher_t *pub) {
+    if (!pub) return -1;
+    
+    pub->configured = true;
+    pub->reconnect_backoff_ms = g_reconnect_initial_ms;
+    
+    if (vr_publisher_connect(pub) != 0) {
+        pub->next_reconnect_us = vr_clock_monotonic_us() + (uint64_t)pub->reconnect_backoff_ms * 1000;
+        return -1;
+    }
+    return 0;
+}
+
+// Open without connecting: vr_publisher_service() makes the first attempt at once,
+// on the thread that drives the publisher, so the caller never waits for the broker
+void vr_publisher_open_async(vr_publisher_t *pub) {
+    if (!pub || pub->configured) return;
+    
+    pub->reconnect_backoff_ms = g_reconnect_initial_ms;
+    pub->next_reconnect_us = 0;
+    pub->configured = true;
+}
+
+// Store connection parameters and set up the streams without connecting
+void vr_rabbitmq_configure(const char *host, int port, const char *username,
+                           const char *password, const char *vhost,
+                           const char *exchange, const char *routing_key) {
     if (host) strncpy(g_host, host, sizeof(g_host) - 1);
     if (username) strncpy(g_username, username, sizeof(g_username) - 1);
     if (password) strncpy(g_password, password, sizeof(g_password) - 1);
@@ -32,151 +167,840 @@ int vr_rabbitmq_init(const char *host, int port, const char *username,
     if (exchange) strncpy(g_exchange, exchange, sizeof(g_exchange) - 1);
     if (routing_key) strncpy(g_routing_key, routing_key, sizeof(g_routing_key) - 1);
     if (port > 0) g_port = port;
+    g_exchange_len = strlen(g_exchange);
+    g_props_generation++;
     
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        char derived[VR_ROUTING_KEY_MAX];
+        const char *key = g_stream_keys[kind];
+        if (!key[0]) {
+            key = vr_stream_format_routing_key(g_routing_key, (vr_stream_kind_t)kind, derived, sizeof(derived)) == 0
+                      ? derived : g_routing_key;
+        }
+        vr_rabbitmq_stream_init(&g_streams[kind], key, g_stream_kinds[kind].sections);
+    }
+    g_parameters_set = true;
+}
+
+// Connect every shard from its publisher thread (call before the threads start)
+void vr_rabbitmq_connect_async(void) {
+    if (!g_parameters_set) {
+        vr_rabbitmq_configure(NULL, 0, NULL, NULL, NULL, NULL, NULL);
+    }
+    for (uint32_t i = 0; i < g_shard_count; i++) {
+        vr_publisher_open_async(g_shards[i]);
+    }
+}
+
+// Initialize RabbitMQ connection, connecting every shard before returning
+int vr_rabbitmq_init(const char *host, int port, const char *username,
+                     const char *password, const char *vhost,
+                     const char *exchange, const char *routing_key) {
+    vr_rabbitmq_configure(host, port, username, password, vhost, exchange, routing_key);
+    
+    int result = 0;
+    for (uint32_t i = 0; i < g_shard_count; i++) {
+        if (vr_publisher_open(g_shards[i]) != 0) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+// 32-bit FNV-1a; stable across runs and hosts, so a stream or device keeps its shard
+uint32_t vr_shard_hash(const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Spread the streams over `connections` publishers (call before vr_embedded_init)
+int vr_rabbitmq_set_connections(uint32_t connections) {
+    if (connections == 0 || connections > VR_SHARD_MAX || g_publisher.configured) {
+        return -1;
+    }
+    
+    for (uint32_t i = 1; i < connections; i++) {
+        if (!g_shards[i] && !(g_shards[i] = vr_publisher_create())) {
+            return -1;
+        }
+    }
+    for (uint32_t i = connections; i < g_shard_count; i++) {
+        vr_publisher_destroy(g_shards[i]);
+        g_shards[i] = NULL;
+    }
+    g_shard_count = connections;
+    
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        const char *name = g_stream_kinds[kind].name;
+        g_stream_shards[kind] = vr_shard_hash(name, strlen(name)) % connections;
+    }
+    return 0;
+}
+
+// Number of publisher shards
+uint32_t vr_rabbitmq_shard_count(void) {
+    return g_shard_count;
+}
+
+// Shard publishing a stream kind
+uint32_t vr_rabbitmq_stream_shard(vr_stream_kind_t kind) {
+    return (unsigned)kind < VR_STREAM_KIND_COUNT ? g_stream_shards[kind] : 0;
+}
+
+// Set up a stream publishing the given sections to routing_key with the configured delta parameters
+void vr_rabbitmq_stream_init(vr_stream_t *stream, const char *routing_key, uint8_t sections) {
+    if (!stream) return;
+    memset(stream, 0, sizeof(*stream));
+    if (routing_key) {
+        snprintf(stream->routing_key, sizeof(stream->routing_key), "%s", routing_key);
+        stream->routing_key_len = (uint32_t)strlen(stream->routing_key);
+    }
+    stream->sections = sections & VR_SECTION_ALL;
+    vr_delta_init(&stream->delta, g_keyframe_interval, g_position_um, g_quat_bits);
+}
+
+// Get the routing key given to vr_rabbitmq_init()
+const char *vr_rabbitmq_get_routing_key(void) {
+    return g_routing_key;
+}
+
+// Override the routing key of one stream kind instead of deriving it from the base key
+int vr_rabbitmq_set_stream_routing_key(vr_stream_kind_t kind, const char *routing_key) {
+    if ((unsigned)kind >= VR_STREAM_KIND_COUNT || !routing_key || !routing_key[0] ||
+        strlen(routing_key) >= VR_ROUTING_KEY_MAX) {
+        return -1;
+    }
+    snprintf(g_stream_keys[kind], sizeof(g_stream_keys[kind]), "%s", routing_key);
+    snprintf(g_streams[kind].routing_key, sizeof(g_streams[kind].routing_key), "%s", routing_key);
+    g_streams[kind].routing_key_len = (uint32_t)strlen(routing_key);
+    return 0;
+}
+
+// Get the routing key a stream kind publishes on (valid after vr_rabbitmq_init)
+const char *vr_rabbitmq_get_stream_routing_key(vr_stream_kind_t kind) {
+    if ((unsigned)kind >= VR_STREAM_KIND_COUNT) {
+        return NULL;
+    }
+    return g_streams[kind].routing_key;
+}
+
+// Get the name of a stream kind ("frame", "pose", "eyes", "status")
+const char *vr_stream_kind_name(vr_stream_kind_t kind) {
+    if ((unsigned)kind >= VR_STREAM_KIND_COUNT) {
+        return "unknown";
+    }
+    return g_stream_kinds[kind].name;
+}
+
+// Get the VR_SECTION_* mask a stream kind carries
+uint8_t vr_stream_kind_sections(vr_stream_kind_t kind) {
+    if ((unsigned)kind >= VR_STREAM_KIND_COUNT) {
+        return 0;
+    }
+    return g_stream_kinds[kind].sections;
+}
+
+// Parse stream kind name from the command line
+int vr_stream_parse_kind(const char *name, vr_stream_kind_t *kind) {
+    if (!name || !kind) {
+        return -1;
+    }
+
+    for (int i = 0; i < VR_STREAM_KIND_COUNT; i++) {
+        if (strcmp(name, g_stream_kinds[i].name) == 0) {
+            *kind = (vr_stream_kind_t)i;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+// Derive a stream's routing key: the frame stream keeps base, the others
+// replace its last segment with their name ("telemetry.data" -> "telemetry.pose")
+int vr_stream_format_routing_key(const char *base, vr_stream_kind_t kind, char *buffer, size_t size) {
+    if (!base || !buffer || size == 0 || (unsigned)kind >= VR_STREAM_KIND_COUNT) {
+        return -1;
+    }
+
+    int len;
+    if (kind == VR_STREAM_FRAME) {
+        len = snprintf(buffer, size, "%s", base);
+    } else {
+        const char *dot = strrchr(base, '.');
+        int prefix = dot ? (int)(dot - base) : (int)strlen(base);
+        len = snprintf(buffer, size, "%.*s.%s", prefix, base, g_stream_kinds[kind].name);
+    }
+
+    return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+// Abort a half-open connection attempt
+static int vr_publisher_connect_failed(vr_publisher_t *pub, const char *message) {
+    fprintf(stderr, "%s\n", message);
+    amqp_destroy_connection(pub->conn);
+    pub->conn = NULL;
+    pub->socket = NULL;
+    return -1;
+}
+
+// Open connection, channel and exchange using the stored parameters
+static int vr_publisher_connect(vr_publisher_t *pub) {
     // Create connection
-    g_conn = amqp_new_connection();
-    if (!g_conn) {
+    pub->conn = amqp_new_connection();
+    if (!pub->conn) {
         fprintf(stderr, "Failed to create RabbitMQ connection\n");
         return -1;
     }
     
     // Create socket
-    g_socket = amqp_tcp_socket_new(g_conn);
-    if (!g_socket) {
-        fprintf(stderr, "Failed to create RabbitMQ socket\n");
-        amqp_destroy_connection(g_conn);
-        return -1;
+    pub->socket = amqp_tcp_socket_new(pub->conn);
+    if (!pub->socket) {
+        return vr_publisher_connect_failed(pub, "Failed to create RabbitMQ socket");
     }
     
-    // Connect to broker
-    int status = amqp_socket_open(g_socket, g_host, g_port);
+    // Connect to broker (bounded, so a dead host cannot wedge the publisher)
+    struct timeval timeout;
+    timeout.tv_sec = VR_CONNECT_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (VR_CONNECT_TIMEOUT_MS % 1000) * 1000;
+    int status = amqp_socket_open_noblock(pub->socket, g_host, g_port, &timeout);
     if (status) {
-        fprintf(stderr, "Failed to open RabbitMQ socket: %s\n", amqp_error_string2(status));
-        amqp_destroy_connection(g_conn);
-        return -1;
+        char message[160];
+        snprintf(message, sizeof(message), "Failed to open RabbitMQ socket: %s", amqp_error_string2(status));
+        return vr_publisher_connect_failed(pub, message);
+    }
+    
+    // Bound the login handshake and every later RPC the same way
+    if (amqp_set_handshake_timeout(pub->conn, &timeout) != AMQP_STATUS_OK ||
+        amqp_set_rpc_timeout(pub->conn, &timeout) != AMQP_STATUS_OK) {
+        return vr_publisher_connect_failed(pub, "Failed to set RabbitMQ timeouts");
     }
     
     // Login
-    amqp_rpc_reply_t reply = amqp_login(g_conn, g_vhost, 0, 131072, 0, AMQP_SASL_METHOD_PLAIN, 
+    amqp_rpc_reply_t reply = amqp_login(pub->conn, g_vhost, 0, 131072, 0, AMQP_SASL_METHOD_PLAIN,
                                         g_username, g_password);
     if (reply.reply_type != AMQP_RESPONSE_NORMAL) {
-        fprintf(stderr, "Failed to login to RabbitMQ\n");
-        amqp_destroy_connection(g_conn);
-        return -1;
+        return vr_publisher_connect_failed(pub, "Failed to login to RabbitMQ");
     }
     
     // Open channel
-    amqp_channel_open(g_conn, 1);
-    reply = amqp_get_rpc_reply(g_conn);
+    amqp_channel_open(pub->conn, 1);
+    reply = amqp_get_rpc_reply(pub->conn);
     if (reply.reply_type != AMQP_RESPONSE_NORMAL) {
-        fprintf(stderr, "Failed to open RabbitMQ channel\n");
-        amqp_destroy_connection(g_conn);
-        return -1;
+        return vr_publisher_connect_failed(pub, "Failed to open RabbitMQ channel");
     }
     
     // Declare exchange
-    amqp_exchange_declare(g_conn, 1, amqp_cstring_bytes(g_exchange), 
+    amqp_exchange_declare(pub->conn, 1, amqp_cstring_bytes(g_exchange),
                          amqp_cstring_bytes("topic"), 0, 1, 0, 0, amqp_empty_table);
-    reply = amqp_get_rpc_reply(g_conn);
+    reply = amqp_get_rpc_reply(pub->conn);
     if (reply.reply_type != AMQP_RESPONSE_NORMAL) {
-        fprintf(stderr, "Failed to declare RabbitMQ exchange\n");
-        amqp_destroy_connection(g_conn);
+        return vr_publisher_connect_failed(pub, "Failed to declare RabbitMQ exchange");
+    }
+    
+    // Enable publisher confirms on the telemetry channel
+    if (g_confirms_enabled) {
+        amqp_confirm_select(pub->conn, 1);
+        reply = amqp_get_rpc_reply(pub->conn);
+        if (reply.reply_type != AMQP_RESPONSE_NORMAL) {
+            return vr_publisher_connect_failed(pub, "Failed to enable RabbitMQ publisher confirms");
+        }
+    }
+    
+    // Delivery tags restart at 1 on every new channel
+    memset(pub->confirm_slots, 0, sizeof(pub->confirm_slots));
+    pub->next_delivery_tag = 1;
+    pub->oldest_unconfirmed = 1;
+    pub->confirms_in_flight = 0;
+    __atomic_store_n(&pub->stats.confirms_in_flight, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pub->stats.confirm_window, g_confirms_enabled ? g_confirm_window : 0, __ATOMIC_RELAXED);
+    
+    __atomic_store_n(&pub->connected, true, __ATOMIC_RELAXED);
+    pub->epoch++;  // Streams resync with a keyframe; consumers may have missed the outage
+    printf("Connected to RabbitMQ at %s:%d (%s delivery, confirms %s)\n", g_host, g_port,
+           g_delivery_mode == VR_DELIVERY_PERSISTENT ? "persistent" : "transient",
+           g_confirms_enabled ? "enabled" : "disabled");
+    return 0;
+}
+
+// Select persistent or transient delivery for telemetry messages
+void vr_rabbitmq_set_delivery_mode(vr_delivery_mode_t mode) {
+    g_delivery_mode = mode;
+    g_props_generation++;
+}
+
+// Enable publisher confirms with a bounded in-flight window (call before init)
+void vr_rabbitmq_set_confirms(bool enabled, uint32_t window) {
+    if (window == 0) window = 1;
+    if (window > VR_CONFIRM_MAX_WINDOW) window = VR_CONFIRM_MAX_WINDOW;
+    g_confirms_enabled = enabled;
+    g_confirm_window = window;
+}
+
+// Configure exponential reconnect backoff (call before init)
+void vr_rabbitmq_set_reconnect(uint32_t initial_ms, uint32_t max_ms) {
+    if (initial_ms == 0) initial_ms = 1;
+    if (max_ms < initial_ms) max_ms = initial_ms;
+    g_reconnect_initial_ms = initial_ms;
+    g_reconnect_max_ms = max_ms;
+    for (uint32_t i = 0; i < g_shard_count; i++) {
+        g_shards[i]->reconnect_backoff_ms = initial_ms;
+    }
+}
+
+// Tear down a failed connection and schedule a reconnect attempt
+static void vr_publisher_drop_connection(vr_publisher_t *pub, const char *reason) {
+    if (!pub->connected) {
+        return;
+    }
+    
+    VR_LOG(VR_LOG_ERROR, "RabbitMQ connection lost (%s), reconnecting in %u ms\n",
+           reason, pub->reconnect_backoff_ms);
+    
+    // Unconfirmed messages died with the channel
+    if (pub->confirms_in_flight > 0) {
+        uint64_t lost = 0;
+        for (uint64_t t = pub->oldest_unconfirmed; t < pub->next_delivery_tag; t++) {
+            vr_confirm_slot_t *slot = &pub->confirm_slots[t % VR_CONFIRM_MAX_WINDOW];
+            if (slot->delivery_tag == t) {
+                lost += slot->frames;
+            }
+        }
+        __atomic_fetch_add(&pub->stats.frames_unconfirmed_lost, lost, __ATOMIC_RELAXED);
+        pub->confirms_in_flight = 0;
+        __atomic_store_n(&pub->stats.confirms_in_flight, 0, __ATOMIC_RELAXED);
+    }
+    
+    amqp_destroy_connection(pub->conn);
+    pub->conn = NULL;
+    pub->socket = NULL;
+    __atomic_store_n(&pub->connected, false, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pub->stats.connection_losses, 1, __ATOMIC_RELAXED);
+    
+    pub->next_reconnect_us = vr_clock_monotonic_us() + (uint64_t)pub->reconnect_backoff_ms * 1000;
+}
+
+// Drive the reconnect state machine; call periodically from the owning thread
+void vr_publisher_service(vr_publisher_t *pub) {
+    if (!pub || !pub->configured || pub->connected) {
+        return;
+    }
+    
+    uint64_t now = vr_clock_monotonic_us();
+    if (now < pub->next_reconnect_us) {
+        return;
+    }
+    
+    if (vr_publisher_connect(pub) == 0) {
+        if (pub->epoch > 1) {
+            __atomic_fetch_add(&pub->stats.reconnects, 1, __ATOMIC_RELAXED);
+        }
+        pub->reconnect_backoff_ms = g_reconnect_initial_ms;
+        return;
+    }
+    
+    // Exponential backoff, capped
+    pub->reconnect_backoff_ms *= 2;
+    if (pub->reconnect_backoff_ms > g_reconnect_max_ms) {
+        pub->reconnect_backoff_ms = g_reconnect_max_ms;
+    }
+    pub->next_reconnect_us = vr_clock_monotonic_us() + (uint64_t)pub->reconnect_backoff_ms * 1000;
+    VR_LOG(VR_LOG_ERROR, "RabbitMQ %s failed, next attempt in %u ms\n",
+           pub->epoch > 0 ? "reconnect" : "connect", pub->reconnect_backoff_ms);
+}
+
+// Drive one shard's reconnect state machine (from the thread publishing that shard)
+void vr_rabbitmq_service(uint32_t shard) {
+    if (shard < g_shard_count) {
+        vr_publisher_service(g_shards[shard]);
+    }
+}
+
+// Longest the owning thread may sleep before the publisher needs servicing:
+// until the next reconnect attempt, or a confirm poll while any are outstanding
+// (now_us on the monotonic clock)
+uint64_t vr_publisher_idle_us(const vr_publisher_t *pub, uint64_t now_us) {
+    if (!pub || !pub->configured) {
+        return UINT64_MAX;
+    }
+    if (!pub->connected) {
+        return pub->next_reconnect_us > now_us ? pub->next_reconnect_us - now_us : 0;
+    }
+    if (g_confirms_enabled && pub->confirms_in_flight > 0) {
+        return VR_CONFIRM_POLL_US;
+    }
+    return UINT64_MAX;
+}
+
+// Idle time of one shard's publisher
+uint64_t vr_rabbitmq_idle_us(uint32_t shard, uint64_t now_us) {
+    return vr_publisher_idle_us(shard < g_shard_count ? g_shards[shard] : NULL, now_us);
+}
+
+// Settle one outstanding delivery tag
+static void vr_confirm_settle(vr_publisher_t *pub, uint64_t tag, bool acked) {
+    vr_confirm_slot_t *slot = &pub->confirm_slots[tag % VR_CONFIRM_MAX_WINDOW];
+    if (slot->delivery_tag != tag) {
+        return;  // Already settled
+    }
+    
+    vr_metrics_record(VR_METRIC_CONFIRM, vr_get_monotonic_ns() - slot->published_ns);
+    if (acked) {
+        __atomic_fetch_add(&pub->stats.confirms_acked, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&pub->stats.confirms_nacked, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&pub->stats.frames_nacked, slot->frames, __ATOMIC_RELAXED);
+        if (slot->stream) {
+            vr_delta_force_keyframe(&slot->stream->delta);  // Deltas after a lost message are useless
+        }
+    }
+    
+    slot->delivery_tag = 0;
+    pub->confirms_in_flight--;
+}
+
+// Apply a basic.ack / basic.nack from the broker
+static void vr_confirm_handle(vr_publisher_t *pub, uint64_t tag, bool multiple, bool acked) {
+    if (multiple) {
+        for (uint64_t t = pub->oldest_unconfirmed; t <= tag && t < pub->next_delivery_tag; t++) {
+            vr_confirm_settle(pub, t, acked);
+        }
+    } else if (tag >= pub->oldest_unconfirmed && tag < pub->next_delivery_tag) {
+        vr_confirm_settle(pub, tag, acked);
+    }
+    
+    // Advance past settled tags
+    while (pub->oldest_unconfirmed < pub->next_delivery_tag &&
+           pub->confirm_slots[pub->oldest_unconfirmed % VR_CONFIRM_MAX_WINDOW].delivery_tag != pub->oldest_unconfirmed) {
+        pub->oldest_unconfirmed++;
+    }
+    
+    __atomic_store_n(&pub->stats.confirms_in_flight, pub->confirms_in_flight, __ATOMIC_RELAXED);
+}
+
+// Read pending broker frames for up to timeout_us; returns -1 if the connection failed
+static int vr_confirm_read(vr_publisher_t *pub, uint32_t timeout_us) {
+    struct timeval tv;
+    tv.tv_sec = timeout_us / 1000000;
+    tv.tv_usec = timeout_us % 1000000;
+    
+    for (;;) {
+        amqp_frame_t frame;
+        int status = amqp_simple_wait_frame_noblock(pub->conn, &frame, &tv);
+        if (status == AMQP_STATUS_TIMEOUT) {
+            return 0;
+        }
+        if (status != AMQP_STATUS_OK) {
+            VR_LOG(VR_LOG_ERROR, "Failed to read publisher confirms: %s\n", amqp_error_string2(status));
+            return -1;
+        }
+    
+        if (frame.frame_type == AMQP_FRAME_METHOD) {
+            if (frame.payload.method.id == AMQP_BASIC_ACK_METHOD) {
+                amqp_basic_ack_t *ack = frame.payload.method.decoded;
+                vr_confirm_handle(pub, ack->delivery_tag, ack->multiple, true);
+            } else if (frame.payload.method.id == AMQP_BASIC_NACK_METHOD) {
+                amqp_basic_nack_t *nack = frame.payload.method.decoded;
+                vr_confirm_handle(pub, nack->delivery_tag, nack->multiple, false);
+            } else if (frame.payload.method.id == AMQP_CHANNEL_CLOSE_METHOD ||
+                       frame.payload.method.id == AMQP_CONNECTION_CLOSE_METHOD) {
+                VR_LOG(VR_LOG_ERROR, "RabbitMQ closed the telemetry channel\n");
+                return -1;
+            }
+        }
+    
+        amqp_maybe_release_buffers(pub->conn);
+    
+        // Only the first read may wait; drain the rest without blocking
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+    }
+}
+
+// Check whether another publish would exceed the confirm window
+static bool vr_confirm_window_full(const vr_publisher_t *pub) {
+    return pub->confirms_in_flight >= g_confirm_window ||
+           pub->next_delivery_tag - pub->oldest_unconfirmed >= VR_CONFIRM_MAX_WINDOW;
+}
+
+// Process any acks/nacks that have arrived without blocking
+int vr_publisher_poll_confirms(vr_publisher_t *pub) {
+    if (!pub || !pub->connected || !g_confirms_enabled || pub->confirms_in_flight == 0) {
+        return 0;
+    }
+    if (vr_confirm_read(pub, 0) != 0) {
+        vr_publisher_drop_connection(pub, "confirm read failed");
         return -1;
     }
+    return 0;
+}
+
+// Block until all outstanding confirms arrive or the timeout expires
+int vr_publisher_wait_for_confirms(vr_publisher_t *pub, uint32_t timeout_ms) {
+    if (!pub || !pub->connected || !g_confirms_enabled) {
+        return 0;
+    }
     
-    g_connected = true;
-    printf("Connected to RabbitMQ at %s:%d\n", g_host, g_port);
+    uint64_t deadline = vr_clock_monotonic_us() + (uint64_t)timeout_ms * 1000;
+    while (pub->confirms_in_flight > 0) {
+        uint64_t now = vr_clock_monotonic_us();
+        if (now >= deadline) {
+            return -1;
+        }
+        if (vr_confirm_read(pub, (uint32_t)(deadline - now)) != 0) {
+            return -1;
+        }
+    }
     return 0;
 }
 
+// Process confirms on one shard
+int vr_rabbitmq_poll_confirms(uint32_t shard) {
+    return shard < g_shard_count ? vr_publisher_poll_confirms(g_shards[shard]) : -1;
+}
+
+// Wait for the outstanding confirms of every shard
+int vr_rabbitmq_wait_for_confirms(uint32_t timeout_ms) {
+    int result = 0;
+    for (uint32_t i = 0; i < g_shard_count; i++) {
+        if (vr_publisher_wait_for_confirms(g_shards[i], timeout_ms) != 0) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+// Get publisher counters
+void vr_publisher_get_stats(const vr_publisher_t *pub, vr_publisher_stats_t *stats) {
+    if (!stats) return;
+    if (!pub) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    stats->messages_published = __atomic_load_n(&pub->stats.messages_published, __ATOMIC_RELAXED);
+    stats->frames_published = __atomic_load_n(&pub->stats.frames_published, __ATOMIC_RELAXED);
+    stats->publish_failures = __atomic_load_n(&pub->stats.publish_failures, __ATOMIC_RELAXED);
+    stats->confirms_acked = __atomic_load_n(&pub->stats.confirms_acked, __ATOMIC_RELAXED);
+    stats->confirms_nacked = __atomic_load_n(&pub->stats.confirms_nacked, __ATOMIC_RELAXED);
+    stats->frames_nacked = __atomic_load_n(&pub->stats.frames_nacked, __ATOMIC_RELAXED);
+    stats->frames_unconfirmed_lost = __atomic_load_n(&pub->stats.frames_unconfirmed_lost, __ATOMIC_RELAXED);
+    stats->connection_losses = __atomic_load_n(&pub->stats.connection_losses, __ATOMIC_RELAXED);
+    stats->reconnects = __atomic_load_n(&pub->stats.reconnects, __ATOMIC_RELAXED);
+    stats->confirms_in_flight = __atomic_load_n(&pub->stats.confirms_in_flight, __ATOMIC_RELAXED);
+    stats->confirm_window = __atomic_load_n(&pub->stats.confirm_window, __ATOMIC_RELAXED);
+}
+
+// Get one shard's counters
+void vr_rabbitmq_get_shard_stats(uint32_t shard, vr_publisher_stats_t *stats) {
+    vr_publisher_get_stats(shard < g_shard_count ? g_shards[shard] : NULL, stats);
+}
+
+// Get the counters of all shards added up
+void vr_rabbitmq_get_stats(vr_publisher_stats_t *stats) {
+    if (!stats) return;
+    
+    vr_publisher_get_stats(&g_publisher, stats);
+    for (uint32_t i = 1; i < g_shard_count; i++) {
+        vr_publisher_stats_t shard;
+        vr_publisher_get_stats(g_shards[i], &shard);
+        stats->messages_published += shard.messages_published;
+        stats->frames_published += shard.frames_published;
+        stats->publish_failures += shard.publish_failures;
+        stats->confirms_acked += shard.confirms_acked;
+        stats->confirms_nacked += shard.confirms_nacked;
+        stats->frames_nacked += shard.frames_nacked;
+        stats->frames_unconfirmed_lost += shard.frames_unconfirmed_lost;
+        stats->connection_losses += shard.connection_losses;
+        stats->reconnects += shard.reconnects;
+        stats->confirms_in_flight += shard.confirms_in_flight;
+        stats->confirm_window += shard.confirm_window;
+    }
+}
+
+// Select wire format used for telemetry messages
+void vr_rabbitmq_set_wire_format(vr_wire_format_t format) {
+    g_wire_format = format;
+    g_props_generation++;
+}
+
+// Set keyframe interval and quantization for the delta wire format (call before
+// creating streams; the default streams are updated immediately)
+void vr_rabbitmq_set_delta_params(uint32_t keyframe_interval, uint32_t position_um, uint32_t quat_bits) {
+    g_keyframe_interval = keyframe_interval;
+    g_position_um = position_um;
+    g_quat_bits = quat_bits;
+    for (int kind = 0; kind < VR_STREAM_KIND_COUNT; kind++) {
+        vr_delta_init(&g_streams[kind].delta, keyframe_interval, position_um, quat_bits);
+    }
+}
+
 // Send telemetry packet to RabbitMQ
 int vr_rabbitmq_send_telemetry(const vr_telemetry_packet_t *packet) {
-    if (!g_connected || !packet) {
+    return vr_rabbitmq_send_batch(packet, 1);
+}
+
+// Build the cached exchange and message properties (after a settings change)
+static void vr_publisher_prepare(vr_publisher_t *pub) {
+    const char *content_type = vr_codec_content_type(g_wire_format);
+    
+    pub->exchange.bytes = g_exchange;
+    pub->exchange.len = g_exchange_len;
+    
+    pub->headers[VR_HEADER_FRAME_COUNT].key = amqp_cstring_bytes("frame_count");
+    pub->headers[VR_HEADER_FRAME_COUNT].value.kind = AMQP_FIELD_KIND_I32;
+    pub->headers[VR_HEADER_FRAME_COUNT].value.value.i32 = 0;
+    pub->headers[VR_HEADER_PUBLISHED_US].key = amqp_cstring_bytes("published_us");
+    pub->headers[VR_HEADER_PUBLISHED_US].value.kind = AMQP_FIELD_KIND_I64;
+    pub->headers[VR_HEADER_PUBLISHED_US].value.value.i64 = 0;
+    
+    // The timestamp property (whole seconds) is for generic AMQP tooling;
+    // latency is measured with published_us and the frames' timestamp_us
+    memset(&pub->telemetry_props, 0, sizeof(pub->telemetry_props));
+    pub->telemetry_props._flags = AMQP_BASIC_CONTENT_TYPE_FLAG | AMQP_BASIC_DELIVERY_MODE_FLAG |
+                                  AMQP_BASIC_HEADERS_FLAG | AMQP_BASIC_TIMESTAMP_FLAG;
+    pub->telemetry_props.content_type = amqp_cstring_bytes(content_type);
+    pub->telemetry_props.delivery_mode = (uint8_t)g_delivery_mode;
+    pub->telemetry_props.headers.num_entries = VR_HEADER_COUNT;
+    pub->telemetry_props.headers.entries = pub->headers;
+    
+    // Metrics are transient; stale metrics are not worth a disk sync
+    memset(&pub->metrics_props, 0, sizeof(pub->metrics_props));
+    pub->metrics_props._flags = AMQP_BASIC_CONTENT_TYPE_FLAG | AMQP_BASIC_DELIVERY_MODE_FLAG;
+    pub->metrics_props.content_type = amqp_cstring_bytes(VR_CONTENT_TYPE_JSON);
+    pub->metrics_props.delivery_mode = (uint8_t)VR_DELIVERY_TRANSIENT;
+    
+    pub->props_generation = g_props_generation;
+}
+
+// Publish one message from pub->message, tracking it for confirms; `frames`
+// telemetry frames it carries (0 for other messages)
+static int vr_publisher_publish(vr_publisher_t *pub, amqp_bytes_t routing_key, size_t len,
+                                uint32_t frames, vr_stream_t *stream) {
+    // Respect the in-flight window: wait for the broker only when it is full
+    if (g_confirms_enabled && vr_confirm_window_full(pub)) {
+        uint64_t deadline = vr_clock_monotonic_us() + VR_CONFIRM_TIMEOUT_MS * 1000;
+        while (vr_confirm_window_full(pub)) {
+            uint64_t now = vr_clock_monotonic_us();
+            if (now >= deadline || vr_confirm_read(pub, (uint32_t)(deadline - now)) != 0) {
+                __atomic_fetch_add(&pub->stats.publish_failures, 1, __ATOMIC_RELAXED);
+                vr_publisher_drop_connection(pub, "confirm window stalled");
+                return -1;
+            }
+        }
+    }
+    
+    if (pub->props_generation != g_props_generation) {
+        vr_publisher_prepare(pub);
+    }
+    
+    const amqp_basic_properties_t *props = &pub->metrics_props;
+    if (frames > 0) {
+        uint64_t now = vr_get_timestamp_us();
+        pub->headers[VR_HEADER_FRAME_COUNT].value.value.i32 = (int32_t)frames;
+        pub->headers[VR_HEADER_PUBLISHED_US].value.value.i64 = (int64_t)now;
+        pub->telemetry_props.timestamp = now / 1000000;
+        props = &pub->telemetry_props;
+    }
+    
+    amqp_bytes_t body;
+    body.len = len;
+    body.bytes = pub->message;
+    
+    uint64_t publish_start = vr_get_monotonic_ns();
+    int status = amqp_basic_publish(pub->conn, 1, pub->exchange, routing_key, 0, 0, props, body);
+    vr_metrics_record(VR_METRIC_PUBLISH, vr_get_monotonic_ns() - publish_start);
+    
+    if (status != AMQP_STATUS_OK) {
+        VR_LOG(VR_LOG_ERROR, "Failed to publish message: %s\n", amqp_error_string2(status));
+        __atomic_fetch_add(&pub->stats.publish_failures, 1, __ATOMIC_RELAXED);
+        vr_publisher_drop_connection(pub, "publish failed");
         return -1;
     }
     
-    // Serialize packet to JSON-like format
-    char message[2048];
-    int len = snprintf(message, sizeof(message),
-        "{"
-        "\"timestamp_us\":%lu,"
-        "\"frame_id\":%u,"
-        "\"head_position\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f},"
-        "\"head_orientation\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"w\":%.6f},"
-        "\"head_acceleration\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f},"
-        "\"head_angular_velocity\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f},"
-        "\"left_eye\":{\"x\":%.6f,\"y\":%.6f,\"pupil_diameter\":%.6f,\"is_blinking\":%s},"
-        "\"right_eye\":{\"x\":%.6f,\"y\":%.6f,\"pupil_diameter\":%.6f,\"is_blinking\":%s},"
-        "\"left_hand\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"orientation\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"w\":%.6f},\"grip_strength\":%.6f,\"is_tracking\":%s},"
-        "\"right_hand\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"orientation\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f,\"w\":%.6f},\"grip_strength\":%.6f,\"is_tracking\":%s},"
-        "\"cpu_usage\":%.2f,"
-        "\"gpu_usage\":%.2f,"
-        "\"temperature\":%.2f,"
-        "\"battery_level\":%u,"
-        "\"is_connected\":%s"
-        "}",
-        packet->timestamp_us,
-        packet->frame_id,
-        packet->head_position.x, packet->head_position.y, packet->head_position.z,
-        packet->head_orientation.x, packet->head_orientation.y, packet->head_orientation.z, packet->head_orientation.w,
-        packet->head_acceleration.x, packet->head_acceleration.y, packet->head_acceleration.z,
-        packet->head_angular_velocity.x, packet->head_angular_velocity.y, packet->head_angular_velocity.z,
-        packet->left_eye.x, packet->left_eye.y, packet->left_eye.pupil_diameter, packet->left_eye.is_blinking ? "true" : "false",
-        packet->right_eye.x, packet->right_eye.y, packet->right_eye.pupil_diameter, packet->right_eye.is_blinking ? "true" : "false",
-        packet->left_hand.x, packet->left_hand.y, packet->left_hand.z,
-        packet->left_hand.orientation.x, packet->left_hand.orientation.y, packet->left_hand.orientation.z, packet->left_hand.orientation.w,
-        packet->left_hand.grip_strength, packet->left_hand.is_tracking ? "true" : "false",
-        packet->right_hand.x, packet->right_hand.y, packet->right_hand.z,
-        packet->right_hand.orientation.x, packet->right_hand.orientation.y, packet->right_hand.orientation.z, packet->right_hand.orientation.w,
-        packet->right_hand.grip_strength, packet->right_hand.is_tracking ? "true" : "false",
-        packet->cpu_usage,
-        packet->gpu_usage,
-        packet->temperature,
-        packet->battery_level,
-        packet->is_connected ? "true" : "false"
-    );
-    
-    if (len >= sizeof(message)) {
-        fprintf(stderr, "Message too large for buffer\n");
+    // Track the delivery tag until the broker confirms it
+    if (g_confirms_enabled) {
+        vr_confirm_slot_t *slot = &pub->confirm_slots[pub->next_delivery_tag % VR_CONFIRM_MAX_WINDOW];
+        slot->delivery_tag = pub->next_delivery_tag;
+        slot->published_ns = vr_get_monotonic_ns();
+        slot->frames = frames;
+        slot->stream = stream;
+        pub->confirms_in_flight++;
+        __atomic_store_n(&pub->stats.confirms_in_flight, pub->confirms_in_flight, __ATOMIC_RELAXED);
+    }
+    pub->next_delivery_tag++;
+    return 0;
+}
+
+// Send one or more telemetry packets of a stream as a single RabbitMQ message
+int vr_publisher_send_batch(vr_publisher_t *pub, vr_stream_t *stream,
+                            const vr_telemetry_packet_t *packets, uint32_t count) {
+    if (!pub || !stream || !pub->connected || !packets || count == 0) {
         return -1;
     }
     
-    // Publish message
-    amqp_basic_properties_t props;
-    props._flags = AMQP_BASIC_CONTENT_TYPE_FLAG | AMQP_BASIC_DELIVERY_MODE_FLAG;
-    props.content_type = amqp_cstring_bytes("application/json");
-    props.delivery_mode = 2; // Persistent message
+    // The delta state belongs to the connection it was last sent on
+    if (stream->epoch != pub->epoch) {
+        vr_delta_force_keyframe(&stream->delta);
+        stream->epoch = pub->epoch;
+    }
     
-    int status = amqp_basic_publish(g_conn, 1, amqp_cstring_bytes(g_exchange),
-                                   amqp_cstring_bytes(g_routing_key), 0, 0,
-                                   &props, amqp_cstring_bytes(message));
+    // Serialize the stream's sections in the configured wire format
+    uint8_t sections = stream->sections ? stream->sections : VR_SECTION_ALL;
+    uint64_t encode_start = vr_get_monotonic_ns();
+    int len;
+    if (g_wire_format == VR_WIRE_FORMAT_DELTA) {
+        len = vr_delta_encode_batch(&stream->delta, packets, count, sections,
+                                    (uint8_t *)pub->message, sizeof(pub->message));
+    } else if (g_wire_format == VR_WIRE_FORMAT_BINARY) {
+        if (count == 1) {
+            len = vr_codec_encode_binary_sections(packets, sections, (uint8_t *)pub->message, sizeof(pub->message));
+        } else {
+            len = vr_codec_encode_binary_batch(packets, count, sections, (uint8_t *)pub->message, sizeof(pub->message));
+        }
+    } else {
+        if (count == 1) {
+            len = vr_codec_encode_json_sections(packets, sections, pub->message, sizeof(pub->message));
+        } else {
+            len = vr_codec_encode_json_batch(packets, count, sections, pub->message, sizeof(pub->message));
+        }
+    }
+    vr_metrics_record(VR_METRIC_SERIALIZE, vr_get_monotonic_ns() - encode_start);
     
-    if (status != AMQP_STATUS_OK) {
-        fprintf(stderr, "Failed to publish message: %s\n", amqp_error_string2(status));
+    if (len < 0) {
+        VR_LOG(VR_LOG_ERROR, "Message too large for buffer\n");
         return -1;
     }
     
+    amqp_bytes_t routing_key;
+    routing_key.len = stream->routing_key_len;
+    routing_key.bytes = stream->routing_key;
+    if (vr_publisher_publish(pub, routing_key, (size_t)len, count, stream) != 0) {
+        vr_delta_force_keyframe(&stream->delta);
+        return -1;
+    }
+    
+    // Sample-to-publish age of every frame, on the monotonic clock
+    uint64_t now = vr_clock_monotonic_us();
+    for (uint32_t i = 0; i < count; i++) {
+        if (packets[i].monotonic_us > 0 && packets[i].monotonic_us <= now) {
+            vr_metrics_record(VR_METRIC_FRAME_AGE, (now - packets[i].monotonic_us) * 1000);
+        }
+    }
+    
+    __atomic_fetch_add(&pub->stats.messages_published, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pub->stats.frames_published, count, __ATOMIC_RELAXED);
     return 0;
 }
 
-// Check if connected
+// Send packets on the default frame stream
+int vr_rabbitmq_send_batch(const vr_telemetry_packet_t *packets, uint32_t count) {
+    return vr_rabbitmq_send_stream_batch(VR_STREAM_FRAME, packets, count);
+}
+
+// Send packets on one of the default streams, through the stream's shard
+int vr_rabbitmq_send_stream_batch(vr_stream_kind_t kind, const vr_telemetry_packet_t *packets,
+                                  uint32_t count) {
+    if ((unsigned)kind >= VR_STREAM_KIND_COUNT) {
+        return -1;
+    }
+    return vr_publisher_send_batch(g_shards[g_stream_shards[kind]], &g_streams[kind], packets, count);
+}
+
+// Set routing key for periodic metrics messages
+void vr_rabbitmq_set_metrics_routing_key(const char *routing_key) {
+    if (routing_key) {
+        strncpy(g_metrics_routing_key, routing_key, sizeof(g_metrics_routing_key) - 1);
+        g_metrics_routing_key_len = strlen(g_metrics_routing_key);
+    }
+}
+
+// Publish a metrics report, formatted straight into the publisher's message buffer
+int vr_rabbitmq_send_metrics(void) {
+    if (!g_publisher.connected) {
+        return -1;
+    }
+    
+    int len = vr_metrics_format_json(g_publisher.message, sizeof(g_publisher.message));
+    if (len <= 0) {
+        return -1;
+    }
+    
+    amqp_bytes_t routing_key;
+    routing_key.len = g_metrics_routing_key_len;
+    routing_key.bytes = g_metrics_routing_key;
+    return vr_publisher_publish(&g_publisher, routing_key, (size_t)len, 0, NULL);
+}
+
+// Check if a publisher is connected
+bool vr_publisher_is_connected(const vr_publisher_t *pub) {
+    return pub && __atomic_load_n(&pub->connected, __ATOMIC_RELAXED);
+}
+
+// Check if shard 0, which also carries metrics, is connected
 bool vr_rabbitmq_is_connected(void) {
-    return g_connected;
+    return __atomic_load_n(&g_publisher.connected, __ATOMIC_RELAXED);
 }
 
-// Close RabbitMQ connection
-void vr_rabbitmq_close(void) {
-    if (g_connected) {
-        amqp_channel_close(g_conn, 1, AMQP_REPLY_SUCCESS);
-        amqp_connection_close(g_conn, AMQP_REPLY_SUCCESS);
-        amqp_destroy_connection(g_conn);
-        g_connected = false;
+// Check if one shard is connected
+bool vr_rabbitmq_shard_is_connected(uint32_t shard) {
+    return shard < g_shard_count && __atomic_load_n(&g_shards[shard]->connected, __ATOMIC_RELAXED);
+}
+
+// Check if a broker has been configured (connected or reconnecting)
+bool vr_rabbitmq_is_configured(void) {
+    return g_publisher.configured;
+}
+
+// Check if broker parameters are set, whether or not the telemetry shards use them
+bool vr_rabbitmq_has_parameters(void) {
+    return g_parameters_set;
+}
+
+// Close a publisher's connection and stop reconnecting
+void vr_publisher_close(vr_publisher_t *pub) {
+    if (!pub) return;
+    pub->configured = false;
+    if (pub->connected) {
+        if (vr_publisher_wait_for_confirms(pub, VR_CONFIRM_TIMEOUT_MS) != 0) {
+            fprintf(stderr, "Closing with %u unconfirmed messages\n", pub->confirms_in_flight);
+        }
+        amqp_channel_close(pub->conn, 1, AMQP_REPLY_SUCCESS);
+        amqp_connection_close(pub->conn, AMQP_REPLY_SUCCESS);
+        amqp_destroy_connection(pub->conn);
+        pub->conn = NULL;
+        pub->socket = NULL;
+        __atomic_store_n(&pub->connected, false, __ATOMIC_RELAXED);
         printf("Disconnected from RabbitMQ\n");
     }
 }
 
-// Reconnect to RabbitMQ
+// Close the connections of every shard
+void vr_rabbitmq_close(void) {
+    for (uint32_t i = 0; i < g_shard_count; i++) {
+        vr_publisher_close(g_shards[i]);
+    }
+}
+
+// Reconnect every shard immediately, bypassing the backoff timer
 int vr_rabbitmq_reconnect(void) {
-    vr_rabbitmq_close();
-    return vr_rabbitmq_init(g_host, g_port, g_username, g_password, g_vhost, g_exchange, g_routing_key);
+    if (!g_publisher.configured) {
+        return -1;
+    }
+    
+    int result = 0;
+    for (uint32_t i = 0; i < g_shard_count; i++) {
+        vr_publisher_t *pub = g_shards[i];
+        vr_publisher_drop_connection(pub, "reconnect requested");
+        pub->next_reconnect_us = 0;
+        vr_publisher_service(pub);
+        if (!pub->connected) {
+            result = -1;
+        }
+    }
+    return result;
 }
@@ -0,0 +1,118 @@
+#include "vr_telemetry.h"
+#include <string.h>
+
+// Adaptive frame stream rate (AIMD, as in TCP congestion control).
+//
+// The main loop measures the publishing path once per interval and asks the
+// controller for the next rate. Any congestion signal scales the rate by
+// VR_RATECTL_DECREASE, then the rate is held for VR_RATECTL_HOLD_INTERVALS so
+// the queues can drain before they are judged again. After
+// VR_RATECTL_PROBE_INTERVALS clear intervals the rate rises by a fixed step.
+// Backing off multiplicatively and probing additively converges on the rate
+// the broker sustains without oscillating around it.
+// While the broker link is down the rate is held, not lowered: the spill
+// buffer absorbs outages, and a lower rate would not bring the broker back.
+
+static const char *const g_ratectl_cause_names[VR_RATECTL_CAUSE_COUNT] = {
+    [VR_RATECTL_CLEAR]           = "none",
+    [VR_RATECTL_RING_DROPS]      = "ring drops",
+    [VR_RATECTL_RING_FILL]       = "ring fill",
+    [VR_RATECTL_CONFIRM_LAG]     = "confirm lag",
+    [VR_RATECTL_PUBLISH_LATENCY] = "publish latency",
+};
+
+// Resolve the bounds around the configured rate
+void vr_ratectl_init(vr_ratectl_t *ctl, const vr_ratectl_config_t *config, uint32_t rate_hz) {
+    memset(ctl, 0, sizeof(*ctl));
+    if (config) {
+        ctl->config = *config;
+    }
+    if (ctl->config.interval_ms == 0) {
+        ctl->config.interval_ms = VR_RATECTL_DEFAULT_INTERVAL_MS;
+    }
+    if (ctl->config.latency_us == 0) {
+        ctl->config.latency_us = VR_RATECTL_DEFAULT_LATENCY_MS * 1000;
+    }
+
+    uint32_t max_hz = ctl->config.max_hz > 0 ? ctl->config.max_hz : rate_hz;
+    uint32_t min_hz = ctl->config.min_hz > 0 ? ctl->config.min_hz : max_hz / 4;
+    if (max_hz < 1) max_hz = 1;
+    if (min_hz < 1) min_hz = 1;
+    if (min_hz > max_hz) min_hz = max_hz;
+
+    ctl->step_hz = max_hz / VR_RATECTL_INCREASE_DIVISOR > 0 ? max_hz / VR_RATECTL_INCREASE_DIVISOR : 1;
+    ctl->stats.enabled = ctl->config.enabled;
+    ctl->stats.min_hz = min_hz;
+    ctl->stats.max_hz = max_hz;
+    ctl->stats.rate_hz = rate_hz < min_hz ? min_hz : (rate_hz > max_hz ? max_hz : rate_hz);
+}
+
+// Strongest congestion signal of an interval
+static vr_ratectl_cause_t vr_ratectl_cause(const vr_ratectl_t *ctl, const vr_ratectl_signals_t *signals) {
+    if (signals->ring_drops > 0) {
+        return VR_RATECTL_RING_DROPS;
+    }
+    if (signals->ring_fill >= VR_RATECTL_RING_HIGH) {
+        return VR_RATECTL_RING_FILL;
+    }
+    if (signals->confirm_fill >= VR_RATECTL_CONFIRM_HIGH) {
+        return VR_RATECTL_CONFIRM_LAG;
+    }
+    if (signals->publishes > 0 && signals->publish_p99_ns > (uint64_t)ctl->config.latency_us * 1000) {
+        return VR_RATECTL_PUBLISH_LATENCY;
+    }
+    return VR_RATECTL_CLEAR;
+}
+
+// Rate for the next interval, given the current rate and the last interval's signals
+uint32_t vr_ratectl_update(vr_ratectl_t *ctl, uint32_t rate_hz, const vr_ratectl_signals_t *signals) {
+    uint32_t min_hz = ctl->stats.min_hz;
+    uint32_t max_hz = ctl->stats.max_hz;
+    uint32_t rate = rate_hz < min_hz ? min_hz : (rate_hz > max_hz ? max_hz : rate_hz);
+
+    bool holding = ctl->hold > 0;
+    if (holding) {
+        ctl->hold--;
+    }
+
+    vr_ratectl_cause_t cause = signals->connected ? vr_ratectl_cause(ctl, signals) : VR_RATECTL_CLEAR;
+    if (!signals->connected) {
+        ctl->clear = 0;
+    } else if (cause != VR_RATECTL_CLEAR) {
+        ctl->clear = 0;
+        if (!holding && rate > min_hz) {
+            uint32_t lower = (uint32_t)(rate * VR_RATECTL_DECREASE);
+            if (lower >= rate) lower = rate - 1;
+            rate = lower > min_hz ? lower : min_hz;
+            ctl->hold = VR_RATECTL_HOLD_INTERVALS;
+            __atomic_store_n(&ctl->stats.decreases, ctl->stats.decreases + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&ctl->stats.last_cause, cause, __ATOMIC_RELAXED);
+        }
+    } else if (++ctl->clear >= VR_RATECTL_PROBE_INTERVALS && !holding && rate < max_hz) {
+        rate = max_hz - rate > ctl->step_hz ? rate + ctl->step_hz : max_hz;
+        ctl->clear = 0;
+        __atomic_store_n(&ctl->stats.increases, ctl->stats.increases + 1, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&ctl->stats.rate_hz, rate, __ATOMIC_RELAXED);
+    return rate;
+}
+
+// Copy the controller's counters (any thread)
+void vr_ratectl_get_stats(const vr_ratectl_t *ctl, vr_ratectl_stats_t *stats) {
+    if (!ctl || !stats) return;
+
+    stats->enabled = ctl->stats.enabled;
+    stats->min_hz = ctl->stats.min_hz;
+    stats->max_hz = ctl->stats.max_hz;
+    stats->rate_hz = __atomic_load_n(&ctl->stats.rate_hz, __ATOMIC_RELAXED);
+    stats->decreases = __atomic_load_n(&ctl->stats.decreases, __ATOMIC_RELAXED);
+    stats->increases = __atomic_load_n(&ctl->stats.increases, __ATOMIC_RELAXED);
+    stats->last_cause = __atomic_load_n(&ctl->stats.last_cause, __ATOMIC_RELAXED);
+}
+
+// Cause name for reports
+const char *vr_ratectl_cause_name(vr_ratectl_cause_t cause) {
+    if ((unsigned)cause >= VR_RATECTL_CAUSE_COUNT) return "unknown";
+    return g_ratectl_cause_names[cause];
+}
@@ -0,0 +1,132 @@
+#include "vr_telemetry.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Single-producer/single-consumer packet ring.
+//
+// The producer owns `head`, the consumer owns `tail`. With VR_RING_DROP_OLDEST
+// the producer may also advance `tail` to evict the oldest entry, so the
+// consumer claims entries with a compare-and-swap and discards its copy if
+// the producer evicted that entry while it was being read.
+
+// Round up to the next power of two
+static uint32_t round_up_pow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v && p < (1u << 31)) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Initialize ring with at least `depth` slots
+int vr_ring_init(vr_packet_ring_t *ring, uint32_t depth, vr_ring_policy_t policy) {
+    if (!ring) return -1;
+
+    memset(ring, 0, sizeof(*ring));
+    if (depth < 2) depth = 2;
+
+    ring->capacity = round_up_pow2(depth);
+    ring->mask = ring->capacity - 1;
+    ring->policy = policy;
+
+    void *slots = NULL;
+    if (posix_memalign(&slots, VR_CACHE_LINE_SIZE,
+                       (size_t)ring->capacity * sizeof(vr_telemetry_packet_t)) != 0) {
+        ring->capacity = 0;
+        return -1;
+    }
+    ring->slots = slots;
+    return 0;
+}
+
+// Release ring storage
+void vr_ring_destroy(vr_packet_ring_t *ring) {
+    if (!ring) return;
+    free(ring->slots);
+    ring->slots = NULL;
+    ring->capacity = 0;
+}
+
+// Producer: enqueue a packet; returns false if the packet itself was dropped
+bool vr_ring_push(vr_packet_ring_t *ring, const vr_telemetry_packet_t *packet) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= ring->capacity) {
+        if (ring->policy == VR_RING_DROP_NEWEST) {
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+
+        // Evict the oldest entry unless the consumer just took it
+        if (__atomic_compare_exchange_n(&ring->tail, &tail, tail + 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(&ring->slots[head & ring->mask], packet, sizeof(vr_telemetry_packet_t));
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    uint32_t occupancy = (uint32_t)(head + 1 - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED));
+    if (occupancy > ring->high_watermark) {
+        __atomic_store_n(&ring->high_watermark, occupancy, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+// Consumer: dequeue the oldest packet; returns false if the ring is empty
+bool vr_ring_pop(vr_packet_ring_t *ring, vr_telemetry_packet_t *packet) {
+    for (;;) {
+        uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        if (tail == head) {
+            return false;
+        }
+
+        memcpy(packet, &ring->slots[tail & ring->mask], sizeof(vr_telemetry_packet_t));
+
+        if (ring->policy == VR_RING_DROP_NEWEST) {
+            __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        if (__atomic_compare_exchange_n(&ring->tail, &tail, tail + 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            return true;
+        }
+        // Entry was evicted by the producer while we copied it; retry
+    }
+}
+
+// Number of packets currently queued
+uint32_t vr_ring_occupancy(const vr_packet_ring_t *ring) {
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return head > tail ? (uint32_t)(head - tail) : 0;
+}
+
+// Snapshot ring counters
+void vr_ring_get_stats(const vr_packet_ring_t *ring, vr_ring_stats_t *stats) {
+    if (!ring || !stats) return;
+    stats->capacity = ring->capacity;
+    stats->occupancy = vr_ring_occupancy(ring);
+    stats->high_watermark = __atomic_load_n(&ring->high_watermark, __ATOMIC_RELAXED);
+    stats->pushed = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+}
+
+// Parse overflow policy name from the command line
+int vr_ring_parse_policy(const char *name, vr_ring_policy_t *policy) {
+    if (!name || !policy) return -1;
+
+    if (strcmp(name, "drop-oldest") == 0) {
+        *policy = VR_RING_DROP_OLDEST;
+    } else if (strcmp(name, "drop-newest") == 0) {
+        *policy = VR_RING_DROP_NEWEST;
+    } else {
+        return -1;
+    }
+    return 0;
+}
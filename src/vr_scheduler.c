@@ -0,0 +1,274 @@
+#include "vr_telemetry.h"
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+// Periodic task scheduler driven by absolute CLOCK_MONOTONIC deadlines.
+//
+// Deadlines are derived from a per-task epoch and release counter instead of
+// being accumulated, so late releases do not shift later ones and integer
+// rates are exact on average. A task that falls more than one period behind
+// skips the missed releases (counted as overruns) rather than bursting.
+//
+// Between deadlines the loop idles as configured: spinning on the clock,
+// yielding, or blocking on a timerfd armed with the absolute deadline, so a
+// sleeping loop wakes once per release and never to poll. Deep sleep rounds
+// each wake-up up to a VR_IDLE_DEEP_SLACK_US grid of the monotonic clock and
+// runs every task due within one slack of it, so tasks with unrelated rates
+// share wake-ups and simulators on one host wake on the same ticks.
+
+static const char *const g_idle_mode_names[VR_IDLE_MODE_COUNT] = {
+    [VR_IDLE_SPIN]  = "spin",
+    [VR_IDLE_YIELD] = "yield",
+    [VR_IDLE_SLEEP] = "sleep",
+    [VR_IDLE_DEEP]  = "deep",
+};
+
+// Compute the deadline of the task's current release
+static uint64_t vr_task_deadline(const vr_task_t *task) {
+    return task->epoch_ns + (uint64_t)task->release * task->period_num_ns / task->period_den;
+}
+
+// Move to the next release, rebasing the epoch once per whole period cycle
+static void vr_task_advance(vr_task_t *task) {
+    task->release++;
+    if (task->release >= task->period_den) {
+        task->epoch_ns += task->period_num_ns;
+        task->release = 0;
+    }
+    task->deadline_ns = vr_task_deadline(task);
+}
+
+// Register a task with a rational period; returns the task id or -1
+static int vr_scheduler_add(vr_scheduler_t *sched, const char *name, vr_task_fn_t fn, void *arg,
+                            uint64_t period_num_ns, uint32_t period_den) {
+    if (!sched || !fn || period_num_ns == 0 || period_den == 0) return -1;
+    if (sched->count >= VR_SCHED_MAX_TASKS) return -1;
+
+    vr_task_t *task = &sched->tasks[sched->count];
+    memset(task, 0, sizeof(*task));
+    task->name = name;
+    task->fn = fn;
+    task->arg = arg;
+    task->period_num_ns = period_num_ns;
+    task->period_den = period_den;
+    return (int)sched->count++;
+}
+
+// Initialize an empty scheduler
+void vr_scheduler_init(vr_scheduler_t *sched) {
+    if (!sched) return;
+    memset(sched, 0, sizeof(*sched));
+    sched->idle = VR_IDLE_SLEEP;
+    sched->timer_fd = -1;
+    sched->epoll_fd = -1;
+}
+
+// Create the timerfd and its epoll set; without them sleeping falls back to clock_nanosleep
+static void vr_scheduler_open_timer(vr_scheduler_t *sched) {
+    if (sched->timer_fd >= 0) return;
+
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event = { .events = EPOLLIN };
+    if (timer_fd < 0 || epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) != 0) {
+        if (timer_fd >= 0) close(timer_fd);
+        if (epoll_fd >= 0) close(epoll_fd);
+        return;
+    }
+    sched->timer_fd = timer_fd;
+    sched->epoll_fd = epoll_fd;
+}
+
+// Select how the loop waits between deadlines
+void vr_scheduler_set_idle(vr_scheduler_t *sched, vr_idle_mode_t idle) {
+    if (!sched || (unsigned)idle >= VR_IDLE_MODE_COUNT) return;
+    sched->idle = idle;
+    if (idle >= VR_IDLE_SLEEP) {
+        vr_scheduler_open_timer(sched);
+    }
+}
+
+// Release the timer descriptors
+void vr_scheduler_close(vr_scheduler_t *sched) {
+    if (!sched) return;
+    if (sched->timer_fd >= 0) close(sched->timer_fd);
+    if (sched->epoll_fd >= 0) close(sched->epoll_fd);
+    sched->timer_fd = -1;
+    sched->epoll_fd = -1;
+}
+
+// Add a task released rate_hz times per second; fn is called with arg
+int vr_scheduler_add_rate(vr_scheduler_t *sched, const char *name, vr_task_fn_t fn, void *arg,
+                          uint32_t rate_hz) {
+    return vr_scheduler_add(sched, name, fn, arg, VR_NSEC_PER_SEC, rate_hz);
+}
+
+// Add a task released every period_us microseconds; fn is called with arg
+int vr_scheduler_add_period(vr_scheduler_t *sched, const char *name, vr_task_fn_t fn, void *arg,
+                            uint64_t period_us) {
+    return vr_scheduler_add(sched, name, fn, arg, period_us * 1000, 1);
+}
+
+// Change a rate-based task's frequency, starting from its next release
+int vr_scheduler_set_rate(vr_scheduler_t *sched, int task_id, uint32_t rate_hz) {
+    if (!sched || task_id < 0 || (uint32_t)task_id >= sched->count || rate_hz == 0) return -1;
+
+    vr_task_t *task = &sched->tasks[task_id];
+    task->epoch_ns = task->deadline_ns;
+    task->release = 0;
+    task->period_num_ns = VR_NSEC_PER_SEC;
+    task->period_den = rate_hz;
+    return 0;
+}
+
+// Anchor all tasks to the current time; the first release of each is immediate
+void vr_scheduler_start(vr_scheduler_t *sched) {
+    if (!sched) return;
+
+    uint64_t now = vr_get_monotonic_ns();
+    for (uint32_t i = 0; i < sched->count; i++) {
+        vr_task_t *task = &sched->tasks[i];
+        task->epoch_ns = now;
+        task->release = 0;
+        task->deadline_ns = now;
+    }
+    sched->started_ns = now;
+    sched->wakeups = 0;
+}
+
+// Wait until the monotonic clock reaches wake_ns; returns -1 if a signal interrupted the wait
+static int vr_scheduler_wait(vr_scheduler_t *sched, uint64_t wake_ns) {
+    switch (sched->idle) {
+    case VR_IDLE_SPIN:
+        while (vr_get_monotonic_ns() < wake_ns) {
+        }
+        return 0;
+    case VR_IDLE_YIELD:
+        while (vr_get_monotonic_ns() < wake_ns) {
+            sched_yield();
+            sched->wakeups++;
+        }
+        return 0;
+    default:
+        break;
+    }
+
+    struct timespec wake;
+    wake.tv_sec = (time_t)(wake_ns / VR_NSEC_PER_SEC);
+    wake.tv_nsec = (long)(wake_ns % VR_NSEC_PER_SEC);
+    if (sched->timer_fd < 0) {
+        sched->wakeups++;
+        return clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR ? -1 : 0;
+    }
+
+    // A deadline already past expires the timer at once
+    struct itimerspec timer = { .it_value = wake };
+    if (wake_ns == 0 || timerfd_settime(sched->timer_fd, TFD_TIMER_ABSTIME, &timer, NULL) != 0) {
+        return 0;
+    }
+    struct epoll_event event;
+    int ready = epoll_wait(sched->epoll_fd, &event, 1, -1);
+    sched->wakeups++;
+    if (ready < 0) {
+        // Signal delivered; give the caller a chance to check for shutdown
+        return -1;
+    }
+    uint64_t expirations;
+    ssize_t drained = read(sched->timer_fd, &expirations, sizeof(expirations));
+    (void)drained;
+    return 0;
+}
+
+// Sleep until the earliest deadline, then run every due task in registration
+// order. Returns the number of tasks run (0 if the sleep was interrupted).
+int vr_scheduler_run_once(vr_scheduler_t *sched) {
+    if (!sched || sched->count == 0) return 0;
+
+    uint64_t next = sched->tasks[0].deadline_ns;
+    for (uint32_t i = 1; i < sched->count; i++) {
+        if (sched->tasks[i].deadline_ns < next) {
+            next = sched->tasks[i].deadline_ns;
+        }
+    }
+
+    // Deep sleep: wake on the slack grid and take tasks due up to one slack later along
+    uint64_t early_ns = 0;
+    if (sched->idle == VR_IDLE_DEEP) {
+        early_ns = (uint64_t)VR_IDLE_DEEP_SLACK_US * 1000;
+        next = (next + early_ns - 1) / early_ns * early_ns;
+    }
+    if (vr_scheduler_wait(sched, next) != 0) {
+        return 0;
+    }
+
+    uint64_t wake_ns = vr_get_monotonic_ns();
+    int ran = 0;
+    for (uint32_t i = 0; i < sched->count; i++) {
+        vr_task_t *task = &sched->tasks[i];
+        uint64_t start = vr_get_monotonic_ns();
+        if (start + early_ns < task->deadline_ns) {
+            continue;
+        }
+
+        uint64_t jitter = start > task->deadline_ns ? start - task->deadline_ns : 0;
+        task->fn(task->arg);
+        uint64_t end = vr_get_monotonic_ns();
+
+        task->runs++;
+        task->jitter_sum_ns += jitter;
+        if (jitter > task->jitter_max_ns) task->jitter_max_ns = jitter;
+        if (end - start > task->runtime_max_ns) task->runtime_max_ns = end - start;
+        ran++;
+
+        // Skip releases that are already in the past
+        vr_task_advance(task);
+        while (task->deadline_ns <= end) {
+            task->overruns++;
+            vr_task_advance(task);
+        }
+    }
+
+    sched->last_busy_ns = vr_get_monotonic_ns() - wake_ns;
+    return ran;
+}
+
+// Snapshot per-task timing statistics
+void vr_scheduler_get_stats(const vr_scheduler_t *sched, int task_id, vr_task_stats_t *stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!sched || task_id < 0 || (uint32_t)task_id >= sched->count) return;
+
+    const vr_task_t *task = &sched->tasks[task_id];
+    stats->name = task->name;
+    stats->period_us = (double)task->period_num_ns / task->period_den / 1000.0;
+    stats->runs = task->runs;
+    stats->overruns = task->overruns;
+    stats->jitter_mean_us = task->runs ? (double)task->jitter_sum_ns / task->runs / 1000.0 : 0.0;
+    stats->jitter_max_us = task->jitter_max_ns / 1000.0;
+    stats->runtime_max_us = task->runtime_max_ns / 1000.0;
+}
+
+// Wake-up counters of the loop since vr_scheduler_start
+void vr_scheduler_get_idle_stats(const vr_scheduler_t *sched, vr_scheduler_idle_stats_t *stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!sched) return;
+
+    stats->idle = sched->idle;
+    stats->wakeups = sched->wakeups;
+    if (sched->started_ns > 0) {
+        stats->elapsed_s = (double)(vr_get_monotonic_ns() - sched->started_ns) / 1e9;
+    }
+    stats->wakeups_per_s = stats->elapsed_s > 0 ? stats->wakeups / stats->elapsed_s : 0.0;
+}
+
+// Idle mode name for the command line and reports
+const char *vr_idle_mode_name(vr_idle_mode_t idle) {
+    if ((unsigned)idle >= VR_IDLE_MODE_COUNT) return "unknown";
+    return g_idle_mode_names[idle];
+}
@@ -0,0 +1,358 @@
+#include "vr_telemetry.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Sensor waveform synthesis.
+//
+// vr_synth_sample() is the reference: one sample, double-precision libm, as
+// the simulator has always computed it. vr_synth_samples() evaluates
+// VR_SYNTH_LANES samples at a time in structure-of-arrays form using GCC
+// vector extensions. Its single-precision sin/cos polynomials run after a
+// range reduction done in double, so accuracy does not decay as the
+// simulation time grows. The same kernel is compiled once for the baseline
+// ISA (SSE2 on x86-64, NEON on AArch64) and once for AVX2, and the build to
+// use is picked from the CPU at runtime. The Makefile passes
+// -ffp-contract=off, so the AVX2 build cannot fuse multiply-adds into FMA
+// and both builds produce bit-identical samples.
+
+#define VR_SYNTH_ISA_COUNT 3
+
+typedef float vr_v8sf __attribute__((vector_size(32)));
+typedef float vr_v4sf __attribute__((vector_size(16)));
+typedef int32_t vr_v8si __attribute__((vector_size(32)));
+typedef double vr_v4df __attribute__((vector_size(32)));
+typedef int64_t vr_v4di __attribute__((vector_size(32)));
+
+typedef union {
+    vr_v8sf v;
+    vr_v4sf half[2];
+} vr_v8sf_halves_t;
+
+typedef union {
+    vr_v8si v;
+    int32_t lane[VR_SYNTH_LANES];
+} vr_v8si_lanes_t;
+
+// One block of samples in structure-of-arrays form
+typedef struct {
+    vr_v8sf head_x, head_y, head_z;
+    vr_v8sf orient_x, orient_y, orient_z;
+    vr_v8sf left_eye_x, left_eye_y, left_pupil;
+    vr_v8sf right_eye_x, right_eye_y, right_pupil;
+    vr_v8sf left_hand_x, right_hand_x, hand_y, hand_z, grip;
+    vr_v8sf cpu, gpu;
+    vr_v4di blinking[2];           // All ones where blinking
+    vr_v4di connected[2];          // All ones where connected
+} vr_synth_block_t;
+
+typedef void (*vr_synth_block_fn_t)(const float *times, vr_synth_block_t *out);
+
+typedef struct {
+    const char *name;
+    vr_synth_block_fn_t block;     // NULL = scalar reference
+    bool (*supported)(void);
+} vr_synth_isa_t;
+
+// Vector helpers are always inlined, so the AVX return-value ABI never applies
+#pragma GCC diagnostic ignored "-Wpsabi"
+#define VR_ALWAYS_INLINE static inline __attribute__((always_inline))
+
+#define VR_2_OVER_PI   0.63661977236758134308
+#define VR_PIO2_HI     1.57079632679489655800  // pi/2 split so k * pi/2 stays exact
+#define VR_PIO2_LO     6.12323399573676603587e-17
+#define VR_ROUND_MAGIC 6755399441055744.0      // 1.5 * 2^52: adding it rounds to an integer
+
+// Round to the nearest integer (|x| < 2^51)
+#define VR_V4DF_ROUND(x) (((x) + VR_ROUND_MAGIC) - VR_ROUND_MAGIC)
+
+// x - floor(x / m) * m for x >= 0; exact for float inputs, like fmod()
+VR_ALWAYS_INLINE vr_v4df vr_v4df_mod(const vr_v4df *x, double m) {
+    vr_v4df k = *x / m;
+    vr_v4df r = VR_V4DF_ROUND(k);
+    r += __builtin_convertvector(r > k, vr_v4df);  // Mask is -1 where rounding went up
+    return *x - r * m;
+}
+
+// Reduce x to r in [-pi/4, pi/4] with x = r + q * pi/2
+VR_ALWAYS_INLINE void vr_synth_reduce(const vr_v8sf *x, vr_v8sf *r, vr_v8si *q) {
+    vr_v8sf_halves_t in = { .v = *x };
+    vr_v8sf_halves_t out;
+    vr_v8si_lanes_t quadrant;
+
+    for (int h = 0; h < 2; h++) {
+        vr_v4df xd = __builtin_convertvector(in.half[h], vr_v4df);
+        vr_v4df k = VR_V4DF_ROUND(xd * VR_2_OVER_PI);
+        vr_v4df rd = (xd - k * VR_PIO2_HI) - k * VR_PIO2_LO;
+        vr_v4di kq = __builtin_convertvector(k, vr_v4di);
+
+        out.half[h] = __builtin_convertvector(rd, vr_v4sf);
+        for (int i = 0; i < 4; i++) {
+            quadrant.lane[h * 4 + i] = (int32_t)kq[i];
+        }
+    }
+    *r = out.v;
+    *q = quadrant.v;
+}
+
+// sin and cos of t * freq; polynomial coefficients from Cephes sinf/cosf
+VR_ALWAYS_INLINE void vr_synth_sincos(const vr_v8sf *t, float freq, vr_v8sf *sin_out, vr_v8sf *cos_out) {
+    vr_v8sf x = *t * freq;
+    vr_v8sf r;
+    vr_v8si q;
+    vr_synth_reduce(&x, &r, &q);
+
+    vr_v8sf z = r * r;
+    vr_v8sf s = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    vr_v8sf c = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z
+                - 0.5f * z + 1.0f;
+
+    // Odd quadrants swap sin and cos; quadrants 2-3 negate sin, 1-2 negate cos
+    vr_v8si swap = (q & 1) != 0;
+    vr_v8si si = (vr_v8si)s;
+    vr_v8si ci = (vr_v8si)c;
+    vr_v8si sin_bits = (swap & ci) | (~swap & si);
+    vr_v8si cos_bits = (swap & si) | (~swap & ci);
+    sin_bits ^= ((q & 2) != 0) & INT32_MIN;
+    cos_bits ^= (((q + 1) & 2) != 0) & INT32_MIN;
+
+    *sin_out = (vr_v8sf)sin_bits;
+    *cos_out = (vr_v8sf)cos_bits;
+}
+
+VR_ALWAYS_INLINE vr_v8sf vr_synth_sin(const vr_v8sf *t, float freq) {
+    vr_v8sf s, c;
+    vr_synth_sincos(t, freq, &s, &c);
+    return s;
+}
+
+VR_ALWAYS_INLINE vr_v8sf vr_synth_cos(const vr_v8sf *t, float freq) {
+    vr_v8sf s, c;
+    vr_synth_sincos(t, freq, &s, &c);
+    return c;
+}
+
+// Evaluate every waveform for VR_SYNTH_LANES sample times
+VR_ALWAYS_INLINE void vr_synth_block_impl(const float *times, vr_synth_block_t *out) {
+    vr_v8sf t;
+    memcpy(&t, times, sizeof(t));
+
+    // Head movement and orientation
+    vr_v8sf sin_05 = vr_synth_sin(&t, 0.5f);
+    vr_v8sf sin_04, cos_04;
+    vr_synth_sincos(&t, 0.4f, &sin_04, &cos_04);
+    out->head_x = sin_05 * 0.1f;
+    out->head_y = 1.7f + vr_synth_sin(&t, 0.3f) * 0.02f;
+    out->head_z = cos_04 * 0.1f;
+    out->orient_x = vr_synth_sin(&t, 0.2f) * 0.1f;
+    out->orient_y = vr_synth_sin(&t, 0.15f) * 0.2f;
+    out->orient_z = vr_synth_sin(&t, 0.1f) * 0.05f;
+
+    // Eye tracking
+    out->left_eye_x = 0.5f + vr_synth_sin(&t, 2.0f) * 0.1f;
+    out->left_eye_y = 0.5f + vr_synth_cos(&t, 1.5f) * 0.1f;
+    out->left_pupil = 3.5f + sin_05 * 0.5f;
+    out->right_eye_x = 0.5f + vr_synth_sin(&t, 2.1f) * 0.1f;
+    out->right_eye_y = 0.5f + vr_synth_cos(&t, 1.6f) * 0.1f;
+    out->right_pupil = 3.5f + vr_synth_sin(&t, 0.51f) * 0.5f;
+
+    // Hand tracking; both hands share y, z and grip
+    out->left_hand_x = 0.3f + vr_synth_sin(&t, 1.0f) * 0.2f;
+    out->right_hand_x = -0.3f + vr_synth_sin(&t, 1.1f) * 0.2f;
+    out->hand_y = 1.2f + vr_synth_cos(&t, 0.7f) * 0.3f;
+    out->hand_z = 0.1f + vr_synth_sin(&t, 1.2f) * 0.15f;
+    out->grip = 0.5f + sin_04 * 0.3f;
+
+    // System metrics
+    out->cpu = 45.0f + vr_synth_sin(&t, 0.8f) * 10.0f;
+    out->gpu = 60.0f + vr_synth_cos(&t, 0.6f) * 15.0f;
+
+    // Blink and connection flags use the same double-precision remainders as fmod()
+    vr_v8sf_halves_t halves = { .v = t };
+    for (int h = 0; h < 2; h++) {
+        vr_v4df td = __builtin_convertvector(halves.half[h], vr_v4df);
+        out->blinking[h] = vr_v4df_mod(&td, 3.0) > (double)2.9f;
+        out->connected[h] = (td < 300.0) | (vr_v4df_mod(&td, 60.0) < 58.0);
+    }
+}
+
+static void vr_synth_block_baseline(const float *times, vr_synth_block_t *out) {
+    vr_synth_block_impl(times, out);
+}
+
+static bool vr_synth_always_supported(void) {
+    return true;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2,fma")))
+static void vr_synth_block_avx2(const float *times, vr_synth_block_t *out) {
+    vr_synth_block_impl(times, out);
+}
+
+static bool vr_synth_avx2_supported(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#define VR_SYNTH_BASELINE_NAME "sse2"
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define VR_SYNTH_BASELINE_NAME "neon"
+#else
+#define VR_SYNTH_BASELINE_NAME "generic"
+#endif
+
+// Preferred first; "auto" picks the first one the CPU supports
+static const vr_synth_isa_t g_synth_isas[VR_SYNTH_ISA_COUNT] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { "avx2", vr_synth_block_avx2, vr_synth_avx2_supported },
+#else
+    { NULL, NULL, NULL },
+#endif
+    { VR_SYNTH_BASELINE_NAME, vr_synth_block_baseline, vr_synth_always_supported },
+    { "scalar", NULL, vr_synth_always_supported },
+};
+
+static const vr_synth_isa_t *g_synth_isa = NULL;  // Set on first use or by vr_synth_select()
+
+// Choose the kernel: "auto", "scalar", or an ISA name from vr_synth_get_isa()
+int vr_synth_select(const char *isa) {
+    bool pick_auto = !isa || strcmp(isa, "auto") == 0;
+
+    for (int i = 0; i < VR_SYNTH_ISA_COUNT; i++) {
+        const vr_synth_isa_t *candidate = &g_synth_isas[i];
+        if (!candidate->name || !candidate->supported()) continue;
+        if (pick_auto || strcmp(isa, candidate->name) == 0) {
+            __atomic_store_n(&g_synth_isa, candidate, __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static const vr_synth_isa_t *vr_synth_current(void) {
+    const vr_synth_isa_t *isa = __atomic_load_n(&g_synth_isa, __ATOMIC_ACQUIRE);
+    if (!isa) {
+        vr_synth_select("auto");
+        isa = __atomic_load_n(&g_synth_isa, __ATOMIC_ACQUIRE);
+    }
+    return isa;
+}
+
+// Name of the kernel vr_synth_samples() uses
+const char *vr_synth_get_isa(void) {
+    return vr_synth_current()->name;
+}
+
+// Synthesize the sample at simulation time t (reference implementation)
+void vr_synth_sample(float simulation_time, vr_telemetry_packet_t *p) {
+    // Simulate head movement
+    p->head_position.x = sin(simulation_time * 0.5f) * 0.1f;
+    p->head_position.y = 1.7f + sin(simulation_time * 0.3f) * 0.02f;
+    p->head_position.z = cos(simulation_time * 0.4f) * 0.1f;
+
+    // Simulate head orientation
+    p->head_orientation.x = sin(simulation_time * 0.2f) * 0.1f;
+    p->head_orientation.y = sin(simulation_time * 0.15f) * 0.2f;
+    p->head_orientation.z = sin(simulation_time * 0.1f) * 0.05f;
+    p->head_orientation.w = sqrt(1.0f -
+        (p->head_orientation.x * p->head_orientation.x +
+         p->head_orientation.y * p->head_orientation.y +
+         p->head_orientation.z * p->head_orientation.z));
+
+    // Simulate eye tracking
+    p->left_eye.x = 0.5f + sin(simulation_time * 2.0f) * 0.1f;
+    p->left_eye.y = 0.5f + cos(simulation_time * 1.5f) * 0.1f;
+    p->left_eye.pupil_diameter = 3.5f + sin(simulation_time * 0.5f) * 0.5f;
+
+    p->right_eye.x = 0.5f + sin(simulation_time * 2.1f) * 0.1f;
+    p->right_eye.y = 0.5f + cos(simulation_time * 1.6f) * 0.1f;
+    p->right_eye.pupil_diameter = 3.5f + sin(simulation_time * 0.51f) * 0.5f;
+
+    // Simulate hand tracking
+    p->left_hand.x = 0.3f + sin(simulation_time) * 0.2f;
+    p->left_hand.y = 1.2f + cos(simulation_time * 0.7f) * 0.3f;
+    p->left_hand.z = 0.1f + sin(simulation_time * 1.2f) * 0.15f;
+    p->left_hand.grip_strength = 0.5f + sin(simulation_time * 0.4f) * 0.3f;
+
+    p->right_hand.x = -0.3f + sin(simulation_time * 1.1f) * 0.2f;
+    p->right_hand.y = 1.2f + cos(simulation_time * 0.7f) * 0.3f;
+    p->right_hand.z = 0.1f + sin(simulation_time * 1.2f) * 0.15f;
+    p->right_hand.grip_strength = 0.5f + sin(simulation_time * 0.4f) * 0.3f;
+
+    // Simulate system metrics
+    p->cpu_usage = 45.0f + sin(simulation_time * 0.8f) * 10.0f;
+    p->gpu_usage = 60.0f + cos(simulation_time * 0.6f) * 15.0f;
+    p->temperature = 35.0f + (p->cpu_usage + p->gpu_usage) * 0.1f;
+    p->battery_level = (uint8_t)(100.0f - simulation_time * 0.1f);
+    bool blinking = fmod(simulation_time, 3.0f) > 2.9f;
+    bool connected = simulation_time < 300.0f || fmod(simulation_time, 60.0f) < 58.0f;
+    p->flags = VR_WIRE_FLAG_LEFT_TRACKING | VR_WIRE_FLAG_RIGHT_TRACKING |
+               (blinking ? VR_WIRE_FLAG_LEFT_BLINKING | VR_WIRE_FLAG_RIGHT_BLINKING : 0) |
+               (connected ? VR_WIRE_FLAG_CONNECTED : 0);
+}
+
+// Copy lane i of a block into a packet (array-of-structures write-back)
+static void vr_synth_store(const vr_synth_block_t *b, int i, float simulation_time,
+                           vr_telemetry_packet_t *p) {
+    p->head_position.x = b->head_x[i];
+    p->head_position.y = b->head_y[i];
+    p->head_position.z = b->head_z[i];
+
+    p->head_orientation.x = b->orient_x[i];
+    p->head_orientation.y = b->orient_y[i];
+    p->head_orientation.z = b->orient_z[i];
+    p->head_orientation.w = sqrtf(1.0f -
+        (p->head_orientation.x * p->head_orientation.x +
+         p->head_orientation.y * p->head_orientation.y +
+         p->head_orientation.z * p->head_orientation.z));
+
+    p->left_eye.x = b->left_eye_x[i];
+    p->left_eye.y = b->left_eye_y[i];
+    p->left_eye.pupil_diameter = b->left_pupil[i];
+    p->right_eye.x = b->right_eye_x[i];
+    p->right_eye.y = b->right_eye_y[i];
+    p->right_eye.pupil_diameter = b->right_pupil[i];
+
+    p->left_hand.x = b->left_hand_x[i];
+    p->left_hand.y = b->hand_y[i];
+    p->left_hand.z = b->hand_z[i];
+    p->left_hand.grip_strength = b->grip[i];
+    p->right_hand.x = b->right_hand_x[i];
+    p->right_hand.y = b->hand_y[i];
+    p->right_hand.z = b->hand_z[i];
+    p->right_hand.grip_strength = b->grip[i];
+
+    p->cpu_usage = b->cpu[i];
+    p->gpu_usage = b->gpu[i];
+    p->temperature = 35.0f + (p->cpu_usage + p->gpu_usage) * 0.1f;
+    p->battery_level = (uint8_t)(100.0f - simulation_time * 0.1f);
+    p->flags = VR_WIRE_FLAG_LEFT_TRACKING | VR_WIRE_FLAG_RIGHT_TRACKING |
+               (b->blinking[i / 4][i % 4] ? VR_WIRE_FLAG_LEFT_BLINKING | VR_WIRE_FLAG_RIGHT_BLINKING : 0) |
+               (b->connected[i / 4][i % 4] ? VR_WIRE_FLAG_CONNECTED : 0);
+}
+
+// Synthesize packets[i] at simulation time times[i]; any number of samples,
+// e.g. many devices at one instant or one device over many timesteps
+void vr_synth_samples(const float *times, vr_telemetry_packet_t *const *packets, uint32_t count) {
+    if (!times || !packets) return;
+
+    const vr_synth_isa_t *isa = vr_synth_current();
+    if (!isa->block) {
+        for (uint32_t i = 0; i < count; i++) {
+            vr_synth_sample(times[i], packets[i]);
+        }
+        return;
+    }
+
+    vr_synth_block_t block;
+    for (uint32_t base = 0; base < count; base += VR_SYNTH_LANES) {
+        uint32_t lanes = count - base < VR_SYNTH_LANES ? count - base : VR_SYNTH_LANES;
+        float t[VR_SYNTH_LANES] = { 0 };
+        memcpy(t, &times[base], lanes * sizeof(float));
+
+        isa->block(t, &block);
+        for (uint32_t i = 0; i < lanes; i++) {
+            vr_synth_store(&block, (int)i, t[i], packets[base + i]);
+        }
+    }
+}
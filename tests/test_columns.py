@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Column Ingest Tests
+
+Checks python/vr_columns.py: ColumnRing keeps the most recent `capacity`
+frames in order across wraparound, when the head lands exactly on a
+multiple of the capacity, and when one message holds more frames than
+the ring; and decode_columns' vectorized binary path produces the same
+columns as decoding with vr_wire and flattening, for every frame and
+batch tests/vr_tests.c --dump writes.
+
+Usage: python tests/test_columns.py   (VR_TESTS=path/to/vr_tests, default bin/vr_tests)
+Skipped when numpy is not installed.
+"""
+
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import test_wire  # noqa: E402  (also puts python/ on the path)
+import vr_wire  # noqa: E402
+
+try:
+    import numpy as np
+    import vr_columns
+except ImportError:
+    np = None
+
+
+def make_frames(first, count):
+    """FrameColumns of `count` frames whose every field is derived from its frame id"""
+    frame_id = np.arange(first, first + count, dtype=np.int64)
+    values = (frame_id[:, None] + np.arange(len(vr_columns.VALUE_COLUMNS)) / 100.0).astype(np.float32)
+    return vr_columns.FrameColumns(frame_id * 10, frame_id, (frame_id % 32).astype(np.uint8),
+                                   np.full(count, vr_wire.SECTION_ALL, dtype=np.uint8), values)
+
+
+@unittest.skipIf(np is None, "numpy is not installed")
+class TestColumnRing(unittest.TestCase):
+    CAPACITY = 8
+
+    def setUp(self):
+        self.ring = vr_columns.ColumnRing(self.CAPACITY)
+        self.appended = []            # (frame_id, received_us) of every frame appended
+        self.next_id = 0
+
+    def append(self, count):
+        received_us = 1000 + len(self.appended)
+        self.ring.append(make_frames(self.next_id, count), received_us)
+        self.appended += [(self.next_id + i, received_us) for i in range(count)]
+        self.next_id += count
+
+    def assertLatest(self, count=None):
+        kept = self.appended[-self.CAPACITY:]
+        expected = kept if count is None else kept[len(kept) - min(count, len(kept)):]
+        latest = self.ring.latest(count)
+        ids = [frame_id for frame_id, _ in expected]
+        self.assertEqual(len(self.ring), len(kept))
+        self.assertEqual(latest['frame_id'].tolist(), ids)
+        self.assertEqual(latest['timestamp_us'].tolist(), [i * 10 for i in ids])
+        self.assertEqual(latest['flags'].tolist(), [i % 32 for i in ids])
+        self.assertEqual(latest['received_us'].tolist(), [received for _, received in expected])
+        for column in (0, 17, len(vr_columns.VALUE_COLUMNS) - 1):
+            name = vr_columns.VALUE_COLUMNS[column]
+            expected_values = np.array(ids, dtype=np.float64) + column / 100.0
+            np.testing.assert_array_equal(latest[name], expected_values.astype(np.float32), err_msg=name)
+
+    def test_empty(self):
+        self.assertEqual(len(self.ring), 0)
+        self.assertEqual(len(self.ring.latest()['frame_id']), 0)
+        self.append(0)
+        self.assertEqual(self.ring.head, 0)
+
+    def test_head_on_a_multiple_of_the_capacity(self):
+        for _ in range(3):
+            self.append(self.CAPACITY)
+            self.assertEqual(self.ring.head % self.CAPACITY, 0)
+            self.assertLatest()
+            self.assertLatest(3)
+        self.append(2)
+        self.append(self.CAPACITY - 2)
+        self.assertEqual(self.ring.head % self.CAPACITY, 0)
+        self.assertLatest()
+
+    def test_wraparound(self):
+        for size in (3, 5, 1, 7, 2, 3, 8, 6, 4, 3, 3, 3):
+            self.append(size)
+            self.assertLatest()
+            self.assertLatest(1)
+            self.assertLatest(5)
+            self.assertLatest(0)
+            self.assertLatest(self.CAPACITY + 3)
+
+    def test_message_larger_than_the_ring(self):
+        self.append(3)
+        self.append(self.CAPACITY * 2 + 5)
+        self.assertEqual(self.ring.head, 3 + self.CAPACITY * 2 + 5)
+        self.assertLatest()
+        self.append(4)
+        self.assertLatest()
+
+    def test_column_subset(self):
+        self.append(11)
+        latest = self.ring.latest(4, columns=('frame_id', 'cpu_usage'))
+        self.assertEqual(sorted(latest), ['cpu_usage', 'frame_id'])
+        self.assertEqual(latest['frame_id'].tolist(), [7, 8, 9, 10])
+
+
+@unittest.skipIf(np is None, "numpy is not installed")
+class TestDecodeColumns(test_wire.WireTestCase):
+    """The vectorized path against vr_wire for the C encoders' own messages"""
+
+    def assertColumnsEqual(self, actual, expected, name):
+        for field in ('timestamp_us', 'frame_id', 'flags', 'sections'):
+            np.testing.assert_array_equal(getattr(actual, field), getattr(expected, field),
+                                          err_msg=f"{name}: {field}")
+        np.testing.assert_array_equal(actual.values, expected.values, err_msg=f"{name}: values")
+
+    def check(self, prefix):
+        for record in self.messages(prefix):
+            with self.subTest(record['name']):
+                body = bytes.fromhex(record['body'])
+                actual = vr_columns.decode_columns(body, record['content_type'])
+                expected = vr_columns.columns_from_frames(vr_wire.decode_message(body, record['content_type']))
+                self.assertEqual(len(actual), len(record['packets']))
+                self.assertColumnsEqual(actual, expected, record['name'])
+
+    def test_binary_frames(self):
+        self.check('binary_frame')
+
+    def test_binary_batches(self):
+        self.check('binary_batch')
+
+    def test_complete_batches_take_the_vectorized_path(self):
+        record = self.messages(f"binary_batch_{vr_wire.SECTION_ALL:x}")[0]
+        flatten = vr_columns.columns_from_frames
+        vr_columns.columns_from_frames = None
+        try:
+            frames = vr_columns.decode_columns(bytes.fromhex(record['body']), record['content_type'])
+        finally:
+            vr_columns.columns_from_frames = flatten
+        self.assertEqual(frames.frame_id.tolist(), [p['frame_id'] for p in record['packets']])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+Column Export Tests
+
+Checks python/vr_export.py: ColumnExporter writes row groups of exactly
+row_group frames, carrying the rest of a message into the next group; the
+files read back with the export schema's types and every frame in order;
+a file is closed once it reaches its size limit or its age limit; and
+messages submitted while the queue is full are counted as dropped. Every
+check runs for both Parquet and Arrow IPC files.
+
+Usage: python tests/test_export.py
+Skipped when numpy or pyarrow is not installed.
+"""
+
+import os
+import queue
+import shutil
+import sys
+import tempfile
+import time
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import test_wire  # noqa: E402,F401  (puts python/ on the path)
+
+try:
+    import pyarrow as pa
+    import pyarrow.ipc
+    import pyarrow.parquet
+    import vr_export
+    from test_columns import make_frames
+except ImportError:
+    vr_export = None
+
+
+@unittest.skipIf(vr_export is None, "numpy or pyarrow is not installed")
+class TestColumnExporter(unittest.TestCase):
+    def setUp(self):
+        self.base = tempfile.mkdtemp(prefix='vr_export_test_')
+        self.directory = self.base
+        self.next_id = 0
+
+    def tearDown(self):
+        shutil.rmtree(self.base)
+
+    def exporter(self, fmt, **kwargs):
+        """A started exporter writing to a fresh directory for this format"""
+        self.directory = os.path.join(self.base, fmt)
+        self.next_id = 0
+        exporter = vr_export.ColumnExporter(self.directory, fmt, **kwargs)
+        exporter.start()
+        return exporter
+
+    def submit(self, exporter, count):
+        exporter.submit(make_frames(self.next_id, count), 1000 + self.next_id)
+        self.next_id += count
+
+    def files(self):
+        return [os.path.join(self.directory, name) for name in sorted(os.listdir(self.directory))]
+
+    def row_groups(self, path, fmt):
+        """Each row group (Parquet) or record batch (Arrow IPC) of a file as a table"""
+        if fmt == 'parquet':
+            reader = pyarrow.parquet.ParquetFile(path)
+            return [reader.read_row_group(i) for i in range(reader.num_row_groups)]
+        with pa.OSFile(path, 'rb') as source:
+            reader = pyarrow.ipc.open_file(source)
+            return [pa.Table.from_batches([reader.get_batch(i)]) for i in range(reader.num_record_batches)]
+
+    def assertGroups(self, fmt, expected):
+        """Files hold row groups of the expected sizes, and all frames submitted, in order"""
+        files = self.files()
+        groups = [self.row_groups(path, fmt) for path in files]
+        self.assertEqual([[group.num_rows for group in file] for file in groups], expected)
+
+        frame_ids, received = [], []
+        for group in (group for file in groups for group in file):
+            self.assertEqual([(field.name, field.type) for field in group.schema],
+                             [(field.name, field.type) for field in vr_export.SCHEMA])
+            frame_ids += group.column('frame_id').to_pylist()
+            received += group.column('received_us').to_pylist()
+        self.assertEqual(frame_ids, list(range(self.next_id)))
+        self.assertEqual(len(received), self.next_id)
+
+    def test_schema_types(self):
+        types = {field.name: field.type for field in vr_export.SCHEMA}
+        self.assertEqual(types['timestamp_us'], pa.int64())
+        self.assertEqual(types['frame_id'], pa.int64())
+        self.assertEqual(types['received_us'], pa.int64())
+        self.assertEqual(types['flags'], pa.uint8())
+        self.assertEqual(types['sections'], pa.uint8())
+        self.assertEqual(types['head_position_x'], pa.float32())
+        self.assertEqual(types['cpu_usage'], pa.float32())
+
+    def test_row_groups_are_cut_at_the_row_group_size(self):
+        for fmt in vr_export.EXPORT_FORMATS:
+            with self.subTest(fmt):
+                exporter = self.exporter(fmt, row_group=10, rotate_mb=0, rotate_s=0)
+                for count in (7, 7, 7, 4, 23):
+                    self.submit(exporter, count)
+                exporter.stop()
+                self.assertGroups(fmt, [[10, 10, 10, 10, 8]])
+                self.assertEqual(exporter.stats['frames_written'], 48)
+                self.assertEqual(exporter.stats['row_groups'], 5)
+                self.assertEqual(exporter.stats['files'], 1)
+
+    def test_rotation_by_size(self):
+        for fmt in vr_export.EXPORT_FORMATS:
+            with self.subTest(fmt):
+                exporter = self.exporter(fmt, row_group=6, rotate_mb=0, rotate_s=0)
+                exporter.rotate_bytes = 1  # Every row group fills a file
+                for count in (4, 4, 4, 3):
+                    self.submit(exporter, count)
+                exporter.stop()
+                self.assertGroups(fmt, [[6], [6], [3]])
+                self.assertEqual(exporter.stats['files'], 3)
+
+    def test_rotation_by_age(self):
+        for fmt in vr_export.EXPORT_FORMATS:
+            with self.subTest(fmt):
+                exporter = self.exporter(fmt, row_group=5, rotate_mb=0, rotate_s=0.5)
+                self.submit(exporter, 5)       # Opens the first file
+                time.sleep(0.7)                # Past its age, before the writer's 1 s idle wake-up
+                self.submit(exporter, 3)       # Flushed into the aged file, which is then closed
+                self.submit(exporter, 5)       # Opens the second file
+                exporter.stop()
+                self.assertGroups(fmt, [[5, 3], [5]])
+                self.assertEqual(exporter.stats['files'], 2)
+
+    def test_full_queue_drops(self):
+        exporter = vr_export.ColumnExporter(self.directory)
+        exporter.queue = queue.Queue(maxsize=2)  # Writer thread not started: nothing drains it
+        for expected_drops in (0, 0, 1, 2):
+            self.submit(exporter, 1)
+            self.assertEqual(exporter.stats['messages_dropped'], expected_drops)
+        self.assertEqual(exporter.queue.qsize(), 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
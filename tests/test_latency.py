@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""
+Latency Window Tests
+
+Checks the consumer's latency bookkeeping in python/vr_consumer.py:
+LatencyWindow keeps exactly the most recent `size` samples across
+wraparound, whether they arrive one at a time, in arrays that wrap the
+end of the window, or in one array longer than the window; and
+latency_summary's count, p50, p99 and max match values worked out by hand.
+
+Usage: python tests/test_latency.py
+Skipped when the consumer's dependencies (numpy, pika, ...) are not installed.
+"""
+
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import test_wire  # noqa: E402,F401  (puts python/ on the path)
+
+try:
+    import numpy as np
+    import vr_consumer
+except ImportError:
+    vr_consumer = None
+
+
+@unittest.skipIf(vr_consumer is None, "the consumer's dependencies are not installed")
+class TestLatencyWindow(unittest.TestCase):
+    SIZE = 5
+
+    def setUp(self):
+        self.window = vr_consumer.LatencyWindow(self.SIZE)
+        self.added = []
+
+    def extend(self, values):
+        self.window.extend(np.array(values, dtype=np.float64))
+        self.added += list(values)
+
+    def add(self, value):
+        self.window.add(value)
+        self.added.append(value)
+
+    def assertLatest(self):
+        """The window holds the last SIZE samples added (in any order)"""
+        kept = self.added[-self.SIZE:]
+        self.assertEqual(sorted(self.window.values().tolist()), sorted(kept))
+
+    def test_empty(self):
+        self.assertEqual(len(self.window.values()), 0)
+        self.extend([])
+        self.assertEqual(len(self.window.values()), 0)
+        self.assertEqual(self.window.summary()['count'], 0)
+
+    def test_wraparound(self):
+        self.extend([1, 2, 3])
+        self.assertLatest()
+        self.extend([4, 5, 6, 7])      # Fills the end of the window, then wraps to the start
+        self.assertLatest()
+        self.assertEqual(self.window.samples.tolist(), [6, 7, 3, 4, 5])
+        self.add(8)
+        self.assertLatest()
+        self.extend([9, 10, 11, 12, 13])  # Exactly one window, starting mid-window
+        self.assertLatest()
+
+    def test_input_longer_than_the_window(self):
+        self.extend([1, 2, 3])
+        self.extend(list(range(100, 112)))
+        self.assertLatest()
+        self.assertEqual(sorted(self.window.values().tolist()), [107, 108, 109, 110, 111])
+        self.extend(list(range(200, 200 + 3 * self.SIZE)))
+        self.assertLatest()
+
+    def test_random_sizes(self):
+        rng = np.random.default_rng(18)
+        for _ in range(200):
+            count = int(rng.integers(0, 2 * self.SIZE + 2))
+            if count == 1 and rng.integers(2):
+                self.add(float(rng.integers(1000)))
+            else:
+                self.extend(rng.integers(1000, size=count).astype(np.float64).tolist())
+            self.assertLatest()
+
+
+@unittest.skipIf(vr_consumer is None, "the consumer's dependencies are not installed")
+class TestLatencySummary(unittest.TestCase):
+    def test_empty(self):
+        self.assertEqual(vr_consumer.latency_summary([]),
+                         {'count': 0, 'p50_ms': None, 'p99_ms': None, 'max_ms': None})
+
+    def test_percentiles(self):
+        # 1..10 ms: p50 halfway between the 5th and 6th samples, p99 at rank
+        # 0.99 * 9 = 8.91, i.e. 91% of the way from the 9th sample to the 10th
+        summary = vr_consumer.latency_summary(np.arange(10, 0, -1) * 1000)
+        self.assertEqual(summary['count'], 10)
+        self.assertAlmostEqual(summary['p50_ms'], 5.5)
+        self.assertAlmostEqual(summary['p99_ms'], 9.91)
+        self.assertAlmostEqual(summary['max_ms'], 10.0)
+
+    def test_single_sample(self):
+        summary = vr_consumer.latency_summary([2500])
+        self.assertEqual(summary, {'count': 1, 'p50_ms': 2.5, 'p99_ms': 2.5, 'max_ms': 2.5})
+
+    def test_window_summary_covers_only_the_window(self):
+        window = vr_consumer.LatencyWindow(4)
+        window.extend(np.array([90000, 1000, 2000, 3000, 4000], dtype=np.float64))  # 90 ms falls out
+        summary = window.summary()
+        self.assertEqual(summary['count'], 4)
+        self.assertAlmostEqual(summary['p50_ms'], 2.5)
+        self.assertAlmostEqual(summary['p99_ms'], 3.97)
+        self.assertAlmostEqual(summary['max_ms'], 4.0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+Consumer Pool Tests
+
+Checks python/vr_pool.py without a broker: per-device routing keys match
+the C producer's vr_device_format_routing_key, device sharding gives every
+device to exactly one worker and spreads them evenly, hash_keys and
+hash_sharding_problem tell literal keys from patterns and refuse a setup
+that would leave all but one worker idle, and ConsumerPool merges fake
+worker reports into pool-wide totals, rates and latency percentiles.
+
+Usage: python tests/test_pool.py
+Skipped when the consumer's dependencies (numpy, pika, ...) are not installed.
+"""
+
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import test_wire  # noqa: E402,F401  (puts python/ on the path)
+
+try:
+    import numpy as np
+    import vr_pool
+    from vr_consumer import LATENCY_STAGES
+except ImportError:
+    vr_pool = None
+
+
+def report(index, messages, frames, start_us, last_us, **latency_us):
+    """A worker report as ShardConsumer.report sends it"""
+    return {'index': index, 'total_messages': messages, 'total_frames': frames,
+            'start_us': start_us, 'last_message_us': last_us,
+            'latency': {stage: np.array(latency_us.get(stage, []), dtype=np.float64)
+                        for stage in LATENCY_STAGES},
+            'export': None}
+
+
+@unittest.skipIf(vr_pool is None, "the consumer's dependencies are not installed")
+class TestRoutingKeys(unittest.TestCase):
+    def test_device_routing_key(self):
+        # The C producer's cases (tests/vr_tests.c test_device_routing_key), plus a '*' segment
+        cases = [('telemetry.data', 7, 'telemetry.7.data'),
+                 ('telemetry.data', 0, 'telemetry.0.data'),
+                 ('telemetry.data', 4294967295, 'telemetry.4294967295.data'),
+                 ('vr.telemetry.pose', 12, 'vr.telemetry.12.pose'),
+                 ('telemetry', 3, 'telemetry.3'),
+                 ('telemetry.', 3, 'telemetry.3.'),
+                 ('.data', 3, '.3.data'),
+                 ('', 3, '.3'),
+                 ('telemetry.*.data', 5, 'telemetry.5.data'),
+                 ('vr.*', 5, 'vr.5')]
+        for base, device_id, expected in cases:
+            with self.subTest(base=base, device_id=device_id):
+                self.assertEqual(vr_pool.device_routing_key(base, device_id), expected)
+
+    def test_device_shards_cover_every_device_once(self):
+        for devices, workers in ((10, 1), (10, 3), (10, 4), (3, 8), (1000, 7)):
+            with self.subTest(devices=devices, workers=workers):
+                shards = [vr_pool.device_shard_keys('telemetry.data', index, workers, devices)
+                          for index in range(workers)]
+                keys = [key for shard in shards for key in shard]
+                self.assertEqual(sorted(keys), sorted(f"telemetry.{d}.data" for d in range(devices)))
+                sizes = [len(shard) for shard in shards]
+                self.assertLessEqual(max(sizes) - min(sizes), 1)
+                again = [vr_pool.device_shard_keys('telemetry.data', index, workers, devices)
+                         for index in range(workers)]
+                self.assertEqual(again, shards)
+
+    def test_device_shards_of_several_bases(self):
+        keys = vr_pool.device_shard_keys(' telemetry.data , telemetry.*.eyes,', 1, 2, 5)
+        self.assertEqual(keys, ['telemetry.1.data', 'telemetry.3.data', 'telemetry.1.eyes', 'telemetry.3.eyes'])
+
+    def test_hash_keys(self):
+        self.assertEqual(vr_pool.hash_keys('telemetry.data'), ['telemetry.data'])
+        self.assertEqual(vr_pool.hash_keys(' a.data, b.data ,,c.data '), ['a.data', 'b.data', 'c.data'])
+        self.assertEqual(vr_pool.hash_keys(''), [])
+        self.assertIsNone(vr_pool.hash_keys('telemetry.*.data'))
+        self.assertIsNone(vr_pool.hash_keys('a.data,telemetry.#'))
+        self.assertEqual(vr_pool.hash_keys('telemetry.star*.data'), ['telemetry.star*.data'])
+
+    def test_hash_sharding_problem(self):
+        for key in ('telemetry.data', '', ' telemetry.data, '):
+            with self.subTest(key=key):
+                self.assertIsNotNone(vr_pool.hash_sharding_problem(key, 4))
+        self.assertIsNone(vr_pool.hash_sharding_problem('telemetry.data', 1))
+        self.assertIsNone(vr_pool.hash_sharding_problem('telemetry.*.data', 4))
+        self.assertIsNone(vr_pool.hash_sharding_problem('#', 4))
+        self.assertIsNone(vr_pool.hash_sharding_problem('a.data,b.data', 4))  # Warned about, not refused
+
+    def test_pool_refuses_a_bad_setup(self):
+        with self.assertRaises(ValueError):
+            vr_pool.ConsumerPool(4, shard_by='hash', routing_key='telemetry.data')
+        with self.assertRaises(ValueError):
+            vr_pool.ConsumerPool(4, shard_by='device', devices=0, routing_key='telemetry.data')
+        with self.assertRaises(ValueError):
+            vr_pool.ConsumerPool(4, shard_by='round-robin', routing_key='telemetry.*.data')
+
+
+@unittest.skipIf(vr_pool is None, "the consumer's dependencies are not installed")
+class TestPoolStatistics(unittest.TestCase):
+    def setUp(self):
+        self.pool = vr_pool.ConsumerPool(3, shard_by='device', devices=6, routing_key='telemetry.data')
+
+    def test_no_reports(self):
+        stats = self.pool.get_statistics()
+        self.assertEqual((stats['workers'], stats['reporting']), (3, 0))
+        self.assertEqual((stats['total_messages'], stats['total_frames']), (0, 0))
+        for stage in LATENCY_STAGES:
+            self.assertEqual(stats['latency'][stage]['count'], 0)
+
+    def test_reports_are_merged(self):
+        self.pool.reports.put(report(0, 1, 1, 0, 1000000))  # Superseded by worker 0's next report
+        self.pool.reports.put(report(0, 10, 100, 1000000, 3000000,
+                                     sample_to_receive=[1000, 2000, 3000], sample_to_publish=[250]))
+        self.pool.reports.put(report(1, 30, 60, 0, 1000000, sample_to_receive=[4000, 5000]))
+        self.pool.reports.put(report(2, 0, 0, None, None))     # No message yet
+        self.pool.collect(timeout=1.0)
+        self.assertEqual(sorted(self.pool.latest), [0, 1, 2])
+
+        stats = self.pool.get_statistics()
+        self.assertEqual((stats['workers'], stats['reporting']), (3, 3))
+        self.assertEqual(stats['total_messages'], 40)
+        self.assertEqual(stats['total_frames'], 160)
+        self.assertAlmostEqual(stats['message_rate'], 10 / 2.0 + 30 / 1.0)
+        self.assertAlmostEqual(stats['frame_rate'], 100 / 2.0 + 60 / 1.0)
+
+        # 1..5 ms pooled: p50 is the middle sample, p99 interpolates 96% of the way from 4 to 5
+        e2e = stats['latency']['sample_to_receive']
+        self.assertEqual(e2e['count'], 5)
+        self.assertAlmostEqual(e2e['p50_ms'], 3.0)
+        self.assertAlmostEqual(e2e['p99_ms'], 4.96)
+        self.assertAlmostEqual(e2e['max_ms'], 5.0)
+        publish = stats['latency']['sample_to_publish']
+        self.assertEqual(publish['count'], 1)
+        self.assertAlmostEqual(publish['p50_ms'], 0.25)
+        self.assertEqual(stats['latency']['publish_to_receive']['count'], 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,277 @@
+#!/usr/bin/env python3
+"""
+Wire Format Round-Trip Tests
+
+Decodes every message tests/vr_tests.c --dump writes (JSON, binary frames,
+sections and batches for every section mask, and delta streams) with
+python/vr_wire.py and compares the frames with the packets the C encoders
+were given. Binary floats must match exactly, JSON to its printed
+precision, and delta frames both exactly against the quantized fields and
+to within the quantization step of the original values.
+
+Usage: python tests/test_wire.py   (VR_TESTS=path/to/vr_tests, default bin/vr_tests)
+"""
+
+import json
+import math
+import os
+import struct
+import subprocess
+import sys
+import unittest
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.insert(0, os.path.join(ROOT, 'python'))
+
+import vr_wire  # noqa: E402
+
+VR_TESTS = os.environ.get('VR_TESTS', os.path.join(ROOT, 'bin', 'vr_tests'))
+
+SECTION_KEYS = {
+    vr_wire.SECTION_HEAD: ('head_position', 'head_orientation', 'head_acceleration', 'head_angular_velocity'),
+    vr_wire.SECTION_EYES: ('left_eye', 'right_eye'),
+    vr_wire.SECTION_HANDS: ('left_hand', 'right_hand'),
+    vr_wire.SECTION_STATUS: ('cpu_usage', 'gpu_usage', 'temperature', 'battery_level', 'is_connected'),
+}
+
+# Quantized field ranges of each section and the flags that belong to it
+# (the VR_WIRE_TYPE_DELTA table in include/vr_telemetry.h)
+QUANT_RANGES = {vr_wire.SECTION_HEAD: (2, 15), vr_wire.SECTION_EYES: (15, 21),
+                vr_wire.SECTION_HANDS: (21, 37), vr_wire.SECTION_STATUS: (37, 41)}
+SECTION_FLAGS = {vr_wire.SECTION_HEAD: 0x00, vr_wire.SECTION_EYES: 0x03,
+                 vr_wire.SECTION_HANDS: 0x0C, vr_wire.SECTION_STATUS: 0x10}
+
+JSON_F6_TOLERANCE = 5.01e-7    # %.6f
+JSON_F2_TOLERANCE = 5.01e-3    # %.2f status fields
+
+
+def f32(value):
+    """Round a float to binary32, as the C side stores it"""
+    return struct.unpack('<f', struct.pack('<f', value))[0]
+
+
+def expected_frame(packet, sections):
+    """The frame the JSON encoder would write for a dumped packet, as Python values"""
+    v = [f32(x) for x in packet['floats']]
+    flags = packet['flags']
+    for section, mask in SECTION_FLAGS.items():
+        if not sections & section:
+            flags &= ~mask
+
+    def vec3(i):
+        return {'x': v[i], 'y': v[i + 1], 'z': v[i + 2]}
+
+    def quat(i):
+        return {'x': v[i], 'y': v[i + 1], 'z': v[i + 2], 'w': v[i + 3]}
+
+    def hand(i, tracking_flag):
+        return {'x': v[i], 'y': v[i + 1], 'z': v[i + 2], 'orientation': quat(i + 3),
+                'grip_strength': v[i + 7], 'is_tracking': bool(flags & tracking_flag)}
+
+    frame = {
+        'timestamp_us': packet['timestamp_us'],
+        'frame_id': packet['frame_id'],
+        'head_position': vec3(0),
+        'head_orientation': quat(3),
+        'head_acceleration': vec3(7),
+        'head_angular_velocity': vec3(10),
+        'left_eye': {'x': v[13], 'y': v[14], 'pupil_diameter': v[15], 'is_blinking': bool(flags & 0x01)},
+        'right_eye': {'x': v[16], 'y': v[17], 'pupil_diameter': v[18], 'is_blinking': bool(flags & 0x02)},
+        'left_hand': hand(19, 0x04),
+        'right_hand': hand(27, 0x08),
+        'cpu_usage': v[35],
+        'gpu_usage': v[36],
+        'temperature': v[37],
+        'battery_level': packet['battery_level'],
+        'is_connected': bool(flags & 0x10),
+    }
+    for section, keys in SECTION_KEYS.items():
+        if not sections & section:
+            for key in keys:
+                del frame[key]
+    return frame
+
+
+def load_dump():
+    result = subprocess.run([VR_TESTS, '--dump'], capture_output=True, text=True, check=True)
+    return [json.loads(line) for line in result.stdout.splitlines() if line.startswith('{')]
+
+
+class WireTestCase(unittest.TestCase):
+    records = None
+
+    @classmethod
+    def setUpClass(cls):
+        if WireTestCase.records is None:
+            WireTestCase.records = load_dump()
+
+    def messages(self, prefix):
+        found = [r for r in self.records if r['name'].startswith(prefix)]
+        self.assertTrue(found, f"no {prefix} messages in the dump")
+        return found
+
+    def decode(self, record, delta_decoder=None):
+        return vr_wire.decode_message(bytes.fromhex(record['body']), record['content_type'], delta_decoder)
+
+    def assertFramesClose(self, actual, expected, tolerance, path=''):
+        """Recursive comparison; tolerance(path) gives the allowed error of a float"""
+        if isinstance(expected, dict):
+            self.assertIsInstance(actual, dict, path)
+            self.assertEqual(sorted(actual), sorted(expected), f"keys of {path or 'frame'}")
+            for key in expected:
+                self.assertFramesClose(actual[key], expected[key], tolerance, f"{path}.{key}" if path else key)
+        elif isinstance(expected, float):
+            self.assertLessEqual(abs(actual - expected), tolerance(path),
+                                 f"{path}: {actual!r} != {expected!r}")
+        else:
+            self.assertEqual(actual, expected, path)
+
+
+class TestFrameFormats(WireTestCase):
+    """JSON and binary frames, section frames and batches"""
+
+    def check(self, prefix, tolerance):
+        for record in self.messages(prefix):
+            with self.subTest(record['name']):
+                frames = self.decode(record)
+                self.assertEqual(len(frames), len(record['packets']))
+                for frame, packet in zip(frames, record['packets']):
+                    self.assertFramesClose(frame, expected_frame(packet, record['sections']), tolerance)
+
+    def test_binary_frames_are_exact(self):
+        self.check('binary_frame', lambda path: 0.0)
+
+    def test_binary_sections_are_exact(self):
+        self.check('binary_sections', lambda path: 0.0)
+
+    def test_binary_batches_are_exact(self):
+        self.check('binary_batch', lambda path: 0.0)
+
+    def test_json_frames(self):
+        self.check('json_frame', json_tolerance)
+
+    def test_json_sections(self):
+        self.check('json_sections', json_tolerance)
+
+    def test_json_batches(self):
+        self.check('json_batch', json_tolerance)
+
+    def test_every_section_mask_is_covered(self):
+        for prefix in ('json_sections', 'binary_sections', 'json_batch', 'binary_batch'):
+            masks = {r['sections'] for r in self.messages(prefix)}
+            self.assertEqual(masks, set(range(1, vr_wire.SECTION_ALL + 1)), prefix)
+
+
+def json_tolerance(path):
+    return JSON_F2_TOLERANCE if path in ('cpu_usage', 'gpu_usage', 'temperature') else JSON_F6_TOLERANCE
+
+
+def masked_quant(fields, sections):
+    """Quantized fields as the decoder must rebuild them: absent sections stay 0"""
+    fields = list(fields)
+    for section, (first, last) in QUANT_RANGES.items():
+        if not sections & section:
+            fields[first:last] = [0] * (last - first)
+            fields[41] &= ~SECTION_FLAGS[section]
+    return fields
+
+
+def quantization_tolerance(record):
+    """Allowed error of a dequantized float: half a step, plus double rounding"""
+    position = record['position_um'] * 1e-6 / 2
+    quat_step = 1.0 / (((1 << (record['quat_bits'] - 1)) - 1) * math.sqrt(2.0))
+    steps = {'head_acceleration': 0.5e-3, 'head_angular_velocity': 0.5e-3, 'grip_strength': 0.5e-4,
+             'pupil_diameter': 0.5e-3, 'cpu_usage': 0.005, 'gpu_usage': 0.005, 'temperature': 0.005}
+
+    def tolerance(path):
+        parts = path.split('.')
+        if 'orientation' in parts[-2:] or parts[0] == 'head_orientation':
+            return 3 * quat_step + 1e-9
+        for part in (parts[-1], parts[0]):
+            if part in steps:
+                return steps[part] + 1e-9
+        if parts[0].endswith('_eye'):
+            return 0.5e-4 + 1e-9
+        return position + 1e-9
+    return tolerance
+
+
+def canonical_quaternions(frame, source):
+    """Normalize the source's quaternions and pick the sign the decoder produced"""
+    for key in ('head_orientation', 'left_hand', 'right_hand'):
+        if key not in source:
+            continue
+        expected = source[key] if key == 'head_orientation' else source[key]['orientation']
+        actual = frame[key] if key == 'head_orientation' else frame[key]['orientation']
+        norm = math.sqrt(sum(expected[c] ** 2 for c in 'xyzw'))
+        if norm <= 1e-6:
+            for c in 'xyzw':
+                expected[c] = 0.0
+            continue
+        sign = 1.0 if sum(expected[c] * actual[c] for c in 'xyzw') >= 0 else -1.0
+        for c in 'xyzw':
+            expected[c] = sign * expected[c] / norm
+
+
+class TestDelta(WireTestCase):
+    """VR_WIRE_TYPE_DELTA: varints, keyframes, sections, smallest-three"""
+
+    def decode_streams(self):
+        """Decode every delta message on its stream's decoder; skip the lost ones"""
+        decoders = {}
+        lost = set()
+        results = []
+        for record in self.messages('delta_'):
+            stream = record['stream']
+            decoder = decoders.setdefault(stream, vr_wire.DeltaDecoder())
+            if record['dropped']:
+                lost.add(stream)
+                continue
+            after_loss = stream in lost
+            lost.discard(stream)
+            skipped = decoder.frames_skipped
+            frames = self.decode(record, decoder)
+            results.append((record, frames, after_loss, decoder.frames_skipped - skipped))
+        return results
+
+    def expected_exact(self, record):
+        return [vr_wire.filter_sections(
+                    vr_wire.dequantize_frame(masked_quant(q, record['sections']),
+                                             record['position_um'], record['quat_bits']),
+                    record['sections'])
+                for q in record['quant']]
+
+    def test_varints_rebuild_the_quantized_frames(self):
+        for record, frames, after_loss, skipped in self.decode_streams():
+            with self.subTest(record['name']):
+                expected = self.expected_exact(record)
+                if after_loss:
+                    # Deltas after a lost message are skipped until a keyframe
+                    self.assertGreater(skipped, 0)
+                    self.assertEqual(skipped + len(frames), len(expected))
+                    expected = expected[skipped:]
+                else:
+                    self.assertEqual(skipped, 0)
+                self.assertEqual(frames, expected)
+
+    def test_dequantized_frames_match_the_source(self):
+        for record, frames, after_loss, skipped in self.decode_streams():
+            tolerance = quantization_tolerance(record)
+            packets = record['packets'][skipped:]
+            with self.subTest(record['name']):
+                for frame, packet in zip(frames, packets):
+                    source = expected_frame(packet, record['sections'])
+                    canonical_quaternions(frame, source)
+                    self.assertFramesClose(frame, source, tolerance)
+
+    def test_every_section_mask_is_covered(self):
+        masks = {r['sections'] for r in self.messages('delta_')}
+        self.assertEqual(masks, set(range(1, vr_wire.SECTION_ALL + 1)))
+
+    def test_lost_message_is_exercised(self):
+        results = self.decode_streams()
+        self.assertTrue(any(after_loss for _, _, after_loss, _ in results))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,1391 @@
+#include "vr_telemetry.h"
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Unit tests for the telemetry pipeline.
+//
+// Run without arguments, the checks that need only the C side. With --dump,
+// every wire format and section mask is written as JSON lines (body in hex
+// plus the packets, and for delta messages the quantized fields, it was
+// encoded from) for tests/test_wire.py to decode with python/vr_wire.py.
+
+#define TEST_RING_DEPTH 8
+#define TEST_STRESS_PUSHES 200000
+#define TEST_HISTORY_DEPTH 13          // Rounds up to a 16-sample window
+#define TEST_HISTORY_PUSHES 1000
+#define TEST_RANDOM_FRAMES 64
+#define TEST_CAPTURE_FRAMES 40
+#define TEST_COLUMN_FRAMES 300         // Past VR_COLUMNS_MAX_FRAMES
+#define TEST_SCHED_RATE_HZ 2999        // Period 333444.48 ns: not a whole number of ns
+#define TEST_SCHED_RELEASES 3100       // Past one epoch rebase (every TEST_SCHED_RATE_HZ releases)
+#define TEST_JSON_VALUES 200000
+#define TEST_LOG_RECORDS 25
+#define TEST_LOG_RACE_THREADS 4
+#define TEST_LOG_RACE_RECORDS 2000     // Per thread, each from its own call site (never rate limited)
+#define TEST_LOG_RACE_ROUNDS 8
+#define TEST_FILTER_POSE 0             // Head position x
+#define TEST_FILTER_OTHER 7            // Head acceleration x
+#define TEST_SYNTH_SAMPLES 1003        // Not a multiple of VR_SYNTH_LANES
+
+static uint32_t g_checks = 0;
+static uint32_t g_failures = 0;
+
+#define CHECK(cond, ...) do { \
+    g_checks++; \
+    if (!(cond)) { \
+        g_failures++; \
+        printf("[FAIL] %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// Deterministic xorshift32 so failures reproduce
+static uint32_t g_rng = 0x9E3779B9u;
+
+static uint32_t rand_u32(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return g_rng;
+}
+
+static float rand_range(float lo, float hi) {
+    return lo + (hi - lo) * (float)(rand_u32() >> 8) / (float)(1u << 24);
+}
+
+// Random unit quaternion; every few draws an edge case instead
+static void rand_quat(vr_orientation_t *q) {
+    switch (rand_u32() % 8) {
+        case 0:  *q = (vr_orientation_t){ 0.0f, 0.0f, 0.0f, 0.0f }; return;     // VR_QUAT_INDEX_ZERO
+        case 1:  *q = (vr_orientation_t){ 0.0f, 0.0f, 0.0f, -1.0f }; return;    // Largest negative
+        case 2:  *q = (vr_orientation_t){ 0.5f, -0.5f, 0.5f, -0.5f }; return;  // Four-way tie
+        default: break;
+    }
+    float c[4];
+    float norm = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        c[i] = rand_range(-1.0f, 1.0f);
+        norm += c[i] * c[i];
+    }
+    norm = sqrtf(norm > 1e-6f ? norm : 1.0f);
+    *q = (vr_orientation_t){ c[0] / norm, c[1] / norm, c[2] / norm, c[3] / norm };
+}
+
+// A packet with every field in its sensor's range, all flags varied
+static void rand_packet(vr_telemetry_packet_t *p, uint32_t i) {
+    memset(p, 0, sizeof(*p));
+    p->timestamp_us = 1700000000000000ull + (uint64_t)i * 16667 + (rand_u32() % 1000);
+    p->frame_id = i == 1 ? UINT32_MAX : i * 3;
+    p->head_position = (vr_position_t){ rand_range(-10, 10), rand_range(0, 2.5f), rand_range(-10, 10) };
+    rand_quat(&p->head_orientation);
+    p->head_acceleration = (vr_acceleration_t){ rand_range(-50, 50), rand_range(-50, 50), rand_range(-50, 50) };
+    p->head_angular_velocity = (vr_angular_velocity_t){ rand_range(-20, 20), rand_range(-20, 20),
+                                                        rand_range(-20, 20) };
+    p->left_eye = (vr_eye_tracking_t){ rand_range(-1, 1), rand_range(-1, 1), rand_range(2, 8) };
+    p->right_eye = (vr_eye_tracking_t){ rand_range(-1, 1), rand_range(-1, 1), rand_range(2, 8) };
+    vr_hand_tracking_t *hands[2] = { &p->left_hand, &p->right_hand };
+    for (int h = 0; h < 2; h++) {
+        hands[h]->x = rand_range(-2, 2);
+        hands[h]->y = rand_range(0, 2);
+        hands[h]->z = rand_range(-2, 2);
+        rand_quat(&hands[h]->orientation);
+        hands[h]->grip_strength = rand_range(0, 1);
+    }
+    p->cpu_usage = rand_range(0, 100);
+    p->gpu_usage = rand_range(0, 100);
+    p->temperature = rand_range(20, 90);
+    p->battery_level = (uint8_t)(i == 2 ? 255 : rand_u32() % 101);
+    p->flags = (uint8_t)(rand_u32() & 0x1F);
+}
+
+// Fields that are on the wire are equal (monotonic_us is not sent)
+static bool packets_equal(const vr_telemetry_packet_t *a, const vr_telemetry_packet_t *b) {
+    float fa[VR_PACKET_FLOATS], fb[VR_PACKET_FLOATS];
+    vr_packet_get_floats(a, fa);
+    vr_packet_get_floats(b, fb);
+    return memcmp(fa, fb, sizeof(fa)) == 0 && a->timestamp_us == b->timestamp_us &&
+           a->frame_id == b->frame_id && a->battery_level == b->battery_level && a->flags == b->flags;
+}
+
+// Fill the ring past capacity under one policy and check what is kept
+static void test_ring_overflow(vr_ring_policy_t policy) {
+    const char *name = policy == VR_RING_DROP_OLDEST ? "drop-oldest" : "drop-newest";
+    vr_packet_ring_t ring;
+    CHECK(vr_ring_init(&ring, TEST_RING_DEPTH, policy) == 0, "%s: init", name);
+
+    const uint32_t extra = 5;
+    vr_telemetry_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    for (uint32_t i = 0; i < TEST_RING_DEPTH + extra; i++) {
+        packet.frame_id = i;
+        bool accepted = vr_ring_push(&ring, &packet);
+        bool expected = policy == VR_RING_DROP_OLDEST || i < TEST_RING_DEPTH;
+        CHECK(accepted == expected, "%s: push %u returned %d", name, i, accepted);
+    }
+
+    vr_ring_stats_t stats;
+    vr_ring_get_stats(&ring, &stats);
+    CHECK(stats.capacity == TEST_RING_DEPTH, "%s: capacity %u", name, stats.capacity);
+    CHECK(stats.occupancy == TEST_RING_DEPTH, "%s: occupancy %u", name, stats.occupancy);
+    CHECK(stats.high_watermark == TEST_RING_DEPTH, "%s: high watermark %u", name, stats.high_watermark);
+    CHECK(stats.dropped == extra, "%s: dropped %lu, expected %u", name, stats.dropped, extra);
+
+    // Drop-oldest keeps the newest frames, drop-newest the first ones; both in order
+    uint32_t first = policy == VR_RING_DROP_OLDEST ? extra : 0;
+    for (uint32_t i = 0; i < TEST_RING_DEPTH; i++) {
+        CHECK(vr_ring_pop(&ring, &packet), "%s: pop %u", name, i);
+        CHECK(packet.frame_id == first + i, "%s: pop %u got frame %u, expected %u",
+              name, i, packet.frame_id, first + i);
+    }
+    CHECK(!vr_ring_pop(&ring, &packet), "%s: pop from empty ring", name);
+
+    // Wrap the indices many times with the ring half full
+    uint32_t next_push = 1000, next_pop = 1000;
+    for (uint32_t round = 0; round < 100; round++) {
+        for (uint32_t i = 0; i < TEST_RING_DEPTH / 2; i++) {
+            packet.frame_id = next_push++;
+            vr_ring_push(&ring, &packet);
+        }
+        for (uint32_t i = 0; i < TEST_RING_DEPTH / 2; i++) {
+            CHECK(vr_ring_pop(&ring, &packet) && packet.frame_id == next_pop,
+                  "%s: wrapped pop got frame %u, expected %u", name, packet.frame_id, next_pop);
+            next_pop++;
+        }
+    }
+    vr_ring_get_stats(&ring, &stats);
+    CHECK(stats.dropped == extra, "%s: wrapping dropped frames (%lu)", name, stats.dropped);
+    vr_ring_destroy(&ring);
+}
+
+typedef struct {
+    vr_packet_ring_t *ring;
+    volatile bool done;
+} test_stress_t;
+
+// Producer thread of the stress test: push faster than the consumer pops
+static void *test_ring_producer(void *arg) {
+    test_stress_t *stress = arg;
+    vr_telemetry_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    for (uint32_t i = 0; i < TEST_STRESS_PUSHES; i++) {
+        packet.frame_id = i;
+        packet.timestamp_us = i;
+        vr_ring_push(stress->ring, &packet);
+    }
+    __atomic_store_n(&stress->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Concurrent producer and consumer: frames arrive in order, intact, and
+// every push is either consumed, dropped or still queued
+static void test_ring_stress(vr_ring_policy_t policy) {
+    const char *name = policy == VR_RING_DROP_OLDEST ? "drop-oldest" : "drop-newest";
+    vr_packet_ring_t ring;
+    CHECK(vr_ring_init(&ring, TEST_RING_DEPTH, policy) == 0, "%s: stress init", name);
+
+    test_stress_t stress = { .ring = &ring, .done = false };
+    pthread_t producer;
+    CHECK(pthread_create(&producer, NULL, test_ring_producer, &stress) == 0, "%s: producer thread", name);
+
+    uint64_t consumed = 0;
+    int64_t last = -1;
+    bool ordered = true, intact = true;
+    vr_telemetry_packet_t packet;
+    for (;;) {
+        bool done = __atomic_load_n(&stress.done, __ATOMIC_ACQUIRE);
+        while (vr_ring_pop(&ring, &packet)) {
+            ordered &= (int64_t)packet.frame_id > last;
+            intact &= packet.timestamp_us == packet.frame_id;
+            last = packet.frame_id;
+            consumed++;
+        }
+        if (done) break;
+    }
+    pthread_join(producer, NULL);
+
+    vr_ring_stats_t stats;
+    vr_ring_get_stats(&ring, &stats);
+    CHECK(ordered, "%s: frames out of order under contention", name);
+    CHECK(intact, "%s: torn frame under contention", name);
+    CHECK(consumed + stats.dropped + stats.occupancy == TEST_STRESS_PUSHES,
+          "%s: consumed %lu + dropped %lu + queued %u != %u pushes",
+          name, consumed, stats.dropped, stats.occupancy, TEST_STRESS_PUSHES);
+    vr_ring_destroy(&ring);
+}
+
+#define TEST_PACKET_WORDS (sizeof(vr_telemetry_packet_t) / sizeof(uint64_t))
+
+typedef struct {
+    vr_packet_snapshot_t snap;
+    volatile bool done;
+} test_snapshot_t;
+
+// Writer thread of the snapshot test: publish i in every word of packet i
+static void *test_snapshot_writer(void *arg) {
+    test_snapshot_t *test = arg;
+    vr_telemetry_packet_t packet;
+    uint64_t *words = (uint64_t *)&packet;
+    for (uint64_t i = 1; i <= TEST_STRESS_PUSHES; i++) {
+        for (size_t w = 0; w < TEST_PACKET_WORDS; w++) {
+            words[w] = i;
+        }
+        vr_snapshot_publish(&test->snap, &packet);
+    }
+    __atomic_store_n(&test->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Concurrent snapshot writer and reader: every read is one whole published
+// packet (all words from the same publish), never older than the last read
+static void test_snapshot_stress(void) {
+    static test_snapshot_t test;
+    memset(&test, 0, sizeof(test));
+    pthread_t writer;
+    CHECK(pthread_create(&writer, NULL, test_snapshot_writer, &test) == 0, "snapshot: writer thread");
+
+    uint64_t reads = 0, torn = 0, last = 0;
+    bool ordered = true;
+    vr_telemetry_packet_t packet;
+    const uint64_t *words = (const uint64_t *)&packet;
+    for (;;) {
+        bool done = __atomic_load_n(&test.done, __ATOMIC_ACQUIRE);
+        vr_snapshot_read(&test.snap, &packet);
+        for (size_t w = 1; w < TEST_PACKET_WORDS; w++) {
+            if (words[w] != words[0]) {
+                torn++;
+                break;
+            }
+        }
+        ordered &= words[0] >= last;
+        last = words[0];
+        reads++;
+        if (done) break;
+    }
+    pthread_join(writer, NULL);
+
+    CHECK(torn == 0, "snapshot: %lu of %lu reads torn", torn, reads);
+    CHECK(ordered, "snapshot: a read went back to an older packet");
+    CHECK(last == TEST_STRESS_PUSHES, "snapshot: last read packet %lu, expected %u", last, TEST_STRESS_PUSHES);
+}
+
+// Packet columns: every field of every loaded packet lands in its column, in
+// wire order for the floats, and a batch past VR_COLUMNS_MAX_FRAMES is cut there
+static void test_packet_columns(void) {
+    static vr_telemetry_packet_t packets[TEST_COLUMN_FRAMES];
+    static vr_packet_columns_t cols;
+    for (uint32_t i = 0; i < TEST_COLUMN_FRAMES; i++) {
+        rand_packet(&packets[i], i);
+        packets[i].monotonic_us = 5000000 + (uint64_t)i * 997 + rand_u32() % 100;
+    }
+
+    uint32_t loaded = vr_columns_load(&cols, packets, 5);
+    CHECK(loaded == 5 && cols.count == 5, "columns: loaded %u of 5 frames", loaded);
+    loaded = vr_columns_load(&cols, packets, TEST_COLUMN_FRAMES);
+    CHECK(loaded == VR_COLUMNS_MAX_FRAMES && cols.count == VR_COLUMNS_MAX_FRAMES,
+          "columns: loaded %u of %u frames, expected the %u-frame cap", loaded, TEST_COLUMN_FRAMES,
+          VR_COLUMNS_MAX_FRAMES);
+
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < cols.count; i++) {
+        const vr_telemetry_packet_t *p = &packets[i];
+        float values[VR_PACKET_FLOATS];
+        vr_packet_get_floats(p, values);
+        bool same = cols.timestamp_us[i] == p->timestamp_us && cols.monotonic_us[i] == p->monotonic_us &&
+                    cols.frame_id[i] == p->frame_id && cols.battery_level[i] == p->battery_level &&
+                    cols.flags[i] == p->flags;
+        for (int f = 0; same && f < VR_PACKET_FLOATS; f++) {
+            same = memcmp(&cols.values[f][i], &values[f], sizeof(float)) == 0;
+        }
+        wrong += !same;
+    }
+    CHECK(wrong == 0, "columns: %u of %u frames not carried over field for field", wrong, cols.count);
+}
+
+// Windowed statistics after every push equal a brute-force recomputation
+// over the samples still in the window, well past wraparound. Components
+// are random, rising, falling and plateaued so the extreme queues see
+// every ordering.
+static void test_history_window(void) {
+    vr_history_ring_t ring;
+    CHECK(vr_history_ring_init(&ring, 4, TEST_HISTORY_DEPTH) == 0, "history: init");
+    CHECK(ring.capacity == 16, "history: capacity %u, expected 16", ring.capacity);
+
+    static float pushed[TEST_HISTORY_PUSHES][4];
+    bool stats_ok = true, samples_ok = true;
+    for (uint32_t i = 0; i < TEST_HISTORY_PUSHES; i++) {
+        float *v = pushed[i];
+        v[0] = rand_range(-10.0f, 10.0f);
+        v[1] = 100.0f + (float)i * 0.25f;
+        v[2] = -(float)(i % 37);
+        v[3] = (float)((i / 5) % 3);
+        vr_history_ring_push(&ring, v, 1000u + i);
+
+        uint32_t window = i + 1 < ring.capacity ? i + 1 : ring.capacity;
+        uint32_t first = i + 1 - window;
+        for (uint32_t c = 0; c < 4; c++) {
+            double sum = 0.0, m2 = 0.0;
+            float lo = pushed[first][c], hi = pushed[first][c];
+            for (uint32_t s = first; s <= i; s++) {
+                sum += pushed[s][c];
+                if (pushed[s][c] < lo) lo = pushed[s][c];
+                if (pushed[s][c] > hi) hi = pushed[s][c];
+            }
+            double mean = sum / window;
+            for (uint32_t s = first; s <= i; s++) {
+                m2 += (pushed[s][c] - mean) * (pushed[s][c] - mean);
+            }
+            double variance = m2 / window;
+
+            vr_history_stats_t stats;
+            bool ok = vr_history_ring_get_stats(&ring, c, &stats) == 0 && stats.count == window &&
+                      fabs(stats.mean - mean) <= 1e-5 * (1.0 + fabs(mean)) &&
+                      fabs(stats.variance - variance) <= 1e-4 * (1.0 + variance) &&
+                      stats.min == lo && stats.max == hi;
+            if (!ok && stats_ok) {
+                CHECK(ok, "history: push %u component %u: count %u mean %g var %g min %g max %g, "
+                      "expected %u %g %g %g %g", i, c, stats.count, stats.mean, stats.variance,
+                      stats.min, stats.max, window, mean, variance, lo, hi);
+            }
+            stats_ok &= ok;
+        }
+
+        uint64_t timestamp;
+        const float *latest = vr_history_ring_sample(&ring, 0, &timestamp);
+        const float *oldest = vr_history_ring_sample(&ring, window - 1, NULL);
+        samples_ok &= latest && oldest && timestamp == 1000u + i &&
+                      memcmp(latest, pushed[i], sizeof(pushed[i])) == 0 &&
+                      memcmp(oldest, pushed[first], sizeof(pushed[first])) == 0 &&
+                      vr_history_ring_sample(&ring, window, NULL) == NULL;
+    }
+    CHECK(stats_ok, "history: windowed statistics differ from recomputation");
+    CHECK(samples_ok, "history: samples by age differ from what was pushed");
+
+    vr_history_stats_t stats;
+    CHECK(vr_history_ring_get_stats(&ring, 4, &stats) < 0, "history: component out of range accepted");
+    vr_history_ring_destroy(&ring);
+}
+
+// Feed a filter n samples 1 ms apart: field TEST_FILTER_POSE (head x, One
+// Euro filtered) and TEST_FILTER_OTHER (not pose) set to value, identity
+// quaternions, everything else zero
+static void filter_feed(vr_filter_t *filter, float value, uint32_t n, uint64_t *now_us) {
+    float x[VR_PACKET_FLOATS] = { 0 };
+    x[3 + 3] = x[22 + 3] = x[30 + 3] = 1.0f;
+    x[TEST_FILTER_POSE] = value;
+    x[TEST_FILTER_OTHER] = value;
+    vr_telemetry_packet_t sample;
+    memset(&sample, 0, sizeof(sample));
+    vr_packet_set_floats(&sample, x);
+    for (uint32_t i = 0; i < n; i++) {
+        *now_us += 1000;
+        sample.monotonic_us = *now_us;
+        vr_filter_update(filter, &sample);
+    }
+}
+
+// One output frame's float fields
+static void filter_frame(vr_filter_t *filter, float *y) {
+    vr_telemetry_packet_t frame;
+    vr_filter_output(filter, &frame);
+    vr_packet_get_floats(&frame, y);
+}
+
+// Telemetry filters: constant input passes through unchanged; a unit step
+// gives the box mean of each frame, the low-pass 1 - (1 - alpha)^n and a
+// monotonic One Euro rise without overshoot; and a stream rate change keeps
+// the filter's state
+static void test_filter_response(void) {
+    static const vr_filter_kind_t kinds[] = { VR_FILTER_NONE, VR_FILTER_BOX, VR_FILTER_LOWPASS, VR_FILTER_ONE_EURO };
+    float y[VR_PACKET_FLOATS];
+    uint64_t now = 1000000;
+
+    for (uint32_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        vr_filter_config_t config = { .kind = kinds[k], .beta = VR_ONE_EURO_DEFAULT_BETA };
+        vr_filter_t filter;
+        vr_filter_init(&filter, &config, 1000, 60);
+        bool constant = true;
+        for (int frame = 0; frame < 20; frame++) {
+            filter_feed(&filter, 2.5f, 16, &now);
+            filter_frame(&filter, y);
+            constant &= fabsf(y[TEST_FILTER_POSE] - 2.5f) < 1e-6f && fabsf(y[TEST_FILTER_OTHER] - 2.5f) < 1e-6f &&
+                        y[6] == 1.0f && y[25] == 1.0f && y[33] == 1.0f;
+        }
+        CHECK(constant, "filter %s: constant input changed", vr_filter_kind_name(kinds[k]));
+    }
+
+    // Box: the mean of exactly the samples since the previous frame
+    vr_filter_config_t config = { .kind = VR_FILTER_BOX };
+    vr_filter_t filter;
+    vr_filter_init(&filter, &config, 1000, 60);
+    filter_feed(&filter, 0.0f, 16, &now);
+    filter_frame(&filter, y);
+    filter_feed(&filter, 0.0f, 4, &now);
+    filter_feed(&filter, 1.0f, 12, &now);
+    filter_frame(&filter, y);
+    CHECK(fabsf(y[TEST_FILTER_OTHER] - 0.75f) < 1e-6f, "filter box: frame straddling the step %g, expected 0.75",
+          y[TEST_FILTER_OTHER]);
+    filter_feed(&filter, 1.0f, 16, &now);
+    filter_frame(&filter, y);
+    CHECK(y[TEST_FILTER_OTHER] == 1.0f, "filter box: frame after the step %g, expected 1", y[TEST_FILTER_OTHER]);
+    filter_frame(&filter, y);
+    CHECK(y[TEST_FILTER_OTHER] == 1.0f, "filter box: frame without new samples not repeated");
+
+    // Low-pass at 10 Hz: y_n = 1 - (1 - alpha)^n
+    config = (vr_filter_config_t){ .kind = VR_FILTER_LOWPASS, .cutoff_hz = 10.0f };
+    vr_filter_init(&filter, &config, 1000, 60);
+    filter_feed(&filter, 0.0f, 1, &now);
+    double alpha = 0.001 / (0.001 + 1.0 / (2.0 * M_PI * 10.0));
+    bool follows = true;
+    for (int n = 1; n <= 200; n++) {
+        filter_feed(&filter, 1.0f, 1, &now);
+        filter_frame(&filter, y);
+        follows &= fabs(y[TEST_FILTER_POSE] - (1.0 - pow(1.0 - alpha, n))) < 1e-5;
+    }
+    CHECK(follows, "filter lowpass: step response is not 1 - (1 - alpha)^n");
+
+    // A stream rate change keeps the state; the default cutoff follows the new rate
+    config = (vr_filter_config_t){ .kind = VR_FILTER_LOWPASS };
+    vr_filter_init(&filter, &config, 1000, 60);
+    filter_feed(&filter, 0.0f, 1, &now);
+    filter_feed(&filter, 1.0f, 5, &now);
+    float before[VR_PACKET_FLOATS];
+    filter_frame(&filter, before);
+    vr_filter_set_rate(&filter, 20);
+    filter_frame(&filter, y);
+    CHECK(filter.primed && memcmp(y, before, sizeof(y)) == 0, "filter: set_rate changed the output");
+    filter_feed(&filter, 1.0f, 1, &now);
+    filter_frame(&filter, y);
+    alpha = 0.001 / (0.001 + 1.0 / (2.0 * M_PI * 10.0));
+    float expected = before[TEST_FILTER_POSE] + (float)alpha * (1.0f - before[TEST_FILTER_POSE]);
+    CHECK(fabsf(y[TEST_FILTER_POSE] - expected) < 1e-6f, "filter: after set_rate(20) %g, expected %g (10 Hz cutoff)",
+          y[TEST_FILTER_POSE], expected);
+
+    // One Euro: pose rises monotonically to the step without overshoot; other fields are box means
+    config = (vr_filter_config_t){ .kind = VR_FILTER_ONE_EURO, .beta = VR_ONE_EURO_DEFAULT_BETA };
+    vr_filter_init(&filter, &config, 1000, 60);
+    filter_feed(&filter, 0.0f, 16, &now);
+    filter_frame(&filter, y);
+    float previous = 0.0f;
+    bool monotonic = true;
+    for (int frame = 0; frame < 120; frame++) {
+        filter_feed(&filter, 1.0f, 16, &now);
+        filter_frame(&filter, y);
+        monotonic &= y[TEST_FILTER_POSE] >= previous && y[TEST_FILTER_POSE] <= 1.0f;
+        previous = y[TEST_FILTER_POSE];
+        if (frame == 0) {
+            CHECK(y[TEST_FILTER_POSE] > 0.0f && y[TEST_FILTER_POSE] < 1.0f,
+                  "filter one-euro: first frame after the step %g, expected a partial rise", y[TEST_FILTER_POSE]);
+        }
+        monotonic &= y[TEST_FILTER_OTHER] == 1.0f;
+    }
+    CHECK(monotonic, "filter one-euro: step response overshoots, falls back, or filters non-pose fields");
+    CHECK(previous > 0.99f, "filter one-euro: %g after 2 s of a unit step", previous);
+}
+
+// Run one rate controller interval
+static uint32_t ratectl_step(vr_ratectl_t *ctl, uint32_t rate, bool connected, bool congested) {
+    vr_ratectl_signals_t signals = { .connected = connected, .publishes = 10 };
+    if (congested) {
+        signals.ring_drops = 3;
+    }
+    return vr_ratectl_update(ctl, rate, &signals);
+}
+
+// AIMD: a congested interval scales the rate down and holds it, clear
+// intervals probe up by a fixed step, both bounded, and nothing changes
+// while the broker is disconnected
+static void test_ratectl_aimd(void) {
+    vr_ratectl_config_t config = { .enabled = true, .max_hz = 100 };
+    vr_ratectl_t ctl;
+    vr_ratectl_init(&ctl, &config, 100);
+    CHECK(ctl.stats.min_hz == 25 && ctl.stats.max_hz == 100 && ctl.step_hz == 5,
+          "ratectl: bounds %u-%u step %u, expected 25-100 step 5", ctl.stats.min_hz, ctl.stats.max_hz, ctl.step_hz);
+
+    // Decrease, then HOLD_INTERVALS congested intervals without change
+    uint32_t rate = ratectl_step(&ctl, 100, true, true);
+    CHECK(rate == 75, "ratectl: decrease to %u, expected 75", rate);
+    for (int i = 0; i < VR_RATECTL_HOLD_INTERVALS; i++) {
+        uint32_t held = ratectl_step(&ctl, rate, true, true);
+        CHECK(held == rate, "ratectl: hold interval %d changed %u to %u", i, rate, held);
+    }
+    rate = ratectl_step(&ctl, rate, true, true);
+    CHECK(rate == 56, "ratectl: decrease after the hold to %u, expected 56", rate);
+    vr_ratectl_stats_t stats;
+    vr_ratectl_get_stats(&ctl, &stats);
+    CHECK(stats.decreases == 2 && stats.increases == 0 && stats.last_cause == VR_RATECTL_RING_DROPS,
+          "ratectl: %lu decreases, %lu increases, cause %d", stats.decreases, stats.increases, stats.last_cause);
+
+    // Additive probe after PROBE_INTERVALS clear intervals, every PROBE_INTERVALS
+    vr_ratectl_init(&ctl, &config, 50);
+    for (int probe = 1; probe <= 3; probe++) {
+        for (int i = 1; i < VR_RATECTL_PROBE_INTERVALS; i++) {
+            rate = ctl.stats.rate_hz;
+            uint32_t held = ratectl_step(&ctl, rate, true, false);
+            CHECK(held == rate, "ratectl: clear interval %d of probe %d changed %u to %u", i, probe, rate, held);
+        }
+        rate = ratectl_step(&ctl, ctl.stats.rate_hz, true, false);
+        CHECK(rate == 50 + 5 * (uint32_t)probe, "ratectl: probe %d to %u, expected %u", probe, rate, 50 + 5 * (uint32_t)probe);
+    }
+
+    // Clamped to max on the way up and to min on the way down
+    vr_ratectl_init(&ctl, &config, 98);
+    for (int i = 0; i < VR_RATECTL_PROBE_INTERVALS * 3; i++) {
+        rate = ratectl_step(&ctl, ctl.stats.rate_hz, true, false);
+        CHECK(rate <= 100, "ratectl: rose to %u past the 100 Hz maximum", rate);
+    }
+    CHECK(rate == 100, "ratectl: probed to %u, expected the 100 Hz maximum", rate);
+    CHECK(ratectl_step(&ctl, 1000, true, false) == 100, "ratectl: rate above the maximum not clamped");
+    vr_ratectl_init(&ctl, &config, 26);
+    for (int i = 0; i < (VR_RATECTL_HOLD_INTERVALS + 1) * 3; i++) {
+        rate = ratectl_step(&ctl, ctl.stats.rate_hz, true, true);
+        CHECK(rate == 25, "ratectl: congested rate %u, expected the 25 Hz minimum", rate);
+    }
+    CHECK(ratectl_step(&ctl, 1, true, true) == 25, "ratectl: rate below the minimum not clamped");
+
+    // Disconnected: congestion is not acted on and probing starts over
+    vr_ratectl_init(&ctl, &config, 60);
+    for (int i = 0; i < VR_RATECTL_PROBE_INTERVALS - 1; i++) {
+        ratectl_step(&ctl, 60, true, false);
+    }
+    for (int i = 0; i < 10; i++) {
+        rate = ratectl_step(&ctl, 60, false, true);
+        CHECK(rate == 60, "ratectl: disconnected interval %d changed the rate to %u", i, rate);
+    }
+    vr_ratectl_get_stats(&ctl, &stats);
+    CHECK(stats.decreases == 0 && stats.increases == 0, "ratectl: disconnected intervals changed the rate");
+    for (int i = 1; i < VR_RATECTL_PROBE_INTERVALS; i++) {
+        CHECK(ratectl_step(&ctl, 60, true, false) == 60, "ratectl: probed before %d clear intervals after reconnecting",
+              VR_RATECTL_PROBE_INTERVALS);
+    }
+    CHECK(ratectl_step(&ctl, 60, true, false) == 65, "ratectl: no probe after reconnecting");
+}
+
+typedef struct {
+    uint32_t calls;
+    uint64_t spin_ns;              // Busy time of the first call
+} test_task_t;
+
+// Scheduler task: count calls; the first one runs long to force an overrun
+static void test_task(void *arg) {
+    test_task_t *task = arg;
+    if (task->calls++ == 0 && task->spin_ns > 0) {
+        uint64_t until = vr_get_monotonic_ns() + task->spin_ns;
+        while (vr_get_monotonic_ns() < until) {
+        }
+    }
+}
+
+// Release n of a rate_hz task is due at epoch + floor(n * 1e9 / rate_hz)
+static uint64_t test_deadline(uint64_t epoch_ns, uint64_t release, uint32_t rate_hz) {
+    return epoch_ns + release * VR_NSEC_PER_SEC / rate_hz;
+}
+
+// Deadlines follow the rational period exactly across epoch rebases, a
+// task that runs past several periods skips (and counts) the missed
+// releases, and a rate change keeps the next deadline and spaces the ones
+// after it at the new period. Releases missed to scheduling noise are
+// accounted for: release index = runs + overruns.
+static void test_scheduler_deadlines(void) {
+    vr_scheduler_t sched;
+    test_task_t counter = { 0 };
+    vr_scheduler_init(&sched);
+    vr_scheduler_set_idle(&sched, VR_IDLE_SLEEP);
+    int id = vr_scheduler_add_rate(&sched, "rate", test_task, &counter, TEST_SCHED_RATE_HZ);
+    CHECK(id == 0, "sched: add returned %d", id);
+    vr_scheduler_start(&sched);
+    uint64_t epoch = sched.started_ns;
+    CHECK(sched.tasks[0].deadline_ns == epoch, "sched: first release is not immediate");
+
+    bool exact = true;
+    while (sched.tasks[0].runs + sched.tasks[0].overruns < TEST_SCHED_RELEASES) {
+        vr_scheduler_run_once(&sched);
+        const vr_task_t *task = &sched.tasks[0];
+        exact &= task->deadline_ns == test_deadline(epoch, task->runs + task->overruns, TEST_SCHED_RATE_HZ);
+    }
+    CHECK(exact, "sched: %u Hz deadlines drift from epoch + n * 1e9 / rate", TEST_SCHED_RATE_HZ);
+    CHECK(counter.calls == sched.tasks[0].runs, "sched: %u calls for %lu runs", counter.calls, sched.tasks[0].runs);
+    vr_scheduler_close(&sched);
+
+    // Overrun: the first call takes 3.5 periods, so releases 1-3 are skipped
+    const uint64_t period_ns = 10000000;
+    test_task_t slow = { .spin_ns = period_ns * 7 / 2 };
+    vr_scheduler_init(&sched);
+    vr_scheduler_set_idle(&sched, VR_IDLE_SPIN);
+    vr_scheduler_add_period(&sched, "slow", test_task, &slow, period_ns / 1000);
+    vr_scheduler_start(&sched);
+    epoch = sched.started_ns;
+    vr_scheduler_run_once(&sched);
+    CHECK(sched.tasks[0].runs == 1 && sched.tasks[0].overruns == 3,
+          "sched: %lu runs, %lu overruns after a 3.5-period release, expected 1, 3",
+          sched.tasks[0].runs, sched.tasks[0].overruns);
+    CHECK(sched.tasks[0].deadline_ns == epoch + 4 * period_ns, "sched: next deadline %+ld ns off release 4",
+          (long)(sched.tasks[0].deadline_ns - (epoch + 4 * period_ns)));
+    vr_scheduler_run_once(&sched);
+    CHECK(sched.tasks[0].runs == 2 && sched.tasks[0].overruns == 3, "sched: overruns after the slow release");
+    vr_scheduler_close(&sched);
+
+    // Rate change: the pending deadline stays, later ones use the new period
+    test_task_t changed = { 0 };
+    vr_scheduler_init(&sched);
+    vr_scheduler_set_idle(&sched, VR_IDLE_SLEEP);
+    id = vr_scheduler_add_rate(&sched, "changed", test_task, &changed, 100);
+    vr_scheduler_start(&sched);
+    for (int i = 0; i < 3; i++) {
+        vr_scheduler_run_once(&sched);
+    }
+    uint64_t pending = sched.tasks[id].deadline_ns;
+    uint64_t before = sched.tasks[id].runs + sched.tasks[id].overruns;
+    CHECK(vr_scheduler_set_rate(&sched, id, 40) == 0, "sched: set_rate");
+    CHECK(sched.tasks[id].deadline_ns == pending, "sched: set_rate moved the pending deadline");
+    exact = true;
+    for (int i = 0; i < 4; i++) {
+        vr_scheduler_run_once(&sched);
+        const vr_task_t *task = &sched.tasks[id];
+        exact &= task->deadline_ns == test_deadline(pending, task->runs + task->overruns - before, 40);
+    }
+    CHECK(exact, "sched: deadlines after set_rate are not spaced 25 ms from the pending one");
+    CHECK(vr_scheduler_set_rate(&sched, id, 0) < 0 && vr_scheduler_set_rate(&sched, id + 1, 10) < 0,
+          "sched: set_rate accepted a zero rate or an unknown task");
+    vr_scheduler_close(&sched);
+}
+
+// Wall-clock offset corrections: an error is slewed out at no more than
+// VR_CLOCK_MAX_SLEW_PPM of the elapsed time in either direction, one within
+// the slew budget is taken exactly, and only an error beyond
+// VR_CLOCK_STEP_US is stepped
+static void test_clock_slew(void) {
+    const uint64_t elapsed_us = (uint64_t)VR_CLOCK_REFRESH_MS * 1000;
+    const int64_t budget = (int64_t)(elapsed_us * VR_CLOCK_MAX_SLEW_PPM / 1000000);
+    CHECK(budget == 5, "clock: %lld us slew budget per %d ms refresh, expected 5", (long long)budget,
+          VR_CLOCK_REFRESH_MS);
+
+    // A 2 ms error converges at the slew limit, never overshooting
+    bool stepped = true;
+    int64_t offset = 1000000, target = offset + 2000;
+    uint32_t refreshes = 0;
+    bool bounded = true;
+    while (offset != target && refreshes < 1000) {
+        int64_t next = vr_clock_correct(offset, target, elapsed_us, &stepped);
+        bounded &= !stepped && next - offset <= budget && next - offset > 0 && next <= target;
+        offset = next;
+        refreshes++;
+    }
+    CHECK(bounded, "clock: slew exceeded %lld us per refresh, overshot or stepped", (long long)budget);
+    CHECK(offset == target && refreshes == 400, "clock: 2 ms error slewed out in %u refreshes, expected 400",
+          refreshes);
+
+    // Backwards, within the budget, at the step threshold and beyond it
+    offset = vr_clock_correct(0, -50000, elapsed_us, &stepped);
+    CHECK(offset == -budget && !stepped, "clock: negative error moved the offset to %lld", (long long)offset);
+    offset = vr_clock_correct(0, budget - 1, elapsed_us, &stepped);
+    CHECK(offset == budget - 1 && !stepped, "clock: error within the budget not taken exactly");
+    offset = vr_clock_correct(0, VR_CLOCK_STEP_US, elapsed_us, &stepped);
+    CHECK(offset == budget && !stepped, "clock: error of exactly VR_CLOCK_STEP_US stepped");
+    offset = vr_clock_correct(0, VR_CLOCK_STEP_US + 1, elapsed_us, &stepped);
+    CHECK(offset == VR_CLOCK_STEP_US + 1 && stepped, "clock: error past VR_CLOCK_STEP_US not stepped");
+    offset = vr_clock_correct(0, -3600000000ll, elapsed_us, &stepped);
+    CHECK(offset == -3600000000ll && stepped, "clock: clock set back an hour not stepped");
+
+    // A long gap between refreshes earns a proportionally larger slew
+    offset = vr_clock_correct(0, 900000, 1000000000, &stepped);
+    CHECK(offset == 500000 && !stepped, "clock: 1000 s gap slewed %lld us, expected 500000", (long long)offset);
+}
+
+// Log rate limit: one call site driven past VR_LOG_BURST in a window writes
+// the burst, counts the rest as suppressed, and reports them in one
+// "Message repeated N times" line, here when the writer shuts down. stdout
+// is redirected to a file for the duration.
+static void test_log_rate_limit(void) {
+    char path[] = "/tmp/vr_tests_log_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "log: temp file");
+    if (fd < 0) return;
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    vr_log_stats_t before, after;
+    vr_log_get_stats(&before);
+    CHECK(vr_log_init() == 0, "log: writer thread");
+    for (uint32_t i = 0; i < TEST_LOG_RECORDS; i++) {
+        VR_LOG(VR_LOG_INFO, "[TEST] record %u\n", i);
+    }
+    vr_log_shutdown();
+    vr_log_get_stats(&after);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    CHECK(after.suppressed - before.suppressed == TEST_LOG_RECORDS - VR_LOG_BURST,
+          "log: %lu records suppressed, expected %u", after.suppressed - before.suppressed,
+          TEST_LOG_RECORDS - VR_LOG_BURST);
+    CHECK(after.dropped == before.dropped, "log: records dropped on a nearly empty ring");
+
+    char output[4096] = { 0 };
+    FILE *file = fopen(path, "r");
+    size_t len = file ? fread(output, 1, sizeof(output) - 1, file) : 0;
+    if (file) fclose(file);
+    unlink(path);
+    output[len] = '\0';
+
+    uint32_t records = 0;
+    for (const char *p = output; (p = strstr(p, "[TEST] record ")) != NULL; p++) {
+        records++;
+    }
+    char summary[128];
+    snprintf(summary, sizeof(summary), "[TEST] Message repeated %u times (vr_tests.c:",
+             TEST_LOG_RECORDS - VR_LOG_BURST);
+    CHECK(records == VR_LOG_BURST, "log: %u records written, expected %u", records, VR_LOG_BURST);
+    CHECK(strstr(output, "[TEST] record 9\n") && !strstr(output, "[TEST] record 10\n"),
+          "log: not the first %u records written", VR_LOG_BURST);
+    CHECK(strstr(output, summary) != NULL, "log: no \"%s...\" line in:\n%s", summary, output);
+}
+
+typedef struct {
+    vr_log_site_t sites[TEST_LOG_RACE_RECORDS];
+    uint32_t *submitted;       // Records submitted by all producers
+} test_log_producer_t;
+
+static test_log_producer_t g_test_log_producers[TEST_LOG_RACE_ROUNDS][TEST_LOG_RACE_THREADS];
+
+static void *test_log_producer(void *arg) {
+    test_log_producer_t *producer = arg;
+    for (uint32_t i = 0; i < TEST_LOG_RACE_RECORDS; i++) {
+        vr_log_site_t *site = &producer->sites[i];
+        site->file = __FILE__;
+        site->line = __LINE__;
+        site->level = VR_LOG_INFO;
+        vr_log_write(site, "[TEST] race %u\n", i);
+        __atomic_fetch_add(producer->submitted, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+// Log shutdown race: over several init/shutdown rounds, producers keep
+// logging while the writer shuts down, and every record is still either
+// written (queued or directly) or counted as dropped on a full ring, none
+// lost in the ring after its final drain
+static void test_log_shutdown_race(void) {
+    char path[] = "/tmp/vr_tests_log_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "log race: temp file");
+    if (fd < 0) return;
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    vr_log_stats_t before, after;
+    vr_log_get_stats(&before);
+    for (uint32_t round = 0; round < TEST_LOG_RACE_ROUNDS; round++) {
+        uint32_t submitted = 0;
+        pthread_t threads[TEST_LOG_RACE_THREADS];
+        CHECK(vr_log_init() == 0, "log race: writer thread");
+        for (uint32_t t = 0; t < TEST_LOG_RACE_THREADS; t++) {
+            g_test_log_producers[round][t].submitted = &submitted;
+            CHECK(pthread_create(&threads[t], NULL, test_log_producer, &g_test_log_producers[round][t]) == 0,
+                  "log race: producer thread");
+        }
+        // Shut down with the producers in full flow
+        while (__atomic_load_n(&submitted, __ATOMIC_RELAXED) < TEST_LOG_RACE_THREADS * TEST_LOG_RACE_RECORDS / 4) {
+            usleep(100);
+        }
+        vr_log_shutdown();
+        for (uint32_t t = 0; t < TEST_LOG_RACE_THREADS; t++) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    vr_log_get_stats(&after);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    FILE *file = fopen(path, "r");
+    char line[VR_LOG_RECORD_MAX];
+    uint64_t records = 0;
+    while (file && fgets(line, sizeof(line), file)) {
+        records += strncmp(line, "[TEST] race ", 12) == 0;
+    }
+    if (file) fclose(file);
+    unlink(path);
+
+    uint64_t total = (uint64_t)TEST_LOG_RACE_ROUNDS * TEST_LOG_RACE_THREADS * TEST_LOG_RACE_RECORDS;
+    uint64_t dropped = after.dropped - before.dropped;
+    CHECK(after.suppressed == before.suppressed, "log race: records from fresh call sites suppressed");
+    CHECK(records + dropped == total, "log race: %llu records written and %llu dropped of %llu",
+          (unsigned long long)records, (unsigned long long)dropped, (unsigned long long)total);
+}
+
+// Binary frames decode back to the packet; malformed input is rejected
+static void test_binary_round_trip(void) {
+    uint8_t buffer[VR_WIRE_FRAME_SIZE + 16];
+    for (uint32_t i = 0; i < TEST_RANDOM_FRAMES; i++) {
+        vr_telemetry_packet_t packet, decoded;
+        rand_packet(&packet, i);
+        int len = vr_codec_encode_binary(&packet, buffer, sizeof(buffer));
+        CHECK(len == VR_WIRE_FRAME_SIZE, "binary frame %u: length %d", i, len);
+        CHECK(vr_codec_decode_binary(buffer, (size_t)len, &decoded) == len, "binary frame %u: decode", i);
+        CHECK(packets_equal(&packet, &decoded), "binary frame %u: round-trip differs", i);
+
+        // All sections is the complete frame format
+        uint8_t sections[VR_WIRE_FRAME_SIZE + 16];
+        int sections_len = vr_codec_encode_binary_sections(&packet, VR_SECTION_ALL, sections, sizeof(sections));
+        CHECK(sections_len == len && memcmp(sections, buffer, (size_t)len) == 0,
+              "binary frame %u: all-sections encoding differs from the frame", i);
+    }
+
+    vr_telemetry_packet_t packet, decoded;
+    rand_packet(&packet, 0);
+    int len = vr_codec_encode_binary(&packet, buffer, sizeof(buffer));
+    CHECK(vr_codec_encode_binary(&packet, buffer, VR_WIRE_FRAME_SIZE - 1) < 0, "binary: short buffer accepted");
+    CHECK(vr_codec_decode_binary(buffer, (size_t)len - 1, &decoded) < 0, "binary: truncated frame accepted");
+    buffer[0] ^= 0xFF;
+    CHECK(vr_codec_decode_binary(buffer, (size_t)len, &decoded) < 0, "binary: bad magic accepted");
+    buffer[0] ^= 0xFF;
+    buffer[2] = VR_WIRE_VERSION + 1;
+    CHECK(vr_codec_decode_binary(buffer, (size_t)len, &decoded) < 0, "binary: bad version accepted");
+}
+
+// Capture files: records written are read back with their sample times, a
+// frame_id offered twice in a row is recorded once, and a truncated file
+// opens with the header count clamped to its complete records
+static void test_capture_round_trip(void) {
+    char path[] = "/tmp/vr_tests_capture_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "capture: temp file");
+    if (fd < 0) return;
+    close(fd);
+
+    vr_capture_t cap;
+    static vr_telemetry_packet_t frames[TEST_CAPTURE_FRAMES];
+    CHECK(vr_capture_create(&cap, path) == 0, "capture: create");
+    for (uint32_t i = 0; i < TEST_CAPTURE_FRAMES; i++) {
+        rand_packet(&frames[i], i + 3);
+        frames[i].frame_id = 100 + i;
+        frames[i].monotonic_us = 5000000 + (uint64_t)i * 11111;
+        CHECK(vr_capture_append(&cap, &frames[i]) == 0, "capture: append %u", i);
+        CHECK(vr_capture_append(&cap, &frames[i]) == 0, "capture: append duplicate %u", i);
+    }
+    CHECK(cap.count == TEST_CAPTURE_FRAMES, "capture: %lu records, duplicates not skipped", cap.count);
+    vr_capture_close(&cap);
+
+    CHECK(vr_capture_open(&cap, path) == 0, "capture: open");
+    CHECK(cap.count == TEST_CAPTURE_FRAMES, "capture: reopened with %lu records", cap.count);
+    CHECK(cap.map_size == VR_CAPTURE_HEADER_SIZE + (size_t)TEST_CAPTURE_FRAMES * VR_CAPTURE_RECORD_SIZE,
+          "capture: closed file is %zu bytes, not trimmed to its records", cap.map_size);
+    CHECK(cap.first_timestamp_us == frames[0].timestamp_us &&
+          cap.last_timestamp_us == frames[TEST_CAPTURE_FRAMES - 1].timestamp_us &&
+          cap.first_monotonic_us == frames[0].monotonic_us &&
+          cap.last_monotonic_us == frames[TEST_CAPTURE_FRAMES - 1].monotonic_us,
+          "capture: header time range differs");
+    for (uint32_t i = 0; i < TEST_CAPTURE_FRAMES; i++) {
+        vr_telemetry_packet_t packet;
+        CHECK(vr_capture_read(&cap, i, &packet) == 0 && packets_equal(&packet, &frames[i]) &&
+              packet.monotonic_us == frames[i].monotonic_us, "capture: record %u differs", i);
+    }
+    vr_telemetry_packet_t packet;
+    CHECK(vr_capture_read(&cap, TEST_CAPTURE_FRAMES, &packet) < 0, "capture: read past the end accepted");
+    vr_capture_close(&cap);
+
+    // Cut the file inside record 10: the header still says 40
+    off_t cut = VR_CAPTURE_HEADER_SIZE + 10 * VR_CAPTURE_RECORD_SIZE + VR_CAPTURE_RECORD_SIZE / 2;
+    CHECK(truncate(path, cut) == 0, "capture: truncate");
+    CHECK(vr_capture_open(&cap, path) == 0, "capture: open truncated");
+    CHECK(cap.count == 10, "capture: truncated file opened with %lu records, expected 10", cap.count);
+    CHECK(vr_capture_read(&cap, 9, &packet) == 0 && packets_equal(&packet, &frames[9]),
+          "capture: last complete record of a truncated file differs");
+    CHECK(vr_capture_read(&cap, 10, &packet) < 0, "capture: partial record readable");
+    vr_capture_close(&cap);
+
+    // Not a capture file
+    CHECK(truncate(path, 0) == 0 && truncate(path, VR_CAPTURE_HEADER_SIZE) == 0, "capture: zero the file");
+    CHECK(vr_capture_open(&cap, path) < 0, "capture: file without magic accepted");
+    unlink(path);
+}
+
+// Flip one byte of a calibration cache file
+static void corrupt_byte(const char *path, long offset) {
+    FILE *file = fopen(path, "r+b");
+    if (!file) return;
+    fseek(file, offset, SEEK_SET);
+    int c = fgetc(file);
+    fseek(file, offset, SEEK_SET);
+    fputc(c ^ 0x01, file);
+    fclose(file);
+}
+
+// Calibration cache: a saved calibration loads back unchanged; a flipped
+// byte, a truncated file, another version, another sensor rate or an
+// expired measurement is refused, and measuring and saving again (what
+// vr_sensors_calibrate() falls back to) makes the cache loadable
+static void test_calibration_cache(void) {
+    char path[] = "/tmp/vr_tests_calibration_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "calibration: temp file");
+    if (fd < 0) return;
+    close(fd);
+
+    vr_calibration_t cal, loaded;
+    CHECK(vr_calibration_measure(&cal, 1000, 5) == 0, "calibration: measure");
+    CHECK(vr_calibration_save(&cal, path) == 0, "calibration: save");
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(vr_calibration_load(&loaded, path, 1000) == 0 && memcmp(&loaded, &cal, sizeof(cal)) == 0,
+          "calibration: round trip differs");
+    CHECK(vr_calibration_load(&loaded, path, 500) < 0, "calibration: cache of another sensor rate accepted");
+
+    // Magic, version, size, rate, offsets, measurement time and the checksum itself
+    static const long corrupted[] = { 0, 4, 6, 8, 17, 30, 41, 48 };
+    for (uint32_t i = 0; i < sizeof(corrupted) / sizeof(corrupted[0]); i++) {
+        corrupt_byte(path, corrupted[i]);
+        CHECK(vr_calibration_load(&loaded, path, 1000) < 0, "calibration: cache corrupt at byte %ld accepted",
+              corrupted[i]);
+        corrupt_byte(path, corrupted[i]);
+    }
+    CHECK(vr_calibration_load(&loaded, path, 1000) == 0, "calibration: restored cache refused");
+
+    // Another version with a valid checksum
+    uint8_t data[VR_CALIBRATION_FILE_SIZE];
+    FILE *file = fopen(path, "rb");
+    CHECK(file && fread(data, 1, sizeof(data), file) == sizeof(data), "calibration: read back");
+    if (file) fclose(file);
+    data[4] = VR_CALIBRATION_VERSION + 1;
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 48; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    for (int i = 0; i < 4; i++) {
+        data[48 + i] = (uint8_t)(hash >> (8 * i));
+    }
+    file = fopen(path, "wb");
+    CHECK(file && fwrite(data, 1, sizeof(data), file) == sizeof(data), "calibration: write version");
+    if (file) fclose(file);
+    CHECK(vr_calibration_load(&loaded, path, 1000) < 0, "calibration: cache of version %d accepted",
+          VR_CALIBRATION_VERSION + 1);
+
+    // Truncated, then expired
+    CHECK(vr_calibration_save(&cal, path) == 0 && truncate(path, VR_CALIBRATION_FILE_SIZE - 1) == 0,
+          "calibration: truncate");
+    CHECK(vr_calibration_load(&loaded, path, 1000) < 0, "calibration: truncated cache accepted");
+    vr_calibration_t stale = cal;
+    stale.measured_us -= ((uint64_t)VR_CALIBRATION_MAX_AGE_S + 1) * 1000000;
+    CHECK(vr_calibration_save(&stale, path) == 0, "calibration: save stale");
+    CHECK(vr_calibration_load(&loaded, path, 1000) < 0, "calibration: expired cache accepted");
+
+    // Fall back: measure again and replace the cache
+    CHECK(vr_calibration_measure(&cal, 1000, 5) == 0 && vr_calibration_save(&cal, path) == 0,
+          "calibration: measure and save after a refused cache");
+    CHECK(vr_calibration_load(&loaded, path, 1000) == 0 && loaded.measured_us == cal.measured_us,
+          "calibration: remeasured cache refused");
+    unlink(path);
+    CHECK(vr_calibration_load(&loaded, path, 1000) < 0, "calibration: missing cache accepted");
+}
+
+// Load generator lists: comma-separated positive integers, at most
+// VR_LOADGEN_MAX_VALUES; anything else fails and leaves count untouched
+static void test_loadgen_parse_list(void) {
+    static const struct {
+        const char *arg;
+        uint32_t count;            // 0 = rejected
+        uint32_t values[3];
+    } cases[] = {
+        { "1", 1, { 1 } },
+        { "1,10,100", 3, { 1, 10, 100 } },
+        { "4294967295", 1, { 4294967295u } },
+        { "007,8", 2, { 7, 8 } },
+        { "", 0, { 0 } },
+        { ",", 0, { 0 } },
+        { "1,", 0, { 0 } },
+        { ",1", 0, { 0 } },
+        { "1,,2", 0, { 0 } },
+        { "0", 0, { 0 } },
+        { "1,0", 0, { 0 } },
+        { "-1", 0, { 0 } },
+        { "+1", 0, { 0 } },
+        { " 1", 0, { 0 } },
+        { "1 ,2", 0, { 0 } },
+        { "1;2", 0, { 0 } },
+        { "1.5", 0, { 0 } },
+        { "0x10", 0, { 0 } },
+        { "4294967296", 0, { 0 } },
+        { "99999999999999999999", 0, { 0 } },
+        { "1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17", 0, { 0 } },
+    };
+
+    for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint32_t values[VR_LOADGEN_MAX_VALUES] = { 0 };
+        uint32_t count = 12345;
+        int result = vr_loadgen_parse_list(cases[c].arg, values, &count);
+        if (cases[c].count == 0) {
+            CHECK(result < 0 && count == 12345, "loadgen: \"%s\" accepted", cases[c].arg);
+            continue;
+        }
+        bool same = result == 0 && count == cases[c].count;
+        for (uint32_t i = 0; same && i < count; i++) {
+            same = values[i] == cases[c].values[i];
+        }
+        CHECK(same, "loadgen: \"%s\" parsed to %u values (result %d)", cases[c].arg, count, result);
+    }
+
+    uint32_t values[VR_LOADGEN_MAX_VALUES], count = 0;
+    CHECK(vr_loadgen_parse_list("1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16", values, &count) == 0 &&
+          count == VR_LOADGEN_MAX_VALUES && values[15] == 16, "loadgen: %u-value list rejected", VR_LOADGEN_MAX_VALUES);
+    CHECK(vr_loadgen_parse_list(NULL, values, &count) < 0, "loadgen: NULL list accepted");
+}
+
+// Per-device routing keys: the id goes before the last segment, and a key
+// that does not fit the buffer fails instead of being truncated
+static void test_device_routing_key(void) {
+    static const struct {
+        const char *base;
+        uint32_t id;
+        size_t size;
+        const char *expected;      // NULL = rejected
+    } cases[] = {
+        { "telemetry.data", 7, VR_ROUTING_KEY_MAX, "telemetry.7.data" },
+        { "telemetry.data", 0, VR_ROUTING_KEY_MAX, "telemetry.0.data" },
+        { "telemetry.data", UINT32_MAX, VR_ROUTING_KEY_MAX, "telemetry.4294967295.data" },
+        { "vr.telemetry.pose", 12, VR_ROUTING_KEY_MAX, "vr.telemetry.12.pose" },
+        { "telemetry", 3, VR_ROUTING_KEY_MAX, "telemetry.3" },
+        { "telemetry.", 3, VR_ROUTING_KEY_MAX, "telemetry.3." },
+        { ".data", 3, VR_ROUTING_KEY_MAX, ".3.data" },
+        { "", 3, VR_ROUTING_KEY_MAX, ".3" },
+        { "telemetry.data", 42, sizeof("telemetry.42.data"), "telemetry.42.data" },
+        { "telemetry.data", 42, sizeof("telemetry.42.data") - 1, NULL },
+        { "telemetry", 42, sizeof("telemetry.42") - 1, NULL },
+        { "telemetry.data", 42, 1, NULL },
+    };
+
+    for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        char key[VR_ROUTING_KEY_MAX];
+        int result = vr_device_format_routing_key(cases[c].base, cases[c].id, key, cases[c].size);
+        if (!cases[c].expected) {
+            CHECK(result < 0, "routing key: \"%s\" for device %u fit %zu bytes", cases[c].base, cases[c].id,
+                  cases[c].size);
+        } else {
+            CHECK(result == 0 && strcmp(key, cases[c].expected) == 0, "routing key: \"%s\" for device %u gave "
+                  "\"%s\" (result %d), expected \"%s\"", cases[c].base, cases[c].id, result == 0 ? key : "",
+                  result, cases[c].expected);
+        }
+    }
+
+    char key[VR_ROUTING_KEY_MAX];
+    CHECK(vr_device_format_routing_key(NULL, 1, key, sizeof(key)) < 0 &&
+          vr_device_format_routing_key("telemetry.data", 1, NULL, sizeof(key)) < 0 &&
+          vr_device_format_routing_key("telemetry.data", 1, key, 0) < 0, "routing key: missing argument accepted");
+}
+
+// Compare the JSON fast path against snprintf for one packet
+static void check_json(const vr_telemetry_packet_t *packet, const char *what) {
+    char fast[VR_JSON_MAX_SIZE * 4], reference[VR_JSON_MAX_SIZE * 4];
+    int fast_len = vr_codec_encode_json(packet, fast, sizeof(fast));
+    int reference_len = vr_codec_encode_json_printf(packet, reference, sizeof(reference));
+    CHECK(fast_len == reference_len && strcmp(fast, reference) == 0,
+          "json %s differs:\n  fast:   %s\n  printf: %s", what, fast, reference);
+
+    // A buffer one byte short must fail rather than truncate
+    if (reference_len > 0 && reference_len < VR_JSON_MAX_SIZE) {
+        char small[VR_JSON_MAX_SIZE];
+        CHECK(vr_codec_encode_json(packet, small, (size_t)reference_len) < 0,
+              "json %s: %d-byte buffer accepted for %d bytes", what, reference_len, reference_len);
+        CHECK(vr_codec_encode_json(packet, small, (size_t)reference_len + 1) == reference_len,
+              "json %s: exact-size buffer rejected", what);
+    }
+}
+
+// The JSON fast path is byte-identical to vr_codec_encode_json_printf,
+// including rounding ties, huge values and non-finite floats
+static void test_json_fast_path(void) {
+    static const float edges[] = {
+        0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 0.0000005f, -0.0000005f, 0.0000015f, 0.0000025f,
+        0.005f, 0.015f, 0.125f, 1e-7f, -1e-7f, 123456.789f, 9999999.0f, 1e10f, -1e10f,
+        2147483647.0f, 4294967296.0f, 1e18f, FLT_MAX, -FLT_MAX, FLT_MIN, FLT_EPSILON,
+        INFINITY, -INFINITY, NAN,
+    };
+    const uint32_t edge_count = sizeof(edges) / sizeof(edges[0]);
+
+    vr_telemetry_packet_t packet;
+    char what[64];
+    for (uint32_t i = 0; i < edge_count; i++) {
+        rand_packet(&packet, i);
+        float values[VR_PACKET_FLOATS];
+        for (int f = 0; f < VR_PACKET_FLOATS; f++) {
+            values[f] = edges[(i + (uint32_t)f) % edge_count];
+        }
+        vr_packet_set_floats(&packet, values);
+        snprintf(what, sizeof(what), "edge set %u", i);
+        check_json(&packet, what);
+    }
+
+    // Random bit patterns cover every exponent; values near the 6- and
+    // 2-decimal rounding boundaries cover ties
+    for (uint32_t i = 0; i < TEST_JSON_VALUES / VR_PACKET_FLOATS; i++) {
+        rand_packet(&packet, i);
+        float values[VR_PACKET_FLOATS];
+        for (int f = 0; f < VR_PACKET_FLOATS; f++) {
+            uint32_t bits = rand_u32();
+            switch (bits % 3) {
+                case 0:  memcpy(&values[f], &bits, sizeof(float)); break;
+                case 1:  values[f] = (float)((int32_t)rand_u32() % 2000000) / 1e6f + 5e-7f; break;
+                default: values[f] = (float)((int32_t)rand_u32() % 20000) / 100.0f + 0.005f; break;
+            }
+        }
+        vr_packet_set_floats(&packet, values);
+        snprintf(what, sizeof(what), "random set %u", i);
+        check_json(&packet, what);
+    }
+
+    // Batches are the frames joined into an array; a short buffer fails
+    vr_telemetry_packet_t frames[3];
+    char batch[VR_JSON_MAX_SIZE * 4], frame[VR_JSON_MAX_SIZE];
+    for (uint32_t i = 0; i < 3; i++) {
+        rand_packet(&frames[i], i);
+    }
+    int len = vr_codec_encode_json_batch(frames, 3, VR_SECTION_ALL, batch, sizeof(batch));
+    CHECK(len > 0 && batch[0] == '[' && batch[len - 1] == ']', "json batch: not an array");
+    int first = vr_codec_encode_json(&frames[0], frame, sizeof(frame));
+    CHECK(first > 0 && strncmp(batch + 1, frame, (size_t)first) == 0 && batch[first + 1] == ',',
+          "json batch: first element differs from the single-frame encoding");
+    CHECK(vr_codec_encode_json_batch(frames, 3, VR_SECTION_ALL, batch, (size_t)len) < 0,
+          "json batch: short buffer accepted");
+}
+
+// Every SIMD build of the synthesis kernel the CPU supports produces
+// bit-identical samples, and each stays close to the scalar reference.
+// Times span long runs and block tails (the count is not a lane multiple).
+static void test_synth_isas(void) {
+    static const char *const isas[] = { "avx2", "sse2", "neon", "generic" };
+    static float times[TEST_SYNTH_SAMPLES];
+    static vr_telemetry_packet_t reference[TEST_SYNTH_SAMPLES], first[TEST_SYNTH_SAMPLES], out[TEST_SYNTH_SAMPLES];
+    static vr_telemetry_packet_t *reference_ptrs[TEST_SYNTH_SAMPLES], *out_ptrs[TEST_SYNTH_SAMPLES];
+    for (uint32_t i = 0; i < TEST_SYNTH_SAMPLES; i++) {
+        times[i] = (float)i * 0.0137f + (float)(i % 7) * 1500.0f;
+        reference_ptrs[i] = &reference[i];
+        out_ptrs[i] = &out[i];
+    }
+    memset(reference, 0, sizeof(reference));
+    CHECK(vr_synth_select("scalar") == 0, "synth: scalar kernel not selectable");
+    vr_synth_samples(times, reference_ptrs, TEST_SYNTH_SAMPLES);
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    CHECK((vr_synth_select("avx2") == 0) == avx2, "synth: avx2 selectable %d, CPU support %d",
+          vr_synth_select("avx2") == 0, avx2);
+#endif
+
+    const char *first_isa = NULL;
+    for (uint32_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+        if (vr_synth_select(isas[k]) != 0) continue;
+        CHECK(strcmp(vr_synth_get_isa(), isas[k]) == 0, "synth: selected %s, running %s", isas[k], vr_synth_get_isa());
+        memset(out, 0, sizeof(out));
+        vr_synth_samples(times, out_ptrs, TEST_SYNTH_SAMPLES);
+
+        if (!first_isa) {
+            first_isa = isas[k];
+            memcpy(first, out, sizeof(out));
+        } else {
+            CHECK(memcmp(out, first, sizeof(out)) == 0, "synth: %s samples are not bit-identical to %s",
+                  isas[k], first_isa);
+        }
+
+        float max_error = 0.0f;
+        bool flags_ok = true;
+        for (uint32_t i = 0; i < TEST_SYNTH_SAMPLES; i++) {
+            float a[VR_PACKET_FLOATS], b[VR_PACKET_FLOATS];
+            vr_packet_get_floats(&out[i], a);
+            vr_packet_get_floats(&reference[i], b);
+            for (int f = 0; f < VR_PACKET_FLOATS; f++) {
+                float error = fabsf(a[f] - b[f]) / (1.0f + fabsf(b[f]));
+                if (error > max_error) max_error = error;
+            }
+            flags_ok &= out[i].flags == reference[i].flags && out[i].battery_level == reference[i].battery_level;
+        }
+        CHECK(max_error < 1e-5f, "synth: %s differs from the scalar reference by %g", isas[k], max_error);
+        CHECK(flags_ok, "synth: %s flags or battery differ from the scalar reference", isas[k]);
+    }
+    CHECK(first_isa != NULL, "synth: no vectorized kernel selectable");
+    vr_synth_select("auto");
+}
+
+// Print bytes as lowercase hex
+static void dump_hex(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        printf("%02x", data[i]);
+    }
+}
+
+// Print the packets a message was encoded from; %.9g round-trips a float
+static void dump_packets(const vr_telemetry_packet_t *packets, uint32_t count) {
+    printf("\"packets\":[");
+    for (uint32_t i = 0; i < count; i++) {
+        float values[VR_PACKET_FLOATS];
+        vr_packet_get_floats(&packets[i], values);
+        printf("%s{\"timestamp_us\":%lu,\"frame_id\":%u,\"battery_level\":%u,\"flags\":%u,\"floats\":[",
+               i ? "," : "", packets[i].timestamp_us, packets[i].frame_id,
+               packets[i].battery_level, packets[i].flags);
+        for (int f = 0; f < VR_PACKET_FLOATS; f++) {
+            printf("%s%.9g", f ? "," : "", values[f]);
+        }
+        printf("]}");
+    }
+    printf("]");
+}
+
+// One dump record: a message body and what it was encoded from
+static void dump_message(const char *name, const char *content_type, uint8_t sections,
+                         const uint8_t *body, size_t len,
+                         const vr_telemetry_packet_t *packets, uint32_t count) {
+    printf("{\"name\":\"%s\",\"content_type\":\"%s\",\"sections\":%u,\"body\":\"",
+           name, content_type, sections);
+    dump_hex(body, len);
+    printf("\",");
+    dump_packets(packets, count);
+    printf("}\n");
+}
+
+// One delta dump record, with the quantized fields the decoder must reproduce
+static void dump_delta(const char *name, const char *stream, bool dropped, vr_delta_encoder_t *enc,
+                       const vr_telemetry_packet_t *packets, uint32_t count, uint8_t sections) {
+    static uint8_t body[VR_WIRE_DELTA_HEADER_SIZE + VR_BATCH_MAX_FRAMES * VR_DELTA_MAX_FRAME_SIZE];
+    int len = vr_delta_encode_batch(enc, packets, count, sections, body, sizeof(body));
+    CHECK(len > 0, "delta %s: encode failed", name);
+    if (len <= 0) return;
+
+    printf("{\"name\":\"%s\",\"content_type\":\"%s\",\"sections\":%u,\"stream\":\"%s\",\"dropped\":%s,"
+           "\"position_um\":%u,\"quat_bits\":%u,\"body\":\"",
+           name, VR_CONTENT_TYPE_BINARY, sections, stream, dropped ? "true" : "false",
+           enc->position_um, enc->quat_bits);
+    dump_hex(body, (size_t)len);
+    printf("\",\"quant\":[");
+    for (uint32_t i = 0; i < count; i++) {
+        vr_quant_frame_t frame;
+        vr_delta_quantize(enc, &packets[i], &frame);
+        printf("%s[", i ? "," : "");
+        for (int f = 0; f < VR_QUANT_FIELDS; f++) {
+            printf("%s%ld", f ? "," : "", frame.fields[f]);
+        }
+        printf("]");
+    }
+    printf("],");
+    dump_packets(packets, count);
+    printf("}\n");
+}
+
+// Write every wire format and section mask for tests/test_wire.py
+static void dump_wire_formats(void) {
+    static vr_telemetry_packet_t frames[TEST_RANDOM_FRAMES];
+    static uint8_t body[VR_BATCH_MAX_MESSAGE_SIZE];
+    char name[64];
+
+    // Simulated sensor data first, then random frames with edge cases
+    vr_device_t device;
+    vr_device_init(&device, 0, 1000);
+    for (uint32_t i = 0; i < TEST_RANDOM_FRAMES / 2; i++) {
+        for (int step = 0; step < 16; step++) {
+            vr_device_update(&device);
+        }
+        frames[i] = device.packet;
+    }
+    for (uint32_t i = TEST_RANDOM_FRAMES / 2; i < TEST_RANDOM_FRAMES; i++) {
+        rand_packet(&frames[i], i - TEST_RANDOM_FRAMES / 2);
+    }
+
+    for (uint32_t i = 0; i < TEST_RANDOM_FRAMES; i += 7) {
+        int len = vr_codec_encode_json(&frames[i], (char *)body, sizeof(body));
+        snprintf(name, sizeof(name), "json_frame_%u", i);
+        dump_message(name, VR_CONTENT_TYPE_JSON, VR_SECTION_ALL, body, (size_t)len, &frames[i], 1);
+        len = vr_codec_encode_binary(&frames[i], body, sizeof(body));
+        snprintf(name, sizeof(name), "binary_frame_%u", i);
+        dump_message(name, VR_CONTENT_TYPE_BINARY, VR_SECTION_ALL, body, (size_t)len, &frames[i], 1);
+    }
+
+    for (uint8_t sections = 1; sections <= VR_SECTION_ALL; sections++) {
+        const vr_telemetry_packet_t *batch = &frames[sections * 3];
+        uint32_t count = 1 + sections % 4;
+        int len = vr_codec_encode_json_sections(batch, sections, (char *)body, sizeof(body));
+        snprintf(name, sizeof(name), "json_sections_%x", sections);
+        dump_message(name, VR_CONTENT_TYPE_JSON, sections, body, (size_t)len, batch, 1);
+        len = vr_codec_encode_binary_sections(batch, sections, body, sizeof(body));
+        snprintf(name, sizeof(name), "binary_sections_%x", sections);
+        dump_message(name, VR_CONTENT_TYPE_BINARY, sections, body, (size_t)len, batch, 1);
+        len = vr_codec_encode_json_batch(batch, count, sections, (char *)body, sizeof(body));
+        snprintf(name, sizeof(name), "json_batch_%x", sections);
+        dump_message(name, VR_CONTENT_TYPE_JSON, sections, body, (size_t)len, batch, count);
+        len = vr_codec_encode_binary_batch(batch, count, sections, body, sizeof(body));
+        snprintf(name, sizeof(name), "binary_batch_%x", sections);
+        dump_message(name, VR_CONTENT_TYPE_BINARY, sections, body, (size_t)len, batch, count);
+    }
+
+    // Delta: every section mask of random frames at the resolution extremes,
+    // each its own stream
+    static const uint32_t resolutions[][2] = { { 1, 16 }, { 1000, 12 }, { 65535, 2 } };
+    for (uint8_t sections = 1; sections <= VR_SECTION_ALL; sections++) {
+        for (uint32_t r = 0; r < 3; r++) {
+            vr_delta_encoder_t enc;
+            vr_delta_init(&enc, 4, resolutions[r][0], resolutions[r][1]);
+            snprintf(name, sizeof(name), "delta_%x_%uum_%ubit", sections, resolutions[r][0], resolutions[r][1]);
+            dump_delta(name, name, false, &enc, &frames[TEST_RANDOM_FRAMES / 2 + sections], 12, sections);
+        }
+    }
+
+    // One stream across messages: keyframes every 4 frames, a lost message
+    // (decoding resumes at the next keyframe), the sequence wrapping, and a
+    // forced keyframe
+    vr_delta_encoder_t enc;
+    vr_delta_init(&enc, 4, VR_DELTA_DEFAULT_POSITION_UM, VR_DELTA_DEFAULT_QUAT_BITS);
+    enc.sequence = UINT16_MAX - 2;
+    dump_delta("delta_stream_0", "stream", false, &enc, &frames[0], 3, VR_SECTION_ALL);
+    dump_delta("delta_stream_1_lost", "stream", true, &enc, &frames[3], 3, VR_SECTION_ALL);
+    dump_delta("delta_stream_2", "stream", false, &enc, &frames[6], 3, VR_SECTION_ALL);
+    dump_delta("delta_stream_3", "stream", false, &enc, &frames[9], 3, VR_SECTION_ALL);
+    vr_delta_force_keyframe(&enc);
+    dump_delta("delta_stream_4", "stream", false, &enc, &frames[13], 3, VR_SECTION_ALL);
+    dump_delta("delta_stream_5", "stream", false, &enc, &frames[40], 20, VR_SECTION_ALL);
+}
+
+int main(int argc, char *argv[]) {
+    vr_clock_init();
+    vr_synth_select("auto");
+
+    if (argc > 1 && strcmp(argv[1], "--dump") == 0) {
+        dump_wire_formats();
+        return g_failures == 0 ? 0 : 1;
+    }
+    if (argc > 1) {
+        printf("Usage: %s [--dump]\n", argv[0]);
+        return 1;
+    }
+
+    test_ring_overflow(VR_RING_DROP_OLDEST);
+    test_ring_overflow(VR_RING_DROP_NEWEST);
+    test_ring_stress(VR_RING_DROP_OLDEST);
+    test_ring_stress(VR_RING_DROP_NEWEST);
+    test_snapshot_stress();
+    test_packet_columns();
+    test_history_window();
+    test_filter_response();
+    test_ratectl_aimd();
+    test_scheduler_deadlines();
+    test_clock_slew();
+    test_log_rate_limit();
+    test_log_shutdown_race();
+    test_binary_round_trip();
+    test_capture_round_trip();
+    test_calibration_cache();
+    test_json_fast_path();
+    test_device_routing_key();
+    test_synth_isas();
+    test_loadgen_parse_list();
+
+    printf("[TEST] %u checks, %u failures\n", g_checks, g_failures);
+    return g_failures == 0 ? 0 : 1;
+}